@@ -0,0 +1,116 @@
+#include "cgi_cache.hpp"
+#include "cgi_response.hpp"
+#include "../utils/server_clock.hpp"
+#include <cstdlib>
+#include <cctype>
+
+CGICache::CGICache(long long ttlMs, long long staleMs, size_t maxBytes, size_t maxEntryBytes)
+    : ttlMs_(ttlMs), staleMs_(staleMs), maxBytes_(maxBytes), maxEntryBytes_(maxEntryBytes),
+      bytes_(0), hits_(0), staleHits_(0), misses_(0) {
+    if (maxEntryBytes_ > maxBytes_)
+        maxEntryBytes_ = maxBytes_;
+}
+
+// host names are case-insensitive, the path & query are not
+std::string CGICache::makeKey(const std::string& method, const std::string& host,
+                              const std::string& uri, const std::string& query) {
+    std::string key;
+    key.reserve(method.size() + host.size() + uri.size() + query.size() + 3);
+    key += method;
+    key += ' ';
+    for (size_t i = 0; i < host.size(); ++i)
+        key += static_cast<char>(std::tolower(static_cast<unsigned char>(host[i])));
+    key += ' ';
+    key += uri;
+    if (!query.empty()) {
+        key += '?';
+        key += query;
+    }
+    return key;
+}
+
+CGICache::Result CGICache::lookup(const std::string& key, long long nowMs, std::string& response) {
+    std::map<std::string, EntryList::iterator>::iterator it = index_.find(key);
+    if (it == index_.end()) {
+        ++misses_;
+        return MISS;
+    }
+    if (nowMs >= it->second->staleUntilMs) {
+        erase(it->second);
+        ++misses_;
+        return MISS;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    response = it->second->response;
+    if (nowMs >= it->second->expiresMs) {
+        ++staleHits_;
+        return STALE;
+    }
+    ++hits_;
+    return FRESH;
+}
+
+void CGICache::store(const std::string& key, const std::string& response, long long ttlMs, long long nowMs) {
+    if (ttlMs <= 0 || key.size() + response.size() > maxEntryBytes_)
+        return;
+    std::map<std::string, EntryList::iterator>::iterator old = index_.find(key);
+    if (old != index_.end())
+        erase(old->second);
+
+    Entry entry;
+    entry.key = key;
+    entry.response = response;
+    entry.expiresMs = nowMs + ttlMs;
+    entry.staleUntilMs = entry.expiresMs + staleMs_;
+    size_t size = entrySize(entry);
+    while (!lru_.empty() && bytes_ + size > maxBytes_)
+        erase(--lru_.end());
+
+    lru_.push_front(entry);
+    index_[key] = lru_.begin();
+    bytes_ += size;
+}
+
+void CGICache::erase(EntryList::iterator entry) {
+    bytes_ -= entrySize(*entry);
+    index_.erase(entry->key);
+    lru_.erase(entry);
+}
+
+/* the script's own freshness wins over the configured TTL, anything personal is never shared */
+long long CGICache::freshnessMs(const CGIResponse& response, long long defaultTtlMs, time_t now) {
+    int status = response.getStatusCode();
+    if (status != 200 && status != 301 && status != 302)
+        return -1;
+    if (response.hasHeader("set-cookie") || response.hasHeader("vary"))
+        return -1;
+
+    std::string control = response.getHeader("cache-control");
+    for (size_t i = 0; i < control.size(); ++i)
+        control[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(control[i])));
+    if (!control.empty()) {
+        if (control.find("no-store") != std::string::npos
+            || control.find("no-cache") != std::string::npos
+            || control.find("private") != std::string::npos)
+            return -1;
+        size_t pos = control.find("s-maxage=");
+        size_t skip = 9;
+        if (pos == std::string::npos) {
+            pos = control.find("max-age=");
+            skip = 8;
+        }
+        if (pos != std::string::npos) {
+            long seconds = std::strtol(control.c_str() + pos + skip, NULL, 10);
+            return seconds > 0 ? static_cast<long long>(seconds) * 1000 : -1;
+        }
+    }
+
+    if (response.hasHeader("expires")) {
+        // an invalid date means already expired (RFC 7234 5.3)
+        time_t expires = ServerClock::parseHttpDate(response.getHeader("expires"));
+        if (expires == -1 || expires <= now)
+            return -1;
+        return static_cast<long long>(expires - now) * 1000;
+    }
+    return defaultTtlMs;
+}
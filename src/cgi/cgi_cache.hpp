@@ -0,0 +1,95 @@
+#ifndef CGI_CACHE_HPP
+#define CGI_CACHE_HPP
+
+#include <string>
+#include <map>
+#include <list>
+#include <ctime>
+
+class CGIResponse;
+
+/**
+ * @brief CGI响应微缓存（cgi_cache，每个location一个）
+ *
+ * 缓存完整的HTTP响应字符串，key 为 方法 + Host + URI + 查询串：
+ *   - 新鲜期：响应的 Cache-Control(s-maxage/max-age) > Expires > 配置的TTL
+ *   - 不缓存：非 200/301/302、Set-Cookie、Vary、no-store/no-cache/private
+ *   - 总字节数超过上限时按LRU淘汰，单个响应超过 maxEntryBytes 不缓存
+ *   - 过期后 staleMs 内仍保留，lookup 返回 STALE（调用者返回旧响应并后台刷新）
+ * 时间统一用 ServerClock 的单调毫秒
+ */
+class CGICache {
+public:
+    /**
+     * @brief lookup() 的结果
+     */
+    enum Result {
+        MISS,       // 没有或已超过stale窗口
+        FRESH,      // 新鲜
+        STALE       // 已过期，但在stale窗口内
+    };
+
+    CGICache(long long ttlMs, long long staleMs, size_t maxBytes, size_t maxEntryBytes);
+
+    /**
+     * @brief 构建缓存key
+     */
+    static std::string makeKey(const std::string& method, const std::string& host,
+                               const std::string& uri, const std::string& query);
+
+    /**
+     * @brief 查找响应，命中（FRESH/STALE）时移到LRU头部
+     *
+     * @param response 输出参数，命中时为缓存的完整HTTP响应
+     */
+    Result lookup(const std::string& key, long long nowMs, std::string& response);
+
+    /**
+     * @brief 存入响应（替换同key的旧响应）
+     *
+     * @param ttlMs 新鲜期（freshnessMs() 的结果），<= 0 时不存
+     */
+    void store(const std::string& key, const std::string& response, long long ttlMs, long long nowMs);
+
+    /**
+     * @brief 根据CGI响应headers计算新鲜期
+     *
+     * @param response 解析后的CGI响应
+     * @param defaultTtlMs 响应没有声明时使用的TTL（配置值）
+     * @param now 当前墙上时间（Expires 比较用）
+     * @return 新鲜期（毫秒），-1 表示不可缓存
+     */
+    static long long freshnessMs(const CGIResponse& response, long long defaultTtlMs, time_t now);
+
+    long long ttlMs() const { return ttlMs_; }
+    size_t entryCount() const { return index_.size(); }
+    size_t bytes() const { return bytes_; }
+    size_t hits() const { return hits_; }
+    size_t staleHits() const { return staleHits_; }
+    size_t misses() const { return misses_; }
+
+private:
+    struct Entry {
+        std::string key;
+        std::string response;
+        long long expiresMs;
+        long long staleUntilMs;
+    };
+    typedef std::list<Entry> EntryList;
+
+    long long ttlMs_;
+    long long staleMs_;
+    size_t maxBytes_;
+    size_t maxEntryBytes_;
+    size_t bytes_;
+    size_t hits_;
+    size_t staleHits_;
+    size_t misses_;
+    EntryList lru_;                                 // 头部为最近使用
+    std::map<std::string, EntryList::iterator> index_;
+
+    void erase(EntryList::iterator entry);
+    static size_t entrySize(const Entry& entry) { return entry.key.size() + entry.response.size(); }
+};
+
+#endif // CGI_CACHE_HPP
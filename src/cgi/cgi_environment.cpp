@@ -1,8 +1,9 @@
 #include "cgi_environment.hpp"
-#include <sstream>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 
-CGIEnvironment::CGIEnvironment() {
+CGIEnvironment::CGIEnvironment() : mapBuilt_(false) {
 }
 
 CGIEnvironment::~CGIEnvironment() {
@@ -15,34 +16,44 @@ void CGIEnvironment::setupEnvironment(const HttpRequest& request,
     (void)serverRoot; // 暂时未使用，避免编译警告
     clear();
 
-    // 添加标准CGI环境变量
+    // 添加标准CGI环境变量（服务器变量是预先构建的）
     addStandardVars(request, scriptPath);
-    addServerVars();
     addRequestVars(request);
 
     // 构建环境变量数组
     buildEnvArray();
 }
 
+// 服务器变量：对所有请求都一样，只构建一次
+const std::vector<std::string>& CGIEnvironment::staticVars() {
+    static std::vector<std::string> vars;
+    if (vars.empty()) {
+        vars.push_back("SERVER_SOFTWARE=webserv/1.0");
+        vars.push_back("SERVER_NAME=localhost");
+        vars.push_back("GATEWAY_INTERFACE=CGI/1.1");
+        vars.push_back("SERVER_PROTOCOL=HTTP/1.1");
+        vars.push_back("SERVER_PORT=8080");
+        // 客户端信息（本地连接）
+        vars.push_back("REMOTE_ADDR=127.0.0.1");
+        vars.push_back("REMOTE_HOST=localhost");
+        vars.push_back("REMOTE_USER=");
+    }
+    return vars;
+}
+
 void CGIEnvironment::addStandardVars(const HttpRequest& request, const std::string& scriptPath) {
+    char length[32];
+    snprintf(length, sizeof(length), "%lu", static_cast<unsigned long>(request.getBody().length()));
+
     // 基本CGI变量
     addVar("REQUEST_METHOD", request.getMethodStr());
     addVar("SCRIPT_NAME", scriptPath);
     addVar("PATH_INFO", scriptPath);
     addVar("QUERY_STRING", request.getQueryString());
-    addVar("CONTENT_LENGTH", toString(request.getBody().length()));
+    addVar("CONTENT_LENGTH", length);
     addVar("CONTENT_TYPE", request.getContentType());
 }
 
-void CGIEnvironment::addServerVars() {
-    // 服务器变量
-    addVar("SERVER_SOFTWARE", "webserv/1.0");
-    addVar("SERVER_NAME", "localhost");
-    addVar("GATEWAY_INTERFACE", "CGI/1.1");
-    addVar("SERVER_PROTOCOL", "HTTP/1.1");
-    addVar("SERVER_PORT", "8080");
-}
-
 void CGIEnvironment::addRequestVars(const HttpRequest& request) {
     // 请求相关变量
     addVar("HTTP_HOST", request.getHost());
@@ -55,28 +66,30 @@ void CGIEnvironment::addRequestVars(const HttpRequest& request) {
     addVar("HTTP_COOKIE", request.getHeader("cookie"));
     addVar("HTTP_REFERER", request.getHeader("referer"));
     addVar("HTTP_AUTHORIZATION", request.getHeader("authorization"));
-
-    // 客户端信息（本地连接）
-    addVar("REMOTE_ADDR", "127.0.0.1");
-    addVar("REMOTE_HOST", "localhost");
-    addVar("REMOTE_USER", "");
 }
 
-void CGIEnvironment::addVar(const std::string& name, const std::string& value) {
-    envMap_[name] = value;
-    envStrings_.push_back(name + "=" + value);
+void CGIEnvironment::addVar(const char* name, const std::string& value) {
+    offsets_.push_back(arena_.size());
+    arena_.insert(arena_.end(), name, name + strlen(name));
+    arena_.push_back('=');
+    arena_.insert(arena_.end(), value.begin(), value.end());
+    arena_.push_back('\0');
+    mapBuilt_ = false;
 }
 
 void CGIEnvironment::addCustomVar(const std::string& name, const std::string& value) {
-    addVar(name, value);
-    buildEnvArray(); // 重建数组
+    addVar(name.c_str(), value);
+    buildEnvArray(); // arena 可能已重新分配，重建数组
 }
 
+// the arena may move while it grows, so pointers are only taken once it is complete
 void CGIEnvironment::buildEnvArray() {
+    const std::vector<std::string>& vars = staticVars();
     envArray_.clear();
-    for (size_t i = 0; i < envStrings_.size(); ++i) {
-        envArray_.push_back(const_cast<char*>(envStrings_[i].c_str()));
-    }
+    for (size_t i = 0; i < vars.size(); ++i)
+        envArray_.push_back(const_cast<char*>(vars[i].c_str()));
+    for (size_t i = 0; i < offsets_.size(); ++i)
+        envArray_.push_back(&arena_[offsets_[i]]);
     envArray_.push_back(NULL); // NULL终止
 }
 
@@ -87,23 +100,35 @@ char** CGIEnvironment::getEnvArray() {
     return &envArray_[0];
 }
 
+const std::map<std::string, std::string>& CGIEnvironment::getVars() const {
+    if (mapBuilt_)
+        return envMap_;
+    envMap_.clear();
+    const std::vector<std::string>& vars = staticVars();
+    for (size_t i = 0; i < vars.size() + offsets_.size(); ++i) {
+        const char* var = i < vars.size() ? vars[i].c_str() : &arena_[offsets_[i - vars.size()]];
+        const char* separator = strchr(var, '=');
+        envMap_[std::string(var, separator - var)] = separator + 1;
+    }
+    mapBuilt_ = true;
+    return envMap_;
+}
+
+// 保留 arena 的容量，对象复用时不再分配
 void CGIEnvironment::clear() {
-    envStrings_.clear();
+    arena_.clear();
+    offsets_.clear();
     envArray_.clear();
     envMap_.clear();
+    mapBuilt_ = false;
 }
 
 void CGIEnvironment::printEnvironment() const {
     std::cout << "=== CGI Environment Variables ===" << std::endl;
-    for (size_t i = 0; i < envStrings_.size(); ++i) {
-        std::cout << envStrings_[i] << std::endl;
-    }
+    const std::vector<std::string>& vars = staticVars();
+    for (size_t i = 0; i < vars.size(); ++i)
+        std::cout << vars[i] << std::endl;
+    for (size_t i = 0; i < offsets_.size(); ++i)
+        std::cout << &arena_[offsets_[i]] << std::endl;
     std::cout << "=================================" << std::endl;
 }
-
-template<typename T>
-std::string CGIEnvironment::toString(T value) {
-    std::ostringstream oss;
-    oss << value;
-    return oss.str();
-}
\ No newline at end of file
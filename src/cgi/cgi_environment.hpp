@@ -11,6 +11,10 @@
  *
  * 负责设置和管理CGI脚本执行时需要的环境变量
  * 符合CGI/1.1标准规范
+ *
+ * 不随请求变化的变量（SERVER_SOFTWARE、GATEWAY_INTERFACE ...）只构建一次，
+ * 环境数组直接指向它们；每个请求的变量以 "NAME=value\0" 连续写入 arena，
+ * 对象可复用（clear() 保留容量），稳定状态下每个请求不再分配内存
  */
 class CGIEnvironment {
 public:
@@ -60,7 +64,12 @@ public:
      *
      * @return 环境变量数量
      */
-    size_t getVarCount() const { return envStrings_.size(); }
+    size_t getVarCount() const { return staticVars().size() + offsets_.size(); }
+
+    /**
+     * @brief 获取变量表（FastCGI 以 name/value 对的形式发送），第一次调用时构建
+     */
+    const std::map<std::string, std::string>& getVars() const;
 
     /**
      * @brief 打印所有环境变量（调试用）
@@ -68,9 +77,16 @@ public:
     void printEnvironment() const;
 
 private:
-    std::vector<std::string> envStrings_;  // 环境变量字符串
+    std::vector<char> arena_;              // 每个请求的变量 "NAME=value\0"...
+    std::vector<size_t> offsets_;          // 各变量在 arena_ 中的起始位置
     std::vector<char*> envArray_;          // 环境变量数组
-    std::map<std::string, std::string> envMap_;  // 环境变量映射（防重复）
+    mutable std::map<std::string, std::string> envMap_;  // getVars() 的缓存
+    mutable bool mapBuilt_;
+
+    /**
+     * @brief 不随请求变化的变量（进程内只构建一次）
+     */
+    static const std::vector<std::string>& staticVars();
 
     /**
      * @brief 添加标准CGI环境变量
@@ -80,11 +96,6 @@ private:
      */
     void addStandardVars(const HttpRequest& request, const std::string& scriptPath);
 
-    /**
-     * @brief 添加服务器相关环境变量
-     */
-    void addServerVars();
-
     /**
      * @brief 添加请求相关环境变量
      *
@@ -98,21 +109,12 @@ private:
     void buildEnvArray();
 
     /**
-     * @brief 添加单个环境变量
+     * @brief 把单个环境变量写入 arena
      *
      * @param name 变量名
      * @param value 变量值
      */
-    void addVar(const std::string& name, const std::string& value);
-
-    /**
-     * @brief 安全地转换数字为字符串
-     *
-     * @param value 数字值
-     * @return 字符串
-     */
-    template<typename T>
-    std::string toString(T value);
+    void addVar(const char* name, const std::string& value);
 };
 
 #endif // CGI_ENVIRONMENT_HPP
\ No newline at end of file
@@ -1,66 +1,417 @@
 #include "cgi_handler.hpp"
-#include "cgi_environment.hpp"
 #include "cgi_process.hpp"
 #include "cgi_response.hpp"
+#include "../utils/server_clock.hpp"
+#include "../utils/server_stats.hpp"
+#include "../utils/logger.hpp"
 #include <sys/stat.h>
+#include <sys/socket.h>
+#include <errno.h>
+#include <cstdio>
 #include <unistd.h>
-#include <iostream>
+#include <limits.h>
+#include <stdlib.h>
 
-CGIHandler::CGIHandler() : timeoutSeconds_(30) {
+CGIHandler::CGIHandler()
+    : outOfFds_(false), timeoutSeconds_(30), nextRefreshId_(-1),
+      maxConcurrent_(0), queueSize_(256), queueTimeoutMs_(5000), draining_(false) {
 }
 
 CGIHandler::~CGIHandler() {
+    // nobody is waiting any more, don't start jobs for waiters or the queue
+    cacheLocks_.clear();
+    queue_.clear();
+    draining_ = true;
+    while (!jobs_.empty())
+        release(jobs_.begin()->first);
+    while (!spills_.empty())
+        dropSpill(spills_.begin()->first);
+    for (std::map<std::string, CGIWorkerPool*>::iterator it = workerPools_.begin(); it != workerPools_.end(); ++it)
+        delete it->second;
+    for (std::map<const LocationConfig*, CGICache*>::iterator it = caches_.begin(); it != caches_.end(); ++it)
+        delete it->second;
 }
 
-bool CGIHandler::execute(const HttpRequest& request,
-                        const LocationConfig& location,
-                        const std::string& scriptPath,
-                        std::string& response) {
+// GET only: HEAD is answered 405 before it reaches CGI (buildHttpResponse), there is nothing to key
+bool CGIHandler::isCacheable(const HttpRequest& request, const LocationConfig& location) {
+    return location.cgiCacheTtlMs > 0 && request.getMethodStr() == "GET"
+        && request.getHeader("Authorization").empty();
+}
+
+CGICache* CGIHandler::getCache(const LocationConfig& location) {
+    std::map<const LocationConfig*, CGICache*>::iterator it = caches_.find(&location);
+    if (it != caches_.end())
+        return it->second;
+    CGICache* cache = new CGICache(location.cgiCacheTtlMs, location.cgiCacheStaleMs,
+                                   location.cgiCacheMaxSize, location.cgiCacheMaxEntry);
+    caches_[&location] = cache;
+    return cache;
+}
+
+/* one backend execution per key at a time (cache lock)
+    - fresh: served from the cache
+    - stale: served from the cache, one background job (negative id, no client) refreshes it
+    - miss while the key is being executed: wait for that job instead of starting another
+*/
+CGIHandler::CacheStatus CGIHandler::lookupCache(int clientFd,
+                                                const HttpRequest& request,
+                                                const LocationConfig& location,
+                                                const std::string& scriptPath,
+                                                std::string& response) {
+    if (!isCacheable(request, location))
+        return CACHE_MISS;
+    CacheKey key(getCache(location), CGICache::makeKey(request.getMethodStr(), request.getHost(),
+                                                       request.getURI(), request.getQueryString()));
+    long long nowMs = ServerClock::monotonicMs();
+    CGICache::Result result = key.first->lookup(key.second, nowMs, response);
+    bool inFlight = cacheLocks_.find(key) != cacheLocks_.end();
+
+    if (result == CGICache::FRESH) {
+        LOG_DEBUG << "✅ CGI cache hit: " << key.second;
+        return CACHE_HIT;
+    }
+    if (result == CGICache::STALE) {
+        LOG_DEBUG << "✅ CGI cache stale hit: " << key.second;
+        if (!inFlight && hasSlot(location)) {
+            int refreshId = nextRefreshId_;
+            nextRefreshId_ = (nextRefreshId_ == INT_MIN) ? -1 : nextRefreshId_ - 1;
+            if (start(refreshId, request, location, scriptPath))
+                LOG_DEBUG << "🔄 CGI cache: refreshing " << key.second;
+        }
+        return CACHE_HIT;
+    }
+    if (!inFlight)
+        return CACHE_MISS;
+
+    Waiter waiter;
+    waiter.clientFd = clientFd;
+    waiter.request = &request;
+    waiter.location = &location;
+    waiter.scriptPath = scriptPath;
+    waiter.queuedMs = nowMs;
+    waiter.deadlineMs = nowMs + location.cgiCacheLockTimeoutMs;
+    cacheLocks_[key].waiters.push_back(waiter);
+    LOG_DEBUG << "⏳ CGI cache: waiting for " << key.second;
+    return CACHE_WAIT;
+}
+
+void CGIHandler::endFill(int clientFd, const std::string* response) {
+    std::map<int, CacheFill>::iterator fill = cacheFills_.find(clientFd);
+    if (fill == cacheFills_.end())
+        return;
+    CacheKey key = fill->second.key;
+    bool shareable = response && fill->second.shareable;
+    cacheFills_.erase(fill);
+
+    std::map<CacheKey, CacheLock>::iterator lock = cacheLocks_.find(key);
+    if (lock == cacheLocks_.end() || lock->second.ownerFd != clientFd)
+        return;
+    std::vector<Waiter> waiters;
+    waiters.swap(lock->second.waiters);
+    cacheLocks_.erase(lock);
+
+    for (size_t i = 0; i < waiters.size(); ++i) {
+        if (!shareable) {
+            startWaiter(waiters[i]); // the first one takes the lock again
+            continue;
+        }
+        setResult(waiters[i].clientFd, 0, "");
+        results_[waiters[i].clientFd].response = *response;
+    }
+}
+
+void CGIHandler::startWaiter(const Waiter& waiter) {
+    StartStatus status = submit(waiter.clientFd, *waiter.request, *waiter.location, waiter.scriptPath);
+    if (status == START_BUSY)
+        setResult(waiter.clientFd, 503, outOfFds_ ? lastError_ : "CGI queue full");
+    else if (status == START_FAILED)
+        setResult(waiter.clientFd, 502, lastError_);
+}
+
+void CGIHandler::setResult(int clientFd, int status, const std::string& error) {
+    JobResult& result = results_[clientFd];
+    result.status = status;
+    result.response.clear();
+    result.error = error;
+    ready_.push_back(clientFd);
+}
+
+void CGIHandler::expireWaiters(long long nowMs) {
+    std::vector<Waiter> expired;
+    for (std::map<CacheKey, CacheLock>::iterator lock = cacheLocks_.begin(); lock != cacheLocks_.end(); ++lock) {
+        std::vector<Waiter>& waiters = lock->second.waiters;
+        for (size_t i = 0; i < waiters.size();) {
+            if (nowMs < waiters[i].deadlineMs) {
+                ++i;
+                continue;
+            }
+            expired.push_back(waiters[i]);
+            waiters.erase(waiters.begin() + i);
+        }
+    }
+    // started outside the loop: start() may add locks
+    for (size_t i = 0; i < expired.size(); ++i) {
+        LOG_WARN << "⏱️  CGI cache: lock timeout, executing for fd=" << expired[i].clientFd;
+        startWaiter(expired[i]);
+    }
+
+    for (size_t i = 0; i < queue_.size();) {
+        if (nowMs < queue_[i].deadlineMs) {
+            ++i;
+            continue;
+        }
+        Waiter waiter = queue_[i];
+        queue_.erase(queue_.begin() + i);
+        unqueue(waiter, nowMs);
+        ++ServerStats::cgi.queueTimeouts;
+        setResult(waiter.clientFd, 503, "CGI queue wait timeout");
+    }
+}
+
+bool CGIHandler::hasSlot(const LocationConfig& location) const {
+    if (maxConcurrent_ > 0 && jobLocations_.size() >= maxConcurrent_)
+        return false;
+    if (location.cgiMaxConcurrent == 0)
+        return true;
+    std::map<const LocationConfig*, size_t>::const_iterator running = running_.find(&location);
+    return running == running_.end() || running->second < location.cgiMaxConcurrent;
+}
+
+long long CGIHandler::queueTimeoutMs(const LocationConfig& location) const {
+    if (location.cgiMaxConcurrent == 0)
+        return queueTimeoutMs_;
+    if (maxConcurrent_ == 0 || location.cgiQueueTimeoutMs < queueTimeoutMs_)
+        return location.cgiQueueTimeoutMs;
+    return queueTimeoutMs_;
+}
+
+int CGIHandler::retryAfter(const LocationConfig& location) const {
+    long long seconds = (queueTimeoutMs(location) + 999) / 1000;
+    return seconds > 0 ? static_cast<int>(seconds) : 1;
+}
+
+void CGIHandler::addCacheStats(StatusSnapshot& snapshot) const {
+    for (std::map<const LocationConfig*, CGICache*>::const_iterator it = caches_.begin();
+         it != caches_.end(); ++it) {
+        snapshot.cacheHits += it->second->hits();
+        snapshot.cacheStaleHits += it->second->staleHits();
+        snapshot.cacheMisses += it->second->misses();
+        snapshot.cacheEntries += it->second->entryCount();
+        snapshot.cacheBytes += it->second->bytes();
+    }
+}
+
+void CGIHandler::setLimits(size_t maxConcurrent, size_t queueSize, long long queueTimeoutMs) {
+    maxConcurrent_ = maxConcurrent;
+    queueSize_ = queueSize;
+    queueTimeoutMs_ = queueTimeoutMs;
+}
+
+/* admission: run now, wait in the FIFO queue, or 503 right away
+    - the location queue bounds requests held back by the location limit,
+      the global queue bounds everything that waits
+*/
+CGIHandler::StartStatus CGIHandler::submit(int clientFd,
+                                           const HttpRequest& request,
+                                           const LocationConfig& location,
+                                           const std::string& scriptPath) {
     lastError_.clear();
+    outOfFds_ = false;
+    if (hasSlot(location)) {
+        if (start(clientFd, request, location, scriptPath))
+            return START_OK;
+        return outOfFds_ ? START_BUSY : START_FAILED;
+    }
+
+    release(clientFd); // 同一连接不应有两个任务
+    size_t& queuedHere = queued_[&location];
+    if (queue_.size() >= queueSize_
+        || (location.cgiMaxConcurrent > 0 && queuedHere >= location.cgiQueueSize)) {
+        ++ServerStats::cgi.rejected;
+        LOG_WARN << "❌ CGI: busy, " << jobLocations_.size() << " running, "
+                  << queue_.size() << " queued";
+        return START_BUSY;
+    }
 
+    Waiter waiter;
+    waiter.clientFd = clientFd;
+    waiter.request = &request;
+    waiter.location = &location;
+    waiter.scriptPath = scriptPath;
+    waiter.queuedMs = ServerClock::monotonicMs();
+    waiter.deadlineMs = waiter.queuedMs + queueTimeoutMs(location);
+    queue_.push_back(waiter);
+    ++queuedHere;
+    ++ServerStats::cgi.queued;
+    ++ServerStats::cgi.queuedTotal;
+    LOG_DEBUG << "⏳ CGI: queued fd=" << clientFd << " (" << queue_.size() << " waiting)";
+    return START_QUEUED;
+}
+
+void CGIHandler::unqueue(const Waiter& waiter, long long nowMs) {
+    std::map<const LocationConfig*, size_t>::iterator queued = queued_.find(waiter.location);
+    if (queued != queued_.end() && --queued->second == 0)
+        queued_.erase(queued);
+    --ServerStats::cgi.queued;
+    long long waited = nowMs - waiter.queuedMs;
+    ServerStats::cgi.queueWaitMsTotal += static_cast<unsigned long long>(waited);
+    if (waited > ServerStats::cgi.queueWaitMsMax)
+        ServerStats::cgi.queueWaitMsMax = waited;
+}
+
+void CGIHandler::endJob(int clientFd) {
+    std::map<int, const LocationConfig*>::iterator job = jobLocations_.find(clientFd);
+    if (job == jobLocations_.end())
+        return;
+    std::map<const LocationConfig*, size_t>::iterator running = running_.find(job->second);
+    if (running != running_.end() && --running->second == 0)
+        running_.erase(running);
+    jobLocations_.erase(job);
+    --ServerStats::cgi.active;
+    drainQueue();
+}
+
+// a slot was freed: start queued requests in order, skipping those whose location is still full
+void CGIHandler::drainQueue() {
+    if (draining_)
+        return;
+    draining_ = true;
+    long long nowMs = ServerClock::monotonicMs();
+    for (size_t i = 0; i < queue_.size();) {
+        if (maxConcurrent_ > 0 && jobLocations_.size() >= maxConcurrent_)
+            break;
+        if (!hasSlot(*queue_[i].location)) {
+            ++i;
+            continue;
+        }
+        Waiter waiter = queue_[i];
+        queue_.erase(queue_.begin() + i);
+        unqueue(waiter, nowMs);
+        if (!start(waiter.clientFd, *waiter.request, *waiter.location, waiter.scriptPath))
+            setResult(waiter.clientFd, outOfFds_ ? 503 : 502, lastError_);
+    }
+    draining_ = false;
+}
+
+// locations sharing interpreter & worker script share the pool; the first one sets its size
+CGIWorkerPool* CGIHandler::getWorkerPool(const LocationConfig& location) {
+    std::string key = location.cgiPath + " " + location.cgiWorker;
+    std::map<std::string, CGIWorkerPool*>::iterator it = workerPools_.find(key);
+    if (it != workerPools_.end())
+        return it->second;
+    CGIWorkerPool* pool = new CGIWorkerPool(location.cgiPath, location.cgiWorker,
+                                            location.cgiWorkersMin, location.cgiWorkersMax,
+                                            location.cgiWorkerMaxRequests, location.cgiWorkerIdleTimeout);
+    workerPools_[key] = pool;
+    return pool;
+}
+
+void CGIHandler::prespawnWorkers(const LocationConfig& location) {
+    if (location.cgiWorker.empty() || !location.fastcgiPass.empty())
+        return;
+    if (!isCGIExecutable(location.cgiPath)) {
+        LOG_ERROR << "❌ CGI worker: interpreter not executable: " << location.cgiPath;
+        return;
+    }
+    getWorkerPool(location)->prespawn();
+}
+
+/* fastcgi_pass: the same CGI variables go to a pooled FastCGI backend instead of a child
+    - the script does not have to exist locally, the backend reports it (Status: 404)
+    - SCRIPT_FILENAME is what php-fpm & co. use to find the script
+*/
+bool CGIHandler::startFastCGI(int clientFd,
+                              const HttpRequest& request,
+                              const LocationConfig& location,
+                              const std::string& scriptPath) {
+    LOG_DEBUG << "🔧 FastCGI: " << scriptPath << " via " << location.fastcgiPass;
+
+    CGIEnvironment& environment = environment_;
+    environment.setupEnvironment(request, scriptPath, getScriptDirectory(scriptPath));
+    char resolved[PATH_MAX];
+    environment.addCustomVar("SCRIPT_FILENAME",
+                             realpath(scriptPath.c_str(), resolved) ? std::string(resolved) : scriptPath);
+    environment.addCustomVar("REQUEST_URI", request.getURI());
+    environment.addCustomVar("REDIRECT_STATUS", "200"); // php-cgi refuses to run without it
+
+    if (!fastcgi_.start(clientFd, location.fastcgiPass, environment.getVars(), request.getBody(),
+                        timeoutSeconds_, location.cgiOutputBufferSize, location.cgiTempPath)) {
+        setError("Invalid FastCGI backend address: " + location.fastcgiPass);
+        return false;
+    }
+    return true;
+}
+
+bool CGIHandler::start(int clientFd,
+                       const HttpRequest& request,
+                       const LocationConfig& location,
+                       const std::string& scriptPath) {
+    lastError_.clear();
+    outOfFds_ = false;
+    release(clientFd); // 同一连接不应有两个任务
+
+    bool started = location.fastcgiPass.empty()
+        ? startProcess(clientFd, request, location, scriptPath)
+        : startFastCGI(clientFd, request, location, scriptPath);
+
+    if (started) {
+        jobLocations_[clientFd] = &location;
+        ++running_[&location];
+        ++ServerStats::cgi.active;
+    }
+
+    // the response is stored by buildResponse() once the job is done
+    if (started && isCacheable(request, location)) {
+        CacheFill& fill = cacheFills_[clientFd];
+        fill.key = CacheKey(getCache(location), CGICache::makeKey(request.getMethodStr(), request.getHost(),
+                                                                  request.getURI(), request.getQueryString()));
+        fill.shareable = false;
+        if (cacheLocks_.find(fill.key) == cacheLocks_.end())
+            cacheLocks_[fill.key].ownerFd = clientFd;
+    }
+    return started;
+}
+
+bool CGIHandler::startProcess(int clientFd,
+                              const HttpRequest& request,
+                              const LocationConfig& location,
+                              const std::string& scriptPath) {
     // 验证CGI执行的前置条件
     if (!validateCGIExecution(location, scriptPath)) {
         return false;
     }
 
-    std::cout << "🔧 CGI: Executing script " << scriptPath
-              << " with " << location.cgiPath << std::endl;
+    LOG_DEBUG << "🔧 CGI: Executing script " << scriptPath
+              << " with " << location.cgiPath;
 
     try {
-        // 1. 设置CGI环境变量
-        CGIEnvironment environment;
+        // 1. 设置CGI环境变量（posix_spawn 复制了环境，start 返回后即可复用）
+        CGIEnvironment& environment = environment_;
         std::string scriptDir = getScriptDirectory(scriptPath);
         environment.setupEnvironment(request, scriptPath, scriptDir);
 
-        // 2. 执行CGI进程
-        CGIProcess process;
-        std::string rawOutput;
-        bool success = process.execute(
-            location.cgiPath,       // CGI程序路径 (如 /usr/bin/python3)
-            scriptPath,             // 脚本路径 (如 ./www/test.py)
-            environment.getEnvArray(),
-            request.getBody(),      // POST数据
-            rawOutput,
-            timeoutSeconds_
-        );
-
-        if (!success) {
-            setError("CGI process execution failed: " + process.getLastError());
-            return false;
+        // cgi_workers: a resident interpreter runs the script, no fork on this request
+        if (!location.cgiWorker.empty()) {
+            getWorkerPool(location)->submit(clientFd, scriptPath, environment.getVars(), request.getBody(),
+                                            timeoutSeconds_, location.cgiOutputBufferSize, location.cgiTempPath);
+            return true;
         }
 
-        // 3. 解析CGI输出并构建HTTP响应
-        CGIResponse cgiResponse;
-        if (!cgiResponse.parseRawOutput(rawOutput)) {
-            setError("Failed to parse CGI output");
+        // 2. 启动CGI进程，I/O交给事件循环
+        CGIProcess* process = new CGIProcess();
+        if (!process->start(location.cgiPath, scriptPath, environment.getEnvArray(),
+                            request.getBody(), timeoutSeconds_)) {
+            setError("CGI process start failed: " + process->getLastError());
+            outOfFds_ = process->outOfFds();
+            if (outOfFds_)
+                LOG_WARN << "❌ CGI: out of fds, refused " << scriptPath;
+            delete process;
             return false;
         }
-
-        response = cgiResponse.buildHTTPResponse();
-
-        std::cout << "✅ CGI: Script executed successfully, response size: "
-                  << response.size() << " bytes" << std::endl;
-
+        if (isCacheable(request, location))
+            process->setStreaming(false); // a cached response needs the whole body
+        process->setOutputLimit(location.cgiOutputBufferSize);
+        jobs_[clientFd] = process;
         return true;
 
     } catch (const std::exception& e) {
@@ -72,12 +423,440 @@ bool CGIHandler::execute(const HttpRequest& request,
     }
 }
 
+void CGIHandler::addFds(fd_set* readFds, fd_set* writeFds, int& maxFd) const {
+    for (std::map<int, CGIProcess*>::const_iterator it = jobs_.begin(); it != jobs_.end(); ++it)
+        it->second->addFds(readFds, writeFds, maxFd);
+    fastcgi_.addFds(readFds, writeFds, maxFd);
+    for (std::map<std::string, CGIWorkerPool*>::const_iterator it = workerPools_.begin(); it != workerPools_.end(); ++it)
+        it->second->addFds(readFds, writeFds, maxFd);
+}
+
+void CGIHandler::handleIO(const fd_set* readFds, const fd_set* writeFds, std::vector<int>& completed) {
+    long long nowMs = ServerClock::monotonicMs();
+
+    for (std::map<int, CGIProcess*>::iterator it = jobs_.begin(); it != jobs_.end(); ++it) {
+        CGIProcess* process = it->second;
+        if (process->isStreaming()) {
+            // reported at header time: only wait for body data, reap & time out
+            process->handleIO(readFds, writeFds);
+            process->checkTimeout(nowMs);
+            continue;
+        }
+        if (process->isComplete() || process->headersReady())
+            continue; // already reported, waiting for finish()
+        process->handleIO(readFds, writeFds);
+        process->checkTimeout(nowMs);
+        if (process->isComplete() || process->headersReady())
+            completed.push_back(it->first);
+    }
+    fastcgi_.handleIO(readFds, writeFds, completed);
+    for (std::map<std::string, CGIWorkerPool*>::iterator it = workerPools_.begin(); it != workerPools_.end(); ++it)
+        it->second->handleIO(readFds, writeFds, completed);
+    CGIProcess::reapKilled();
+
+    expireWaiters(nowMs);
+    // background cache refreshes have no client to report to
+    for (size_t i = 0; i < completed.size();) {
+        if (completed[i] >= 0) {
+            ++i;
+            continue;
+        }
+        std::map<int, CGIProcess*>::iterator job = jobs_.find(completed[i]);
+        if (job != jobs_.end() && job->second->headersReady()) {
+            // past cgi_output_buffer: nothing to cache and nobody to stream to, drop the refresh
+            LOG_WARN << "⚠️  CGI cache: refresh output exceeds cgi_output_buffer, not cached";
+            release(completed[i]);
+            completed.erase(completed.begin() + i);
+            continue;
+        }
+        std::string discarded;
+        finish(completed[i], discarded);
+        offloads_.erase(completed[i]);
+        dropSpill(completed[i]);
+        completed.erase(completed.begin() + i);
+    }
+    completed.insert(completed.end(), ready_.begin(), ready_.end());
+    ready_.clear();
+}
+
+int CGIHandler::finish(int clientFd, std::string& response, bool chunkedAllowed) {
+    // collapsed request: the result of the job it waited for
+    std::map<int, JobResult>::iterator result = results_.find(clientFd);
+    if (result != results_.end()) {
+        int status = result->second.status;
+        if (status == 0)
+            response.swap(result->second.response);
+        else
+            setError(result->second.error);
+        results_.erase(result);
+        return status;
+    }
+
+    int status = finishJob(clientFd, response, chunkedAllowed);
+    endFill(clientFd, status == 0 ? &response : NULL);
+    if (!isStreaming(clientFd))
+        endJob(clientFd); // a streamed job holds its slot until release()
+    return status;
+}
+
+int CGIHandler::finishJob(int clientFd, std::string& response, bool chunkedAllowed) {
+    // FastCGI backend
+    if (fastcgi_.hasJob(clientFd)) {
+        CGIOutputBuffer rawOutput;
+        std::string error;
+        int status = fastcgi_.finish(clientFd, rawOutput, error);
+        if (status != 0) {
+            setError(error);
+            return status;
+        }
+        return buildResponse(clientFd, rawOutput, response);
+    }
+
+    // resident worker
+    for (std::map<std::string, CGIWorkerPool*>::iterator pool = workerPools_.begin(); pool != workerPools_.end(); ++pool) {
+        if (!pool->second->hasJob(clientFd))
+            continue;
+        CGIOutputBuffer rawOutput;
+        std::string error;
+        int status = pool->second->finish(clientFd, rawOutput, error);
+        if (status != 0) {
+            setError(error);
+            return status;
+        }
+        return buildResponse(clientFd, rawOutput, response);
+    }
+
+    std::map<int, CGIProcess*>::iterator it = jobs_.find(clientFd);
+    if (it == jobs_.end())
+        return 502;
+
+    CGIProcess* process = it->second;
+    int status = 0;
+
+    if (process->headersReady())
+        return startStream(clientFd, process, response, chunkedAllowed);
+
+    if (process->timedOut()) {
+        setError("CGI process timeout");
+        status = 504;
+    }
+    else if (!process->succeeded()) {
+        setError("CGI process execution failed: " + process->getLastError());
+        status = 502;
+    }
+    else
+        status = buildResponse(clientFd, process->getOutput(), response);
+
+    delete process;
+    jobs_.erase(it);
+    return status;
+}
+
+/* the script is still writing its body: send the headers now, forward the rest as it comes
+    - Content-Length from the script: body passes through as is
+    - otherwise chunked for HTTP/1.1, or delimited by closing the connection for HTTP/1.0
+*/
+int CGIHandler::startStream(int clientFd, CGIProcess* process, std::string& response, bool chunkedAllowed) {
+    std::string output;
+    process->beginStreaming(output);
+
+    size_t separatorLength = 0;
+    size_t headerEnd = CGIResponse::findHeaderEnd(output, separatorLength);
+    CGIResponse cgiResponse;
+    if (!cgiResponse.parseHeaderBlock(output.substr(0, headerEnd))) {
+        setError("Failed to parse CGI output headers");
+        delete process;
+        jobs_.erase(clientFd);
+        return 502;
+    }
+    if (recordOffload(clientFd, cgiResponse)) {
+        // the server sends the file, whatever the script still writes is not needed
+        delete process;
+        jobs_.erase(clientFd);
+        response.clear();
+        return 0;
+    }
+
+    Stream& stream = streams_[clientFd];
+    stream.chunked = !cgiResponse.hasHeader("content-length") && chunkedAllowed;
+    stream.untilClose = !stream.chunked && !cgiResponse.hasHeader("content-length");
+    stream.chunkLeft = 0;
+    stream.finished = false;
+    if (stream.chunked)
+        cgiResponse.setHeader("transfer-encoding", "chunked");
+    else if (stream.untilClose)
+        cgiResponse.setHeader("connection", "close");
+
+    response = cgiResponse.buildHeaderBlock();
+    size_t bodyStart = headerEnd + separatorLength;
+    if (bodyStart < output.size()) {
+        if (stream.chunked) {
+            char size[32];
+            snprintf(size, sizeof(size), "%lx\r\n", static_cast<unsigned long>(output.size() - bodyStart));
+            response += size;
+        }
+        response.append(output, bodyStart, std::string::npos);
+        if (stream.chunked)
+            response += "\r\n";
+    }
+    LOG_DEBUG << "✅ CGI: Streaming response" << (stream.chunked ? " (chunked)" : "");
+    return 0;
+}
+
+bool CGIHandler::streamWantsWrite(int clientFd) const {
+    std::map<int, Stream>::const_iterator stream = streams_.find(clientFd);
+    if (stream == streams_.end())
+        return false;
+    if (!stream->second.pending.empty() || stream->second.finished)
+        return true;
+    std::map<int, CGIProcess*>::const_iterator job = jobs_.find(clientFd);
+    return job != jobs_.end() && (job->second->outputReadable() || job->second->timedOut());
+}
+
+CGIHandler::StreamStatus CGIHandler::pumpStream(int clientFd, unsigned long long& bytesSent) {
+    std::map<int, Stream>::iterator streamIt = streams_.find(clientFd);
+    std::map<int, CGIProcess*>::iterator jobIt = jobs_.find(clientFd);
+    if (streamIt == streams_.end() || jobIt == jobs_.end())
+        return STREAM_ERROR;
+    Stream& stream = streamIt->second;
+    CGIProcess* process = jobIt->second;
+
+    while (true) {
+        // chunk framing (or read() fallback data) goes out before more body
+        while (!stream.pending.empty()) {
+            ssize_t sent = send(clientFd, stream.pending.data(), stream.pending.size(), MSG_NOSIGNAL);
+            if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                return STREAM_AGAIN;
+            if (sent <= 0)
+                return STREAM_ERROR;
+            ServerStats::http.bytesOut += static_cast<unsigned long long>(sent);
+            bytesSent += static_cast<unsigned long long>(sent);
+            stream.pending.erase(0, sent);
+        }
+        if (stream.finished) {
+            StreamStatus status = stream.untilClose ? STREAM_CLOSE : STREAM_DONE;
+            release(clientFd);
+            return status;
+        }
+        if (process->timedOut())
+            return STREAM_ERROR; // the body is cut short, only closing tells the client
+
+        if (stream.chunkLeft == 0) {
+            if (!process->outputReadable())
+                return STREAM_AGAIN;
+            size_t available = process->availableOutput();
+            if (available == 0) {
+                // readable & empty: EOF, the script is done
+                process->closeOutput();
+                if (stream.chunked)
+                    stream.pending = "0\r\n\r\n";
+                stream.finished = true;
+                continue;
+            }
+            stream.chunkLeft = available;
+            if (stream.chunked) {
+                char size[32];
+                snprintf(size, sizeof(size), "%lx\r\n", static_cast<unsigned long>(available));
+                stream.pending = size;
+                continue;
+            }
+        }
+
+        size_t pendingBefore = stream.pending.size();
+        ssize_t moved = process->transferOutput(clientFd, stream.chunkLeft, stream.pending);
+        if (moved < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return STREAM_AGAIN; // socket full, the pipe still holds the data
+        if (moved <= 0)
+            return STREAM_ERROR;
+        if (stream.pending.size() == pendingBefore)
+            bytesSent += static_cast<unsigned long long>(moved); // spliced straight to the socket
+        stream.chunkLeft -= moved;
+        if (stream.chunkLeft == 0) {
+            if (stream.chunked)
+                stream.pending += "\r\n";
+            process->outputDrained();
+        }
+    }
+}
+
+// 3. 解析CGI输出并构建HTTP响应
+int CGIHandler::buildResponse(int clientFd, const std::string& rawOutput, std::string& response, size_t spilledBody) {
+    CGIResponse cgiResponse;
+    if (!cgiResponse.parseRawOutput(rawOutput, spilledBody)) {
+        setError("Failed to parse CGI output");
+        return 502;
+    }
+    if (recordOffload(clientFd, cgiResponse)) {
+        response.clear(); // never cached: the cache fill stays unshareable
+        return 0;
+    }
+    response = cgiResponse.buildHTTPResponse();
+
+    std::map<int, CacheFill>::iterator fill = cacheFills_.find(clientFd);
+    if (fill != cacheFills_.end() && spilledBody == 0) {
+        CGICache* cache = fill->second.key.first;
+        long long ttlMs = CGICache::freshnessMs(cgiResponse, cache->ttlMs(), ServerClock::now());
+        cache->store(fill->second.key.second, response, ttlMs, ServerClock::monotonicMs());
+        fill->second.shareable = ttlMs > 0;
+    }
+    LOG_DEBUG << "✅ CGI: Script executed successfully, response size: "
+              << response.size() << " bytes";
+    return 0;
+}
+
+/* X-Accel-Redirect / X-Sendfile: keep the target & the headers the client should still see
+    - X-Sendfile only counts where the job's location has a cgi_sendfile_root
+*/
+bool CGIHandler::recordOffload(int clientFd, const CGIResponse& cgiResponse) {
+    static const char* const passed[][2] = {
+        { "content-type", "Content-Type" },
+        { "content-disposition", "Content-Disposition" },
+        { "content-language", "Content-Language" },
+        { "cache-control", "Cache-Control" },
+        { "expires", "Expires" },
+        { "set-cookie", "Set-Cookie" }
+    };
+    std::map<int, const LocationConfig*>::const_iterator job = jobLocations_.find(clientFd);
+    bool sendfileAllowed = job != jobLocations_.end() && !job->second->cgiSendfileRoot.empty();
+
+    std::string target;
+    CGIResponse::Offload type = cgiResponse.getOffload(sendfileAllowed, target);
+    if (type == CGIResponse::OFFLOAD_NONE)
+        return false;
+    Offload& offload = offloads_[clientFd];
+    offload.type = type;
+    offload.target = target;
+    offload.headers.clear();
+    for (size_t i = 0; i < sizeof(passed) / sizeof(passed[0]); ++i) {
+        if (i == 0 && cgiResponse.hasDefaultContentType())
+            continue; // no type from the script: the file's own MIME type
+        if (cgiResponse.hasHeader(passed[i][0]))
+            offload.headers[passed[i][1]] = cgiResponse.getHeader(passed[i][0]);
+    }
+    LOG_DEBUG << "✅ CGI: " << (type == CGIResponse::OFFLOAD_ACCEL ? "X-Accel-Redirect " : "X-Sendfile ")
+              << target;
+    return true;
+}
+
+bool CGIHandler::takeOffload(int clientFd, Offload& offload) {
+    std::map<int, Offload>::iterator it = offloads_.find(clientFd);
+    if (it == offloads_.end())
+        return false;
+    offload = it->second;
+    offloads_.erase(it);
+    return true;
+}
+
+/* past cgi_output_buffer the tail of the output is in a temp file:
+    the head goes out from memory, the tail from the file (see takeSpill) */
+int CGIHandler::buildResponse(int clientFd, CGIOutputBuffer& output, std::string& response) {
+    if (output.failed()) {
+        setError("CGI output could not be spilled to a temp file");
+        return 502;
+    }
+    int status = buildResponse(clientFd, output.memory(), response, static_cast<size_t>(output.spilled()));
+    if (status != 0 || output.spilled() == 0 || offloads_.count(clientFd))
+        return status;
+
+    off_t length = output.spilled();
+    int fd = output.takeSpill();
+    if (fd == -1) {
+        setError("CGI output temp file lost");
+        return 502;
+    }
+    dropSpill(clientFd);
+    spills_[clientFd] = std::make_pair(fd, length);
+    LOG_DEBUG << "🔧 CGI: " << length << " bytes of output spilled to a temp file";
+    return 0;
+}
+
+bool CGIHandler::takeSpill(int clientFd, int& fd, off_t& length) {
+    std::map<int, std::pair<int, off_t> >::iterator it = spills_.find(clientFd);
+    if (it == spills_.end())
+        return false;
+    fd = it->second.first;
+    length = it->second.second;
+    spills_.erase(it);
+    return true;
+}
+
+void CGIHandler::dropSpill(int clientFd) {
+    std::map<int, std::pair<int, off_t> >::iterator it = spills_.find(clientFd);
+    if (it == spills_.end())
+        return;
+    close(it->second.first);
+    spills_.erase(it);
+}
+
+void CGIHandler::release(int clientFd) {
+    streams_.erase(clientFd);
+    offloads_.erase(clientFd);
+    dropSpill(clientFd);
+    endFill(clientFd, NULL); // its waiters execute themselves
+    results_.erase(clientFd);
+    for (size_t i = 0; i < ready_.size(); ++i) {
+        if (ready_[i] == clientFd)
+            ready_.erase(ready_.begin() + i--);
+    }
+    for (std::map<CacheKey, CacheLock>::iterator lock = cacheLocks_.begin(); lock != cacheLocks_.end(); ++lock) {
+        std::vector<Waiter>& waiters = lock->second.waiters;
+        for (size_t i = 0; i < waiters.size(); ++i) {
+            if (waiters[i].clientFd == clientFd)
+                waiters.erase(waiters.begin() + i--);
+        }
+    }
+    for (size_t i = 0; i < queue_.size(); ++i) {
+        if (queue_[i].clientFd == clientFd) {
+            unqueue(queue_[i], ServerClock::monotonicMs());
+            queue_.erase(queue_.begin() + i);
+            break;
+        }
+    }
+    fastcgi_.release(clientFd);
+    for (std::map<std::string, CGIWorkerPool*>::iterator it = workerPools_.begin(); it != workerPools_.end(); ++it)
+        it->second->release(clientFd);
+    std::map<int, CGIProcess*>::iterator it = jobs_.find(clientFd);
+    if (it != jobs_.end()) {
+        delete it->second; // kills a still running child, reapKilled() reaps it
+        jobs_.erase(it);
+    }
+    endJob(clientFd);
+}
+
+size_t CGIHandler::activeCount() const {
+    size_t count = jobs_.size() + fastcgi_.activeCount();
+    for (std::map<std::string, CGIWorkerPool*>::const_iterator it = workerPools_.begin(); it != workerPools_.end(); ++it)
+        count += it->second->activeCount();
+    return count;
+}
+
+bool CGIHandler::needsPolling() const {
+    if (!ready_.empty() || CGIProcess::hasKilled())
+        return true;
+    if (fastcgi_.hasFinished())
+        return true;
+    for (std::map<std::string, CGIWorkerPool*>::const_iterator it = workerPools_.begin(); it != workerPools_.end(); ++it) {
+        if (it->second->hasFinished())
+            return true;
+    }
+    for (std::map<int, CGIProcess*>::const_iterator it = jobs_.begin(); it != jobs_.end(); ++it) {
+        if (it->second->needsPolling())
+            return true;
+    }
+    return false;
+}
+
 bool CGIHandler::isCGIRequest(const std::string& uri, const LocationConfig& location) {
     // std::cout << "🔍 Checking CGI for URI: " << uri << std::endl;
     // std::cout << "🔍 Location path: " << location.path << std::endl;
     // std::cout << "🔍 CGI Extension: '" << location.cgiExtension << "'" << std::endl;
     // std::cout << "🔍 CGI Path: '" << location.cgiPath << "'" << std::endl;
 
+    // fastcgi_pass: every request of the location, or only the configured extension
+    if (!location.fastcgiPass.empty()) {
+        return location.cgiExtension.empty() || getFileExtension(uri) == location.cgiExtension;
+    }
+
     // 检查location是否配置了CGI
     if (location.cgiExtension.empty() || location.cgiPath.empty()) {
         // std::cout << "🔍 CGI not configured for this location" << std::endl;
@@ -131,7 +910,7 @@ bool CGIHandler::isScriptValid(const std::string& scriptPath) {
 
 void CGIHandler::setError(const std::string& error) {
     lastError_ = error;
-    std::cerr << "❌ CGI Error: " << error << std::endl;
+    LOG_ERROR << "❌ CGI Error: " << error;
 }
 
 bool CGIHandler::validateCGIExecution(const LocationConfig& location, const std::string& scriptPath) {
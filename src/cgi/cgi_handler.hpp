@@ -4,7 +4,17 @@
 #include "../http/http_request.hpp"
 #include "../http/http_response.hpp"
 #include "../configparser/config.hpp"
+#include "cgi_environment.hpp"
+#include "cgi_process.hpp"
+#include "fastcgi_client.hpp"
+#include "cgi_worker_pool.hpp"
+#include "cgi_cache.hpp"
+#include "cgi_response.hpp"
+#include "../utils/status_report.hpp"
 #include <string>
+#include <map>
+#include <vector>
+#include <deque>
 
 /**
  * @brief CGI处理器主接口类
@@ -14,6 +24,44 @@
  */
 class CGIHandler {
 public:
+    /**
+     * @brief pumpStream() 的结果
+     */
+    enum StreamStatus {
+        STREAM_AGAIN,   // 等待管道可读或socket可写
+        STREAM_DONE,    // body已完整发送，连接可复用
+        STREAM_CLOSE,   // body以关闭连接结束（HTTP/1.0且没有Content-Length）
+        STREAM_ERROR    // 子进程超时/出错或客户端断开，应关闭连接
+    };
+
+    /**
+     * @brief submit() 的结果
+     */
+    enum StartStatus {
+        START_OK,       // 已启动
+        START_QUEUED,   // cgi_max_concurrent 已满，排队等待，完成时通过 handleIO 的 completed 通知
+        START_BUSY,     // 队列也满了，或fd用尽（见 CGIProcess::outOfFds），应返回503
+        START_FAILED    // 启动失败（见 getLastError）
+    };
+
+    /**
+     * @brief lookupCache() 的结果
+     */
+    enum CacheStatus {
+        CACHE_MISS,     // 需要执行CGI（调用 start）
+        CACHE_HIT,      // response 为缓存的响应（过期时已在后台刷新）
+        CACHE_WAIT      // 同key的CGI正在执行，完成后通过 handleIO 的 completed 通知
+    };
+
+    /**
+     * @brief X-Accel-Redirect / X-Sendfile：由服务器代替CGI发送的文件
+     */
+    struct Offload {
+        CGIResponse::Offload type;
+        std::string target;                         // URI 或文件路径
+        std::map<std::string, std::string> headers; // 保留给客户端的CGI headers（Content-Type、Content-Disposition等）
+    };
+
     /**
      * @brief 构造函数
      */
@@ -25,18 +73,142 @@ public:
     ~CGIHandler();
 
     /**
-     * @brief 执行CGI脚本
+     * @brief 启动CGI脚本（非阻塞）
      *
+     * 子进程的管道由主事件循环驱动，完成后通过 handleIO() 的 completed 列表通知
+     *
+     * @param clientFd 发起请求的客户端fd（作为任务的key）
      * @param request HTTP请求对象
      * @param location 匹配的location配置
      * @param scriptPath CGI脚本的完整路径
-     * @param response 输出参数，完整的HTTP响应字符串
-     * @return true 执行成功，false 执行失败
+     * @return true 已启动，false 启动失败（见 getLastError）
+     */
+    bool start(int clientFd,
+               const HttpRequest& request,
+               const LocationConfig& location,
+               const std::string& scriptPath);
+
+    /**
+     * @brief 按 cgi_max_concurrent 准入后启动CGI
+     *
+     * location和全局都有空位时立即 start()；否则进入FIFO队列（location和全局队列长度都有上限），
+     * 有任务结束时按顺序启动，排队超过 cgi_queue 的超时时间以503报告
+     */
+    StartStatus submit(int clientFd,
+                       const HttpRequest& request,
+                       const LocationConfig& location,
+                       const std::string& scriptPath);
+
+    /**
+     * @brief 全局并发上限和队列（main级别的 cgi_max_concurrent / cgi_queue）
+     */
+    void setLimits(size_t maxConcurrent, size_t queueSize, long long queueTimeoutMs);
+
+    /**
+     * @brief 503响应的 Retry-After（秒），取排队超时时间
+     */
+    int retryAfter(const LocationConfig& location) const;
+
+    /**
+     * @brief 把所有location微缓存的命中/未命中/大小累加到状态页快照（stub_status）
+     */
+    void addCacheStats(StatusSnapshot& snapshot) const;
+
+    /**
+     * @brief 在location的微缓存（cgi_cache）中查找GET响应
+     *
+     * 同一个key同时只执行一次CGI（cache lock）：
+     *   - 过期但在 cgi_cache_stale 窗口内：返回旧响应，后台刷新（没有刷新在跑时）
+     *   - 未命中且同key的CGI正在执行：等待它的结果，最多 cgi_cache_lock_timeout，
+     *     超时或结果不可共享时自己执行
+     *
+     * @param clientFd 客户端fd（等待时作为任务的key）
+     * @param scriptPath CGI脚本的完整路径（后台刷新/超时后执行用）
+     * @param response 输出参数，CACHE_HIT 时为缓存的完整HTTP响应
+     */
+    CacheStatus lookupCache(int clientFd,
+                            const HttpRequest& request,
+                            const LocationConfig& location,
+                            const std::string& scriptPath,
+                            std::string& response);
+
+    /**
+     * @brief 为配置了 cgi_workers 的location预先启动 min 个worker（服务器启动时调用）
+     */
+    void prespawnWorkers(const LocationConfig& location);
+
+    /**
+     * @brief 把所有运行中任务的fd加入select集合
+     */
+    void addFds(fd_set* readFds, fd_set* writeFds, int& maxFd) const;
+
+    /**
+     * @brief 处理就绪的CGI管道并检查超时
+     *
+     * @param completed 输出参数，本轮完成（成功/失败/超时）的客户端fd
+     */
+    void handleIO(const fd_set* readFds, const fd_set* writeFds, std::vector<int>& completed);
+
+    /**
+     * @brief 为已完成的任务构建HTTP响应并释放任务
+     *
+     * 子进程仍在输出body时（header已读完）只构建header和已读到的body，
+     * 任务转为流式（isStreaming），其余body由 pumpStream() 转发
+     *
+     * @param clientFd 客户端fd
+     * @param response 输出参数，完整的HTTP响应字符串（流式时为开头部分）
+     * @param chunkedAllowed 客户端支持 Transfer-Encoding: chunked（HTTP/1.1）
+     * @return 0 成功；否则为应返回给客户端的错误码（502 / 504）
+     */
+    int finish(int clientFd, std::string& response, bool chunkedAllowed = true);
+
+    /**
+     * @brief finish() 成功后取出任务的文件发送请求（此时 response 为空，CGI的body已丢弃）
+     *
+     * @return true 应由服务器发送文件，false 普通响应
+     */
+    bool takeOffload(int clientFd, Offload& offload);
+
+    /**
+     * @brief finish() 成功后取出落盘的body尾部（cgi_output_buffer 超限），在 response 之后从该文件发送
+     *
+     * @param fd 输出参数，已unlink的临时文件，调用者负责关闭
+     * @param length 输出参数，文件中的字节数
+     * @return false 输出全部在内存中
+     */
+    bool takeSpill(int clientFd, int& fd, off_t& length);
+
+    /**
+     * @brief 任务的body正在从管道流式转发
+     */
+    bool isStreaming(int clientFd) const { return streams_.count(clientFd) != 0; }
+
+    /**
+     * @brief 流式任务有数据可发，客户端socket应加入写集合
+     */
+    bool streamWantsWrite(int clientFd) const;
+
+    /**
+     * @brief 客户端socket可写时转发body（splice，必要时加chunked分块）
+     *
+     * @param bytesSent 累加本次写入socket的字节数（access_log）
+     */
+    StreamStatus pumpStream(int clientFd, unsigned long long& bytesSent);
+
+    /**
+     * @brief 放弃任务（客户端断开），杀死子进程
+     */
+    void release(int clientFd);
+
+    /**
+     * @brief 运行中的任务数
+     */
+    size_t activeCount() const;
+
+    /**
+     * @brief 是否有任务（或被杀死的子进程）只能靠轮询回收，事件循环应缩短select超时
      */
-    bool execute(const HttpRequest& request,
-                 const LocationConfig& location,
-                 const std::string& scriptPath,
-                 std::string& response);
+    bool needsPolling() const;
 
     /**
      * @brief 检查URI是否为CGI请求
@@ -94,7 +266,180 @@ public:
 
 private:
     std::string lastError_;     // 最后的错误信息
+    bool outOfFds_;             // 上次 start() 因fd用尽失败：503而不是502
     int timeoutSeconds_;        // CGI执行超时时间（默认30秒）
+    std::map<int, CGIProcess*> jobs_; // 客户端fd -> 运行中的CGI进程
+    CGIEnvironment environment_;      // 每个请求复用（arena保留容量）
+    FastCGIClient fastcgi_;           // fastcgi_pass 后端连接池
+    std::map<std::string, CGIWorkerPool*> workerPools_; // "解释器 worker脚本" -> 常驻worker池
+
+    struct Stream {
+        bool chunked;           // Transfer-Encoding: chunked
+        bool untilClose;        // 既没有长度也不能chunked：body以关闭连接结束
+        size_t chunkLeft;       // 当前块还未转发的字节数
+        std::string pending;    // 还没发出的块头/块尾（或read()退回时的数据）
+        bool finished;          // 已读到EOF，pending发完即结束
+    };
+    std::map<int, Stream> streams_;   // 客户端fd -> 正在流式转发的CGI body
+
+    typedef std::pair<CGICache*, std::string> CacheKey;
+
+    struct CacheFill {
+        CacheKey key;
+        bool shareable;         // 响应可缓存，等待同key的请求可以直接使用
+    };
+
+    // 等待cache lock或并发名额的请求
+    struct Waiter {
+        int clientFd;
+        const HttpRequest* request;     // 连接的请求，release() 之前一直有效
+        const LocationConfig* location;
+        std::string scriptPath;
+        long long queuedMs;             // 进入队列的时间（统计排队时间）
+        long long deadlineMs;           // cgi_cache_lock_timeout / cgi_queue 超时
+    };
+
+    struct CacheLock {
+        int ownerFd;                        // 正在为该key执行的任务（后台刷新为负数）
+        std::vector<Waiter> waiters;
+    };
+
+    struct JobResult {
+        int status;             // 0 或错误码
+        std::string response;
+        std::string error;
+    };
+
+    std::map<const LocationConfig*, CGICache*> caches_; // cgi_cache 的location -> 微缓存
+    std::map<int, CacheFill> cacheFills_;               // 客户端fd -> 完成后要写入的缓存项
+    std::map<CacheKey, CacheLock> cacheLocks_;          // 正在执行的key -> 等待它的请求
+    std::map<int, JobResult> results_;  // 等待者 -> 共享到的结果或503/502，finish() 取走
+    std::vector<int> ready_;            // 有结果、尚未通过 handleIO 报告的等待者
+    int nextRefreshId_;                                 // 后台刷新任务的key（负数，不是fd）
+    std::map<int, Offload> offloads_;                   // 客户端fd -> 待发送的文件，takeOffload() 取走
+    std::map<int, std::pair<int, off_t> > spills_;      // 客户端fd -> 落盘的body（fd, 长度），takeSpill() 取走
+
+    size_t maxConcurrent_;              // 全局并发上限，0 = 不限制
+    size_t queueSize_;                  // 全局队列长度上限
+    long long queueTimeoutMs_;
+    std::map<int, const LocationConfig*> jobLocations_; // 运行中的任务 -> 计数的location
+    std::map<const LocationConfig*, size_t> running_;   // location -> 运行中的任务数
+    std::map<const LocationConfig*, size_t> queued_;    // location -> 排队数
+    std::deque<Waiter> queue_;                          // 等待并发名额的请求（FIFO）
+    bool draining_;                                     // drainQueue() 不重入
+
+    /**
+     * @brief GET、没有 Authorization、location开启了 cgi_cache（HEAD在路由前已返回405，不经过CGI）
+     */
+    static bool isCacheable(const HttpRequest& request, const LocationConfig& location);
+
+    /**
+     * @brief 取得location的微缓存，第一次使用时创建
+     */
+    CGICache* getCache(const LocationConfig& location);
+
+    /**
+     * @brief 任务结束：释放它持有的cache lock，把结果交给等待者（不可共享时让它们自己执行）
+     *
+     * @param response 任务的响应，失败时为 NULL
+     */
+    void endFill(int clientFd, const std::string* response);
+
+    /**
+     * @brief 等待cache lock的请求自己执行（经过并发准入），失败时以502/503报告
+     */
+    void startWaiter(const Waiter& waiter);
+
+    /**
+     * @brief 报告一个没有任务的结果（finish() 取走）
+     */
+    void setResult(int clientFd, int status, const std::string& error);
+
+    /**
+     * @brief 等待超过 cgi_cache_lock_timeout 的请求自己执行，排队超时的请求以503报告
+     */
+    void expireWaiters(long long nowMs);
+
+    /**
+     * @brief location和全局都还有并发名额
+     */
+    bool hasSlot(const LocationConfig& location) const;
+
+    /**
+     * @brief 适用于该location的排队超时（location和全局中较短的）
+     */
+    long long queueTimeoutMs(const LocationConfig& location) const;
+
+    /**
+     * @brief 任务结束：释放并发名额，启动排队的请求
+     */
+    void endJob(int clientFd);
+
+    /**
+     * @brief 按FIFO顺序启动有名额的排队请求
+     */
+    void drainQueue();
+
+    /**
+     * @brief 请求离开队列（启动、超时或客户端断开）
+     */
+    void unqueue(const Waiter& waiter, long long nowMs);
+
+    /**
+     * @brief finish() 的任务部分：取出CGI输出并构建响应
+     */
+    int finishJob(int clientFd, std::string& response, bool chunkedAllowed);
+
+    /**
+     * @brief 启动子进程或常驻worker执行脚本（fork/worker路径）
+     */
+    bool startProcess(int clientFd,
+                      const HttpRequest& request,
+                      const LocationConfig& location,
+                      const std::string& scriptPath);
+
+    /**
+     * @brief header已读完：构建响应开头并把任务转为流式
+     */
+    int startStream(int clientFd, CGIProcess* process, std::string& response, bool chunkedAllowed);
+
+    /**
+     * @brief 取得location对应的worker池，第一次使用时按该location的参数创建
+     */
+    CGIWorkerPool* getWorkerPool(const LocationConfig& location);
+
+    /**
+     * @brief 通过 fastcgi_pass 后端执行（不fork）
+     */
+    bool startFastCGI(int clientFd,
+                      const HttpRequest& request,
+                      const LocationConfig& location,
+                      const std::string& scriptPath);
+
+    /**
+     * @brief 解析CGI输出（CGI进程或FastCGI）并构建HTTP响应
+     *
+     * @param spilledBody rawOutput 之后落盘的body字节数（> 0 时不缓存）
+     * @return 0 成功，502 输出无效
+     */
+    int buildResponse(int clientFd, const std::string& rawOutput, std::string& response, size_t spilledBody = 0);
+
+    /**
+     * @brief FastCGI/worker的输出：内存部分构建响应，落盘部分留给 takeSpill()
+     */
+    int buildResponse(int clientFd, CGIOutputBuffer& output, std::string& response);
+
+    /**
+     * @brief 关闭未被取走的落盘文件
+     */
+    void dropSpill(int clientFd);
+
+    /**
+     * @brief 响应是 X-Accel-Redirect / X-Sendfile 时记录文件发送请求（不缓存）
+     *
+     * @return true 已记录，body应丢弃
+     */
+    bool recordOffload(int clientFd, const CGIResponse& cgiResponse);
 
     /**
      * @brief 设置错误信息
@@ -0,0 +1,108 @@
+#include "cgi_output_buffer.hpp"
+#include "../utils/server_stats.hpp"
+#include "../utils/logger.hpp"
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+CGIOutputBuffer::CGIOutputBuffer()
+    : limit_(static_cast<size_t>(-1)), spillFd_(-1), spilled_(0), failed_(false) {
+}
+
+CGIOutputBuffer::~CGIOutputBuffer() {
+    clear();
+}
+
+void CGIOutputBuffer::setLimit(size_t limit, const std::string& tempDir) {
+    limit_ = limit < MIN_LIMIT ? MIN_LIMIT : limit;
+    tempDir_ = tempDir;
+}
+
+bool CGIOutputBuffer::append(const char* data, size_t length) {
+    if (failed_)
+        return false;
+    size_t oldSize = memory_.size();
+    if (spillFd_ == -1 && memory_.size() < limit_) {
+        size_t room = limit_ - memory_.size();
+        size_t kept = length < room ? length : room;
+        memory_.append(data, kept);
+        setMemory(oldSize);
+        data += kept;
+        length -= kept;
+    }
+    return length == 0 || spill(data, length);
+}
+
+/* past the limit everything goes to the file, in order; the file has no name from the start */
+bool CGIOutputBuffer::spill(const char* data, size_t length) {
+    if (spillFd_ == -1) {
+        std::string pattern = tempDir_.empty() ? std::string("/tmp") : tempDir_;
+        pattern += "/webserv-cgi.XXXXXX";
+        std::vector<char> path(pattern.begin(), pattern.end());
+        path.push_back('\0');
+        spillFd_ = mkstemp(&path[0]);
+        if (spillFd_ == -1) {
+            LOG_ERROR << "❌ CGI output: cannot create temp file in " << tempDir_;
+            failed_ = true;
+            return false;
+        }
+        unlink(&path[0]);
+        fcntl(spillFd_, F_SETFD, FD_CLOEXEC);
+        ++ServerStats::cgi.outputSpills;
+    }
+    while (length > 0) {
+        ssize_t written = write(spillFd_, data, length);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0) {
+            LOG_ERROR << "❌ CGI output: temp file write failed";
+            failed_ = true;
+            return false;
+        }
+        data += written;
+        length -= written;
+        spilled_ += written;
+        ServerStats::cgi.outputSpilled += static_cast<unsigned long long>(written);
+    }
+    return true;
+}
+
+int CGIOutputBuffer::takeSpill() {
+    int fd = spillFd_;
+    if (fd != -1 && lseek(fd, 0, SEEK_SET) == -1) {
+        close(fd);
+        fd = -1;
+    }
+    spillFd_ = -1;
+    spilled_ = 0;
+    return fd;
+}
+
+void CGIOutputBuffer::swap(CGIOutputBuffer& other) {
+    memory_.swap(other.memory_);
+    std::swap(limit_, other.limit_);
+    tempDir_.swap(other.tempDir_);
+    std::swap(spillFd_, other.spillFd_);
+    std::swap(spilled_, other.spilled_);
+    std::swap(failed_, other.failed_);
+}
+
+void CGIOutputBuffer::clear() {
+    size_t oldSize = memory_.size();
+    std::string().swap(memory_);
+    setMemory(oldSize);
+    if (spillFd_ != -1)
+        close(spillFd_);
+    spillFd_ = -1;
+    spilled_ = 0;
+    failed_ = false;
+}
+
+// the gauge follows what is held in memory, whichever buffer holds it
+void CGIOutputBuffer::setMemory(size_t oldSize) {
+    ServerStats::cgi.outputBuffered -= oldSize;
+    ServerStats::cgi.outputBuffered += memory_.size();
+}
@@ -0,0 +1,73 @@
+#ifndef CGI_OUTPUT_BUFFER_HPP
+#define CGI_OUTPUT_BUFFER_HPP
+
+#include <string>
+#include <sys/types.h>
+
+/**
+ * @brief 有上限的CGI输出缓冲（cgi_output_buffer，FastCGI和常驻worker使用）
+ *
+ * 这两种后端只在任务完成后一次交出输出，无法对管道施加背压，所以：
+ *   - 内存中最多保留 limit 字节（至少 MIN_LIMIT，保证header块在内存中）
+ *   - 超出部分写入临时目录中已unlink的文件，fd关闭时空间自动释放
+ *   - 发送时先发内存部分，其余由事件循环从文件 sendfile()
+ *   - 内存中的字节数和落盘字节数记入 ServerStats::cgi
+ */
+class CGIOutputBuffer {
+public:
+    static const size_t MIN_LIMIT = 16 * 1024;
+
+    CGIOutputBuffer();
+    ~CGIOutputBuffer();
+
+    /**
+     * @brief 设置内存上限和临时文件目录（append 之前调用）
+     */
+    void setLimit(size_t limit, const std::string& tempDir);
+
+    /**
+     * @brief 追加输出，超过上限的部分写入临时文件
+     *
+     * @return false 临时文件创建/写入失败（failed() 之后一直为 true）
+     */
+    bool append(const char* data, size_t length);
+
+    /**
+     * @brief 内存中的部分（输出的开头）
+     */
+    const std::string& memory() const { return memory_; }
+
+    size_t size() const { return memory_.size() + static_cast<size_t>(spilled_); }
+    bool empty() const { return size() == 0; }
+    off_t spilled() const { return spilled_; }
+    bool failed() const { return failed_; }
+
+    /**
+     * @brief 取出临时文件（已定位到开头），调用者负责关闭；没有时返回 -1
+     */
+    int takeSpill();
+
+    /**
+     * @brief 与另一个缓冲交换全部内容（finish() 交出输出用）
+     */
+    void swap(CGIOutputBuffer& other);
+
+    void clear();
+
+private:
+    std::string memory_;
+    size_t limit_;
+    std::string tempDir_;
+    int spillFd_;               // 已unlink的临时文件，-1 = 没有落盘
+    off_t spilled_;             // 已写入临时文件的字节数
+    bool failed_;
+
+    bool spill(const char* data, size_t length);
+    void setMemory(size_t oldSize);
+
+    // 禁止拷贝构造和赋值
+    CGIOutputBuffer(const CGIOutputBuffer&);
+    CGIOutputBuffer& operator=(const CGIOutputBuffer&);
+};
+
+#endif // CGI_OUTPUT_BUFFER_HPP
@@ -1,268 +1,389 @@
 #include "cgi_process.hpp"
+#include "cgi_response.hpp"
+#include "../utils/server_clock.hpp"
+#include "../utils/server_stats.hpp"
+#include "../utils/logger.hpp"
+#include "../utils/fd_limit.hpp"
+#include <sys/ioctl.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/wait.h>
-#include <sys/select.h>
+#include <sys/syscall.h>
 #include <signal.h>
+#include <spawn.h>
+#include <errno.h>
 #include <cstring>
-#include <iostream>
-#include <ctime>
-#include <sys/time.h>
 
-CGIProcess::CGIProcess() : childPid_(-1), pipesCreated_(false) {
-    inputPipe_[0] = inputPipe_[1] = -1;
-    outputPipe_[0] = outputPipe_[1] = -1;
+// a header block is searched for in the first 64 KB only, output without one is buffered whole
+static const size_t MAX_HEADER_SCAN = 65536;
+
+// pipe capacities: Linux defaults to 64 KB, unprivileged processes may go up to
+// /proc/sys/fs/pipe-max-size (1 MB by default)
+static const size_t DEFAULT_PIPE_SIZE = 65536;
+static const size_t INPUT_PIPE_SIZE = 1024 * 1024;
+static const size_t OUTPUT_PIPE_SIZE = 256 * 1024;
+
+CGIProcess::CGIProcess()
+    : childPid_(-1), stdinFd_(-1), stdoutFd_(-1), pidFd_(-1), inputOffset_(0),
+      deadlineMs_(0), timeoutMs_(0), exitStatus_(0), timedOut_(false), failed_(false), outOfFds_(false),
+      headersReady_(false), streaming_(false), outputReadable_(false), useSplice_(true),
+      streamAllowed_(true), outputLimit_(static_cast<size_t>(-1)) {
 }
 
 CGIProcess::~CGIProcess() {
     killProcess();
-    closePipes();
+    closeFd(stdinFd_);
+    closeFd(stdoutFd_);
+    closeFd(pidFd_);
 }
 
-bool CGIProcess::execute(const std::string& cgiPath,
-                        const std::string& scriptPath,
-                        char** envp,
-                        const std::string& inputData,
-                        std::string& output,
-                        int timeoutSeconds) {
-    std::cout << "🔧 CGI: Starting execution..." << std::endl;
-    std::cout << "🔧 CGI: Path: " << cgiPath << std::endl;
-    std::cout << "🔧 CGI: Script: " << scriptPath << std::endl;
-    std::cout << "🔧 CGI: Timeout: " << timeoutSeconds << "s" << std::endl;
+bool CGIProcess::start(const std::string& cgiPath,
+                       const std::string& scriptPath,
+                       char** envp,
+                       const std::string& inputData,
+                       int timeoutSeconds) {
+    LOG_DEBUG << "🔧 CGI: Starting " << cgiPath << " " << scriptPath
+              << " (timeout=" << timeoutSeconds << "s)";
 
     lastError_.clear();
+    outOfFds_ = false;
 
     // 创建管道
-    std::cout << "🔧 CGI: Creating pipes..." << std::endl;
-    if (!createPipes()) {
-        std::cout << "❌ CGI: Failed to create pipes" << std::endl;
+    int inputPipe[2];
+    int outputPipe[2];
+    if (!createPipes(inputPipe, outputPipe)) {
+        LOG_ERROR << "❌ CGI: Failed to create pipes";
         return false;
     }
-    std::cout << "✅ CGI: Pipes created successfully" << std::endl;
-
-    // Fork子进程
-    std::cout << "🔧 CGI: Forking child process..." << std::endl;
-    childPid_ = fork();
-    if (childPid_ == -1) {
-        std::cout << "❌ CGI: Fork failed" << std::endl;
-        setError("Failed to fork process");
-        closePipes();
+    // fewer select() rounds per large body; small bodies keep the default pipe
+    if (inputData.size() > DEFAULT_PIPE_SIZE)
+        growPipe(inputPipe[1], inputData.size() < INPUT_PIPE_SIZE ? inputData.size() : INPUT_PIPE_SIZE);
+    growPipe(outputPipe[0], OUTPUT_PIPE_SIZE);
+
+    // posix_spawn: glibc uses clone(CLONE_VM|CLONE_VFORK), no page tables are copied however
+    // large the server is, and nothing runs in the child between the dup2s and execve
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attributes;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, inputPipe[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, outputPipe[1], STDOUT_FILENO);
+    posix_spawnattr_init(&attributes);
+    sigset_t defaults;
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE); // the server ignores it, scripts expect the default
+    posix_spawnattr_setsigdefault(&attributes, &defaults);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGDEF);
+
+    char* argv[] = {
+        const_cast<char*>(cgiPath.c_str()),
+        const_cast<char*>(scriptPath.c_str()),
+        NULL
+    };
+    long long spawnStartUs = ServerClock::preciseUs();
+    int spawnError = posix_spawn(&childPid_, cgiPath.c_str(), &actions, &attributes, argv, envp);
+    ServerStats::countSpawn(ServerClock::preciseUs() - spawnStartUs);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    if (spawnError != 0) {
+        LOG_ERROR << "❌ CGI: Spawn failed: " << strerror(spawnError);
+        setError(std::string("Failed to spawn process: ") + strerror(spawnError));
+        childPid_ = -1;
+        close(inputPipe[0]);
+        close(inputPipe[1]);
+        close(outputPipe[0]);
+        close(outputPipe[1]);
         return false;
     }
 
-    if (childPid_ == 0) {
-        // 子进程：执行CGI
-        std::cerr << "🔧 CGI Child: Setting up child process..." << std::endl;
-        setupChildProcess(cgiPath, scriptPath, envp);
-        // execve 不应该返回，如果返回说明出错
-        std::cerr << "❌ CGI Child: execve failed, exiting" << std::endl;
-        exit(1);
-    } else {
-        // 父进程：处理I/O
-        std::cout << "🔧 CGI Parent: Child PID: " << childPid_ << std::endl;
-        std::cout << "🔧 CGI Parent: Handling parent process..." << std::endl;
-        return handleParentProcess(inputData, output, timeoutSeconds);
-    }
+    // 父进程：关闭子进程使用的管道端，剩下的交给事件循环
+    LOG_DEBUG << "🔧 CGI Parent: Child PID: " << childPid_;
+    close(inputPipe[0]);
+    close(outputPipe[1]);
+    stdinFd_ = inputPipe[1];
+    stdoutFd_ = outputPipe[0];
+
+    input_ = inputData;
+    inputOffset_ = 0;
+    if (input_.empty())
+        closeFd(stdinFd_); // 没有body，子进程立即读到EOF
+
+    // pidfd: 子进程退出时变为可读，可以直接放进select()
+#ifdef SYS_pidfd_open
+    pidFd_ = static_cast<int>(syscall(SYS_pidfd_open, childPid_, 0));
+    if (pidFd_ != -1 && !fitsFdSet(pidFd_))
+        closeFd(pidFd_);    // too high for select(): reaped by polling instead (needsPolling)
+    if (pidFd_ != -1)
+        fcntl(pidFd_, F_SETFD, FD_CLOEXEC);
+#endif
+
+    timeoutMs_ = static_cast<long long>(timeoutSeconds) * 1000;
+    deadlineMs_ = ServerClock::monotonicMs() + timeoutMs_;
+    return true;
 }
 
-bool CGIProcess::createPipes() {
-    if (pipe(inputPipe_) == -1 || pipe(outputPipe_) == -1) {
+// all four ends are close-on-exec: the child's copies survive through the spawn dup2s,
+// other CGI children must not inherit them or they would hold the pipes open
+// the parent ends go into select(): out of fds or past FD_SETSIZE the CGI is refused (outOfFds)
+bool CGIProcess::createPipes(int inputPipe[2], int outputPipe[2]) {
+    if (pipe(inputPipe) == -1) {
+        outOfFds_ = (errno == EMFILE || errno == ENFILE);
+        setError("Failed to create pipes");
+        return false;
+    }
+    if (pipe(outputPipe) == -1) {
+        outOfFds_ = (errno == EMFILE || errno == ENFILE);
+        close(inputPipe[0]);
+        close(inputPipe[1]);
         setError("Failed to create pipes");
         return false;
     }
-    pipesCreated_ = true;
+    int fds[4] = { inputPipe[0], inputPipe[1], outputPipe[0], outputPipe[1] };
+    if (!fitsFdSet(inputPipe[1]) || !fitsFdSet(outputPipe[0])) {
+        for (int i = 0; i < 4; ++i)
+            close(fds[i]);
+        outOfFds_ = true;
+        setError("Pipe fds beyond the select() limit (FD_SETSIZE)");
+        return false;
+    }
+    for (int i = 0; i < 4; ++i)
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+    // parent ends are driven by select(), never block on them
+    fcntl(inputPipe[1], F_SETFL, fcntl(inputPipe[1], F_GETFL, 0) | O_NONBLOCK);
+    fcntl(outputPipe[0], F_SETFL, fcntl(outputPipe[0], F_GETFL, 0) | O_NONBLOCK);
     return true;
 }
 
-void CGIProcess::closePipes() {
-    if (pipesCreated_) {
-        if (inputPipe_[0] != -1) close(inputPipe_[0]);
-        if (inputPipe_[1] != -1) close(inputPipe_[1]);
-        if (outputPipe_[0] != -1) close(outputPipe_[0]);
-        if (outputPipe_[1] != -1) close(outputPipe_[1]);
-        pipesCreated_ = false;
-    }
+// best effort: over the limit (EPERM) or without F_SETPIPE_SZ the pipe keeps its size
+void CGIProcess::growPipe(int fd, size_t size) {
+#ifdef F_SETPIPE_SZ
+    if (fcntl(fd, F_SETPIPE_SZ, static_cast<int>(size)) == -1 && size > DEFAULT_PIPE_SIZE)
+        fcntl(fd, F_SETPIPE_SZ, static_cast<int>(DEFAULT_PIPE_SIZE));
+#else
+    (void)fd;
+    (void)size;
+#endif
 }
 
-bool CGIProcess::setupChildProcess(const std::string& cgiPath,
-                                  const std::string& scriptPath,
-                                  char** envp) {
-    std::cout << "🔧 CGI Child: Redirecting stdin/stdout..." << std::endl;
-    // 重定向stdin和stdout
-    dup2(inputPipe_[0], STDIN_FILENO);
-    dup2(outputPipe_[1], STDOUT_FILENO);
-    // dup2(outputPipe_[1], STDERR_FILENO);
-
-    std::cout << "🔧 CGI Child: Closing unused pipe ends..." << std::endl;
-    // 关闭不需要的管道端
-    close(inputPipe_[1]);
-    close(outputPipe_[0]);
-    close(inputPipe_[0]);
-    close(outputPipe_[1]);
-
-    // 不切换目录，直接使用完整路径执行脚本
-    std::cout << "🔧 CGI Child: Using full script path: " << scriptPath << std::endl;
-
-    // 执行CGI程序
-    char* argv[] = {
-        const_cast<char*>(cgiPath.c_str()),
-        const_cast<char*>(scriptPath.c_str()),
-        NULL
-    };
-
-    std::cerr << "🔧 CGI Child: Executing: " << cgiPath << " " << scriptPath << std::endl;
-    execve(cgiPath.c_str(), argv, envp);
-    std::cerr << "❌ CGI Child: Failed to execute CGI: " << cgiPath << std::endl;
-    return false;
+void CGIProcess::addFds(fd_set* readFds, fd_set* writeFds, int& maxFd) const {
+    if (stdinFd_ != -1) {
+        FD_SET(stdinFd_, writeFds);
+        if (stdinFd_ > maxFd) maxFd = stdinFd_;
+    }
+    if (stdoutFd_ != -1 && !outputReadable_ && !headersReady()) {
+        FD_SET(stdoutFd_, readFds);
+        if (stdoutFd_ > maxFd) maxFd = stdoutFd_;
+    }
+    if (pidFd_ != -1 && childPid_ > 0) {
+        FD_SET(pidFd_, readFds);
+        if (pidFd_ > maxFd) maxFd = pidFd_;
+    }
 }
 
-bool CGIProcess::handleParentProcess(const std::string& inputData,
-                                    std::string& output,
-                                    int timeoutSeconds) {
-    std::cout << "🔧 CGI Parent: Closing child's pipe ends..." << std::endl;
-    // 关闭子进程使用的管道端
-    close(inputPipe_[0]);
-    close(outputPipe_[1]);
-
-    // 发送输入数据
-    std::cout << "🔧 CGI Parent: Sending input data (" << inputData.length() << " bytes)..." << std::endl;
-    if (!inputData.empty()) {
-        writeToPipe(inputPipe_[1], inputData);
-    }
-    close(inputPipe_[1]);
-
-    // 读取输出
-    std::cout << "🔧 CGI Parent: Reading output from child..." << std::endl;
-    bool success = readFromPipe(outputPipe_[0], output, timeoutSeconds);
-    std::cout << "🔧 CGI Parent: Read " << output.length() << " bytes from child" << std::endl;
-    close(outputPipe_[0]);
-
-    // 等待子进程结束
-    std::cout << "🔧 CGI Parent: Waiting for child to finish..." << std::endl;
-    if (!waitForChild(timeoutSeconds)) {
-        std::cout << "❌ CGI Parent: Child timeout or error, killing child" << std::endl;
-        killChild();
-        setError("CGI process timeout or error");
-        return false;
+/* stdin & stdout are pumped in the same pass, so a script that answers
+   before consuming its whole body cannot deadlock against us */
+void CGIProcess::handleIO(const fd_set* readFds, const fd_set* writeFds) {
+    if (stdinFd_ != -1 && FD_ISSET(stdinFd_, writeFds))
+        writeInput();
+    if (stdoutFd_ != -1 && FD_ISSET(stdoutFd_, readFds)) {
+        if (streaming_)
+            outputReadable_ = true; // the client side forwards it
+        else
+            readOutput();
     }
 
-    std::cout << "✅ CGI Parent: Child finished successfully" << std::endl;
-    return success;
+    if (childPid_ > 0) {
+        if (pidFd_ != -1) {
+            if (FD_ISSET(pidFd_, readFds))
+                reapChild();
+        }
+        else if (stdoutFd_ == -1)
+            reapChild(); // no pidfd: poll once the output is done
+    }
 }
 
-bool CGIProcess::readFromPipe(int fd, std::string& output, int timeoutSeconds) {
-    output.clear();
-    char buffer[4096];
+void CGIProcess::writeInput() {
+    while (inputOffset_ < input_.size()) {
+        ssize_t written = write(stdinFd_, input_.data() + inputOffset_, input_.size() - inputOffset_);
+        if (written > 0) {
+            inputOffset_ += written;
+            ServerStats::cgi.pipeIn += static_cast<unsigned long long>(written);
+            continue;
+        }
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return; // pipe full, wait for the next writable event
+        if (written < 0 && errno == EINTR)
+            continue;
+        // EPIPE: the script does not read its body, that is not an error for the response
+        break;
+    }
+    closeFd(stdinFd_);
+}
 
-    fd_set readSet;
-    struct timeval timeout;
-    timeout.tv_sec = timeoutSeconds;
-    timeout.tv_usec = 0;
+void CGIProcess::readOutput() {
+    char buffer[16384];
 
     while (true) {
-        FD_ZERO(&readSet);
-        FD_SET(fd, &readSet);
-
-        int result = select(fd + 1, &readSet, NULL, NULL, &timeout);
-        if (result == 0) {
-            // 超时
-            break;
+        ssize_t bytesRead = read(stdoutFd_, buffer, sizeof(buffer));
+        if (bytesRead > 0) {
+            output_.append(buffer, bytesRead);
+            ServerStats::cgi.pipeOut += static_cast<unsigned long long>(bytesRead);
+            size_t separatorLength;
+            if (!streamAllowed_ && output_.size() > outputLimit_) {
+                // too big to hold for the cache: stream it, the rest waits in the pipe
+                streamAllowed_ = true;
+                if (CGIResponse::findHeaderEnd(output_, separatorLength) != std::string::npos) {
+                    headersReady_ = true;
+                    return;
+                }
+            }
+            // headers complete: leave the body in the pipe, it is streamed to the client
+            if (streamAllowed_ && output_.size() - bytesRead < MAX_HEADER_SCAN
+                && CGIResponse::findHeaderEnd(output_, separatorLength) != std::string::npos) {
+                headersReady_ = true;
+                return;
+            }
+            continue;
         }
-        if (result < 0) {
-            setError("select() failed during CGI output reading");
-            return false;
+        if (bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (bytesRead < 0 && errno == EINTR)
+            continue;
+        if (bytesRead < 0) {
+            setError("read() failed on CGI output");
+            failed_ = true;
         }
+        break; // EOF
+    }
+    LOG_DEBUG << "🔧 CGI Parent: Read " << output_.length() << " bytes from child";
+    closeFd(stdoutFd_);
+}
 
-        ssize_t bytesRead = read(fd, buffer, sizeof(buffer));
-        if (bytesRead <= 0) {
-            break; // EOF或错误
-        }
+bool CGIProcess::reapChild() {
+    int status = 0;
+    pid_t result = waitpid(childPid_, &status, WNOHANG);
 
-        output.append(buffer, bytesRead);
+    if (result == 0)
+        return false; // 子进程还在运行
+    if (result == childPid_) {
+        exitStatus_ = status;
+        LOG_DEBUG << "🔧 CGI Parent: Child " << childPid_ << " exited, status=" << status;
     }
-
+    else {
+        // waitpid 出错
+        setError("waitpid() failed");
+        failed_ = true;
+    }
+    childPid_ = -1;
+    closeFd(pidFd_);
     return true;
 }
 
-bool CGIProcess::writeToPipe(int fd, const std::string& data) {
-    size_t totalWritten = 0;
-    while (totalWritten < data.size()) {
-        ssize_t bytesWritten = write(fd, data.c_str() + totalWritten,
-                                   data.size() - totalWritten);
-        if (bytesWritten <= 0) {
-            return false;
-        }
-        totalWritten += bytesWritten;
-    }
-    return true;
+void CGIProcess::beginStreaming(std::string& output) {
+    output.swap(output_);
+    output_.clear();
+    streaming_ = true;
+    // from here the timeout is for inactivity: a slow client holds the script back
+    // through the pipe, that is not the script hanging
+    deadlineMs_ = ServerClock::monotonicMs() + timeoutMs_;
 }
 
-bool CGIProcess::waitForChild(int timeoutSeconds) {
-    int status;
-
-    // 使用循环和短暂的非阻塞检查，而不是sleep
-    time_t startTime = time(NULL);
-    time_t currentTime;
-
-    std::cout << "🔧 CGI Parent: Waiting for child PID " << childPid_ << " (timeout=" << timeoutSeconds << "s)" << std::endl;
-
-    do {
-        pid_t result = waitpid(childPid_, &status, WNOHANG);
-        currentTime = time(NULL);
-
-        if (result == childPid_) {
-            // 子进程已结束
-            std::cout << "🔧 CGI Parent: Child exited, status=" << status << std::endl;
-            std::cout << "🔧 CGI Parent: WIFEXITED=" << WIFEXITED(status) << ", WEXITSTATUS=" << WEXITSTATUS(status) << std::endl;
-            childPid_ = -1;
-            return WIFEXITED(status) && WEXITSTATUS(status) == 0;
-        } else if (result == -1) {
-            // waitpid 出错
-            std::cout << "❌ CGI Parent: waitpid error" << std::endl;
-            childPid_ = -1;
-            return false;
-        }
+size_t CGIProcess::availableOutput() const {
+    int available = 0;
+    if (stdoutFd_ == -1 || ioctl(stdoutFd_, FIONREAD, &available) == -1)
+        return 0;
+    return static_cast<size_t>(available);
+}
 
-        // 子进程还在运行，检查超时
-        if (currentTime - startTime >= timeoutSeconds) {
-            // 超时
-            std::cout << "❌ CGI Parent: Timeout after " << (currentTime - startTime) << "s" << std::endl;
-            return false;
+ssize_t CGIProcess::transferOutput(int socketFd, size_t maxBytes, std::string& fallback) {
+#ifdef SPLICE_F_NONBLOCK
+    if (useSplice_) {
+        // no SPLICE_F_MORE: it corks the socket, and the last piece of a body then waited
+        // out the 200 ms cork timer whenever the script wrote it separately from the headers
+        ssize_t moved = splice(stdoutFd_, NULL, socketFd, NULL, maxBytes, SPLICE_F_NONBLOCK);
+        if (moved > 0) {
+            ServerStats::http.bytesOut += static_cast<unsigned long long>(moved);
+            ServerStats::cgi.pipeOut += static_cast<unsigned long long>(moved);
+            deadlineMs_ = ServerClock::monotonicMs() + timeoutMs_;
         }
+        if (moved >= 0 || errno != EINVAL)
+            return moved;
+        useSplice_ = false; // socket type without splice support
+    }
+#else
+    (void)socketFd;
+#endif
+    char buffer[16384];
+    ssize_t bytesRead = read(stdoutFd_, buffer, maxBytes < sizeof(buffer) ? maxBytes : sizeof(buffer));
+    if (bytesRead > 0) {
+        fallback.append(buffer, bytesRead);
+        ServerStats::cgi.pipeOut += static_cast<unsigned long long>(bytesRead);
+        deadlineMs_ = ServerClock::monotonicMs() + timeoutMs_;
+    }
+    return bytesRead;
+}
 
-        if ((currentTime - startTime) % 2 == 0 && (currentTime - startTime) > 0) {
-            std::cout << "🔧 CGI Parent: Still waiting... elapsed=" << (currentTime - startTime) << "s" << std::endl;
-        }
+bool CGIProcess::checkTimeout(long long nowMs) {
+    if (isComplete() || nowMs < deadlineMs_)
+        return false;
+    LOG_WARN << "❌ CGI Parent: Timeout, killing child " << childPid_;
+    killChild();
+    closeFd(stdinFd_);
+    closeFd(stdoutFd_);
+    timedOut_ = true;
+    setError("CGI process timeout");
+    return true;
+}
 
-        // 短暂等待，避免忙等待
-        usleep(10000); // 等待10毫秒
+bool CGIProcess::isComplete() const {
+    if (timedOut_ || failed_)
+        return true;
+    return stdoutFd_ == -1 && childPid_ <= 0;
+}
 
-    } while (true);
+bool CGIProcess::succeeded() const {
+    return isComplete() && !timedOut_ && !failed_
+        && WIFEXITED(exitStatus_) && WEXITSTATUS(exitStatus_) == 0;
 }
 
+bool CGIProcess::needsPolling() const {
+    return childPid_ > 0 && pidFd_ == -1 && stdoutFd_ == -1;
+}
+
+std::vector<pid_t> CGIProcess::killed_;
+
+// SIGKILL is not instant (a child in uninterruptible sleep dies when it wakes up):
+// reap it now if it is already gone, otherwise later from reapKilled(), never blocking the loop
 void CGIProcess::killChild() {
     if (childPid_ > 0) {
-        kill(childPid_, SIGTERM);
-        sleep(1);
-        if (waitpid(childPid_, NULL, WNOHANG) == 0) {
-            kill(childPid_, SIGKILL);
-            waitpid(childPid_, NULL, 0);
-        }
+        kill(childPid_, SIGKILL);
+        if (waitpid(childPid_, NULL, WNOHANG) == 0)
+            killed_.push_back(childPid_);
         childPid_ = -1;
     }
+    closeFd(pidFd_);
+}
+
+void CGIProcess::reapKilled() {
+    for (size_t i = 0; i < killed_.size(); ) {
+        pid_t result = waitpid(killed_[i], NULL, WNOHANG);
+        if (result == killed_[i] || (result == -1 && errno == ECHILD))
+            killed_.erase(killed_.begin() + i);
+        else
+            ++i;
+    }
 }
 
 void CGIProcess::killProcess() {
     killChild();
 }
 
-std::string CGIProcess::getScriptDirectory(const std::string& scriptPath) {
-    size_t lastSlash = scriptPath.find_last_of('/');
-    if (lastSlash == std::string::npos) {
-        return ".";
+void CGIProcess::closeFd(int& fd) {
+    if (fd != -1) {
+        close(fd);
+        fd = -1;
     }
-    return scriptPath.substr(0, lastSlash);
 }
 
 void CGIProcess::setError(const std::string& error) {
     lastError_ = error;
-}
\ No newline at end of file
+}
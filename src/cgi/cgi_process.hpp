@@ -2,14 +2,21 @@
 #define CGI_PROCESS_HPP
 
 #include <string>
+#include <vector>
 #include <sys/types.h>
+#include <sys/select.h>
 #include <stdlib.h>
 
 /**
- * @brief CGI进程管理器
+ * @brief CGI进程管理器（非阻塞）
  *
- * 负责fork子进程、执行CGI程序、管理进程间通信
- * 处理进程超时、错误恢复等
+ * 负责用posix_spawn启动CGI程序（vfork语义，不复制父进程页表）、管理进程间通信
+ * stdin/stdout管道为非阻塞fd，由主事件循环的select()驱动：
+ *   start() -> addFds() / handleIO() 循环 -> isComplete()
+ * 子进程通过pidfd回收（内核不支持时退回 waitpid(WNOHANG) 轮询）
+ *
+ * 流式输出：读到header块的空行后停止读取（headersReady），调用方取走header后
+ * beginStreaming()，body留在管道里，由 transferOutput() 直接转发到客户端socket
  */
 class CGIProcess {
 public:
@@ -19,140 +26,242 @@ public:
     CGIProcess();
 
     /**
-     * @brief 析构函数
+     * @brief 析构函数，仍在运行的子进程会被杀死（回收见 reapKilled）
      */
     ~CGIProcess();
 
     /**
-     * @brief 执行CGI进程
+     * @brief 启动CGI进程，不等待输出
      *
      * @param cgiPath CGI程序路径（如 /usr/bin/python3）
      * @param scriptPath 脚本文件路径（如 ./www/test.py）
-     * @param envp 环境变量数组
-     * @param inputData 输入数据（POST body等）
-     * @param output 输出数据（CGI程序的输出）
+     * @param envp 环境变量数组（start返回后即可释放/复用）
+     * @param inputData 输入数据（POST body等），在事件循环中逐步写入
      * @param timeoutSeconds 超时时间（秒）
-     * @return true 执行成功，false 执行失败
+     * @return true 子进程已启动，false 启动失败
      */
-    bool execute(const std::string& cgiPath,
-                 const std::string& scriptPath,
-                 char** envp,
-                 const std::string& inputData,
-                 std::string& output,
-                 int timeoutSeconds = 30);
+    bool start(const std::string& cgiPath,
+               const std::string& scriptPath,
+               char** envp,
+               const std::string& inputData,
+               int timeoutSeconds = 30);
 
     /**
-     * @brief 获取最后的错误信息
+     * @brief 把仍在使用的管道fd / pidfd 加入select集合
      *
-     * @return 错误描述字符串
+     * @param readFds 读集合（stdout、pidfd）
+     * @param writeFds 写集合（stdin，尚有输入未写完时）
+     * @param maxFd 更新为最大fd
      */
-    const std::string& getLastError() const { return lastError_; }
+    void addFds(fd_set* readFds, fd_set* writeFds, int& maxFd) const;
 
     /**
-     * @brief 检查是否有进程正在运行
+     * @brief 处理select()返回的就绪fd：写stdin、读stdout、回收子进程
+     */
+    void handleIO(const fd_set* readFds, const fd_set* writeFds);
+
+    /**
+     * @brief 检查超时，超时则杀死子进程
      *
-     * @return true 有进程运行，false 无进程运行
+     * @param nowMs 当前单调时间（毫秒）
+     * @return true 本次调用触发了超时
      */
-    bool isRunning() const { return childPid_ > 0; }
+    bool checkTimeout(long long nowMs);
 
     /**
-     * @brief 强制终止当前CGI进程
+     * @brief 输出已读完且子进程已回收（或超时/出错）
      */
-    void killProcess();
+    bool isComplete() const;
 
-private:
-    std::string lastError_;     // 最后的错误信息
-    pid_t childPid_;           // 子进程PID
-    int inputPipe_[2];         // 输入管道（父进程写，子进程读）
-    int outputPipe_[2];        // 输出管道（子进程写，父进程读）
-    bool pipesCreated_;        // 管道是否已创建
+    /**
+     * @brief 子进程正常退出（exit 0）且未超时
+     */
+    bool succeeded() const;
+
+    /**
+     * @brief 是否因超时被终止
+     */
+    bool timedOut() const { return timedOut_; }
+
+    /**
+     * @brief 输出已读完但没有pidfd，只能靠轮询waitpid回收
+     */
+    bool needsPolling() const;
 
     /**
-     * @brief 创建进程间通信管道
+     * @brief CGI程序的原始输出（headers + body）
      *
-     * @return true 创建成功，false 创建失败
+     * 流式模式下只包含header块和随之读到的第一段body
      */
-    bool createPipes();
+    const std::string& getOutput() const { return output_; }
 
     /**
-     * @brief 关闭所有管道
+     * @brief header块已读完、子进程还在输出body，可以开始流式转发
      */
-    void closePipes();
+    bool headersReady() const { return headersReady_ && !streaming_ && !isComplete(); }
 
     /**
-     * @brief 设置子进程环境
+     * @brief 进入流式模式：不再读入 output_，stdout只用来等待可读
      *
-     * @param cgiPath CGI程序路径
-     * @param scriptPath 脚本路径
-     * @param envp 环境变量
-     * @return true 设置成功，false 设置失败
+     * 之后的超时按空闲计算：每次转发出数据都重新计时，慢客户端不会被总时长截断
+     *
+     * @param output 输出参数，取走目前读到的输出
+     */
+    void beginStreaming(std::string& output);
+
+    bool isStreaming() const { return streaming_; }
+
+    /**
+     * @brief 是否允许流式输出（默认允许；要缓存的响应必须完整读入）
      */
-    bool setupChildProcess(const std::string& cgiPath,
-                          const std::string& scriptPath,
-                          char** envp);
+    void setStreaming(bool allowed) { streamAllowed_ = allowed; }
 
     /**
-     * @brief 处理父进程逻辑
+     * @brief 不流式时输出在内存中的上限（cgi_output_buffer）
      *
-     * @param inputData 要发送给子进程的数据
-     * @param output 从子进程读取的输出
-     * @param timeoutSeconds 超时时间
-     * @return true 处理成功，false 处理失败
+     * 超过后放弃缓存改为流式：其余输出留在管道中，随客户端发送进度读取（背压）
+     */
+    void setOutputLimit(size_t limit) { outputLimit_ = limit; }
+
+    /**
+     * @brief 流式模式下stdout已可读（有数据或EOF），等待转发
+     */
+    bool outputReadable() const { return outputReadable_; }
+
+    /**
+     * @brief 管道中可直接读取的字节数（FIONREAD），0 表示EOF
      */
-    bool handleParentProcess(const std::string& inputData,
-                            std::string& output,
-                            int timeoutSeconds);
+    size_t availableOutput() const;
 
     /**
-     * @brief 等待子进程结束（带超时）
+     * @brief 把最多 maxBytes 字节body从管道转发到socket
      *
-     * @param timeoutSeconds 超时时间
-     * @return true 子进程正常结束，false 超时或错误
+     * Linux上用splice()零拷贝；不支持时read()进 fallback，由调用方send()
+     *
+     * @param socketFd 客户端socket
+     * @param maxBytes 最多转发的字节数（不超过 availableOutput()）
+     * @param fallback 输出参数，未能splice时读出的数据追加到这里
+     * @return 转发/读出的字节数；-1 出错（errno EAGAIN 表示socket已满）
      */
-    bool waitForChild(int timeoutSeconds);
+    ssize_t transferOutput(int socketFd, size_t maxBytes, std::string& fallback);
 
     /**
-     * @brief 强制杀死子进程
+     * @brief 可读的数据已转发完，重新等待stdout可读
      */
-    void killChild();
+    void outputDrained() { outputReadable_ = false; }
 
     /**
-     * @brief 设置错误信息
+     * @brief stdout读到EOF，关闭读端
+     */
+    void closeOutput() { closeFd(stdoutFd_); }
+
+    /**
+     * @brief 获取最后的错误信息
      *
-     * @param error 错误描述
+     * @return 错误描述字符串
      */
-    void setError(const std::string& error);
+    const std::string& getLastError() const { return lastError_; }
 
     /**
-     * @brief 从管道读取所有数据
+     * @brief start() 失败是因为fd用尽（EMFILE/ENFILE，或管道fd超出select()的FD_SETSIZE）
      *
-     * @param fd 文件描述符
-     * @param output 输出字符串
-     * @param timeoutSeconds 超时时间
-     * @return true 读取成功，false 读取失败
+     * @return true 应返回503而不是502
      */
-    bool readFromPipe(int fd, std::string& output, int timeoutSeconds);
+    bool outOfFds() const { return outOfFds_; }
 
     /**
-     * @brief 向管道写入数据
+     * @brief 检查是否有进程正在运行
      *
-     * @param fd 文件描述符
-     * @param data 要写入的数据
-     * @return true 写入成功，false 写入失败
+     * @return true 有进程运行，false 无进程运行
      */
-    bool writeToPipe(int fd, const std::string& data);
+    bool isRunning() const { return childPid_ > 0; }
 
     /**
-     * @brief 获取脚本所在目录
+     * @brief 强制终止当前CGI进程
+     */
+    void killProcess();
+
+    /**
+     * @brief 用 F_SETPIPE_SZ 扩大管道容量（尽力而为，失败时保持原大小）
      *
-     * @param scriptPath 脚本完整路径
-     * @return 目录路径
+     * @param fd 管道的任一端
+     * @param size 期望的容量（字节），内核会向上取整到页的整数倍
+     */
+    static void growPipe(int fd, size_t size);
+
+    /**
+     * @brief 回收已被SIGKILL、当时还没退出的子进程（非阻塞，事件循环每轮调用）
      */
-    std::string getScriptDirectory(const std::string& scriptPath);
+    static void reapKilled();
+
+    /**
+     * @brief 还有被杀死、尚未回收的子进程，事件循环应缩短select超时
+     */
+    static bool hasKilled() { return !killed_.empty(); }
+
+private:
+    static std::vector<pid_t> killed_;  // 已SIGKILL、等待 reapKilled() 回收的子进程
+
+    std::string lastError_;     // 最后的错误信息
+    pid_t childPid_;            // 子进程PID，回收后为-1
+    int stdinFd_;               // 父进程写端（子进程stdin），写完后关闭
+    int stdoutFd_;              // 父进程读端（子进程stdout），EOF后关闭
+    int pidFd_;                 // 子进程退出时可读，-1表示不支持
+    std::string input_;         // 待写入的输入数据
+    size_t inputOffset_;        // 已写入的字节数
+    std::string output_;        // 已读取的输出
+    long long deadlineMs_;      // 超时截止时间（单调时钟毫秒），流式时为空闲截止时间
+    long long timeoutMs_;       // 超时时间，流式时每次转发后重新计时
+    int exitStatus_;            // waitpid状态
+    bool timedOut_;             // 是否超时
+    bool failed_;               // 管道/waitpid出错
+    bool outOfFds_;             // start() 因fd用尽失败
+    bool headersReady_;         // output_ 中已有完整的header块
+    bool streaming_;            // body由调用方从管道直接转发
+    bool outputReadable_;       // 流式模式下stdout可读，尚未转发
+    bool useSplice_;            // splice()不可用（EINVAL）后退回 read()
+    bool streamAllowed_;        // false: 即使header已读完也读到EOF
+    size_t outputLimit_;        // 不流式时 output_ 的上限，超过后改为流式
+
+    /**
+     * @brief 创建非阻塞、close-on-exec的管道
+     */
+    bool createPipes(int inputPipe[2], int outputPipe[2]);
+
+    /**
+     * @brief 写stdin直到EAGAIN或写完
+     */
+    void writeInput();
+
+    /**
+     * @brief 读stdout直到EAGAIN或EOF
+     */
+    void readOutput();
+
+    /**
+     * @brief 非阻塞回收子进程
+     *
+     * @return true 子进程已回收
+     */
+    bool reapChild();
+
+    /**
+     * @brief 强制杀死子进程（SIGKILL），还没退出时留给 reapKilled() 回收
+     */
+    void killChild();
+
+    void closeFd(int& fd);
+
+    /**
+     * @brief 设置错误信息
+     *
+     * @param error 错误描述
+     */
+    void setError(const std::string& error);
 
     // 禁止拷贝构造和赋值
     CGIProcess(const CGIProcess&);
     CGIProcess& operator=(const CGIProcess&);
 };
 
-#endif // CGI_PROCESS_HPP
\ No newline at end of file
+#endif // CGI_PROCESS_HPP
@@ -3,13 +3,13 @@
 #include <algorithm>
 #include <iostream>
 
-CGIResponse::CGIResponse() : statusCode_(200), isValid_(false) {
+CGIResponse::CGIResponse() : statusCode_(200), isValid_(false), defaultContentType_(false) {
 }
 
 CGIResponse::~CGIResponse() {
 }
 
-bool CGIResponse::parseRawOutput(const std::string& rawOutput) {
+bool CGIResponse::parseRawOutput(const std::string& rawOutput, size_t moreBody) {
     lastError_.clear();
     reset();
 
@@ -19,21 +19,19 @@ bool CGIResponse::parseRawOutput(const std::string& rawOutput) {
     }
 
     // 查找header和body的分界线
-    size_t headerEnd = rawOutput.find("\r\n\r\n");
+    size_t separatorLength = 0;
+    size_t headerEnd = findHeaderEnd(rawOutput, separatorLength);
     if (headerEnd == std::string::npos) {
-        headerEnd = rawOutput.find("\n\n");
-        if (headerEnd == std::string::npos) {
-            // 没有找到分界线，可能全是body
-            body_ = rawOutput;
-            setDefaultHeaders();
-            isValid_ = true;
-            return true;
-        }
+        // 没有找到分界线，可能全是body
+        body_ = rawOutput;
+        setDefaultHeaders(moreBody);
+        isValid_ = true;
+        return true;
     }
 
     // 分离header和body
     std::string headerSection = rawOutput.substr(0, headerEnd);
-    body_ = rawOutput.substr(headerEnd + 4); // +4 跳过 \r\n\r\n
+    body_.assign(rawOutput, headerEnd + separatorLength, std::string::npos);
 
     // 解析headers
     if (!parseHeaders(headerSection)) {
@@ -41,12 +39,57 @@ bool CGIResponse::parseRawOutput(const std::string& rawOutput) {
     }
 
     // 设置默认headers
-    setDefaultHeaders();
+    setDefaultHeaders(moreBody);
+
+    isValid_ = true;
+    return true;
+}
 
+// the earliest blank line ends the headers, whichever line ending the script uses
+size_t CGIResponse::findHeaderEnd(const std::string& output, size_t& separatorLength) {
+    size_t crlf = output.find("\r\n\r\n");
+    size_t lf = output.find("\n\n");
+    if (lf != std::string::npos && (crlf == std::string::npos || lf < crlf)) {
+        separatorLength = 2;
+        return lf;
+    }
+    separatorLength = 4;
+    return crlf;
+}
+
+bool CGIResponse::parseHeaderBlock(const std::string& headerSection) {
+    lastError_.clear();
+    reset();
+    if (!parseHeaders(headerSection))
+        return false;
+    defaultContentType_ = needsDefaultContentType();
+    if (defaultContentType_)
+        headers_["content-type"] = "text/html";
+    if (headers_.find("connection") == headers_.end())
+        headers_["connection"] = "close";
     isValid_ = true;
     return true;
 }
 
+// X-Accel-Redirect is always honoured, X-Sendfile only where the location allows it
+CGIResponse::Offload CGIResponse::getOffload(bool sendfileAllowed, std::string& target) const {
+    std::map<std::string, std::string>::const_iterator it = headers_.find("x-accel-redirect");
+    if (it != headers_.end() && !it->second.empty()) {
+        target = it->second;
+        return OFFLOAD_ACCEL;
+    }
+    it = headers_.find("x-sendfile");
+    if (sendfileAllowed && it != headers_.end() && !it->second.empty()) {
+        target = it->second;
+        return OFFLOAD_SENDFILE;
+    }
+    return OFFLOAD_NONE;
+}
+
+void CGIResponse::setHeader(const std::string& name, const std::string& value) {
+    headers_[normalizeHeaderName(name)] = value;
+}
+
 bool CGIResponse::parseHeaders(const std::string& headerSection) {
     std::istringstream iss(headerSection);
     std::string line;
@@ -106,6 +149,16 @@ bool CGIResponse::handleSpecialHeader(const std::string& name, const std::string
 }
 
 std::string CGIResponse::buildHTTPResponse() const {
+    // header block first, the body is appended once into a buffer sized for both
+    std::string headerBlock = buildHeaderBlock();
+    std::string response;
+    response.reserve(headerBlock.size() + body_.size());
+    response += headerBlock;
+    response += body_;
+    return response;
+}
+
+std::string CGIResponse::buildHeaderBlock() const {
     std::ostringstream response;
 
     // 状态行
@@ -118,23 +171,20 @@ std::string CGIResponse::buildHTTPResponse() const {
     }
 
     response << "\r\n";
-
-    // Body
-    response << body_;
-
     return response.str();
 }
 
-void CGIResponse::setDefaultHeaders() {
+void CGIResponse::setDefaultHeaders(size_t moreBody) {
     // 设置Content-Length
     if (headers_.find("content-length") == headers_.end()) {
         std::ostringstream oss;
-        oss << body_.length();
+        oss << body_.length() + moreBody;
         headers_["content-length"] = oss.str();
     }
 
     // 设置Content-Type
-    if (needsDefaultContentType()) {
+    defaultContentType_ = needsDefaultContentType();
+    if (defaultContentType_) {
         headers_["content-type"] = "text/html";
     }
 
@@ -195,6 +245,7 @@ void CGIResponse::reset() {
     headers_.clear();
     body_.clear();
     isValid_ = false;
+    defaultContentType_ = false;
     lastError_.clear();
 }
 
@@ -13,6 +13,15 @@
  */
 class CGIResponse {
 public:
+    /**
+     * @brief 由服务器代替CGI发送的body（getOffload() 的结果）
+     */
+    enum Offload {
+        OFFLOAD_NONE,       // 普通响应
+        OFFLOAD_ACCEL,      // X-Accel-Redirect：同一server内的URI，按其location作为静态文件发送
+        OFFLOAD_SENDFILE    // X-Sendfile：文件路径，必须在 cgi_sendfile_root 之内
+    };
+
     /**
      * @brief 构造函数
      */
@@ -33,9 +42,10 @@ public:
      * body content
      *
      * @param rawOutput CGI程序的原始输出
+     * @param moreBody rawOutput 之后还有的body字节数（落盘到临时文件的部分，计入默认的 Content-Length）
      * @return true 解析成功，false 解析失败
      */
-    bool parseRawOutput(const std::string& rawOutput);
+    bool parseRawOutput(const std::string& rawOutput, size_t moreBody = 0);
 
     /**
      * @brief 构建完整的HTTP响应
@@ -44,6 +54,43 @@ public:
      */
     std::string buildHTTPResponse() const;
 
+    /**
+     * @brief 在已读到的CGI输出中查找header块的结束位置（流式转发用）
+     *
+     * @param output 目前读到的输出
+     * @param separatorLength 输出参数：空行分隔符长度（\r\n\r\n 为4，\n\n 为2）
+     * @return header块长度，还没读到空行时返回 npos
+     */
+    static size_t findHeaderEnd(const std::string& output, size_t& separatorLength);
+
+    /**
+     * @brief 只解析header块，body随后从管道流式转发
+     *
+     * 没有 Content-Length 时不补默认值：body长度未知，由调用方决定 chunked 或关闭连接
+     *
+     * @param headerSection header块（不含空行）
+     * @return true 解析成功，false 解析失败
+     */
+    bool parseHeaderBlock(const std::string& headerSection);
+
+    /**
+     * @brief 构建状态行和headers（以空行结束，不含body）
+     */
+    std::string buildHeaderBlock() const;
+
+    /**
+     * @brief 检查脚本是否要求服务器发送文件（此时CGI输出的body被丢弃）
+     *
+     * @param sendfileAllowed location配置了 cgi_sendfile_root；否则 X-Sendfile 按普通header处理
+     * @param target 输出参数：X-Accel-Redirect 的URI或 X-Sendfile 的路径
+     */
+    Offload getOffload(bool sendfileAllowed, std::string& target) const;
+
+    /**
+     * @brief 设置/覆盖一个响应header
+     */
+    void setHeader(const std::string& name, const std::string& value);
+
     /**
      * @brief 获取HTTP状态码
      *
@@ -86,6 +133,11 @@ public:
      */
     void reset();
 
+    /**
+     * @brief Content-Type 是补上的默认值（脚本没有输出）
+     */
+    bool hasDefaultContentType() const { return defaultContentType_; }
+
     /**
      * @brief 检查响应是否有效
      *
@@ -105,6 +157,7 @@ private:
     std::map<std::string, std::string> headers_;    // HTTP headers
     std::string body_;                              // 响应体
     bool isValid_;                                  // 响应是否有效
+    bool defaultContentType_;                       // content-type 由 setDefaultHeaders 补上
     std::string lastError_;                         // 最后的错误信息
 
     /**
@@ -117,8 +170,10 @@ private:
 
     /**
      * @brief 设置默认headers
+     *
+     * @param moreBody 不在 body_ 中的body字节数
      */
-    void setDefaultHeaders();
+    void setDefaultHeaders(size_t moreBody);
 
     /**
      * @brief 检查header行是否有效
@@ -0,0 +1,447 @@
+#include "cgi_worker_pool.hpp"
+#include "cgi_process.hpp"
+#include "../utils/server_clock.hpp"
+#include "../utils/server_stats.hpp"
+#include "../utils/logger.hpp"
+#include "../utils/fd_limit.hpp"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <errno.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+static const size_t MAX_FRAME_HEADER = 64;
+static const long long RESPAWN_DELAY_MS = 1000;
+
+CGIWorkerPool::CGIWorkerPool(const std::string& interpreter,
+                             const std::string& workerScript,
+                             size_t minWorkers,
+                             size_t maxWorkers,
+                             size_t maxRequests,
+                             int idleTimeoutSeconds)
+    : interpreter_(interpreter), workerScript_(workerScript),
+      minWorkers_(minWorkers), maxWorkers_(maxWorkers < 1 ? 1 : maxWorkers),
+      maxRequests_(maxRequests),
+      idleTimeoutMs_(static_cast<long long>(idleTimeoutSeconds) * 1000), respawnAfterMs_(0) {
+    if (minWorkers_ > maxWorkers_)
+        minWorkers_ = maxWorkers_;
+}
+
+CGIWorkerPool::~CGIWorkerPool() {
+    while (!jobs_.empty())
+        release(jobs_.begin()->first);
+    while (!workers_.empty())
+        retireWorker(workers_.back(), false);
+    // workers exit on stdin EOF; give them the chance before the server exits
+    for (size_t i = 0; i < exiting_.size(); ++i)
+        waitpid(exiting_[i], NULL, 0);
+}
+
+void CGIWorkerPool::prespawn() {
+    while (workers_.size() < minWorkers_) {
+        if (!spawnWorker())
+            break;
+    }
+}
+
+/* "REQ <script> <env> <body>\n" + payloads: lengths first, so neither side ever scans
+   the body and binary uploads pass through untouched */
+void CGIWorkerPool::submit(int clientFd,
+                           const std::string& scriptPath,
+                           const std::map<std::string, std::string>& env,
+                           const std::string& body,
+                           int timeoutSeconds,
+                           size_t outputLimit,
+                           const std::string& tempDir) {
+    std::string envBlock;
+    for (std::map<std::string, std::string>::const_iterator it = env.begin(); it != env.end(); ++it) {
+        // a newline inside a value would split the variable; CGI headers cannot carry one anyway
+        if (it->second.find('\n') != std::string::npos)
+            continue;
+        envBlock += it->first;
+        envBlock += '=';
+        envBlock += it->second;
+        envBlock += '\n';
+    }
+
+    Job* job = new Job();
+    job->clientFd = clientFd;
+    std::ostringstream header;
+    header << "REQ " << scriptPath.size() << ' ' << envBlock.size() << ' ' << body.size() << '\n';
+    job->frame.reserve(header.str().size() + scriptPath.size() + envBlock.size() + body.size());
+    job->frame = header.str();
+    job->frame += scriptPath;
+    job->frame += envBlock;
+    job->frame += body;
+    job->output.setLimit(outputLimit, tempDir);
+    job->deadlineMs = ServerClock::monotonicMs() + static_cast<long long>(timeoutSeconds) * 1000;
+    job->exitStatus = 0;
+    job->complete = false;
+    job->failed = false;
+    job->timedOut = false;
+    job->worker = NULL;
+
+    jobs_[clientFd] = job;
+    waiting_.push_back(job);
+    dispatch();
+}
+
+void CGIWorkerPool::addFds(fd_set* readFds, fd_set* writeFds, int& maxFd) const {
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        const Worker* worker = workers_[i];
+        FD_SET(worker->fromFd, readFds);
+        if (worker->fromFd > maxFd) maxFd = worker->fromFd;
+        if (worker->job && worker->writeOffset < worker->job->frame.size()) {
+            FD_SET(worker->toFd, writeFds);
+            if (worker->toFd > maxFd) maxFd = worker->toFd;
+        }
+    }
+}
+
+void CGIWorkerPool::handleIO(const fd_set* readFds, const fd_set* writeFds, std::vector<int>& completed) {
+    // retireWorker() erases from workers_: only advance when the worker survived
+    for (size_t i = 0; i < workers_.size(); ) {
+        Worker* worker = workers_[i];
+        if (worker->job && FD_ISSET(worker->toFd, writeFds) && !flush(worker))
+            continue;
+        if (FD_ISSET(worker->fromFd, readFds) && !readResponse(worker))
+            continue;
+        ++i;
+    }
+
+    long long nowMs = ServerClock::monotonicMs();
+    for (std::map<int, Job*>::iterator it = jobs_.begin(); it != jobs_.end(); ++it) {
+        Job* job = it->second;
+        if (job->complete || nowMs < job->deadlineMs)
+            continue;
+        LOG_WARN << "❌ CGI worker: Timeout for fd=" << job->clientFd;
+        detach(job);
+        job->timedOut = true;
+        completeJob(job, true, "CGI worker timeout");
+    }
+
+    maintain(nowMs);
+    dispatch();
+    reapExited();
+
+    completed.insert(completed.end(), finished_.begin(), finished_.end());
+    finished_.clear();
+}
+
+int CGIWorkerPool::finish(int clientFd, CGIOutputBuffer& output, std::string& error) {
+    std::map<int, Job*>::iterator it = jobs_.find(clientFd);
+    if (it == jobs_.end()) {
+        error = "No CGI worker job for this connection";
+        return 502;
+    }
+    Job* job = it->second;
+
+    int status = 0;
+    if (job->timedOut)
+        status = 504;
+    else if (!job->complete || job->failed)
+        status = 502;
+    else if (job->exitStatus != 0) {
+        job->error = "CGI script exited with non-zero status";
+        status = 502;
+    }
+    output.swap(job->output);
+    error = job->error;
+
+    jobs_.erase(it);
+    detach(job);
+    delete job;
+    return status;
+}
+
+void CGIWorkerPool::release(int clientFd) {
+    std::map<int, Job*>::iterator it = jobs_.find(clientFd);
+    if (it == jobs_.end())
+        return;
+    Job* job = it->second;
+    jobs_.erase(it);
+
+    detach(job);
+    delete job;
+
+    // a completion not reported yet must not reach a new connection reusing this fd
+    for (size_t i = 0; i < finished_.size(); ) {
+        if (finished_[i] == clientFd)
+            finished_.erase(finished_.begin() + i);
+        else
+            ++i;
+    }
+}
+
+CGIWorkerPool::Worker* CGIWorkerPool::spawnWorker() {
+    if (access(workerScript_.c_str(), R_OK) != 0) {
+        LOG_ERROR << "❌ CGI worker: Worker script not readable: " << workerScript_;
+        return NULL;
+    }
+    int toWorker[2];
+    int fromWorker[2];
+    if (pipe(toWorker) == -1)
+        return NULL;
+    if (pipe(fromWorker) == -1) {
+        close(toWorker[0]);
+        close(toWorker[1]);
+        return NULL;
+    }
+    // same rules as CGIProcess: nothing leaks into other children, parent ends never block,
+    // and a worker whose parent ends select() can't watch is not started
+    int fds[4] = { toWorker[0], toWorker[1], fromWorker[0], fromWorker[1] };
+    if (!fitsFdSet(toWorker[1]) || !fitsFdSet(fromWorker[0])) {
+        for (int i = 0; i < 4; ++i)
+            close(fds[i]);
+        LOG_WARN << "❌ CGI worker: pipe fds beyond the select() limit, worker not started";
+        return NULL;
+    }
+    for (int i = 0; i < 4; ++i)
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+    fcntl(toWorker[1], F_SETFL, fcntl(toWorker[1], F_GETFL, 0) | O_NONBLOCK);
+    fcntl(fromWorker[0], F_SETFL, fcntl(fromWorker[0], F_GETFL, 0) | O_NONBLOCK);
+    // the worker lives for many requests, its pipes are enlarged once
+    CGIProcess::growPipe(toWorker[1], 1024 * 1024);
+    CGIProcess::growPipe(fromWorker[0], 256 * 1024);
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        for (int i = 0; i < 4; ++i)
+            close(fds[i]);
+        LOG_ERROR << "❌ CGI worker: fork failed: " << strerror(errno);
+        return NULL;
+    }
+    if (pid == 0) {
+        dup2(toWorker[0], STDIN_FILENO);
+        dup2(fromWorker[1], STDOUT_FILENO);
+        char* argv[] = {
+            const_cast<char*>(interpreter_.c_str()),
+            const_cast<char*>(workerScript_.c_str()),
+            NULL
+        };
+        execv(interpreter_.c_str(), argv);
+        _exit(127);
+    }
+    close(toWorker[0]);
+    close(fromWorker[1]);
+
+    Worker* worker = new Worker();
+    worker->pid = pid;
+    worker->toFd = toWorker[1];
+    worker->fromFd = fromWorker[0];
+    worker->job = NULL;
+    worker->writeOffset = 0;
+    worker->inFrame = false;
+    worker->outputLeft = 0;
+    worker->served = 0;
+    worker->idleSinceMs = ServerClock::monotonicMs();
+    workers_.push_back(worker);
+
+    LOG_DEBUG << "🔧 CGI worker: Started " << interpreter_ << " " << workerScript_
+              << " (pid " << pid << ", " << workers_.size() << "/" << maxWorkers_ << ")";
+    return worker;
+}
+
+/* closing stdin ends the worker's read loop; kill is for a worker busy with a script
+   whose result nobody wants any more. Either way the pid is waited for later, never here */
+void CGIWorkerPool::retireWorker(Worker* worker, bool kill) {
+    if (worker->job) {
+        worker->job->worker = NULL;
+        if (!worker->job->complete)
+            completeJob(worker->job, true, "CGI worker exited unexpectedly");
+    }
+    if (kill)
+        ::kill(worker->pid, SIGKILL);
+    close(worker->toFd);
+    close(worker->fromFd);
+    exiting_.push_back(worker->pid);
+
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        if (workers_[i] == worker) {
+            workers_.erase(workers_.begin() + i);
+            break;
+        }
+    }
+    delete worker;
+}
+
+// FIFO: idle workers first, then grow the pool up to max
+void CGIWorkerPool::dispatch() {
+    for (size_t i = 0; i < workers_.size() && !waiting_.empty(); ++i) {
+        if (!workers_[i]->job) {
+            Job* job = waiting_.front();
+            waiting_.pop_front();
+            assign(workers_[i], job);
+        }
+    }
+    while (!waiting_.empty() && workers_.size() < maxWorkers_) {
+        Worker* worker = spawnWorker();
+        if (!worker && !workers_.empty())
+            return; // out of pipes or processes: the jobs wait for a busy worker instead
+        Job* job = waiting_.front();
+        waiting_.pop_front();
+        if (worker)
+            assign(worker, job);
+        else
+            completeJob(job, true, "Failed to start CGI worker");
+    }
+}
+
+void CGIWorkerPool::assign(Worker* worker, Job* job) {
+    worker->job = job;
+    worker->writeOffset = 0;
+    worker->readBuf.clear();
+    worker->inFrame = false;
+    worker->outputLeft = 0;
+    job->worker = worker;
+    flush(worker);
+}
+
+bool CGIWorkerPool::flush(Worker* worker) {
+    const std::string& frame = worker->job->frame;
+    while (worker->writeOffset < frame.size()) {
+        ssize_t written = write(worker->toFd, frame.data() + worker->writeOffset,
+                                frame.size() - worker->writeOffset);
+        if (written > 0) {
+            worker->writeOffset += written;
+            ServerStats::cgi.pipeIn += static_cast<unsigned long long>(written);
+            continue;
+        }
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return true;
+        if (written < 0 && errno == EINTR)
+            continue;
+        retireWorker(worker, true);
+        return false;
+    }
+    return true;
+}
+
+/* "RES <status> <length>\n" + output. Output arriving from an idle worker, or EOF,
+   means the worker is broken or gone: it is retired and replaced by maintain() */
+bool CGIWorkerPool::readResponse(Worker* worker) {
+    char buffer[16384];
+    bool eof = false;
+    while (true) {
+        ssize_t bytesRead = read(worker->fromFd, buffer, sizeof(buffer));
+        if (bytesRead > 0) {
+            worker->readBuf.append(buffer, bytesRead);
+            ServerStats::cgi.pipeOut += static_cast<unsigned long long>(bytesRead);
+            continue;
+        }
+        if (bytesRead < 0 && errno == EINTR)
+            continue;
+        if (bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        eof = true;
+        break;
+    }
+
+    int parsed = worker->job ? parseResponse(worker) : -1;
+    if (parsed < 0 || eof) {
+        if (worker->served == 0 && parsed <= 0) // died on startup: do not respawn in a tight loop
+            respawnAfterMs_ = ServerClock::monotonicMs() + RESPAWN_DELAY_MS;
+        retireWorker(worker, !eof);
+        return false;
+    }
+    if (parsed > 0 && maxRequests_ != 0 && worker->served >= maxRequests_) {
+        LOG_DEBUG << "🔧 CGI worker: Recycling pid " << worker->pid
+                  << " after " << worker->served << " requests";
+        retireWorker(worker, false);
+        return false;
+    }
+    return true;
+}
+
+// 1: job completed, 0: frame incomplete, -1: malformed frame
+// output is moved into the job as it arrives, so only cgi_output_buffer of it stays in memory
+int CGIWorkerPool::parseResponse(Worker* worker) {
+    Job* job = worker->job;
+    if (!worker->inFrame) {
+        size_t eol = worker->readBuf.find('\n');
+        if (eol == std::string::npos)
+            return worker->readBuf.size() > MAX_FRAME_HEADER ? -1 : 0;
+
+        int status = 0;
+        unsigned long length = 0;
+        char tag[4] = { 0 };
+        if (eol > MAX_FRAME_HEADER
+            || std::sscanf(worker->readBuf.c_str(), "%3s %d %lu", tag, &status, &length) != 3
+            || std::strcmp(tag, "RES") != 0)
+            return -1;
+        job->exitStatus = status;
+        worker->inFrame = true;
+        worker->outputLeft = length;
+        worker->readBuf.erase(0, eol + 1);
+    }
+
+    size_t take = worker->readBuf.size() < worker->outputLeft ? worker->readBuf.size() : worker->outputLeft;
+    job->output.append(worker->readBuf.data(), take); // a failed spill is reported by finish()
+    worker->readBuf.erase(0, take);
+    worker->outputLeft -= take;
+    if (worker->outputLeft > 0)
+        return 0; // output still arriving
+
+    worker->inFrame = false;
+    job->worker = NULL;
+    worker->job = NULL;
+    worker->readBuf.clear();
+    worker->served++;
+    worker->idleSinceMs = ServerClock::monotonicMs();
+    completeJob(job, false, "");
+    return 1;
+}
+
+void CGIWorkerPool::completeJob(Job* job, bool failed, const std::string& error) {
+    job->complete = true;
+    job->failed = failed;
+    job->error = error;
+    job->frame.clear();
+    finished_.push_back(job->clientFd);
+}
+
+// a running script cannot be interrupted, the worker goes with it
+void CGIWorkerPool::detach(Job* job) {
+    if (job->worker) {
+        Worker* worker = job->worker;
+        worker->job = NULL;
+        job->worker = NULL;
+        retireWorker(worker, true);
+    }
+    else if (!job->complete)
+        waiting_.erase(std::find(waiting_.begin(), waiting_.end(), job));
+}
+
+// keep min workers alive, drop idle ones above min after idleTimeout
+void CGIWorkerPool::maintain(long long nowMs) {
+    for (size_t i = 0; i < workers_.size() && workers_.size() > minWorkers_; ) {
+        Worker* worker = workers_[i];
+        if (!worker->job && idleTimeoutMs_ > 0 && nowMs - worker->idleSinceMs >= idleTimeoutMs_) {
+            LOG_DEBUG << "🔧 CGI worker: Reaping idle pid " << worker->pid;
+            retireWorker(worker, false);
+            continue;
+        }
+        ++i;
+    }
+    while (workers_.size() < minWorkers_ && nowMs >= respawnAfterMs_) {
+        if (!spawnWorker()) {
+            respawnAfterMs_ = nowMs + RESPAWN_DELAY_MS;
+            break;
+        }
+    }
+}
+
+void CGIWorkerPool::reapExited() {
+    for (size_t i = 0; i < exiting_.size(); ) {
+        pid_t result = waitpid(exiting_[i], NULL, WNOHANG);
+        if (result == exiting_[i] || (result == -1 && errno == ECHILD))
+            exiting_.erase(exiting_.begin() + i);
+        else
+            ++i;
+    }
+}
@@ -0,0 +1,152 @@
+#ifndef CGI_WORKER_POOL_HPP
+#define CGI_WORKER_POOL_HPP
+
+#include <string>
+#include <map>
+#include <vector>
+#include <deque>
+#include <sys/select.h>
+#include <sys/types.h>
+#include "cgi_output_buffer.hpp"
+
+/**
+ * @brief 常驻解释器worker池（cgi_workers）
+ *
+ * 每个 (解释器, worker脚本) 一个池，worker 以 `cgiPath workerScript` 启动后
+ * 在循环里执行脚本，省掉每个请求的 fork+exec+解释器启动：
+ *   - 请求帧（服务器 -> worker stdin）：
+ *       "REQ <脚本路径长度> <环境长度> <body长度>\n" 脚本路径 环境 body
+ *     环境为 "NAME=value\n" 行，内容与 CGIEnvironment 给 execve 的一致
+ *   - 响应帧（worker stdout -> 服务器）：
+ *       "RES <退出码> <输出长度>\n" 输出
+ *     输出是脚本的原始CGI输出（headers + body），仍由 CGIResponse 解析
+ *   - 池大小在 [min, max] 之间：启动时预先拉起 min 个，忙时按需扩到 max，
+ *     再多的请求排队；超过 min 的worker空闲 idleTimeout 秒后回收
+ *   - 每个worker处理 maxRequests 个请求后回收（限制脚本泄漏的状态/内存）
+ *   - 超时或客户端断开时worker正在跑的脚本无法中断，直接杀掉该worker
+ * 所有管道由主事件循环的select()驱动，接口与 FastCGIClient 一致
+ */
+class CGIWorkerPool {
+public:
+    CGIWorkerPool(const std::string& interpreter,
+                  const std::string& workerScript,
+                  size_t minWorkers,
+                  size_t maxWorkers,
+                  size_t maxRequests,
+                  int idleTimeoutSeconds);
+    ~CGIWorkerPool();
+
+    /**
+     * @brief 拉起 min 个worker（服务器启动时调用）
+     */
+    void prespawn();
+
+    /**
+     * @brief 提交一个请求，有空闲worker时立即发送，否则排队
+     *
+     * @param clientFd 客户端fd（作为任务的key）
+     * @param scriptPath 脚本路径
+     * @param env CGI变量
+     * @param body 请求体（脚本的stdin）
+     * @param timeoutSeconds 超时时间（秒）
+     * @param outputLimit 输出在内存中的上限，超出部分写入 tempDir 中的临时文件
+     */
+    void submit(int clientFd,
+                const std::string& scriptPath,
+                const std::map<std::string, std::string>& env,
+                const std::string& body,
+                int timeoutSeconds,
+                size_t outputLimit,
+                const std::string& tempDir);
+
+    /**
+     * @brief 把worker管道加入select集合（空闲worker也监听stdout，以发现其退出）
+     */
+    void addFds(fd_set* readFds, fd_set* writeFds, int& maxFd) const;
+
+    /**
+     * @brief 处理就绪的worker管道，检查超时，回收/补充worker
+     *
+     * @param completed 输出参数，本轮完成（成功/失败/超时）的客户端fd
+     */
+    void handleIO(const fd_set* readFds, const fd_set* writeFds, std::vector<int>& completed);
+
+    bool hasJob(int clientFd) const { return jobs_.count(clientFd) != 0; }
+
+    /**
+     * @brief 取出已完成任务的输出并释放任务
+     *
+     * @return 0 成功；否则为应返回给客户端的错误码（502 / 504）
+     */
+    int finish(int clientFd, CGIOutputBuffer& output, std::string& error);
+
+    /**
+     * @brief 放弃任务（客户端断开），正在执行的worker被杀掉
+     */
+    void release(int clientFd);
+
+    size_t activeCount() const { return jobs_.size(); }
+    size_t workerCount() const { return workers_.size(); }
+    bool hasFinished() const { return !finished_.empty(); }
+
+private:
+    struct Worker;
+
+    struct Job {
+        int clientFd;
+        std::string frame;          // 完整的请求帧
+        CGIOutputBuffer output;     // 响应帧中的输出，边读边移入（超过上限落盘）
+        long long deadlineMs;
+        int exitStatus;
+        bool complete;
+        bool failed;
+        bool timedOut;
+        std::string error;
+        Worker* worker;
+    };
+
+    struct Worker {
+        pid_t pid;
+        int toFd;                   // worker stdin
+        int fromFd;                 // worker stdout
+        Job* job;                   // NULL = 空闲
+        size_t writeOffset;
+        std::string readBuf;
+        bool inFrame;               // 已解析 RES 行，输出还在到达
+        unsigned long outputLeft;   // 本帧还未读到的输出字节数
+        size_t served;
+        long long idleSinceMs;
+    };
+
+    std::string interpreter_;
+    std::string workerScript_;
+    size_t minWorkers_;
+    size_t maxWorkers_;
+    size_t maxRequests_;
+    long long idleTimeoutMs_;
+    long long respawnAfterMs_;          // 启动失败后推迟补充worker
+
+    std::vector<Worker*> workers_;
+    std::deque<Job*> waiting_;
+    std::map<int, Job*> jobs_;          // 客户端fd -> 任务（拥有）
+    std::vector<int> finished_;         // 已完成、尚未通过 handleIO 报告的客户端fd
+    std::vector<pid_t> exiting_;        // 已回收、等待waitpid的worker
+
+    Worker* spawnWorker();
+    void retireWorker(Worker* worker, bool kill);
+    void dispatch();
+    void assign(Worker* worker, Job* job);
+    bool flush(Worker* worker);
+    bool readResponse(Worker* worker);
+    int parseResponse(Worker* worker);
+    void completeJob(Job* job, bool failed, const std::string& error);
+    void detach(Job* job);
+    void maintain(long long nowMs);
+    void reapExited();
+
+    // 禁止拷贝构造和赋值
+    CGIWorkerPool(const CGIWorkerPool&);
+    CGIWorkerPool& operator=(const CGIWorkerPool&);
+};
+
+#endif // CGI_WORKER_POOL_HPP
@@ -0,0 +1,636 @@
+#include "fastcgi_client.hpp"
+#include "../utils/server_clock.hpp"
+#include "../utils/logger.hpp"
+#include "../utils/fd_limit.hpp"
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <cstring>
+#include <cstdlib>
+
+namespace {
+    // FastCGI 1.0 record types
+    enum {
+        FCGI_BEGIN_REQUEST      = 1,
+        FCGI_ABORT_REQUEST      = 2,
+        FCGI_END_REQUEST        = 3,
+        FCGI_PARAMS             = 4,
+        FCGI_STDIN              = 5,
+        FCGI_STDOUT             = 6,
+        FCGI_STDERR             = 7,
+        FCGI_GET_VALUES         = 9,
+        FCGI_GET_VALUES_RESULT  = 10
+    };
+
+    enum {
+        FCGI_VERSION_1          = 1,
+        FCGI_HEADER_LEN         = 8,
+        FCGI_MAX_CONTENT        = 65535,
+        FCGI_RESPONDER          = 1,
+        FCGI_KEEP_CONN          = 1,
+        FCGI_REQUEST_COMPLETE   = 0,
+        FCGI_CANT_MPX_CONN      = 1
+    };
+
+    const size_t kMaxConnections = 16; // per upstream, unless FCGI_MAX_CONNS says less
+}
+
+FastCGIClient::FastCGIClient() {
+}
+
+FastCGIClient::~FastCGIClient() {
+    for (std::map<int, Request*>::iterator it = requests_.begin(); it != requests_.end(); ++it)
+        delete it->second;
+    for (std::map<std::string, Upstream*>::iterator it = upstreams_.begin(); it != upstreams_.end(); ++it) {
+        Upstream* upstream = it->second;
+        for (size_t i = 0; i < upstream->conns.size(); ++i) {
+            close(upstream->conns[i]->fd);
+            delete upstream->conns[i];
+        }
+        delete upstream;
+    }
+}
+
+// =================== record encoding ===================
+
+void FastCGIClient::appendRecord(std::string& out, unsigned char type, unsigned short id,
+                                 const char* content, size_t length) {
+    unsigned char padding = static_cast<unsigned char>((8 - (length % 8)) % 8);
+    char header[FCGI_HEADER_LEN];
+    header[0] = FCGI_VERSION_1;
+    header[1] = static_cast<char>(type);
+    header[2] = static_cast<char>((id >> 8) & 0xff);
+    header[3] = static_cast<char>(id & 0xff);
+    header[4] = static_cast<char>((length >> 8) & 0xff);
+    header[5] = static_cast<char>(length & 0xff);
+    header[6] = static_cast<char>(padding);
+    header[7] = 0;
+    out.append(header, FCGI_HEADER_LEN);
+    if (length)
+        out.append(content, length);
+    out.append(padding, '\0');
+}
+
+// a stream is any number of records, terminated by an empty one
+void FastCGIClient::appendStream(std::string& out, unsigned char type, unsigned short id,
+                                 const std::string& data) {
+    for (size_t offset = 0; offset < data.size(); offset += FCGI_MAX_CONTENT) {
+        size_t chunk = data.size() - offset;
+        if (chunk > FCGI_MAX_CONTENT)
+            chunk = FCGI_MAX_CONTENT;
+        appendRecord(out, type, id, data.data() + offset, chunk);
+    }
+    appendRecord(out, type, id, NULL, 0);
+}
+
+static void appendLength(std::string& out, size_t length) {
+    if (length < 128) {
+        out += static_cast<char>(length);
+        return;
+    }
+    out += static_cast<char>(((length >> 24) & 0x7f) | 0x80);
+    out += static_cast<char>((length >> 16) & 0xff);
+    out += static_cast<char>((length >> 8) & 0xff);
+    out += static_cast<char>(length & 0xff);
+}
+
+void FastCGIClient::appendNameValue(std::string& out, const std::string& name, const std::string& value) {
+    appendLength(out, name.size());
+    appendLength(out, value.size());
+    out += name;
+    out += value;
+}
+
+static bool readLength(const unsigned char* data, size_t length, size_t& pos, size_t& value) {
+    if (pos >= length)
+        return false;
+    if (!(data[pos] & 0x80)) {
+        value = data[pos++];
+        return true;
+    }
+    if (pos + 4 > length)
+        return false;
+    value = (static_cast<size_t>(data[pos] & 0x7f) << 24) | (static_cast<size_t>(data[pos + 1]) << 16)
+          | (static_cast<size_t>(data[pos + 2]) << 8) | data[pos + 3];
+    pos += 4;
+    return true;
+}
+
+// =================== public interface ===================
+
+bool FastCGIClient::start(int clientFd,
+                          const std::string& address,
+                          const std::map<std::string, std::string>& params,
+                          const std::string& body,
+                          int timeoutSeconds,
+                          size_t outputLimit,
+                          const std::string& tempDir) {
+    release(clientFd);
+
+    Upstream* upstream = getUpstream(address);
+    if (!upstream)
+        return false;
+
+    Request* req = new Request();
+    req->clientFd = clientFd;
+    req->upstream = upstream;
+    req->id = 0;
+    req->conn = NULL;
+    for (std::map<std::string, std::string>::const_iterator it = params.begin(); it != params.end(); ++it)
+        appendNameValue(req->params, it->first, it->second);
+    req->body = body;
+    req->output.setLimit(outputLimit, tempDir);
+    req->deadlineMs = ServerClock::monotonicMs() + static_cast<long long>(timeoutSeconds) * 1000;
+    req->appStatus = 0;
+    req->complete = false;
+    req->failed = false;
+    req->timedOut = false;
+    req->retried = false;
+    requests_[clientFd] = req;
+
+    upstream->waiting.push_back(req);
+    dispatch(upstream);
+    return true;
+}
+
+void FastCGIClient::addFds(fd_set* readFds, fd_set* writeFds, int& maxFd) const {
+    for (std::map<std::string, Upstream*>::const_iterator it = upstreams_.begin(); it != upstreams_.end(); ++it) {
+        const std::vector<Connection*>& conns = it->second->conns;
+        for (size_t i = 0; i < conns.size(); ++i) {
+            const Connection* conn = conns[i];
+            // readable also reports a backend closing an idle keep-alive connection
+            if (conn->connected)
+                FD_SET(conn->fd, readFds);
+            if (!conn->connected || conn->writeOffset < conn->writeBuf.size())
+                FD_SET(conn->fd, writeFds);
+            if (conn->fd > maxFd)
+                maxFd = conn->fd;
+        }
+    }
+}
+
+void FastCGIClient::handleIO(const fd_set* readFds, const fd_set* writeFds, std::vector<int>& completed) {
+    for (std::map<std::string, Upstream*>::iterator it = upstreams_.begin(); it != upstreams_.end(); ++it) {
+        Upstream* upstream = it->second;
+        // closeConnection() erases from conns: only advance when the connection survived
+        for (size_t i = 0; i < upstream->conns.size(); ) {
+            Connection* conn = upstream->conns[i];
+
+            if (!conn->connected && FD_ISSET(conn->fd, writeFds)) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                if (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &err, &len) == -1 || err != 0) {
+                    closeConnection(conn, std::string("connect() failed: ") + strerror(err ? err : errno));
+                    continue;
+                }
+                conn->connected = true;
+            }
+            if (conn->connected && FD_ISSET(conn->fd, writeFds) && !flush(conn))
+                continue;
+            if (conn->connected && FD_ISSET(conn->fd, readFds) && !readRecords(conn))
+                continue;
+            ++i;
+        }
+    }
+
+    // timeouts, for requests still queued as well as in flight
+    long long nowMs = ServerClock::monotonicMs();
+    for (std::map<int, Request*>::iterator it = requests_.begin(); it != requests_.end(); ++it) {
+        Request* req = it->second;
+        if (!req->complete && nowMs >= req->deadlineMs) {
+            LOG_WARN << "❌ FastCGI: Timeout for fd=" << req->clientFd;
+            detach(req);
+            req->timedOut = true;
+            completeRequest(req, true, "FastCGI backend timeout");
+        }
+    }
+
+    // hand freed connection slots to queued requests
+    for (std::map<std::string, Upstream*>::iterator it = upstreams_.begin(); it != upstreams_.end(); ++it) {
+        if (!it->second->waiting.empty())
+            dispatch(it->second);
+    }
+
+    completed.insert(completed.end(), finished_.begin(), finished_.end());
+    finished_.clear();
+}
+
+int FastCGIClient::finish(int clientFd, CGIOutputBuffer& output, std::string& error) {
+    std::map<int, Request*>::iterator it = requests_.find(clientFd);
+    if (it == requests_.end()) {
+        error = "No FastCGI request for this connection";
+        return 502;
+    }
+    Request* req = it->second;
+    if (!req->complete)
+        detach(req);
+
+    int status = 0;
+    if (req->timedOut)
+        status = 504;
+    else if (!req->complete || req->failed)
+        status = 502;
+    else if (req->appStatus != 0) {
+        req->error = "FastCGI application exited with non-zero status";
+        status = 502;
+    }
+    output.swap(req->output);
+    error = req->error;
+
+    delete req;
+    requests_.erase(it);
+    return status;
+}
+
+void FastCGIClient::release(int clientFd) {
+    std::map<int, Request*>::iterator it = requests_.find(clientFd);
+    if (it == requests_.end())
+        return;
+    if (!it->second->complete)
+        detach(it->second);
+    delete it->second;
+    requests_.erase(it);
+
+    // a completion not reported yet must not reach a new connection reusing this fd
+    for (size_t i = 0; i < finished_.size(); ) {
+        if (finished_[i] == clientFd)
+            finished_.erase(finished_.begin() + i);
+        else
+            ++i;
+    }
+}
+
+// =================== upstreams & connections ===================
+
+FastCGIClient::Upstream* FastCGIClient::getUpstream(const std::string& address) {
+    std::map<std::string, Upstream*>::iterator it = upstreams_.find(address);
+    if (it != upstreams_.end())
+        return it->second;
+
+    Upstream* upstream = new Upstream();
+    upstream->address = address;
+    upstream->multiplex = false;    // until FCGI_GET_VALUES says otherwise
+    upstream->maxRequests = 1;
+    upstream->maxConns = kMaxConnections;
+    upstream->valuesRequested = false;
+    if (!resolveAddress(address, *upstream)) {
+        LOG_ERROR << "❌ FastCGI: Cannot resolve backend address " << address;
+        delete upstream;
+        return NULL;
+    }
+    upstreams_[address] = upstream;
+    return upstream;
+}
+
+// resolved once per backend: unix:/path.sock, 127.0.0.1:9000, [::1]:9000, localhost:9000
+bool FastCGIClient::resolveAddress(const std::string& address, Upstream& upstream) {
+    std::memset(&upstream.addr, 0, sizeof(upstream.addr));
+
+    if (address.compare(0, 5, "unix:") == 0) {
+        struct sockaddr_un* un = reinterpret_cast<struct sockaddr_un*>(&upstream.addr);
+        std::string path = address.substr(5);
+        if (path.empty() || path.size() >= sizeof(un->sun_path))
+            return false;
+        un->sun_family = AF_UNIX;
+        std::memcpy(un->sun_path, path.c_str(), path.size() + 1);
+        upstream.addrLen = sizeof(struct sockaddr_un);
+        return true;
+    }
+
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos)
+        return false;
+    std::string host = address.substr(0, colon);
+    std::string port = address.substr(colon + 1);
+    if (host.size() > 2 && host[0] == '[' && host[host.size() - 1] == ']')
+        host = host.substr(1, host.size() - 2);
+
+    struct addrinfo hints;
+    struct addrinfo* result = NULL;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0 || !result)
+        return false;
+    std::memcpy(&upstream.addr, result->ai_addr, result->ai_addrlen);
+    upstream.addrLen = result->ai_addrlen;
+    freeaddrinfo(result);
+    return true;
+}
+
+FastCGIClient::Connection* FastCGIClient::openConnection(Upstream* upstream) {
+    int fd = socket(upstream->addr.ss_family, SOCK_STREAM, 0);
+    if (fd == -1)
+        return NULL;
+    // select() can't watch it: requests keep waiting for a pooled connection, or fail with none
+    if (!fitsFdSet(fd)) {
+        LOG_WARN << "❌ FastCGI: socket fd=" << fd << " beyond the select() limit, not opened";
+        close(fd);
+        return NULL;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    bool connected = true;
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&upstream->addr), upstream->addrLen) == -1) {
+        if (errno != EINPROGRESS && errno != EAGAIN) {
+            LOG_ERROR << "❌ FastCGI: connect(" << upstream->address << ") failed: " << strerror(errno);
+            close(fd);
+            return NULL;
+        }
+        connected = false; // finished when the socket becomes writable
+    }
+
+    Connection* conn = new Connection();
+    conn->fd = fd;
+    conn->upstream = upstream;
+    conn->connected = connected;
+    conn->writeOffset = 0;
+    conn->nextId = 1;
+    conn->served = 0;
+    upstream->conns.push_back(conn);
+    LOG_DEBUG << "🔧 FastCGI: New connection to " << upstream->address << " fd=" << fd;
+    return conn;
+}
+
+/* assign queued requests to connections
+    - multiplexing backend: any connection below FCGI_MAX_REQS
+    - otherwise: an idle keep-alive connection
+    - else open a new one while below the pool limit, or keep waiting
+*/
+void FastCGIClient::dispatch(Upstream* upstream) {
+    while (!upstream->waiting.empty()) {
+        Connection* target = NULL;
+        for (size_t i = 0; i < upstream->conns.size() && !target; ++i) {
+            Connection* conn = upstream->conns[i];
+            size_t inFlight = conn->active.size();
+            if (upstream->multiplex ? inFlight < upstream->maxRequests : inFlight == 0)
+                target = conn;
+        }
+        if (!target && upstream->conns.size() < upstream->maxConns)
+            target = openConnection(upstream);
+        if (!target) {
+            // nothing in flight will free a slot: the backend is unreachable
+            if (upstream->conns.empty()) {
+                while (!upstream->waiting.empty()) {
+                    Request* req = upstream->waiting.front();
+                    upstream->waiting.pop_front();
+                    completeRequest(req, true, "Cannot connect to FastCGI backend " + upstream->address);
+                }
+            }
+            return;
+        }
+        Request* req = upstream->waiting.front();
+        upstream->waiting.pop_front();
+        sendRequest(target, req);
+        if (target->connected && !flush(target))
+            continue; // write failed, the connection was closed & its requests requeued/failed
+    }
+}
+
+void FastCGIClient::sendRequest(Connection* conn, Request* req) {
+    Upstream* upstream = conn->upstream;
+
+    unsigned short id = 1;
+    if (upstream->multiplex) {
+        id = conn->nextId;
+        while (id == 0 || conn->active.count(id))
+            ++id;
+        conn->nextId = static_cast<unsigned short>(id + 1);
+    }
+    conn->active[id] = req;
+    req->conn = conn;
+    req->id = id;
+
+    // ask once per backend whether it multiplexes, the answer is used for later dispatches
+    if (!upstream->valuesRequested) {
+        std::string names;
+        appendNameValue(names, "FCGI_MAX_CONNS", "");
+        appendNameValue(names, "FCGI_MAX_REQS", "");
+        appendNameValue(names, "FCGI_MPXS_CONNS", "");
+        appendRecord(conn->writeBuf, FCGI_GET_VALUES, 0, names.data(), names.size());
+        upstream->valuesRequested = true;
+    }
+
+    const char begin[8] = { 0, FCGI_RESPONDER, FCGI_KEEP_CONN, 0, 0, 0, 0, 0 };
+    appendRecord(conn->writeBuf, FCGI_BEGIN_REQUEST, id, begin, sizeof(begin));
+    appendStream(conn->writeBuf, FCGI_PARAMS, id, req->params);
+    appendStream(conn->writeBuf, FCGI_STDIN, id, req->body);
+}
+
+// false if the connection had to be closed
+bool FastCGIClient::flush(Connection* conn) {
+    while (conn->writeOffset < conn->writeBuf.size()) {
+        ssize_t sent = send(conn->fd, conn->writeBuf.data() + conn->writeOffset,
+                            conn->writeBuf.size() - conn->writeOffset, MSG_NOSIGNAL);
+        if (sent > 0) {
+            conn->writeOffset += sent;
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return true;
+        if (sent < 0 && errno == EINTR)
+            continue;
+        closeConnection(conn, std::string("send() to FastCGI backend failed: ") + strerror(errno));
+        return false;
+    }
+    conn->writeBuf.clear();
+    conn->writeOffset = 0;
+    return true;
+}
+
+// false if the connection had to be closed
+bool FastCGIClient::readRecords(Connection* conn) {
+    char buffer[16384];
+    bool eof = false;
+
+    while (true) {
+        ssize_t n = recv(conn->fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            conn->readBuf.append(buffer, n);
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (n < 0 && errno == EINTR)
+            continue;
+        eof = true;
+        break;
+    }
+
+    size_t offset = 0;
+    const std::string& buf = conn->readBuf;
+    while (buf.size() - offset >= FCGI_HEADER_LEN) {
+        const unsigned char* h = reinterpret_cast<const unsigned char*>(buf.data() + offset);
+        if (h[0] != FCGI_VERSION_1) {
+            closeConnection(conn, "FastCGI protocol error");
+            return false;
+        }
+        size_t length = (static_cast<size_t>(h[4]) << 8) | h[5];
+        size_t total = FCGI_HEADER_LEN + length + h[6];
+        if (buf.size() - offset < total)
+            break;
+        unsigned short id = static_cast<unsigned short>((h[2] << 8) | h[3]);
+        handleRecord(conn, h[1], id, buf.data() + offset + FCGI_HEADER_LEN, length);
+        offset += total;
+    }
+    conn->readBuf.erase(0, offset);
+
+    if (eof) {
+        closeConnection(conn, "FastCGI backend closed the connection");
+        return false;
+    }
+    return true;
+}
+
+void FastCGIClient::handleRecord(Connection* conn, unsigned char type, unsigned short id,
+                                 const char* content, size_t length) {
+    if (type == FCGI_GET_VALUES_RESULT) {
+        handleValues(conn->upstream, content, length);
+        return;
+    }
+
+    std::map<unsigned short, Request*>::iterator it = conn->active.find(id);
+    if (it == conn->active.end())
+        return;
+    Request* req = it->second; // NULL: aborted, records are dropped until END_REQUEST
+
+    if (type == FCGI_STDOUT) {
+        if (req)
+            req->output.append(content, length); // a failed spill is reported by finish()
+    }
+    else if (type == FCGI_STDERR) {
+        if (length)
+            LOG_WARN << "🔧 FastCGI stderr: " << std::string(content, length);
+    }
+    else if (type == FCGI_END_REQUEST && length >= 8) {
+        const unsigned char* body = reinterpret_cast<const unsigned char*>(content);
+        int appStatus = (body[0] << 24) | (body[1] << 16) | (body[2] << 8) | body[3];
+        unsigned char protocolStatus = body[4];
+
+        conn->active.erase(it);
+        conn->served++;
+        if (!req)
+            return;
+        req->conn = NULL;
+        req->id = 0;
+        req->appStatus = appStatus;
+
+        if (protocolStatus == FCGI_CANT_MPX_CONN) {
+            // the backend refused a second request on this connection: stop multiplexing, retry
+            conn->upstream->multiplex = false;
+            conn->upstream->waiting.push_front(req);
+        }
+        else if (protocolStatus != FCGI_REQUEST_COMPLETE)
+            completeRequest(req, true, "FastCGI backend rejected the request (overloaded or unknown role)");
+        else
+            completeRequest(req, false, "");
+    }
+}
+
+void FastCGIClient::handleValues(Upstream* upstream, const char* content, size_t length) {
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(content);
+    size_t pos = 0;
+
+    while (pos < length) {
+        size_t nameLen, valueLen;
+        if (!readLength(data, length, pos, nameLen) || !readLength(data, length, pos, valueLen)
+            || pos + nameLen + valueLen > length)
+            break;
+        std::string name(content + pos, nameLen);
+        std::string value(content + pos + nameLen, valueLen);
+        pos += nameLen + valueLen;
+
+        long number = std::strtol(value.c_str(), NULL, 10);
+        if (name == "FCGI_MPXS_CONNS")
+            upstream->multiplex = (number == 1);
+        else if (name == "FCGI_MAX_REQS" && number > 0)
+            upstream->maxRequests = static_cast<size_t>(number);
+        else if (name == "FCGI_MAX_CONNS" && number > 0 && static_cast<size_t>(number) < kMaxConnections)
+            upstream->maxConns = static_cast<size_t>(number);
+    }
+    LOG_DEBUG << "🔧 FastCGI: " << upstream->address << " multiplex=" << upstream->multiplex
+              << " max_reqs=" << upstream->maxRequests << " max_conns=" << upstream->maxConns;
+}
+
+void FastCGIClient::completeRequest(Request* req, bool failed, const std::string& error) {
+    req->complete = true;
+    req->failed = failed;
+    req->error = error;
+    req->params.clear();
+    req->body.clear();
+    finished_.push_back(req->clientFd);
+}
+
+/* take a request off its queue or connection
+    - queued: just removed
+    - in flight on a multiplexed connection: FCGI_ABORT_REQUEST, id kept until END_REQUEST
+    - in flight alone on a connection: the connection is dropped, the backend stops writing
+*/
+void FastCGIClient::detach(Request* req) {
+    Connection* conn = req->conn;
+    if (!conn) {
+        std::deque<Request*>& waiting = req->upstream->waiting;
+        for (std::deque<Request*>::iterator it = waiting.begin(); it != waiting.end(); ++it) {
+            if (*it == req) {
+                waiting.erase(it);
+                break;
+            }
+        }
+        return;
+    }
+
+    conn->active[req->id] = NULL;
+    req->conn = NULL;
+
+    bool othersInFlight = false;
+    for (std::map<unsigned short, Request*>::iterator it = conn->active.begin(); it != conn->active.end(); ++it) {
+        if (it->second)
+            othersInFlight = true;
+    }
+    if (!othersInFlight) {
+        closeConnection(conn, "request aborted");
+        return;
+    }
+    appendRecord(conn->writeBuf, FCGI_ABORT_REQUEST, req->id, NULL, 0);
+    if (conn->connected)
+        flush(conn);
+}
+
+/* close a backend connection
+    - requests that got no output on a reused keep-alive connection are requeued once
+      (the backend may have closed it while idle)
+    - the others fail with 502
+*/
+void FastCGIClient::closeConnection(Connection* conn, const std::string& reason) {
+    Upstream* upstream = conn->upstream;
+    for (size_t i = 0; i < upstream->conns.size(); ++i) {
+        if (upstream->conns[i] == conn) {
+            upstream->conns.erase(upstream->conns.begin() + i);
+            break;
+        }
+    }
+
+    for (std::map<unsigned short, Request*>::iterator it = conn->active.begin(); it != conn->active.end(); ++it) {
+        Request* req = it->second;
+        if (!req)
+            continue;
+        req->conn = NULL;
+        req->id = 0;
+        if (!req->retried && conn->served > 0 && req->output.empty()) {
+            req->retried = true;
+            upstream->waiting.push_front(req);
+        }
+        else
+            completeRequest(req, true, reason);
+    }
+
+    if (!conn->active.empty() || !conn->connected)
+        LOG_DEBUG << "🔧 FastCGI: Closing fd=" << conn->fd << ": " << reason;
+    close(conn->fd);
+    delete conn;
+}
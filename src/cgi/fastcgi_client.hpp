@@ -0,0 +1,159 @@
+#ifndef FASTCGI_CLIENT_HPP
+#define FASTCGI_CLIENT_HPP
+
+#include <string>
+#include <map>
+#include <vector>
+#include <deque>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include "cgi_output_buffer.hpp"
+
+/**
+ * @brief FastCGI客户端（非阻塞，连接池）
+ *
+ * location 配置了 fastcgi_pass 时代替 fork+exec：
+ *   - 每个后端地址一个连接池，连接带 FCGI_KEEP_CONN 复用
+ *   - 第一个连接上发送 FCGI_GET_VALUES，后端声明 FCGI_MPXS_CONNS=1 时
+ *     同一连接上并发多个 request id，否则一个连接同时只跑一个请求
+ *   - 连接满时请求在该后端的队列中等待
+ *   - 所有socket由主事件循环的select()驱动，接口与CGIProcess一致：
+ *     start() -> addFds() / handleIO() -> finish()
+ */
+class FastCGIClient {
+public:
+    FastCGIClient();
+    ~FastCGIClient();
+
+    /**
+     * @brief 提交一个请求
+     *
+     * @param clientFd 客户端fd（作为任务的key）
+     * @param address 后端地址 unix:/path.sock 或 host:port
+     * @param params CGI变量（FCGI_PARAMS）
+     * @param body 请求体（FCGI_STDIN）
+     * @param timeoutSeconds 超时时间（秒）
+     * @param outputLimit 输出在内存中的上限，超出部分写入 tempDir 中的临时文件
+     * @return true 已排队/已发送，false 地址无效
+     */
+    bool start(int clientFd,
+               const std::string& address,
+               const std::map<std::string, std::string>& params,
+               const std::string& body,
+               int timeoutSeconds,
+               size_t outputLimit,
+               const std::string& tempDir);
+
+    /**
+     * @brief 把后端连接加入select集合
+     */
+    void addFds(fd_set* readFds, fd_set* writeFds, int& maxFd) const;
+
+    /**
+     * @brief 处理就绪的后端连接并检查超时
+     *
+     * @param completed 输出参数，本轮完成（成功/失败/超时）的客户端fd
+     */
+    void handleIO(const fd_set* readFds, const fd_set* writeFds, std::vector<int>& completed);
+
+    /**
+     * @brief 客户端fd是否有FastCGI任务
+     */
+    bool hasJob(int clientFd) const { return requests_.count(clientFd) != 0; }
+
+    /**
+     * @brief 取出已完成任务的输出并释放任务
+     *
+     * @param output 输出参数，FCGI_STDOUT 的内容（CGI格式：headers + body，可能部分在临时文件中）
+     * @param error 输出参数，失败原因
+     * @return 0 成功；否则为应返回给客户端的错误码（502 / 504）
+     */
+    int finish(int clientFd, CGIOutputBuffer& output, std::string& error);
+
+    /**
+     * @brief 放弃任务（客户端断开），已发送的请求用 FCGI_ABORT_REQUEST 取消
+     */
+    void release(int clientFd);
+
+    size_t activeCount() const { return requests_.size(); }
+
+    /**
+     * @brief 有在事件循环之外完成的任务（如连接立即失败），下一轮select不应等待
+     */
+    bool hasFinished() const { return !finished_.empty(); }
+
+private:
+    struct Connection;
+    struct Upstream;
+
+    struct Request {
+        int clientFd;
+        Upstream* upstream;
+        unsigned short id;          // 0 = 尚未分配连接
+        Connection* conn;
+        std::string params;         // 编码后的 name-value 对
+        std::string body;
+        CGIOutputBuffer output;     // FCGI_STDOUT
+        long long deadlineMs;
+        int appStatus;
+        bool complete;
+        bool failed;
+        bool timedOut;
+        bool retried;               // 复用的连接被后端关闭时重发过一次
+        std::string error;
+    };
+
+    struct Connection {
+        int fd;
+        Upstream* upstream;
+        bool connected;             // 非阻塞connect已完成
+        std::string writeBuf;
+        size_t writeOffset;
+        std::string readBuf;
+        std::map<unsigned short, Request*> active; // NULL = 已取消，等待 END_REQUEST 释放id
+        unsigned short nextId;
+        size_t served;              // 已完成的请求数，>0 表示是复用的连接
+    };
+
+    struct Upstream {
+        std::string address;
+        struct sockaddr_storage addr;
+        socklen_t addrLen;
+        std::vector<Connection*> conns;
+        std::deque<Request*> waiting;
+        bool multiplex;             // FCGI_MPXS_CONNS
+        size_t maxRequests;         // FCGI_MAX_REQS（每连接）
+        size_t maxConns;            // FCGI_MAX_CONNS
+        bool valuesRequested;
+    };
+
+    std::map<std::string, Upstream*> upstreams_;
+    std::map<int, Request*> requests_;  // 客户端fd -> 请求（拥有）
+    std::vector<int> finished_;         // 已完成、尚未通过 handleIO 报告的客户端fd
+
+    Upstream* getUpstream(const std::string& address);
+    static bool resolveAddress(const std::string& address, Upstream& upstream);
+    Connection* openConnection(Upstream* upstream);
+    void dispatch(Upstream* upstream);
+    void sendRequest(Connection* conn, Request* req);
+    bool flush(Connection* conn);
+    bool readRecords(Connection* conn);
+    void handleRecord(Connection* conn, unsigned char type, unsigned short id,
+                      const char* content, size_t length);
+    void handleValues(Upstream* upstream, const char* content, size_t length);
+    void completeRequest(Request* req, bool failed, const std::string& error);
+    void detach(Request* req);
+    void closeConnection(Connection* conn, const std::string& reason);
+
+    static void appendRecord(std::string& out, unsigned char type, unsigned short id,
+                             const char* content, size_t length);
+    static void appendStream(std::string& out, unsigned char type, unsigned short id,
+                             const std::string& data);
+    static void appendNameValue(std::string& out, const std::string& name, const std::string& value);
+
+    // 禁止拷贝构造和赋值
+    FastCGIClient(const FastCGIClient&);
+    FastCGIClient& operator=(const FastCGIClient&);
+};
+
+#endif // FASTCGI_CLIENT_HPP
@@ -0,0 +1,107 @@
+"""Resident CGI worker for python scripts (cgi_workers directive).
+
+Started by the server as `<cgi_path> python_worker.py` and fed one request
+at a time over stdin:
+
+    REQ <script length> <env length> <body length>\\n<script><env><body>
+
+where env is "NAME=value\\n" lines. The script runs in this process with
+os.environ, sys.stdin and sys.stdout swapped for the request, exactly as a
+forked CGI would see them, and its raw output goes back as:
+
+    RES <exit status> <output length>\\n<output>
+
+Modules imported by scripts stay loaded between requests; that is the point.
+"""
+import io
+import os
+import runpy
+import sys
+import traceback
+
+
+class Capture(io.BytesIO):
+    """Script output; survives a script closing its stdout."""
+
+    def close(self):
+        pass
+
+
+def read_exact(stream, length):
+    data = b""
+    while len(data) < length:
+        chunk = stream.read(length - len(data))
+        if not chunk:
+            raise EOFError
+        data += chunk
+    return data
+
+
+def run_script(script, env, body):
+    output = Capture()
+    saved = sys.stdin, sys.stdout, sys.argv, os.getcwd()
+    base_env = dict(os.environ)
+
+    os.environ.clear()  # a forked CGI sees only the CGI variables too
+    os.environ.update(env)
+    sys.stdin = io.TextIOWrapper(io.BytesIO(body), encoding="utf-8", errors="replace")
+    sys.stdout = io.TextIOWrapper(output, encoding="utf-8", write_through=True)
+    sys.argv = [script]
+    status = 0
+    try:
+        runpy.run_path(script, run_name="__main__")
+    except SystemExit as exc:
+        if exc.code is None:
+            status = 0
+        elif isinstance(exc.code, int):
+            status = exc.code
+        else:
+            print(exc.code, file=sys.stderr)
+            status = 1
+    except BaseException:
+        traceback.print_exc(file=sys.stderr)
+        status = 1
+    finally:
+        try:
+            sys.stdout.flush()
+        except ValueError:
+            pass  # the script closed its stdout
+        data = output.getvalue()
+        sys.stdin, sys.stdout, sys.argv = saved[0], saved[1], saved[2]
+        os.chdir(saved[3])
+        os.environ.clear()
+        os.environ.update(base_env)
+    return status, data
+
+
+def main():
+    requests = sys.stdin.buffer
+    replies = sys.stdout.buffer
+    while True:
+        header = requests.readline()
+        if not header:
+            return
+        tag, script_len, env_len, body_len = header.split()
+        if tag != b"REQ":
+            sys.exit("python_worker: bad frame")
+        try:
+            script = read_exact(requests, int(script_len)).decode()
+            env_block = read_exact(requests, int(env_len)).decode("utf-8", "replace")
+            body = read_exact(requests, int(body_len))
+        except EOFError:
+            return
+
+        env = {}
+        for line in env_block.split("\n"):
+            name, sep, value = line.partition("=")
+            if sep:
+                env[name] = value
+
+        status, data = run_script(script, env, body)
+        replies.write(b"RES %d %d\n" % (status, len(data)))
+        replies.write(data)
+        replies.flush()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,39 @@
+# Resident CGI worker for shell scripts (cgi_workers directive).
+#
+# Started by the server as `<cgi_path> shell_worker.sh`; speaks the same
+# framed protocol as python_worker.py:
+#
+#   REQ <script length> <env length> <body length>\n<script><env><body>
+#   RES <exit status> <output length>\n<output>
+#
+# Each script is sourced in a subshell (fork, no exec, no interpreter boot)
+# with only the CGI variables exported and the body on stdin.
+
+spool=$(mktemp -d "${TMPDIR:-/tmp}/webserv-shell-worker.XXXXXX") || exit 1
+trap 'rm -rf "$spool"' EXIT
+search_path=$PATH
+
+# exactly $1 bytes from stdin: read builtins and head may consume more from a pipe
+take() {
+    dd bs=65536 count="$1" iflag=count_bytes,fullblock status=none
+}
+
+while IFS=' ' read -r tag script_len env_len body_len; do
+    [ "$tag" = "REQ" ] || exit 1
+    script=$(take "$script_len")
+    take "$env_len" > "$spool/env"
+    take "$body_len" > "$spool/body"
+
+    (
+        unset $(compgen -e)
+        PATH=$search_path   # unexported, like the default PATH of a fresh bash
+        while IFS= read -r var; do
+            export "$var"
+        done < "$spool/env"
+        . "$script"
+    ) < "$spool/body" > "$spool/out"
+    status=$?
+
+    printf 'RES %d %d\n' "$status" "$(stat -c %s "$spool/out")"
+    cat "$spool/out"
+done
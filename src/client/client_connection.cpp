@@ -1,20 +1,29 @@
 #include "client_connection.hpp"
+#include "../utils/server_clock.hpp"
+#include <unistd.h>
 
 // default constructor
 ClientConnection::ClientConnection() 
-    : fd(-1), bytes_sent(0), request_complete(false), response_ready(false), 
-    last_active(time(NULL)), http_request(NULL), http_response(NULL), server_instance(NULL), matched_location(NULL)
-{}
+    : fd(-1), bytes_sent(0), request_complete(false), response_ready(false), cgi_pending(false), cgi_streaming(false),
+    body_fd(-1), body_offset(0), body_remaining(0), body_tail(NULL),
+    last_active(ServerClock::monotonic()), bytes_in(0), bytes_out(0), http_request(NULL), http_response(NULL), listen_port(-1), vhosts(NULL), server_instance(NULL), matched_location(NULL)
+{
+    remote_addr.s_addr = 0;
+}
 
 // constructor with param
 ClientConnection::ClientConnection(int socket_fd) 
-    : fd(socket_fd), bytes_sent(0), request_complete(false), response_ready(false), 
-    last_active(time(NULL)), http_request(NULL), http_response(NULL), server_instance(NULL), matched_location(NULL)
-{}
+    : fd(socket_fd), bytes_sent(0), request_complete(false), response_ready(false), cgi_pending(false), cgi_streaming(false),
+    body_fd(-1), body_offset(0), body_remaining(0), body_tail(NULL),
+    last_active(ServerClock::monotonic()), bytes_in(0), bytes_out(0), http_request(NULL), http_response(NULL), listen_port(-1), vhosts(NULL), server_instance(NULL), matched_location(NULL)
+{
+    remote_addr.s_addr = 0;
+}
 
 // default destructor
 ClientConnection::~ClientConnection()
 {
+    closeBody();
     if (http_request) {
         delete http_request;
         // http_request = NULL;
@@ -23,4 +32,18 @@ ClientConnection::~ClientConnection()
         delete http_response;
         // http_response = NULL;
     }
-}
\ No newline at end of file
+}
+
+void ClientConnection::closeBody()
+{
+    if (body_fd != -1)
+        close(body_fd);
+    body_fd = -1;
+    body_offset = 0;
+    body_remaining = 0;
+}
+
+size_t ClientConnection::responseSize() const
+{
+    return response_buffer.size() + (body_tail ? body_tail->size() : 0);
+}
@@ -3,12 +3,16 @@
 
 #include <string>
 #include <ctime>
+#include <sys/types.h>
+#include <netinet/in.h>
 #include "../http/http_request.hpp" // handle http request
 #include "../http/http_response.hpp" // handle http response
 #include "../configparser/config.hpp" // for server & location config
+#include "../utils/latency_histogram.hpp" // per-phase request timestamps
 
 // forward declaration
 class ServerInstance;
+class VirtualHostTable;
 struct LocationConfig;
 
 struct ClientConnection {
@@ -18,13 +22,25 @@ struct ClientConnection {
     size_t bytes_sent;          // number of bytes sent
     bool request_complete;      // whether request is fully received
     bool response_ready;        // whether response is ready to send
-    time_t last_active;       // to deal with timeout
+    bool cgi_pending;           // awaiting upstream: CGI running, response not built yet
+    bool cgi_streaming;         // headers sent, CGI body still being forwarded from the pipe
+    int body_fd;                // file sent with sendfile() after response_buffer, -1 = none
+    off_t body_offset;          // next file offset to send
+    off_t body_remaining;       // file bytes still to send
+    const std::string* body_tail; // preloaded tail sent after response_buffer (not owned), NULL = none
+    time_t last_active;       // to deal with timeout (ServerClock monotonic seconds)
+    RequestTiming timing;       // phase timestamps of the current request
+    unsigned long long bytes_in;  // bytes received for the current request (access_log)
+    unsigned long long bytes_out; // bytes sent for the current response (access_log)
+    struct in_addr remote_addr; // client address, formatted only when logged
 
     // handle http request & response
     HttpRequest* http_request; // request parsing & validation
     HttpResponse* http_response; // response building
 
     // config context for this connection
+    int listen_port; // port of the listening socket that accepted this connection
+    const VirtualHostTable* vhosts; // name-based servers on that port, captured at accept
     ServerInstance* server_instance; // which server is handling this request
     LocationConfig* matched_location; // which location matched the URI
 
@@ -34,6 +50,9 @@ struct ClientConnection {
 
     // Constructor with parameters
     ClientConnection(int socket_fd);
+
+    void closeBody(); // drop the file body (sent, aborted or connection reused)
+    size_t responseSize() const; // response_buffer + body_tail, the bytes bytes_sent counts up to
 };
 
 #endif // CLIENT_CONNECTION_H
\ No newline at end of file
@@ -16,18 +16,47 @@ struct LocationConfig {
     bool autoindex;                          // 是否开启目录浏览
     std::string cgiExtension;                // CGI扩展名
     std::string cgiPath;                     // CGI程序路径
+    std::string fastcgiPass;                 // FastCGI后端: unix:/path.sock 或 host:port
     std::string redirect;                    // 重定向URL
     size_t clientMaxBodySize;                // 客户端最大请求体大小
                                              // 0 = 不限制
                                              // SIZE_MAX = 未设置(使用server级别)
                                              // 其他值 = 具体限制
+    std::string cgiWorker;                   // 常驻worker脚本（cgi_workers），空 = 每个请求fork一次
+    size_t cgiWorkersMin;                    // 预先启动的worker数
+    size_t cgiWorkersMax;                    // worker数上限，再多的请求排队
+    size_t cgiWorkerMaxRequests;             // worker处理多少个请求后回收，0 = 不回收
+    int cgiWorkerIdleTimeout;                // 超过min的worker空闲多少秒后回收
+    long long cgiCacheTtlMs;                 // GET响应微缓存的默认TTL（cgi_cache），0 = 不缓存
+    size_t cgiCacheMaxSize;                  // 该location缓存的总字节上限（LRU淘汰）
+    size_t cgiCacheMaxEntry;                 // 单个响应超过此大小不缓存
+    long long cgiCacheStaleMs;               // 过期后仍可返回旧响应的时间（后台刷新），0 = 不返回
+    long long cgiCacheLockTimeoutMs;         // 等待同key正在执行的CGI的最长时间，超时后自己执行
+    size_t cgiMaxConcurrent;                 // 该location同时运行的CGI上限（cgi_max_concurrent），0 = 不限制
+    size_t cgiQueueSize;                     // 达到上限后最多排队的请求数，再多的返回503
+    long long cgiQueueTimeoutMs;             // 排队超过此时间返回503
+    size_t cgiOutputBufferSize;              // FastCGI/worker输出在内存中的上限，超出部分写临时文件；fork的CGI超出后停止读管道
+    std::string cgiTempPath;                 // 输出超出上限时临时文件所在目录
+    std::string cgiSendfileRoot;             // 允许 X-Sendfile 的目录（cgi_sendfile_root），空 = 不识别 X-Sendfile
+    bool internal;                           // 只能通过 X-Accel-Redirect 访问，外部请求返回404
+    std::string stubStatus;                  // 状态页（stub_status）的默认格式: "text" / "prometheus"，空 = 普通location
 
     // 默认构造函数 (SIZE_MAX 表示未设置,使用server级别的配置)
-    LocationConfig() : autoindex(false), clientMaxBodySize(static_cast<size_t>(-1)) {}
+    LocationConfig() : autoindex(false), clientMaxBodySize(static_cast<size_t>(-1)),
+        cgiWorkersMin(0), cgiWorkersMax(0), cgiWorkerMaxRequests(1000), cgiWorkerIdleTimeout(60),
+        cgiCacheTtlMs(0), cgiCacheMaxSize(16 * 1024 * 1024), cgiCacheMaxEntry(1024 * 1024),
+        cgiCacheStaleMs(0), cgiCacheLockTimeoutMs(5000),
+        cgiMaxConcurrent(0), cgiQueueSize(64), cgiQueueTimeoutMs(5000),
+        cgiOutputBufferSize(1024 * 1024), cgiTempPath("/tmp"), internal(false) {}
 
     // 构造函数
     LocationConfig(const std::string& locationPath)
-        : path(locationPath), autoindex(false), clientMaxBodySize(static_cast<size_t>(-1)) {}
+        : path(locationPath), autoindex(false), clientMaxBodySize(static_cast<size_t>(-1)),
+          cgiWorkersMin(0), cgiWorkersMax(0), cgiWorkerMaxRequests(1000), cgiWorkerIdleTimeout(60),
+          cgiCacheTtlMs(0), cgiCacheMaxSize(16 * 1024 * 1024), cgiCacheMaxEntry(1024 * 1024),
+        cgiCacheStaleMs(0), cgiCacheLockTimeoutMs(5000),
+        cgiMaxConcurrent(0), cgiQueueSize(64), cgiQueueTimeoutMs(5000),
+        cgiOutputBufferSize(1024 * 1024), cgiTempPath("/tmp"), internal(false) {}
 };
 
 // Server配置结构体
@@ -67,9 +96,18 @@ struct ServerConfig {
 // 全局配置结构体
 struct Config {
     std::vector<ServerConfig> servers;       // 所有服务器配置
-    
+    std::map<std::string, std::string> mimeTypes; // 扩展名 -> MIME类型 (types {} / include)
+    size_t cgiMaxConcurrent;                 // 全局同时运行的CGI上限（main级别 cgi_max_concurrent），0 = 不限制
+    size_t cgiQueueSize;                     // 全局最多排队的CGI请求数
+    long long cgiQueueTimeoutMs;             // 全局排队超时
+    std::string errorLog;                    // error_log: "stderr" / "stdout" / 文件路径
+    std::string errorLogLevel;               // 最低日志级别: debug / info / warn / error
+    std::string accessLog;                   // access_log 文件路径，空 = 关闭
+    std::string accessLogFormat;             // access_log 格式（$变量），空 = 默认格式
+
     // 默认构造函数
-    Config() {}
+    Config() : cgiMaxConcurrent(0), cgiQueueSize(256), cgiQueueTimeoutMs(5000),
+        errorLog("stderr"), errorLogLevel("info") {}
     
     // 辅助函数：添加服务器配置
     void addServer(const ServerConfig& server) {
@@ -92,6 +130,14 @@ struct Config {
     // 辅助函数：清空配置
     void clear() {
         servers.clear();
+        mimeTypes.clear();
+        cgiMaxConcurrent = 0;
+        cgiQueueSize = 256;
+        cgiQueueTimeoutMs = 5000;
+        errorLog = "stderr";
+        errorLogLevel = "info";
+        accessLog.clear();
+        accessLogFormat.clear();
     }
     
     // 辅助函数：检查配置是否为空
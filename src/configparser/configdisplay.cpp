@@ -102,6 +102,53 @@ void displayLocationConfig(const LocationConfig& location, size_t indent) {
     printIndent(indent);
     std::cout << "├── CGI Path: \"" << location.cgiPath << "\"" << std::endl;
 
+    if (!location.fastcgiPass.empty()) {
+        printIndent(indent);
+        std::cout << "├── FastCGI Pass: \"" << location.fastcgiPass << "\"" << std::endl;
+    }
+
+    if (!location.cgiWorker.empty()) {
+        printIndent(indent);
+        std::cout << "├── CGI Workers: " << location.cgiWorkersMin << "-" << location.cgiWorkersMax
+                  << " \"" << location.cgiWorker << "\" (max requests " << location.cgiWorkerMaxRequests
+                  << ", idle " << location.cgiWorkerIdleTimeout << "s)" << std::endl;
+    }
+
+    if (location.cgiCacheTtlMs > 0) {
+        printIndent(indent);
+        std::cout << "├── CGI Cache: " << location.cgiCacheTtlMs << " ms, "
+                  << location.cgiCacheMaxSize << " bytes (max entry "
+                  << location.cgiCacheMaxEntry << "), stale " << location.cgiCacheStaleMs
+                  << " ms, lock timeout " << location.cgiCacheLockTimeoutMs << " ms" << std::endl;
+    }
+
+    if (location.cgiMaxConcurrent > 0) {
+        printIndent(indent);
+        std::cout << "├── CGI Max Concurrent: " << location.cgiMaxConcurrent << " (queue "
+                  << location.cgiQueueSize << ", " << location.cgiQueueTimeoutMs << " ms)" << std::endl;
+    }
+
+    if (!location.cgiExtension.empty() || !location.fastcgiPass.empty()) {
+        printIndent(indent);
+        std::cout << "├── CGI Output Buffer: " << location.cgiOutputBufferSize << " bytes (spill to \""
+                  << location.cgiTempPath << "\")" << std::endl;
+    }
+
+    if (!location.cgiSendfileRoot.empty()) {
+        printIndent(indent);
+        std::cout << "├── CGI Sendfile Root: \"" << location.cgiSendfileRoot << "\"" << std::endl;
+    }
+
+    if (location.internal) {
+        printIndent(indent);
+        std::cout << "├── Internal: ON" << std::endl;
+    }
+
+    if (!location.stubStatus.empty()) {
+        printIndent(indent);
+        std::cout << "├── Stub Status: " << location.stubStatus << std::endl;
+    }
+
     // 重定向设置
     printIndent(indent);
     std::cout << "└── Redirect: \"" << location.redirect << "\"" << std::endl;
@@ -200,6 +247,13 @@ void displayServerConfig(const ServerConfig& server, size_t serverIndex) {
 void displayFullConfig(const Config& config) {
     printSeparator("WEBSERV CONFIGURATION DISPLAY", '=');
     std::cout << "Total servers configured: " << config.getServerCount() << std::endl;
+    std::cout << "MIME types configured: " << config.mimeTypes.size() << std::endl;
+    if (config.cgiMaxConcurrent > 0) {
+        std::cout << "CGI max concurrent: " << config.cgiMaxConcurrent << " (queue "
+                  << config.cgiQueueSize << ", " << config.cgiQueueTimeoutMs << " ms)" << std::endl;
+    }
+    std::cout << "Error log: " << config.errorLog << " (" << config.errorLogLevel << ")" << std::endl;
+    std::cout << "Access log: " << (config.accessLog.empty() ? std::string("off") : config.accessLog) << std::endl;
     std::cout << std::endl;
     
     if (config.empty()) {
@@ -18,6 +18,10 @@ bool ConfigParser::parseFile(const std::string& filename, Config& config) {
         lastError = "Cannot open file: " + filename;
         return false;
     }
+
+    // relative include paths are resolved against the config file's directory
+    size_t lastSlash = filename.find_last_of('/');
+    configDir = (lastSlash == std::string::npos) ? "" : filename.substr(0, lastSlash);
     
     std::string content((std::istreambuf_iterator<char>(file)),
                         std::istreambuf_iterator<char>());
@@ -129,7 +133,7 @@ Token ConfigParser::getNextToken(const std::string& content, size_t& pos) {
 }
 
 bool ConfigParser::isWordChar(char c) {
-    return std::isalnum(c) || c == '_' || c == '-' || c == '.' || c == '/' || c == ':';
+    return std::isalnum(c) || c == '_' || c == '-' || c == '.' || c == '/' || c == ':' || c == '+' || c == '*';
 }
 
 bool ConfigParser::isDigit(char c) {
@@ -190,6 +194,13 @@ std::string ConfigParser::readNumber(const std::string& content, size_t& pos) {
             currentColumn++;
         }
     }
+
+    // words starting with a digit (eg. "3gp", "7z" in mime.types) stay one token
+    while (pos < content.length() && isWordChar(content[pos])) {
+        number += content[pos];
+        pos++;
+        currentColumn++;
+    }
     
     return number;
 }
@@ -253,8 +264,71 @@ bool ConfigParser::parseConfig(Config& config) {
             }
             
             config.addServer(server);
+        } else if (currentToken().type == TOKEN_WORD && currentToken().value == "types") {
+            consumeToken(); // 消费 "types"
+
+            if (!expectOpenBrace() || !parseTypes(config) || !expectCloseBrace()) {
+                return false;
+            }
+        } else if (currentToken().type == TOKEN_WORD && currentToken().value == "include") {
+            consumeToken(); // 消费 "include"
+
+            std::vector<std::string> args = getDirectiveArgs();
+            if (!parseInclude(config, args) || !expectSemicolon()) {
+                return false;
+            }
+        } else if (currentToken().type == TOKEN_WORD && currentToken().value == "cgi_max_concurrent") {
+            consumeToken();
+
+            std::vector<std::string> args = getDirectiveArgs();
+            if (args.size() != 1 || !parseCount(args[0], config.cgiMaxConcurrent)) {
+                printError("cgi_max_concurrent directive requires a number (0 = unlimited)");
+                return false;
+            }
+            if (!expectSemicolon()) {
+                return false;
+            }
+        } else if (currentToken().type == TOKEN_WORD && currentToken().value == "cgi_queue") {
+            consumeToken();
+
+            std::vector<std::string> args = getDirectiveArgs();
+            if (!parseCgiQueue(config.cgiQueueSize, config.cgiQueueTimeoutMs, args) || !expectSemicolon()) {
+                return false;
+            }
+        } else if (currentToken().type == TOKEN_WORD && currentToken().value == "error_log") {
+            consumeToken();
+
+            // error_log <stderr|stdout|file> [debug|info|warn|error]
+            std::vector<std::string> args = getDirectiveArgs();
+            if (args.empty() || args.size() > 2
+                || (args.size() == 2 && args[1] != "debug" && args[1] != "info"
+                    && args[1] != "warn" && args[1] != "error")) {
+                printError("error_log directive requires a destination and an optional level (error_log stderr info)");
+                return false;
+            }
+            config.errorLog = args[0];
+            if (args.size() == 2)
+                config.errorLogLevel = args[1];
+            if (!expectSemicolon()) {
+                return false;
+            }
+        } else if (currentToken().type == TOKEN_WORD && currentToken().value == "access_log") {
+            consumeToken();
+
+            // access_log <file|off> ["format with $variables"]
+            std::vector<std::string> args = getDirectiveArgs();
+            if (args.empty() || args.size() > 2) {
+                printError("access_log directive requires a file (or off) and an optional format");
+                return false;
+            }
+            config.accessLog = args[0] == "off" ? std::string() : args[0];
+            if (args.size() == 2)
+                config.accessLogFormat = args[1];
+            if (!expectSemicolon()) {
+                return false;
+            }
         } else {
-            printError("Expected 'server' directive");
+            printError("Expected 'server', 'types', 'include', 'cgi_max_concurrent', 'cgi_queue', 'error_log' or 'access_log' directive");
             return false;
         }
     }
@@ -262,6 +336,89 @@ bool ConfigParser::parseConfig(Config& config) {
     return true;
 }
 
+/* types { text/html html htm; image/svg+xml svg; ... }
+    - same layout as nginx mime.types: MIME type followed by its extensions
+    - later entries override earlier ones and the built-in defaults
+*/
+bool ConfigParser::parseTypes(Config& config) {
+    while (currentToken().type != TOKEN_RBRACE && currentToken().type != TOKEN_EOF) {
+        if (currentToken().type != TOKEN_WORD && currentToken().type != TOKEN_STRING) {
+            printError("Expected MIME type in types block");
+            return false;
+        }
+        std::string mimeType = currentToken().value;
+        consumeToken();
+
+        std::vector<std::string> extensions = getDirectiveArgs();
+        if (extensions.empty()) {
+            printError("MIME type " + mimeType + " requires at least one extension");
+            return false;
+        }
+        for (size_t i = 0; i < extensions.size(); ++i) {
+            std::string ext = extensions[i];
+            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+            config.mimeTypes[ext] = mimeType;
+        }
+
+        if (!expectSemicolon()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* include mime.types;
+    - the included file may only contain types blocks
+*/
+bool ConfigParser::parseInclude(Config& config, const std::vector<std::string>& args) {
+    if (args.size() != 1) {
+        printError("include directive requires one argument");
+        return false;
+    }
+    std::string path = args[0];
+    if (!path.empty() && path[0] != '/' && !configDir.empty()) {
+        path = configDir + "/" + path;
+    }
+
+    std::ifstream file(path.c_str());
+    if (!file.is_open()) {
+        printError("Cannot open included file: " + path);
+        return false;
+    }
+    std::string included((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+    file.close();
+
+    ConfigParser parser;
+    if (!parser.parseTypesFile(included, config)) {
+        lastError = path + ": " + parser.getLastError();
+        return false;
+    }
+    return true;
+}
+
+bool ConfigParser::parseTypesFile(const std::string& configContent, Config& config) {
+    content = configContent;
+    currentTokenIndex = 0;
+    tokens.clear();
+
+    if (!tokenize(configContent)) {
+        return false;
+    }
+
+    while (currentToken().type != TOKEN_EOF) {
+        if (currentToken().type != TOKEN_WORD || currentToken().value != "types") {
+            printError("Expected 'types' block in included file");
+            return false;
+        }
+        consumeToken();
+        if (!expectOpenBrace() || !parseTypes(config) || !expectCloseBrace()) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool ConfigParser::parseServer(ServerConfig& server) {
     while (currentToken().type != TOKEN_RBRACE && currentToken().type != TOKEN_EOF) {
         if (currentToken().type == TOKEN_WORD) {
@@ -344,6 +501,55 @@ bool ConfigParser::parseListenWithValidation(ServerConfig& server, const std::ve
     return true;
 }
 
+// 纯数字且在 1-65535 范围内
+bool ConfigParser::isValidPortString(const std::string& portStr) {
+    if (portStr.empty() || portStr.length() > 5)
+        return false;
+    for (size_t i = 0; i < portStr.length(); ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(portStr[i])))
+            return false;
+    }
+    long port = std::strtol(portStr.c_str(), NULL, 10);
+    return port > 0 && port <= 65535;
+}
+
+// 纯数字，不允许符号（strtoul 会接受 "-1"）
+bool ConfigParser::parseCount(const std::string& str, size_t& value) {
+    if (str.empty() || str.length() > 9)
+        return false;
+    for (size_t i = 0; i < str.length(); ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(str[i])))
+            return false;
+    }
+    value = std::strtoul(str.c_str(), NULL, 10);
+    return true;
+}
+
+// 500ms | 1s | 5m | 1h，不带单位为秒
+bool ConfigParser::parseDuration(const std::string& str, long long& milliseconds) {
+    size_t digits = 0;
+    while (digits < str.length() && std::isdigit(static_cast<unsigned char>(str[digits])))
+        ++digits;
+    size_t value = 0;
+    if (!parseCount(str.substr(0, digits), value))
+        return false;
+
+    std::string unit = str.substr(digits);
+    long long scale = 0;
+    if (unit == "ms")
+        scale = 1;
+    else if (unit.empty() || unit == "s")
+        scale = 1000;
+    else if (unit == "m")
+        scale = 60 * 1000;
+    else if (unit == "h")
+        scale = 60 * 60 * 1000;
+    else
+        return false;
+    milliseconds = static_cast<long long>(value) * scale;
+    return true;
+}
+
 bool ConfigParser::parseErrorPageWithValidation(ServerConfig& server, const std::vector<std::string>& args) {
     // error_page 指令格式: error_page code [code...] uri;
     // 最后一个参数是文件路径,前面所有参数都是错误码
@@ -488,6 +694,76 @@ void ConfigParser::parseCgiPass(LocationConfig& location, const std::vector<std:
     }
 }
 
+// fastcgi_pass unix:/run/php/php-fpm.sock; | fastcgi_pass 127.0.0.1:9000;
+bool ConfigParser::parseFastcgiPass(LocationConfig& location, const std::vector<std::string>& args) {
+    const std::string& address = args[0];
+
+    if (address.compare(0, 5, "unix:") == 0) {
+        if (address.length() == 5) {
+            printError("fastcgi_pass: empty unix socket path");
+            return false;
+        }
+    } else {
+        size_t colon = address.rfind(':');
+        if (colon == std::string::npos || colon == 0 || !isValidPortString(address.substr(colon + 1))) {
+            printError("fastcgi_pass: invalid address " + address);
+            return false;
+        }
+    }
+    location.fastcgiPass = address;
+    return true;
+}
+
+// cgi_workers 2 8 ./src/cgi/workers/python_worker.py;
+bool ConfigParser::parseCgiWorkers(LocationConfig& location, const std::vector<std::string>& args) {
+    size_t minWorkers = 0;
+    size_t maxWorkers = 0;
+    if (!parseCount(args[0], minWorkers) || !parseCount(args[1], maxWorkers)
+        || maxWorkers == 0 || minWorkers > maxWorkers) {
+        printError("cgi_workers: expected 0 <= min <= max, max >= 1");
+        return false;
+    }
+    location.cgiWorkersMin = minWorkers;
+    location.cgiWorkersMax = maxWorkers;
+    location.cgiWorker = args[2];
+    return true;
+}
+
+// cgi_cache 1s; | cgi_cache 10s 64m;
+bool ConfigParser::parseCgiCache(LocationConfig& location, const std::vector<std::string>& args) {
+    long long ttl = 0;
+    if (!parseDuration(args[0], ttl) || ttl <= 0) {
+        printError("cgi_cache: invalid ttl " + args[0]);
+        return false;
+    }
+    location.cgiCacheTtlMs = ttl;
+    if (args.size() > 1) {
+        location.cgiCacheMaxSize = parseSize(args[1]);
+        if (location.cgiCacheMaxSize == 0) {
+            printError("cgi_cache: invalid size " + args[1]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// cgi_queue 64; | cgi_queue 64 5s;
+bool ConfigParser::parseCgiQueue(size_t& size, long long& timeoutMs, const std::vector<std::string>& args) {
+    if (args.empty() || args.size() > 2) {
+        printError("cgi_queue directive requires a size and an optional timeout (cgi_queue 64 5s)");
+        return false;
+    }
+    if (!parseCount(args[0], size)) {
+        printError("cgi_queue: invalid size " + args[0]);
+        return false;
+    }
+    if (args.size() > 1 && (!parseDuration(args[1], timeoutMs) || timeoutMs <= 0)) {
+        printError("cgi_queue: invalid timeout " + args[1]);
+        return false;
+    }
+    return true;
+}
+
 bool ConfigParser::parseLocationDirective(LocationConfig& location) {
     std::string directive = currentToken().value;
     consumeToken();
@@ -545,6 +821,97 @@ bool ConfigParser::parseLocationDirective(LocationConfig& location) {
             return false;
         }
         parseCgiPass(location, args);
+    } else if (directive == "fastcgi_pass") {
+        if (args.size() != 1) {
+            printError("fastcgi_pass directive requires one argument (unix:/path.sock or host:port)");
+            return false;
+        }
+        if (!parseFastcgiPass(location, args)) {
+            return false;
+        }
+    } else if (directive == "cgi_workers") {
+        if (args.size() != 3) {
+            printError("cgi_workers directive requires three arguments (min, max and worker script)");
+            return false;
+        }
+        if (!parseCgiWorkers(location, args)) {
+            return false;
+        }
+    } else if (directive == "cgi_worker_max_requests") {
+        if (args.size() != 1 || !parseCount(args[0], location.cgiWorkerMaxRequests)) {
+            printError("cgi_worker_max_requests directive requires a number (0 = unlimited)");
+            return false;
+        }
+    } else if (directive == "cgi_worker_idle_timeout") {
+        size_t seconds = 0;
+        if (args.size() != 1 || !parseCount(args[0], seconds)) {
+            printError("cgi_worker_idle_timeout directive requires a number of seconds");
+            return false;
+        }
+        location.cgiWorkerIdleTimeout = static_cast<int>(seconds);
+    } else if (directive == "cgi_cache") {
+        if (args.empty() || args.size() > 2) {
+            printError("cgi_cache directive requires a ttl and an optional size (cgi_cache 1s 16m)");
+            return false;
+        }
+        if (!parseCgiCache(location, args)) {
+            return false;
+        }
+    } else if (directive == "cgi_cache_max_entry") {
+        if (args.size() != 1) {
+            printError("cgi_cache_max_entry directive requires a size");
+            return false;
+        }
+        location.cgiCacheMaxEntry = parseSize(args[0]);
+    } else if (directive == "cgi_cache_stale") {
+        if (args.size() != 1 || !parseDuration(args[0], location.cgiCacheStaleMs)) {
+            printError("cgi_cache_stale directive requires a duration (cgi_cache_stale 10s)");
+            return false;
+        }
+    } else if (directive == "cgi_max_concurrent") {
+        if (args.size() != 1 || !parseCount(args[0], location.cgiMaxConcurrent)) {
+            printError("cgi_max_concurrent directive requires a number (0 = unlimited)");
+            return false;
+        }
+    } else if (directive == "cgi_queue") {
+        if (!parseCgiQueue(location.cgiQueueSize, location.cgiQueueTimeoutMs, args)) {
+            return false;
+        }
+    } else if (directive == "cgi_cache_lock_timeout") {
+        if (args.size() != 1 || !parseDuration(args[0], location.cgiCacheLockTimeoutMs)) {
+            printError("cgi_cache_lock_timeout directive requires a duration (cgi_cache_lock_timeout 5s)");
+            return false;
+        }
+    } else if (directive == "cgi_output_buffer") {
+        if (args.empty() || args.size() > 2) {
+            printError("cgi_output_buffer directive requires a size and an optional temp directory (cgi_output_buffer 1m /tmp)");
+            return false;
+        }
+        location.cgiOutputBufferSize = parseSize(args[0]);
+        if (location.cgiOutputBufferSize == 0) {
+            printError("cgi_output_buffer: invalid size " + args[0]);
+            return false;
+        }
+        if (args.size() > 1)
+            location.cgiTempPath = args[1];
+    } else if (directive == "cgi_sendfile_root") {
+        if (args.size() != 1 || args[0].empty() || args[0][0] != '/') {
+            printError("cgi_sendfile_root directive requires an absolute directory");
+            return false;
+        }
+        location.cgiSendfileRoot = args[0];
+    } else if (directive == "internal") {
+        if (!args.empty()) {
+            printError("internal directive takes no arguments");
+            return false;
+        }
+        location.internal = true;
+    } else if (directive == "stub_status") {
+        if (args.size() > 1 || (args.size() == 1 && args[0] != "text" && args[0] != "prometheus")) {
+            printError("stub_status directive takes an optional format (stub_status text|prometheus)");
+            return false;
+        }
+        location.stubStatus = args.empty() ? "text" : args[0];
     } else if (directive == "return" || directive == "redirect") {
         if (args.empty()) {
             printError(directive + "指令需要一个参数");
@@ -35,6 +35,7 @@ struct Token {
 class ConfigParser {
 private:
     std::string content;                // 配置文件内容
+    std::string configDir;              // 配置文件所在目录 (include 相对路径)
     std::vector<Token> tokens;          // 词法分析后的token列表
     size_t currentTokenIndex;           // 当前处理的token索引
     size_t currentLine;                 // 当前行号
@@ -57,6 +58,9 @@ private:
     bool parseLocation(LocationConfig& location);
     bool parseServerDirective(ServerConfig& server);
     bool parseLocationDirective(LocationConfig& location);
+    bool parseTypes(Config& config);
+    bool parseInclude(Config& config, const std::vector<std::string>& args);
+    bool parseTypesFile(const std::string& configContent, Config& config);
     
     // 辅助方法
     Token currentToken();
@@ -81,12 +85,18 @@ private:
     void parseCgi(LocationConfig& location, const std::vector<std::string>& args);
     void parseRedirect(LocationConfig& location, const std::vector<std::string>& args);
     void parseCgiPass(LocationConfig& location, const std::vector<std::string>& args);
+    bool parseFastcgiPass(LocationConfig& location, const std::vector<std::string>& args);
+    bool parseCgiWorkers(LocationConfig& location, const std::vector<std::string>& args);
+    bool parseCgiCache(LocationConfig& location, const std::vector<std::string>& args);
+    bool parseCgiQueue(size_t& size, long long& timeoutMs, const std::vector<std::string>& args);
 	
 	bool parseListenWithValidation(ServerConfig& server, const std::vector<std::string>& args);
     bool parseErrorPageWithValidation(ServerConfig& server, const std::vector<std::string>& args);
     bool parseAllowMethodsWithValidation(LocationConfig& location, const std::vector<std::string>& args);
 
 	bool isValidPortString(const std::string& portStr);
+    bool parseCount(const std::string& str, size_t& value);
+    bool parseDuration(const std::string& str, long long& milliseconds);
     bool isValidIPAddress(const std::string& ip);
 
     // 工具方法
@@ -1,24 +1,40 @@
 #include "initialize.hpp"
+#include "../utils/server_clock.hpp"
+#include "../utils/server_stats.hpp"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
 #include <cstring>
 #include <errno.h>
+#include <limits.h>
+#include <cstdlib>
+#include <arpa/inet.h>
 
 // =================== ServerInstance Implementation ===================
 
 ServerInstance::ServerInstance(const ServerConfig& serverConfig) 
-    : config(serverConfig) {
+    : config(serverConfig), latency(serverConfig.locations.size() + 1) {
+    locationMatcher.build(config.locations);
+    std::ostringstream label;
+    label << (config.serverName.empty() ? std::string("_") : config.serverName[0]);
+    if (!config.listen.empty())
+        label << ":" << config.listen[0];
+    label_ = label.str();
 }
 
 ServerInstance::~ServerInstance() {
     cleanup();
 }
 
-bool ServerInstance::initialize() {
+bool ServerInstance::initialize(const std::set<int>& sharedPorts) {
     // Create socket for each listening port
     for (size_t i = 0; i < config.listen.size(); ++i) {
         int port = config.listen[i];
+        // name-based virtual host: the earlier server's socket accepts for both
+        if (sharedPorts.count(port)) {
+            std::cout << "Port " << port << " already bound, sharing the listening socket" << std::endl;
+            continue;
+        }
         int sockfd = socket(AF_INET, SOCK_STREAM, 0);
         if (sockfd == -1) {
             std::cerr << "Failed to create socket for port " << port 
@@ -39,7 +55,8 @@ bool ServerInstance::initialize() {
         }
 
 
-        // Set non-blocking mode
+        // Set non-blocking & close-on-exec (CGI children must not inherit the listener)
+        fcntl(sockfd, F_SETFD, FD_CLOEXEC);
         int flags = fcntl(sockfd, F_GETFL, 0);
         if (flags == -1 || fcntl(sockfd, F_SETFL, flags | O_NONBLOCK) == -1) {
             std::cerr << "Failed to set non-blocking mode for port " << port 
@@ -70,10 +87,45 @@ bool ServerInstance::initialize() {
         
         std::cout << "Socket created and bound to port " << port << std::endl;
     }
-    
+
+    loadErrorPages();
     return true;
 }
 
+/* preload configured error pages
+    - each error_page URI is resolved like a normal request (location root/alias)
+    - status line, headers & body are serialized once; per request only Date & Connection are added
+    - a page that cannot be read is skipped, the generated default page is used instead
+*/
+bool ServerInstance::loadErrorPages() {
+    errorPageCache.clear();
+    bool allLoaded = true;
+
+    for (std::map<int, std::string>::const_iterator it = config.errorPages.begin();
+         it != config.errorPages.end(); ++it) {
+        int statusCode = it->first;
+        const std::string& uri = it->second;
+        std::string filePath = resolveFilePath(uri, findMatchingLocation(uri));
+
+        std::ifstream file(filePath.c_str(), std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Warning: cannot load error page " << statusCode
+                      << " from " << filePath << std::endl;
+            allLoaded = false;
+            continue;
+        }
+        std::ostringstream body;
+        body << file.rdbuf();
+        errorPageCache[statusCode] = HttpResponse::preload(statusCode, body.str(), filePath);
+    }
+    return allLoaded;
+}
+
+const PreloadedResponse* ServerInstance::getErrorPage(int statusCode) const {
+    std::map<int, PreloadedResponse>::const_iterator it = errorPageCache.find(statusCode);
+    return (it != errorPageCache.end()) ? &it->second : NULL;
+}
+
 bool ServerInstance::startListening() {
     for (size_t i = 0; i < socketFds.size(); ++i) {
         int sockfd = socketFds[i];
@@ -107,6 +159,8 @@ void WebServer::cleanup() {
     }
     servers.clear();
     portToServers.clear();
+    vhostTables.clear();
+    listenFdToPort.clear();
 }
 
 bool ServerInstance::isListeningOnPort(int port) const {
@@ -119,72 +173,51 @@ int ServerInstance::getSocketForPort(int port) const {
 }
 
 
+/* longest-prefix location lookup through the precompiled radix trie
+    - see LocationMatcher for the exact / directory / prefix rules
+*/
 LocationConfig* ServerInstance::findMatchingLocation(const std::string& path) {
-    LocationConfig* bestMatch = NULL;
-    size_t maxLength = 0;
-
-    // location iteration
-    for (size_t i = 0; i < config.locations.size(); ++i) {
-        LocationConfig& location = config.locations[i];
-        bool match = false;
-
-        // 1. exact match
-        if (location.path == path)
-            match = true;
-        // 2. directory match: eg. /github/ should match /github
-        else if (location.path.length() > 1 && location.path[location.path.length() - 1] == '/'
-                 && path + "/" == location.path)
-            match = true;
-        // 3. prefix match with boundary checkes
-        else if (location.path.length() <= path.length()
-                && path.substr(0, location.path.length()) == location.path)
-                {
-                    // boundary check
-                    if (location.path[location.path.length() - 1] == '/' // location ends with '/'
-                        || path.length() == location.path.length() // exact length match
-                        || path[location.path.length()] == '/') // next char is '/
-                        match = true;
-                }
-        // update maxLength & bestMatch
-        if (match && location.path.length() > maxLength) {
-            maxLength = location.path.length();
-            bestMatch = &location;
-        }
-    }
-    return bestMatch;
+    int index = locationMatcher.match(path);
+    return (index < 0) ? NULL : &config.locations[index];
 }
 
-bool ServerInstance::matchesServerName(const std::string& hostHeader) const {
-    if (config.serverName.empty()) {
-        return true; // 默认服务器
-    }
-    
-    // 提取主机名（去掉端口）
-    std::string host = hostHeader;
-    size_t colonPos = host.find(':');
-    if (colonPos != std::string::npos) {
-        host = host.substr(0, colonPos);
-    }
-    
-    // 检查是否匹配任何服务器名
-    for (size_t i = 0; i < config.serverName.size(); ++i) {
-        const std::string& serverName = config.serverName[i];
-        if (host == serverName || serverName == "_") {
-            return true;
-        }
+PhaseLatency& ServerInstance::latencyFor(const LocationConfig* location) {
+    size_t index = config.locations.size();
+    if (location && !config.locations.empty() && location >= &config.locations[0]
+        && location < &config.locations[0] + config.locations.size())
+        index = location - &config.locations[0];
+    return latency[index];
+}
+
+/* construct file path with root/ alias logic
+    - alias: strip the location path, append the rest to the alias
+    - root: append the full URI to location root, or server root
+*/
+std::string ServerInstance::resolveFilePath(const std::string& uri, const LocationConfig* location) const {
+    // if using alias: replace the requst URI with location path
+    if (location && !location->alias.empty())
+    {
+        std::string remaining_path = uri; // eg. location /kapouet/pouic/toto/pouet
+        // strip the location path prefix, eg. location /kapouet
+        if (uri.find(location->path) == 0)
+            remaining_path = uri.substr(location->path.length());
+        return (location->alias + remaining_path);
     }
-    
-    return false;
+    // using root: append full URI to root
+    if (location && !location->root.empty())
+        return location->root + uri;
+    return config.root + uri;
 }
 
 // =================== WebServer Implementation ===================
 
-WebServer::WebServer() : initialized(false), running(false) {
+WebServer::WebServer() : initialized(false), running(false), latencyDumpRequested(0) {
 }
 
 WebServer::~WebServer() {
     stop();
     cleanup();
+    Logger::stop(); // flush what the writer thread hasn't written yet
 }
 
 bool WebServer::initialize(const std::string& configFile) {
@@ -206,6 +239,15 @@ bool WebServer::initialize(const std::string& configFile) {
 bool WebServer::initializeFromConfig(const Config& cfg) {
     config = cfg;
 
+    // build the extension -> MIME type table once, not per response
+    MimeTypes::configure(config.mimeTypes);
+
+    std::string format_error;
+    if (!config.accessLogFormat.empty() && !accessLogFormat.compile(config.accessLogFormat, format_error)) {
+        std::cerr << "access_log: " << format_error << std::endl;
+        return false;
+    }
+
     // Validate configuration
     if (!validateConfig()) {
         std::cerr << "Configuration validation failed" << std::endl;
@@ -271,16 +313,19 @@ bool WebServer::validateConfig() {
 }
 
 bool WebServer::createServerInstances() {
+    std::set<int> boundPorts; // only the first server on a port opens the socket
+
     for (size_t i = 0; i < config.getServerCount(); ++i) {
         const ServerConfig& serverConfig = config.getServer(i);
         
         ServerInstance* server = new ServerInstance(serverConfig);
-        if (!server->initialize()) {
+        if (!server->initialize(boundPorts)) {
             delete server;
             return false;
         }
         
         servers.push_back(server);
+        boundPorts.insert(serverConfig.listen.begin(), serverConfig.listen.end());
     }
     
     return true;
@@ -294,6 +339,10 @@ bool WebServer::setupPortMapping() {
         for (size_t j = 0; j < listenPorts.size(); ++j) {
             int port = listenPorts[j];
             portToServers[port].push_back(server);
+            vhostTables[port].add(server, server->getConfig().serverName);
+            int fd = server->getSocketForPort(port);
+            if (fd != -1)
+                listenFdToPort[fd] = port;
         }
     }
     
@@ -382,6 +431,12 @@ bool WebServer::start() {
         std::cout << "Server is already running" << std::endl;
         return true;
     }
+
+    // from here on runtime messages go through the logger's writer thread
+    LogLevel level = LOG_LEVEL_INFO;
+    Logger::parseLevel(config.errorLogLevel, level);
+    if (!Logger::start(config.errorLog, level, config.accessLog))
+        return false;
     
     // 开始监听所有服务器
     for (size_t i = 0; i < servers.size(); ++i) {
@@ -392,6 +447,15 @@ bool WebServer::start() {
         }
     }
     
+    cgiHandler_.setLimits(config.cgiMaxConcurrent, config.cgiQueueSize, config.cgiQueueTimeoutMs);
+
+    // resident CGI interpreters are started before the first request needs one
+    for (size_t i = 0; i < servers.size(); ++i) {
+        const std::vector<LocationConfig>& locations = servers[i]->getConfig().locations;
+        for (size_t j = 0; j < locations.size(); ++j)
+            cgiHandler_.prespawnWorkers(locations[j]);
+    }
+
     running = true;
     std::cout << "WebServer started successfully!" << std::endl;
     
@@ -432,35 +496,13 @@ void ServerInstance::cleanup() {
 }
 
 ServerInstance* WebServer::findServerByHost(const std::string& hostHeader, int port) {
-    // port lookup: find all servers listening on this port
-    std::map<int, std::vector<ServerInstance*> >::iterator it = portToServers.find(port);
-    if (it == portToServers.end()) {
+    // port lookup: the server_name tables of this port
+    std::map<int, VirtualHostTable>::const_iterator it = vhostTables.find(port);
+    if (it == vhostTables.end()) {
         return NULL; // no server listening on this port
     }
-    
-    const std::vector<ServerInstance*>& serverList = it->second;
-    
-    // host header lookup: find the server that matches the host header
-    for (size_t i = 0; i < serverList.size(); ++i) {
-        ServerInstance* server = serverList[i];
-        if (server->matchesServerName(hostHeader)) {
-            return server;
-        }
-    }
-    
-    // default server fallback: if no exact match, return the 1st server as default
-    return serverList.empty() ? NULL : serverList[0];
-}
-
-int WebServer::getPortFromClientSocket(int clientFd) {
-    // init
-    struct sockaddr_in addr;
-    socklen_t addrlen = sizeof(addr);
-    // get socket name
-    if (getsockname(clientFd, (struct sockaddr*)&addr, &addrlen) == 0)
-        return ntohs(addr.sin_port);
-    // error case
-    return -1;
+    // exact > *.suffix > prefix.* > default server
+    return it->second.lookup(hostHeader);
 }
 
 const Config& WebServer::getConfig() const {
@@ -476,6 +518,59 @@ std::string WebServer::getLastError() const {
 }
 
 
+/* "HTTP/1.1 200 OK" -> 200, 0 if the buffer doesn't start with a status line */
+static int responseStatusCode(const std::string& response)
+{
+    if (response.size() < 12 || response.compare(0, 5, "HTTP/") != 0 || response[8] != ' ')
+        return 0;
+    int code = 0;
+    for (size_t i = 9; i < 12; ++i) {
+        if (response[i] < '0' || response[i] > '9')
+            return 0;
+        code = code * 10 + (response[i] - '0');
+    }
+    return code;
+}
+
+/* a response is fully out: its phases go to the histograms of the server & location that handled it */
+static void recordLatency(ClientConnection* conn)
+{
+    if (!conn->server_instance)
+        return;
+    conn->server_instance->latencyFor(conn->matched_location).record(conn->timing, ServerClock::monotonicUs());
+    conn->timing.acceptedUs = 0; // accept -> first byte only counts for the first request
+}
+
+/* one access_log line per finished response, formatted on the stack and queued to the writer thread */
+void WebServer::logAccess(const ClientConnection* conn) const
+{
+    if (!Logger::accessEnabled() || conn->response_buffer.empty())
+        return;
+    char address[INET_ADDRSTRLEN];
+    if (!inet_ntop(AF_INET, &conn->remote_addr, address, sizeof(address)))
+        address[0] = '\0';
+
+    AccessLogEntry entry;
+    entry.remoteAddr = address;
+    entry.request = conn->request_buffer.c_str();
+    size_t lineEnd = conn->request_buffer.find("\r\n");
+    entry.requestLength = lineEnd == std::string::npos ? 0 : lineEnd;
+    if (conn->http_request && conn->http_request->getIsParsed())
+        entry.host = &conn->http_request->getHost();
+    if (conn->server_instance)
+        entry.server = &conn->server_instance->label();
+    if (conn->matched_location)
+        entry.location = &conn->matched_location->path;
+    entry.status = responseStatusCode(conn->response_buffer);
+    entry.bytesReceived = conn->bytes_in;
+    entry.bytesSent = conn->bytes_out;
+    entry.timing = &conn->timing;
+    entry.doneUs = ServerClock::monotonicUs();
+
+    LogLine line(LOG_SINK_ACCESS);
+    accessLogFormat.render(entry, line);
+}
+
 void WebServer::run() {
     // ensure server is running before entering event loop
     if (!running) {
@@ -483,11 +578,20 @@ void WebServer::run() {
         return;
     }
     
-    std::cout << "Starting main event loop..." << std::endl;
+    LOG_INFO << "Starting main event loop...";
+    ServerClock::update();
+    ServerStats::loop.startedMs = ServerClock::monotonicMs();
     // init maxFd to find the highest fd for select() call
     updateMaxFd();
     
     while (running) {
+        // SIGUSR1 interrupted select(): the dump runs here, outside the handler
+        if (latencyDumpRequested) {
+            latencyDumpRequested = 0;
+            dumpLatency();
+        }
+        // building the fd sets is O(connections): it counts as busy time too
+        long long setupStartUs = ServerClock::preciseUs();
         // clear previous iteration's fd sets for select()
         FD_ZERO(&readFds);
         FD_ZERO(&writeFds);
@@ -510,28 +614,46 @@ void WebServer::run() {
             if (!conn->request_complete) {
                 FD_SET(fd, &readFds);  // 等待读取请求
             }
+            // waiting for CGI: still watched, a client that goes away releases its job
+            else if (conn->cgi_pending) {
+                FD_SET(fd, &readFds);
+            }
             // add clients that have response ready to write set
-            if (conn->response_ready && conn->bytes_sent < conn->response_buffer.size()) {
-                FD_SET(fd, &writeFds); // 等待发送响应
+            if (conn->response_ready
+                && (conn->bytes_sent < conn->responseSize() || conn->body_fd != -1)) {
+                FD_SET(fd, &writeFds); // 等待发送响应（或文件body）
+            }
+            // streamed CGI body: only once the pipe has something (or the stream must end)
+            else if (conn->cgi_streaming && cgiHandler_.streamWantsWrite(fd)) {
+                FD_SET(fd, &writeFds);
             }
         }
         
+        /* CGI pipes & pidfds of running jobs */
+        int selectMaxFd = maxFd;
+        cgiHandler_.addFds(&readFds, &writeFds, selectMaxFd);
+
         /* select() call */ 
-        // setup timeout to periodically wake up and check running flag
+        // setup timeout to periodically wake up and check running flag,
+        // shorter while a CGI child can only be reaped by polling waitpid()
         struct timeval timeout;
         timeout.tv_sec = 0;
-        timeout.tv_usec = 100000;
+        timeout.tv_usec = cgiHandler_.needsPolling() ? 10000 : 100000;
         
+        long long setupUs = ServerClock::preciseUs() - setupStartUs;
         // return the number of fds ready for read/write
-        int activity = select(maxFd + 1, &readFds, &writeFds, NULL, &timeout);
+        int activity = select(selectMaxFd + 1, &readFds, &writeFds, NULL, &timeout);
         // error handling
         if (activity < 0) {
             if (errno == EINTR) {
                 continue; // 被信号中断，继续循环
             }
-            std::cerr << "select() failed: " << strerror(errno) << std::endl;
+            LOG_ERROR << "select() failed: " << strerror(errno);
             break;
         }
+        // refresh the cached clock once per wake-up, every handler below reads it
+        ServerClock::update();
+        long long busyStartUs = ServerClock::preciseUs(); // iteration timing for stub_status
         
         /* new connection handling */ 
         // if the server socket is readable, then accept new connections on all listening sockets
@@ -544,6 +666,12 @@ void WebServer::run() {
                 }
             }
         }
+
+        /* CGI handling: pump pipes, reap children, enforce timeouts */
+        std::vector<int> cgiCompleted;
+        cgiHandler_.handleIO(&readFds, &writeFds, cgiCompleted);
+        for (size_t i = 0; i < cgiCompleted.size(); ++i)
+            finishCGIResponse(cgiCompleted[i]);
         
         /* client request/response handling */
         for (std::map<int, ClientConnection*>::iterator it = clientConnections.begin();
@@ -557,7 +685,10 @@ void WebServer::run() {
 
             // if the client fd is readable, handle http request
             if (FD_ISSET(clientFd, &readFds)) {
-                handleClientRequest(clientFd);
+                if (it->second->request_complete)
+                    watchCGIClient(clientFd);
+                else
+                    handleClientRequest(clientFd);
             }
 
             // check if connection still exists after handleClientRequest
@@ -584,7 +715,10 @@ void WebServer::run() {
             ClientConnection* conn = it->second;
 
             // if the request response is ready, and completely sent, then close or reset the connection
-            if (conn->response_ready && conn->bytes_sent >= conn->response_buffer.size()) {
+            if (conn->response_ready && !conn->cgi_streaming && conn->body_fd == -1
+                && conn->bytes_sent >= conn->responseSize()) {
+                recordLatency(conn);
+                logAccess(conn);
                 // For HTTP/1.1, keep the connection alive by default unless "Connection: close"
                 bool keep_alive = true;
                 if (conn->http_response) {
@@ -608,18 +742,18 @@ void WebServer::run() {
         /* handle connection timeout
             - auto close the connection when idle +30 seconds
         */
-        time_t current_time = time(NULL);
+        time_t current_time = ServerClock::monotonic();
         for (std::map<int, ClientConnection*>::iterator it = clientConnections.begin();
             it != clientConnections.end();) 
             {
                 ClientConnection* conn = it->second;
                 time_t elapse = current_time - conn->last_active;
 
-                // 30 seconds timeout
-                if (elapse > 30)
+                // 30 seconds timeout; a CGI job has its own deadline, a client leaving it is seen by watchCGIClient
+                if (elapse > 30 && !conn->cgi_pending)
                 {
                     int fd = it->first;
-                    std::cout << "Connection timed out: fd=" << fd << std::endl;
+                    LOG_INFO << "Connection timed out: fd=" << fd;
                     std::map<int, ClientConnection*>::iterator next_it = it;
                     ++next_it;
                     closeClientConnection(fd);
@@ -628,12 +762,27 @@ void WebServer::run() {
                 else
                     ++it;
             }
+        ServerStats::countIteration(setupUs + ServerClock::preciseUs() - busyStartUs);
     }
     
-    std::cout << "Event loop ended." << std::endl;
+    LOG_INFO << "Event loop ended.";
 }
 
+// fds below FD_SETSIZE kept free of clients so CGI pipes & pidfds usually still fit;
+// the limit itself is enforced where those are created (fitsFdSet): a CGI that doesn't fit gets 503
+static const int CLIENT_FD_HEADROOM = 32;
+
 void WebServer::handleNewConnection(int serverFd) {
+    // resolve the listener once per accept batch instead of getsockname() per request
+    int listenPort = -1;
+    const VirtualHostTable* vhosts = NULL;
+    std::map<int, int>::const_iterator portIt = listenFdToPort.find(serverFd);
+    if (portIt != listenFdToPort.end()) {
+        listenPort = portIt->second;
+        vhosts = &vhostTables[listenPort];
+    }
+
+    size_t refused = 0;
     while (true) {
         struct sockaddr_in clientAddr;
         socklen_t clientLen = sizeof(clientAddr);
@@ -642,27 +791,84 @@ void WebServer::handleNewConnection(int serverFd) {
         if (clientFd == -1) {
             if (errno == EAGAIN || errno == EWOULDBLOCK)
                 break;
-            std::cerr << "Failed to accept connection: " << strerror(errno) << std::endl;
+            LOG_ERROR << "Failed to accept connection: " << strerror(errno);
             break;
         }
+        ++ServerStats::http.accepted;
+        // select() can't watch fds >= FD_SETSIZE; leave the headroom to CGI pipes.
+        // shows up as accepted - handled in stub_status
+        if (clientFd >= FD_SETSIZE - CLIENT_FD_HEADROOM) {
+            close(clientFd);
+            ++refused;
+            continue;
+        }
+        // CGI children must not inherit client sockets, or a closed connection stays open in them
+        fcntl(clientFd, F_SETFD, FD_CLOEXEC);
         // set non-blocking mode
         int flags = fcntl(clientFd, F_GETFL, 0);
         if (flags == -1 || fcntl(clientFd, F_SETFL, flags | O_NONBLOCK) == -1) {
-            std::cerr << "Failed to set non-blocking mode" << std::endl;
+            LOG_ERROR << "Failed to set non-blocking mode";
             close(clientFd);
             continue;
         }
         // create client connection object
         ClientConnection* conn = new ClientConnection(clientFd);
-        conn->last_active = time(NULL); // init last active time
+        conn->last_active = ServerClock::monotonic(); // init last active time
+        conn->listen_port = listenPort;
+        conn->vhosts = vhosts;
+        // default server until the Host header is known, so early errors use its error pages
+        conn->server_instance = vhosts ? vhosts->defaultServer() : NULL;
         clientConnections[clientFd] = conn;
+        ++ServerStats::http.handled;
+        conn->remote_addr = clientAddr.sin_addr;
+        conn->timing.acceptedUs = ServerClock::monotonicUs();
 
         // 更新maxFd
         if (clientFd > maxFd) {
             maxFd = clientFd;
         }
-        std::cout << "New connection accepted: fd=" << clientFd << std::endl;
+        LOG_DEBUG << "New connection accepted: fd=" << clientFd;
+    }
+    if (refused)    // one line per accept batch, a connection flood must not flood the log too
+        LOG_WARN << "Refused " << refused << " connection(s) beyond the select() fd limit";
+}
+
+/* build an error response into conn->response_buffer
+    - preloaded error page of the matched server if configured for this status,
+      its body goes out from the server's page cache (body_tail) without a copy
+    - otherwise the generated HTML error page
+*/
+static void setErrorResponse(ClientConnection* conn, int status_code, const std::string& message)
+{
+    conn->body_tail = NULL;
+    if (conn->server_instance) {
+        const PreloadedResponse* page = conn->server_instance->getErrorPage(status_code);
+        if (page) {
+            conn->response_buffer = conn->http_response->buildPreloadedResponse(*page);
+            conn->body_tail = &page->tail;
+            return;
+        }
     }
+    conn->response_buffer = conn->http_response->buildErrorResponse(status_code, message, *conn->http_request);
+}
+
+/* the response can go out: ends the build phase of the request timing */
+static void markResponseReady(ClientConnection* conn)
+{
+    conn->response_ready = true;
+    conn->timing.readyUs = ServerClock::monotonicUs();
+}
+
+/* 503 for a full CGI queue: Retry-After tells well-behaved clients when to come back */
+static void setServiceUnavailable(ClientConnection* conn, int retry_after)
+{
+    setErrorResponse(conn, 503, "Service Unavailable");
+    size_t status_end = conn->response_buffer.find("\r\n");
+    if (status_end == std::string::npos)
+        return;
+    std::ostringstream header;
+    header << "Retry-After: " << retry_after << "\r\n";
+    conn->response_buffer.insert(status_end + 2, header.str());
 }
 
 /* helper function for handleClientRequest */
@@ -685,6 +891,24 @@ static void trimValidateRequestBuffer(std::string& request_buffer) {
     }
 }
 
+/* the request is complete and its CGI job runs or waits (queue, cache lock):
+    - EOF or error: the client is gone, closing releases the job, its slot & cache lock,
+      kills the child or aborts the FastCGI request
+    - data: pipelining is not supported, it would be dropped by the reset anyway
+*/
+void WebServer::watchCGIClient(int clientFd) {
+    char buffer[4096];
+    ssize_t bytesRead = recv(clientFd, buffer, sizeof(buffer), 0);
+    if (bytesRead > 0) {
+        ServerStats::http.bytesIn += static_cast<unsigned long long>(bytesRead);
+        return;
+    }
+    if (bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        return;
+    LOG_DEBUG << "Client disconnected while waiting for CGI: fd=" << clientFd;
+    closeClientConnection(clientFd);
+}
+
 /* complete handle client request, integrated with HttpRequest
     - request reception
     - check request completeness
@@ -709,7 +933,7 @@ void WebServer::handleClientRequest(int clientFd) {
     
     if (bytesRead <= 0) {
         if (bytesRead == 0)
-            std::cout << "Client disconnected: fd=" << clientFd << std::endl;
+            LOG_DEBUG << "Client disconnected: fd=" << clientFd;
         // } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
         //     std::cerr << "recv() failed: " << strerror(errno) << std::endl;
         // }
@@ -718,7 +942,13 @@ void WebServer::handleClientRequest(int clientFd) {
     } else {
         buffer[bytesRead] = '\0';
         conn->request_buffer += buffer;
-        conn->last_active = time(NULL); // update last active time
+        ServerStats::http.bytesIn += static_cast<unsigned long long>(bytesRead);
+        conn->bytes_in += static_cast<unsigned long long>(bytesRead);
+        if (conn->timing.startUs == 0)
+            conn->timing.startUs = ServerClock::monotonicUs();
+        if (conn->timing.headersUs == 0 && conn->request_buffer.find("\r\n\r\n") != std::string::npos)
+            conn->timing.headersUs = ServerClock::monotonicUs();
+        conn->last_active = ServerClock::monotonic(); // update last active time
     }
 
     /* check for request completeness & parsing & response */
@@ -735,49 +965,60 @@ void WebServer::handleClientRequest(int clientFd) {
         return;
 
     // check request completeness
+    long long phase_start_us = ServerClock::preciseUs();
     RequestStatus status = conn->http_request->isRequestComplete(conn->request_buffer);
+    conn->timing.parseUs += ServerClock::preciseUs() - phase_start_us;
     // std::cout << "🚧 DEBUG: isRequestComplete status: " << status << std::endl;
 
     if (status == REQUEST_COMPLETE) // request is complete
     {
         conn->request_complete = true;
-        if (parseHttpRequest(conn)) // parse & validate request successfully
+        conn->timing.completeUs = ServerClock::monotonicUs();
+        phase_start_us = ServerClock::preciseUs();
+        bool parsed = parseHttpRequest(conn);
+        conn->timing.parseUs += ServerClock::preciseUs() - phase_start_us;
+        if (parsed) // parse & validate request successfully
         {
-            // extract host header and port
-            std::string host = conn->http_request->getHost();
-            int port = getPortFromClientSocket(clientFd); 
-            // find the matching server instance, if not found, fall back to the first server
-            if (port == -1)
-                conn->server_instance = servers.empty() ? NULL : servers[0];
+            phase_start_us = ServerClock::preciseUs();
+            // find the matching server instance by host header on the accepting port,
+            // if the listener is unknown, fall back to the first server
+            if (conn->vhosts)
+                conn->server_instance = conn->vhosts->lookup(conn->http_request->getHost());
             else
-                conn->server_instance = findServerByHost(host, port);
+                conn->server_instance = servers.empty() ? NULL : servers[0];
             // extract request uri
             std::string uri = conn->http_request->getURI();
             // find the matching location, if not found, set to NULL
             conn->matched_location = conn->server_instance->findMatchingLocation(uri);
+            conn->timing.routeUs = ServerClock::preciseUs() - phase_start_us;
 
             // build the response
+            phase_start_us = ServerClock::preciseUs();
             buildHttpResponse(conn);
-            // mark response ready
-            conn->response_ready = true;
+            conn->timing.buildUs = ServerClock::preciseUs() - phase_start_us;
+            // mark response ready, unless waiting for the CGI output
+            if (conn->cgi_pending)
+                conn->timing.cgiStartUs = ServerClock::monotonicUs();
+            else
+                markResponseReady(conn);
         }
         else // parse & validate request fails
         {
             
             conn->http_response->resultToStatusCode(conn->http_request->getValidationStatus());
-            conn->response_buffer = conn->http_response->buildErrorResponse(conn->http_response->getStatusCode(), "TBU", *conn->http_request);
-            conn->response_ready = true;
+            setErrorResponse(conn, conn->http_response->getStatusCode(), "TBU");
+            markResponseReady(conn);
         }
     }
     else if (status == REQUEST_TOO_LARGE)
     {
-        conn->response_buffer = conn->http_response->buildErrorResponse(413, "Content Too Large", *conn->http_request);
-        conn->response_ready = true;
+        setErrorResponse(conn, 413, "Content Too Large");
+        markResponseReady(conn);
     }
     else if (status == INVALID_REQUEST)
     {
-        conn->response_buffer = conn->http_response->buildErrorResponse(400, "Bad Request", *conn->http_request);
-        conn->response_ready = true;
+        setErrorResponse(conn, 400, "Bad Request");
+        markResponseReady(conn);
     }
     // if status == NEED_MORE_DATA, keep building the buffer
 }
@@ -798,14 +1039,14 @@ bool WebServer::parseHttpRequest(ClientConnection* conn) {
     ValidationResult val_status = conn->http_request->validateRequest();
     if (val_status != VALID_REQUEST)
     {
-        std::cerr << "HTTP request validation failed: " << val_status << std::endl;
+        LOG_ERROR << "HTTP request validation failed: " << val_status;
         return false;
     }
 
-    std::cout << "✍️ Parsed request: "
+    LOG_DEBUG << "✍️ Parsed request: "
                 << conn->http_request->getMethodStr() << " "
                 << conn->http_request->getURI() << " "
-                << conn->http_request->getHttpVersion() << " " << std::endl;
+                << conn->http_request->getHttpVersion() << " ";
     return true;
 }
 
@@ -814,7 +1055,7 @@ static void generateDirListing(ClientConnection* conn, const std::string& dir_pa
     // open the directory
     DIR* dir = opendir(dir_path.c_str());
     if (!dir){
-        conn->response_buffer = conn->http_response->buildErrorResponse(500, "Cannot Read Directory", *conn->http_request);
+        setErrorResponse(conn, 500, "Cannot Read Directory");
         return;
     }
     // generate HTML header
@@ -850,22 +1091,93 @@ static void generateDirListing(ClientConnection* conn, const std::string& dir_pa
 */
 static std::string buildFilePath(ClientConnection* conn, const std::string& uri)
 {
-    // if using alias: replace the requst URI with location path
-    if (conn->matched_location && !conn->matched_location->alias.empty())
+    return conn->server_instance->resolveFilePath(uri, conn->matched_location);
+}
+
+/* serve a regular file: the head now, the body by sendfile() from the event loop
+    - 304 / 206 / 416 for conditional & range requests, see HttpResponse::buildFileHead
+    - the fd is opened before fstat() so the checked file is the one that gets sent
+*/
+static void serveStaticFile(ClientConnection* conn, const std::string& file_path)
+{
+    int file_fd = open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat file_stat;
+    if (file_fd == -1 || fstat(file_fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode))
     {
-        std::string location_path = conn->matched_location->path; // eg. location /kapouet
-        std::string remaining_path = uri; // eg. location /kapouet/pouic/toto/pouet
-        // strip the location path prefix
-        if (uri.find(location_path) == 0)
-            remaining_path = uri.substr(location_path.length()); 
-        return (conn->matched_location->alias + remaining_path);
+        if (file_fd != -1)
+            close(file_fd);
+        setErrorResponse(conn, 404, "Not Found");
+        return;
     }
-    // using root: append full URI to root
-    std::string root = conn->server_instance->getConfig().root;
-    if (conn->matched_location && !conn->matched_location->root.empty()) {
-        root = conn->matched_location->root;
+    off_t offset = 0;
+    off_t length = 0;
+    conn->response_buffer = conn->http_response->buildFileHead(file_path, file_stat, *conn->http_request,
+                                                               offset, length);
+    if (length == 0)
+    {
+        close(file_fd);
+        return;
+    }
+    conn->closeBody();
+    conn->body_fd = file_fd;
+    conn->body_offset = offset;
+    conn->body_remaining = length;
+}
+
+/* X-Sendfile: the real path must stay inside cgi_sendfile_root (no symlink or ../ escapes) */
+static bool resolveSendfilePath(const std::string& path, const std::string& root, std::string& resolved)
+{
+    char real_root[PATH_MAX];
+    char real_path[PATH_MAX];
+    if (!realpath(root.c_str(), real_root) || !realpath(path.c_str(), real_path))
+        return false;
+    std::string prefix(real_root);
+    if (prefix[prefix.length() - 1] != '/')
+        prefix += "/";
+    resolved = real_path;
+    return resolved.compare(0, prefix.length(), prefix) == 0;
+}
+
+/* X-Accel-Redirect / X-Sendfile from a CGI: the file goes out like any static one
+    - X-Accel-Redirect: a URI of the same server, its location must serve static files
+      (internal locations are reachable this way only)
+    - X-Sendfile: a file inside the location's cgi_sendfile_root
+    - the script's Content-Type, Content-Disposition & caching headers are kept
+*/
+static void serveOffload(ClientConnection* conn, const CGIHandler::Offload& offload)
+{
+    std::string file_path;
+    if (offload.type == CGIResponse::OFFLOAD_ACCEL)
+    {
+        std::string uri = offload.target.substr(0, offload.target.find('?'));
+        if (uri.empty() || uri[0] != '/' || uri.find("/..") != std::string::npos)
+        {
+            LOG_ERROR << "❌ X-Accel-Redirect: invalid URI " << offload.target;
+            setErrorResponse(conn, 500, "Internal Server Error");
+            return;
+        }
+        LocationConfig* location = conn->server_instance->findMatchingLocation(uri);
+        if (location && (!location->redirect.empty() || CGIHandler::isCGIRequest(uri, *location)))
+        {
+            LOG_ERROR << "❌ X-Accel-Redirect: not a static location " << uri;
+            setErrorResponse(conn, 500, "Internal Server Error");
+            return;
+        }
+        file_path = conn->server_instance->resolveFilePath(uri, location);
+    }
+    else if (!conn->matched_location
+             || !resolveSendfilePath(offload.target, conn->matched_location->cgiSendfileRoot, file_path))
+    {
+        LOG_ERROR << "❌ X-Sendfile: outside cgi_sendfile_root " << offload.target;
+        setErrorResponse(conn, 403, "Forbidden");
+        return;
     }
-    return root + uri;
+
+    conn->http_response->reset();
+    for (std::map<std::string, std::string>::const_iterator it = offload.headers.begin();
+         it != offload.headers.end(); ++it)
+        conn->http_response->setHeader(it->first, it->second);
+    serveStaticFile(conn, file_path);
 }
 
 /* helper function for handleGetResponse
@@ -897,7 +1209,7 @@ static void handleRedirect(ClientConnection* conn)
     size_t space_pos = redirect_str.find(' ');
     if (space_pos == std::string::npos)
     {
-        conn->response_buffer = conn->http_response->buildErrorResponse(500, "Internal Server Error", *conn->http_request);
+        setErrorResponse(conn, 500, "Internal Server Error");
         return;
     }
     int status_code = atoi(redirect_str.substr(0, space_pos).c_str());
@@ -908,12 +1220,13 @@ static void handleRedirect(ClientConnection* conn)
     conn->http_response->setBody("");
     conn->response_buffer = conn->http_response->buildFullResponse(*conn->http_request);
     // log redirect
-    std::cout << "Redirecting to: " << redirect_url << " (" << status_code << ")" << std::endl;
+    LOG_DEBUG << "Redirecting to: " << redirect_url << " (" << status_code << ")";
 }
 
 /* helpder function for handleGETResponse & handlePostResponse: to support CGI
-    - execute CGI
-    - set conn->response buffer on success
+    - a cgi_cache entry is served directly, or the request waits for the same one in flight
+    - start CGI, the event loop pumps its pipes
+    - on start the connection waits for the output (cgi_pending), see finishCGIResponse
     - set 502 on failure
     - return true/false
 */
@@ -921,21 +1234,37 @@ static bool handleCGIExecution(ClientConnection* conn, const std::string scriptP
 {
     // pre check
     if (!conn->matched_location) {
-        conn->response_buffer = conn->http_response->buildErrorResponse(500, "Internal Server Error", *conn->http_request);
+        setErrorResponse(conn, 500, "Internal Server Error");
         conn->response_ready = true;
         return false;
     }
-    // execute CGI
-    std::string response;
-    if (cgiHandler.execute(*conn->http_request, *conn->matched_location, scriptPath, response)) {
-        conn->response_buffer = response;
-        conn->response_ready = true;
-        std::cout << "✅ CGI request handled successfully" << std::endl;
+    // micro-cache: a hit needs no CGI, a request collapsed onto a running one waits for it
+    switch (cgiHandler.lookupCache(conn->fd, *conn->http_request, *conn->matched_location,
+                                   scriptPath, conn->response_buffer)) {
+    case CGIHandler::CACHE_HIT:
         return true;
+    case CGIHandler::CACHE_WAIT:
+        conn->cgi_pending = true;
+        return true;
+    case CGIHandler::CACHE_MISS:
+        break;
+    }
+    // start CGI, or wait for a cgi_max_concurrent slot
+    switch (cgiHandler.submit(conn->fd, *conn->http_request, *conn->matched_location, scriptPath)) {
+    case CGIHandler::START_OK:
+    case CGIHandler::START_QUEUED:
+        conn->cgi_pending = true;
+        return true;
+    case CGIHandler::START_BUSY:
+        setServiceUnavailable(conn, cgiHandler.retryAfter(*conn->matched_location));
+        conn->response_ready = true;
+        return false;
+    case CGIHandler::START_FAILED:
+        break;
     }
     // error handling
-    std::cerr << "❌ CGI execution failed: " << cgiHandler.getLastError() << std::endl;
-    conn->response_buffer = conn->http_response->buildErrorResponse(502, "Bad Gateway", *conn->http_request);
+    LOG_ERROR << "❌ CGI execution failed: " << cgiHandler.getLastError();
+    setErrorResponse(conn, 502, "Bad Gateway");
     conn->response_ready = true;
 
     return false;
@@ -965,7 +1294,7 @@ static void handleDirRequest(ClientConnection* conn, const std::string& file_pat
             if (conn->matched_location && CGIHandler::isCGIRequest(index_files[i], *conn->matched_location))
                 handleCGIExecution(conn, index_path, cgiHandler);
             else // serve as static file
-                conn->response_buffer = conn->http_response->buildFileResponse(index_path, *conn->http_request);
+                serveStaticFile(conn, index_path);
             return;
         }
     }
@@ -976,8 +1305,8 @@ static void handleDirRequest(ClientConnection* conn, const std::string& file_pat
         return;
     }
     // no index file found, no autoindex enabled
-    // conn->response_buffer = conn->http_response->buildErrorResponse(403, "Forbidden", *conn->http_request);
-    conn->response_buffer = conn->http_response->buildErrorResponse(404, "Not Found", *conn->http_request);
+    // setErrorResponse(conn, 403, "Forbidden");
+    setErrorResponse(conn, 404, "Not Found");
 }
 
 /* helper function for buildHttpResponse： build the response for GET
@@ -997,7 +1326,7 @@ static void handleGetResponse(ClientConnection* conn, std::string& uri, CGIHandl
     /* check for method permission */
     if (!isMethodAllowed("GET", conn->matched_location))
     {
-        conn->response_buffer = conn->http_response->buildErrorResponse(405, "Method Not Allowed", *conn->http_request);
+        setErrorResponse(conn, 405, "Method Not Allowed");
         return;
     }    
     /* check for redirects */
@@ -1012,7 +1341,7 @@ static void handleGetResponse(ClientConnection* conn, std::string& uri, CGIHandl
     /* check for CGI request */
     if (conn->matched_location && CGIHandler::isCGIRequest(uri, *conn->matched_location))
     {
-        std::cout << "🔧 GET: CGI request detected for URI: " << uri << std::endl;
+        LOG_DEBUG << "🔧 GET: CGI request detected for URI: " << uri;
         handleCGIExecution(conn, file_path, cgiHandler);
         return;
     }
@@ -1023,13 +1352,18 @@ static void handleGetResponse(ClientConnection* conn, std::string& uri, CGIHandl
         - if no index files, check for autoindex
     */
     struct stat file_stat;
-    if (stat(file_path.c_str(), &file_stat) == 0 && S_ISDIR(file_stat.st_mode)) // is directory
+    if (stat(file_path.c_str(), &file_stat) != 0) // file not exists
+    {
+        setErrorResponse(conn, 404, "Not Found");
+        return;
+    }
+    if (S_ISDIR(file_stat.st_mode)) // is directory
     {
         handleDirRequest(conn, file_path, uri, cgiHandler);
         return;
     }
     /* serve the file */
-    conn->response_buffer = conn->http_response->buildFileResponse(file_path, *conn->http_request);
+    serveStaticFile(conn, file_path);
 }
 
 /* helper function for buildHttpResponse: build the response for POST, should process the data
@@ -1042,12 +1376,12 @@ static void handlePostResponse(ClientConnection* conn, std::string& uri, CGIHand
 {
     /* check for method permission */
     if (!isMethodAllowed("POST", conn->matched_location)) {
-        conn->response_buffer = conn->http_response->buildErrorResponse(405, "Method Not Allowed", *conn->http_request);
+        setErrorResponse(conn, 405, "Method Not Allowed");
         return;
     }
     /* determine root path */
     std::string file_path = buildFilePath(conn, uri);
-    std::cout << "🈺 DEBUG: file path: " << file_path << std::endl;
+    LOG_DEBUG << "🈺 DEBUG: file path: " << file_path;
     /* client body size validation */
     // 获取有效的 client_max_body_size:
     // 1. 如果 location 设置了(不是 SIZE_MAX),使用 location 的
@@ -1063,14 +1397,14 @@ static void handlePostResponse(ClientConnection* conn, std::string& uri, CGIHand
     if (configMaxBodySize > 0) {
         size_t requestBodySize = conn->http_request->getBody().size();
         if (requestBodySize > configMaxBodySize) {
-            conn->response_buffer = conn->http_response->buildErrorResponse(413, "Content Too Large", *conn->http_request);
+            setErrorResponse(conn, 413, "Content Too Large");
             return;
         }
     }
     /* check for CGI request */
     if (conn->matched_location && CGIHandler::isCGIRequest(uri, *conn->matched_location))
     {
-        std::cout << "🔧 POST: CGI request detected for URI: " << uri << std::endl;
+        LOG_DEBUG << "🔧 POST: CGI request detected for URI: " << uri;
         handleCGIExecution(conn, file_path, cgiHandler);
         return;
     }
@@ -1081,7 +1415,7 @@ static void handlePostResponse(ClientConnection* conn, std::string& uri, CGIHand
         // parse multipart/form data
         if (!conn->http_request->parseMultipartFormData())
         {
-            conn->response_buffer = conn->http_response->buildErrorResponse(400, "Bad Request", *conn->http_request);
+            setErrorResponse(conn, 400, "Bad Request");
             return;
         }
         // extract upload data
@@ -1090,7 +1424,7 @@ static void handlePostResponse(ClientConnection* conn, std::string& uri, CGIHand
 
         // create upload dir if needed
         if (mkdir(file_path.c_str(), 0755) != 0 && errno != EEXIST){
-            conn->response_buffer = conn->http_response->buildErrorResponse(500, "Internal Server Error - Cannot create upload directory", *conn->http_request);
+            setErrorResponse(conn, 500, "Internal Server Error - Cannot create upload directory");
         }
 
         // save the upload data
@@ -1099,26 +1433,26 @@ static void handlePostResponse(ClientConnection* conn, std::string& uri, CGIHand
             FileUpload& file = files[i];
             std::string filename = file.filename;
             std::string upload_path = file_path + "/" + filename;
-            std::cout << "🚧 DEBUG: upload path: " << upload_path << std::endl;
+            LOG_DEBUG << "🚧 DEBUG: upload path: " << upload_path;
             // save file.content to upload_path
             if (filename.empty())
                 continue; // skip files without names
             // open file for writing
             std::ofstream outfile(upload_path.c_str(), std::ios::binary);
             if (!outfile.is_open()) {
-                conn->response_buffer = conn->http_response->buildErrorResponse(500, "Internal Server Error - Cannot create file", *conn->http_request);
+                setErrorResponse(conn, 500, "Internal Server Error - Cannot create file");
                 return;
             }
             // write file content
             outfile.write(file.content.c_str(), file.content.size());
             outfile.close();
             if (outfile.fail()){
-                conn->response_buffer = conn->http_response->buildErrorResponse(500, "Internal Server Error - File write failed", *conn->http_request);
+                setErrorResponse(conn, 500, "Internal Server Error - File write failed");
                 return;
             }
             saved_files.push_back(file.filename);
         }
-        std::cout << "DEBUG: saved file size: " << saved_files.size() << std::endl;
+        LOG_DEBUG << "DEBUG: saved file size: " << saved_files.size();
 
         // response generation
         conn->http_response->setStatusCode(201);
@@ -1173,16 +1507,16 @@ static void handleDeleteResponse(ClientConnection* conn, std::string& uri, CGIHa
 {
     /* check for method permission */
     if (!isMethodAllowed("DELETE", conn->matched_location)) {
-        conn->response_buffer = conn->http_response->buildErrorResponse(405, "Method Not Allowed", *conn->http_request);
+        setErrorResponse(conn, 405, "Method Not Allowed");
         return;
     }
     /* determine root path */
     std::string file_path = buildFilePath(conn, uri);
-    std::cout << "🈺 DEBUG: file path: " << file_path << std::endl;
+    LOG_DEBUG << "🈺 DEBUG: file path: " << file_path;
     /* check for CGI request */
     if (conn->matched_location && CGIHandler::isCGIRequest(uri, *conn->matched_location))
     {
-        std::cout << "🔧 DELETE: CGI request detected for URI: " << uri << std::endl;
+        LOG_DEBUG << "🔧 DELETE: CGI request detected for URI: " << uri;
         handleCGIExecution(conn, file_path, cgiHandler);
         return;
     }
@@ -1190,7 +1524,7 @@ static void handleDeleteResponse(ClientConnection* conn, std::string& uri, CGIHa
     struct stat file_stat;
     if (stat(file_path.c_str(), &file_stat) == 0 && S_ISDIR(file_stat.st_mode)) // is directory
     {
-        conn->response_buffer = conn->http_response->buildErrorResponse(403, "Forbidden", *conn->http_request);
+        setErrorResponse(conn, 403, "Forbidden");
         return;
     }
     /* check the file and try to delete */
@@ -1204,10 +1538,74 @@ static void handleDeleteResponse(ClientConnection* conn, std::string& uri, CGIHa
         }
         // cannot delete
         else
-            conn->response_buffer = conn->http_response->buildErrorResponse(403, "Forbidden", *conn->http_request);
+            setErrorResponse(conn, 403, "Forbidden");
     }
     else
-        conn->response_buffer = conn->http_response->buildErrorResponse(404, "Not Found", *conn->http_request);
+        setErrorResponse(conn, 404, "Not Found");
+}
+
+/* what ServerStats can't count as events happen: states, caches & latency per server/location */
+void WebServer::collectStatus(StatusSnapshot& snapshot) const {
+    for (std::map<int, ClientConnection*>::const_iterator it = clientConnections.begin();
+         it != clientConnections.end(); ++it) {
+        const ClientConnection* client = it->second;
+        ++snapshot.active;
+        if (client->request_complete || client->response_ready)
+            ++snapshot.writing; // includes this request and CGI jobs still running
+        else if (client->request_buffer.empty())
+            ++snapshot.waiting;
+        else
+            ++snapshot.reading;
+    }
+    cgiHandler_.addCacheStats(snapshot);
+
+    for (size_t i = 0; i < servers.size(); ++i) {
+        const std::vector<LocationConfig>& locations = servers[i]->getConfig().locations;
+        const std::vector<PhaseLatency>& latency = servers[i]->getLatency();
+        for (size_t j = 0; j < latency.size(); ++j) {
+            if (latency[j].phase(PHASE_TOTAL).count() == 0)
+                continue;
+            LatencyTarget target;
+            target.server = servers[i]->label();
+            target.location = j < locations.size() ? locations[j].path : "";
+            target.phases = &latency[j];
+            snapshot.latency.push_back(target);
+        }
+    }
+}
+
+void WebServer::dumpLatency() const {
+    StatusSnapshot snapshot;
+    collectStatus(snapshot);
+    std::cerr << "=== request latency (SIGUSR1) ===\n" << StatusReport::latency(snapshot) << std::flush;
+}
+
+/* stub_status page
+    - ?format=prometheus or ?format=text overrides the format set on the location
+    - connection states are counted here, the totals come from ServerStats
+*/
+void WebServer::serveStatus(ClientConnection* conn) {
+    std::string format = conn->matched_location->stubStatus;
+    std::string query = "&" + conn->http_request->getQueryString() + "&";
+    if (query.find("&format=prometheus&") != std::string::npos)
+        format = "prometheus";
+    else if (query.find("&format=text&") != std::string::npos)
+        format = "text";
+
+    StatusSnapshot snapshot;
+    collectStatus(snapshot);
+
+    long long now_ms = ServerClock::monotonicMs();
+    conn->http_response->setStatusCode(200);
+    conn->http_response->setHeader("Cache-Control", "no-store");
+    if (format == "prometheus") {
+        conn->http_response->setHeader("Content-Type", StatusReport::PROMETHEUS_CONTENT_TYPE);
+        conn->http_response->setBody(StatusReport::prometheus(snapshot, now_ms));
+    } else {
+        conn->http_response->setHeader("Content-Type", "text/plain");
+        conn->http_response->setBody(StatusReport::text(snapshot, now_ms));
+    }
+    conn->response_buffer = conn->http_response->buildFullResponse(*conn->http_request);
 }
 
 /* complete http response generation
@@ -1225,6 +1623,19 @@ void WebServer::buildHttpResponse(ClientConnection* conn) {
     {
         conn->response_buffer = conn->http_response->buildFullResponse(*conn->http_request);
     }
+    // internal locations are only reachable through a CGI X-Accel-Redirect
+    else if (conn->matched_location && conn->matched_location->internal)
+    {
+        setErrorResponse(conn, 404, "Not Found");
+    }
+    // stub_status: the live counters instead of a file
+    else if (conn->matched_location && !conn->matched_location->stubStatus.empty())
+    {
+        if (conn->http_request->getMethodStr() == "GET")
+            serveStatus(conn);
+        else
+            setErrorResponse(conn, 405, "Method Not Allowed");
+    }
     else // if VALID_REQUEST
     {
         // get the method and uri
@@ -1238,7 +1649,7 @@ void WebServer::buildHttpResponse(ClientConnection* conn) {
         else if (method == "DELETE")
             handleDeleteResponse(conn, uri, cgiHandler_);
         else {
-            conn->response_buffer = conn->http_response->buildErrorResponse(405, "Method Not Allowed", *conn->http_request);
+            setErrorResponse(conn, 405, "Method Not Allowed");
         }
     }
 }
@@ -1251,28 +1662,148 @@ void WebServer::handleClientResponse(int clientFd) {
     ClientConnection* conn = it->second;
     if (!conn || !conn->response_ready) return;
     
-    size_t remaining = conn->response_buffer.size() - conn->bytes_sent;
-    if (remaining == 0) return;
+    if (conn->bytes_sent >= conn->responseSize()) {
+        if (conn->cgi_streaming)
+            streamCGIBody(conn);
+        else if (conn->body_fd != -1)
+            sendFileBody(conn);
+        return;
+    }
     
-    const char* data = conn->response_buffer.c_str() + conn->bytes_sent;
-    ssize_t bytesSent = send(clientFd, data, remaining, 0);
+    // count the response once, by the status line that actually goes out
+    if (conn->bytes_sent == 0)
+        ServerStats::countResponse(responseStatusCode(conn->response_buffer));
+
+    // headers, then a preloaded body straight from the server's page cache
+    struct iovec iov[2];
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    size_t head_size = conn->response_buffer.size();
+    if (conn->bytes_sent < head_size) {
+        iov[msg.msg_iovlen].iov_base = const_cast<char*>(conn->response_buffer.data() + conn->bytes_sent);
+        iov[msg.msg_iovlen++].iov_len = head_size - conn->bytes_sent;
+    }
+    if (conn->body_tail) {
+        size_t tail_sent = conn->bytes_sent > head_size ? conn->bytes_sent - head_size : 0;
+        iov[msg.msg_iovlen].iov_base = const_cast<char*>(conn->body_tail->data() + tail_sent);
+        iov[msg.msg_iovlen++].iov_len = conn->body_tail->size() - tail_sent;
+    }
+    // a file body follows: let the kernel coalesce the headers with its first segment
+    ssize_t bytesSent = sendmsg(clientFd, &msg, conn->body_fd != -1 ? MSG_MORE : 0);
     
     if (bytesSent > 0) {
         conn->bytes_sent += bytesSent;
-        std::cout << "Sent " << bytesSent << " bytes to fd=" << clientFd << std::endl;
+        ServerStats::http.bytesOut += static_cast<unsigned long long>(bytesSent);
+        conn->bytes_out += static_cast<unsigned long long>(bytesSent);
+        LOG_DEBUG << "Sent " << bytesSent << " bytes to fd=" << clientFd;
     } else if (bytesSent <= 0) {
-        std::cerr << "send() failed: " << std::endl;
+        LOG_ERROR << "send() failed: ";
         closeClientConnection(clientFd);
     }
 }
 
+/* the CGI header block is out: forward the body straight from the pipe
+    - the connection is reused or closed by the lifecycle check once the stream is done
+*/
+void WebServer::streamCGIBody(ClientConnection* conn) {
+    CGIHandler::StreamStatus status = cgiHandler_.pumpStream(conn->fd, conn->bytes_out);
+    conn->last_active = ServerClock::monotonic();
+    if (status == CGIHandler::STREAM_AGAIN)
+        return;
+
+    conn->cgi_streaming = false;
+    if (status == CGIHandler::STREAM_DONE) {
+        LOG_DEBUG << "✅ CGI stream complete: fd=" << conn->fd;
+        return;
+    }
+    if (status == CGIHandler::STREAM_ERROR)
+        LOG_ERROR << "❌ CGI stream aborted: fd=" << conn->fd;
+    closeClientConnection(conn->fd);
+}
+
+/* the headers are out: send the file body straight from the page cache
+    - at most 1 MB per call so one large download doesn't hold up the other connections
+    - the connection is reused or closed by the lifecycle check once body_fd is closed
+*/
+void WebServer::sendFileBody(ClientConnection* conn) {
+    const off_t max_chunk = 1024 * 1024;
+    size_t count = static_cast<size_t>(conn->body_remaining < max_chunk ? conn->body_remaining : max_chunk);
+    ssize_t sent = sendfile(conn->fd, conn->body_fd, &conn->body_offset, count);
+    if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        return;
+    if (sent <= 0) {
+        // error, or the file shrank under us: the promised length can't be kept
+        LOG_ERROR << "❌ sendfile() failed: fd=" << conn->fd;
+        closeClientConnection(conn->fd);
+        return;
+    }
+    conn->body_remaining -= sent;
+    ServerStats::http.bytesOut += static_cast<unsigned long long>(sent);
+    conn->bytes_out += static_cast<unsigned long long>(sent);
+    conn->last_active = ServerClock::monotonic();
+    if (conn->body_remaining == 0) {
+        conn->closeBody();
+        LOG_DEBUG << "✅ File body sent: fd=" << conn->fd;
+    }
+}
+
+/* a CGI job of this connection is complete (exited, failed or timed out)
+    - success -> CGI response, a spilled body tail is sent like a file body
+    - failure -> 502, timeout -> 504, queue wait timeout -> 503
+*/
+void WebServer::finishCGIResponse(int clientFd) {
+    std::map<int, ClientConnection*>::iterator it = clientConnections.find(clientFd);
+    if (it == clientConnections.end()) {
+        cgiHandler_.release(clientFd);
+        return;
+    }
+    ClientConnection* conn = it->second;
+    if (!conn->cgi_pending)
+        return;
+
+    bool http11 = conn->http_request && conn->http_request->getHttpVersion() == "HTTP/1.1";
+    int status = cgiHandler_.finish(clientFd, conn->response_buffer, http11);
+    CGIHandler::Offload offload;
+    if (status == 0 && cgiHandler_.takeOffload(clientFd, offload)) {
+        serveOffload(conn, offload);
+    }
+    else if (status == 0) {
+        conn->cgi_streaming = cgiHandler_.isStreaming(clientFd);
+        // output past cgi_output_buffer: the rest of the body goes out from its temp file
+        int spill_fd = -1;
+        off_t spill_length = 0;
+        if (cgiHandler_.takeSpill(clientFd, spill_fd, spill_length)) {
+            conn->closeBody();
+            conn->body_fd = spill_fd;
+            conn->body_remaining = spill_length;
+        }
+        LOG_DEBUG << "✅ CGI request handled successfully";
+    }
+    else if (status == 503 && conn->matched_location) {
+        LOG_ERROR << "❌ CGI not started: " << cgiHandler_.getLastError();
+        setServiceUnavailable(conn, cgiHandler_.retryAfter(*conn->matched_location));
+    }
+    else {
+        LOG_ERROR << "❌ CGI execution failed: " << cgiHandler_.getLastError();
+        setErrorResponse(conn, status, status == 504 ? "Gateway Timeout" : "Bad Gateway");
+    }
+    conn->cgi_pending = false;
+    markResponseReady(conn);
+    conn->last_active = ServerClock::monotonic();
+}
+
 void WebServer::resetConnectionForResue(ClientConnection* conn) {
     // reset connection state for next request
     conn->request_buffer.clear();
     conn->response_buffer.clear();
+    conn->body_tail = NULL;
     conn->bytes_sent = 0;
     conn->request_complete = false;
     conn->response_ready = false;
+    conn->cgi_pending = false;
+    conn->cgi_streaming = false;
+    conn->closeBody();
     if (conn->http_request) {
         delete conn->http_request;
         conn->http_request = NULL;
@@ -1281,11 +1812,14 @@ void WebServer::resetConnectionForResue(ClientConnection* conn) {
         delete conn->http_response;
         conn->http_response = NULL;
     }
-    conn->server_instance = NULL;
+    conn->server_instance = conn->vhosts ? conn->vhosts->defaultServer() : NULL;
     conn->matched_location = NULL;
-    conn->last_active = time(NULL); 
+    conn->timing.reset();
+    conn->bytes_in = 0;
+    conn->bytes_out = 0;
+    conn->last_active = ServerClock::monotonic();
     // log reset
-    std::cout << "Connection reset for reuse: fd=" << conn->fd << std::endl;
+    LOG_DEBUG << "Connection reset for reuse: fd=" << conn->fd;
 }
 
 void WebServer::closeClientConnection(int clientFd) {
@@ -1294,9 +1828,10 @@ void WebServer::closeClientConnection(int clientFd) {
         delete it->second;
         clientConnections.erase(it);
     }
+    cgiHandler_.release(clientFd); // kill a CGI still working for this connection
     close(clientFd);
     updateMaxFd();
-    std::cout << "Connection closed: fd=" << clientFd << std::endl;
+    LOG_DEBUG << "Connection closed: fd=" << clientFd;
 }
 
 // find the current max fd nb being used by the server and stores it in maxFd
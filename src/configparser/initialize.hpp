@@ -3,14 +3,25 @@
 
 #include "config.hpp"
 #include "configparser.hpp"
+#include "location_matcher.hpp" // radix trie over location paths
+#include "virtual_host_table.hpp" // Host header -> server, per port
 #include "../client/client_connection.hpp"
 #include "../http/http_request.hpp" // handle http request
 #include "../http/http_response.hpp" // handle http response
+#include "../http/mime_types.hpp" // extension -> MIME type registry
 #include "../cgi/cgi_handler.hpp" // CGI handler
+#include "../utils/latency_histogram.hpp" // per-phase request latency
+#include "../utils/status_report.hpp" // stub_status page
+#include "../utils/logger.hpp" // LOG_* macros, asynchronous writer
+#include "../utils/access_log.hpp" // access_log format
+#include <csignal>
 #include <vector>
 #include <map>
+#include <set>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <fcntl.h>
@@ -25,24 +36,33 @@ private:
     ServerConfig config;
     std::vector<int> socketFds;     // 监听的socket文件描述符
     std::map<int, int> portToSocket; // 端口到socket的映射
+    std::map<int, PreloadedResponse> errorPageCache; // 状态码 -> 预序列化的错误页面
+    LocationMatcher locationMatcher; // compiled from config.locations in the constructor
+    std::vector<PhaseLatency> latency; // per location, the last one for requests without a location
+    std::string label_; // "first_server_name:first_port", for metrics & access_log
     
 public:
     ServerInstance(const ServerConfig& serverConfig);
     ~ServerInstance();
     
-    bool initialize();
+    bool initialize(const std::set<int>& sharedPorts = std::set<int>()); // sharedPorts: already bound by an earlier server
     bool startListening();
     void cleanup();
+    bool loadErrorPages(); // (re)load configured error_page files into memory
     
     // Getter方法
     const ServerConfig& getConfig() const { return config; }
     const std::vector<int>& getSocketFds() const { return socketFds; }
     bool isListeningOnPort(int port) const;
     int getSocketForPort(int port) const;
+    const PreloadedResponse* getErrorPage(int statusCode) const;
+    const std::string& label() const { return label_; }
+    PhaseLatency& latencyFor(const LocationConfig* location);
+    const std::vector<PhaseLatency>& getLatency() const { return latency; }
     
     // 辅助方法
     LocationConfig* findMatchingLocation(const std::string& path);
-    bool matchesServerName(const std::string& hostHeader) const;
+    std::string resolveFilePath(const std::string& uri, const LocationConfig* location) const;
 };
 
 // Web服务器主类
@@ -51,8 +71,12 @@ private:
     Config config; // main storage for config
     std::vector<ServerInstance*> servers; // each holds ServerConfig copy
     std::map<int, std::vector<ServerInstance*> > portToServers; // port mapping
+    std::map<int, VirtualHostTable> vhostTables; // port -> server_name tables
+    std::map<int, int> listenFdToPort; // listening socket -> port, resolved at accept
     bool initialized;
     bool running;
+    volatile sig_atomic_t latencyDumpRequested; // set by SIGUSR1, handled by the event loop
+    AccessLogFormat accessLogFormat; // compiled from config.accessLogFormat
 
     std::map<int, ClientConnection*> clientConnections;  // fd -> 客户端连接
     fd_set readFds, writeFds;                           // select用的fd集合
@@ -63,11 +87,19 @@ private:
 	
 	void handleNewConnection(int serverFd);
     void handleClientRequest(int clientFd);
+    void watchCGIClient(int clientFd);
     void handleClientResponse(int clientFd);
     void closeClientConnection(int clientFd);
     void resetConnectionForResue(ClientConnection* conn);
+    void finishCGIResponse(int clientFd); // build the response of a completed CGI job
+    void streamCGIBody(ClientConnection* conn); // forward a streamed CGI body once the headers are out
+    void sendFileBody(ClientConnection* conn); // sendfile() the static file body once the headers are out
     bool parseHttpRequest(ClientConnection* conn);
     void buildHttpResponse(ClientConnection* conn);
+    void serveStatus(ClientConnection* conn); // stub_status location: text or Prometheus metrics
+    void collectStatus(StatusSnapshot& snapshot) const; // connection states, cache & latency
+    void dumpLatency() const; // latency histograms to stderr (SIGUSR1)
+    void logAccess(const ClientConnection* conn) const; // one access_log line per finished response
     void updateMaxFd();// 最大fd值
 
     // CGI处理方法
@@ -95,12 +127,12 @@ public:
     bool start(); // start listening on all configured ports
     void stop(); // gracefully shut down all servers
     bool isRunning() const { return running; }
+    void requestLatencyDump() { latencyDumpRequested = 1; } // async-signal-safe
     
     // 获取服务器信息 - 只保留声明，定义移到 .cpp 文件
     const Config& getConfig() const;
     size_t getServerCount() const;
     ServerInstance* findServerByHost(const std::string& hostHeader, int port); // virtual host routing, by match http host header to server config
-    int getPortFromClientSocket(int clientFd); // extract port from client socket
     
 	void run();  // main event loop using select() for I/O multiplexing
 
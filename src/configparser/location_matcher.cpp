@@ -0,0 +1,162 @@
+#include "location_matcher.hpp"
+#include <algorithm>
+
+LocationMatcher::LocationMatcher() {
+    nodes_.push_back(Node());
+}
+
+void LocationMatcher::build(const std::vector<LocationConfig>& locations) {
+    nodes_.clear();
+    nodes_.push_back(Node());
+    for (size_t i = 0; i < locations.size(); ++i) {
+        if (!locations[i].path.empty())
+            insert(locations[i].path, static_cast<int>(i));
+    }
+}
+
+int LocationMatcher::findChild(int node, unsigned char c) const {
+    const std::vector<unsigned char>& keys = nodes_[node].keys;
+    std::vector<unsigned char>::const_iterator it = std::lower_bound(keys.begin(), keys.end(), c);
+    if (it == keys.end() || *it != c)
+        return -1;
+    return nodes_[node].children[it - keys.begin()];
+}
+
+// keep keys sorted so lookups can binary search
+void LocationMatcher::addChild(int node, int child) {
+    unsigned char c = static_cast<unsigned char>(nodes_[child].label[0]);
+    std::vector<unsigned char>& keys = nodes_[node].keys;
+    size_t slot = std::lower_bound(keys.begin(), keys.end(), c) - keys.begin();
+    keys.insert(keys.begin() + slot, c);
+    nodes_[node].children.insert(nodes_[node].children.begin() + slot, child);
+}
+
+void LocationMatcher::insert(const std::string& path, int index) {
+    int node = 0;
+    size_t pos = 0;
+
+    while (pos < path.length()) {
+        unsigned char c = static_cast<unsigned char>(path[pos]);
+        int child = findChild(node, c);
+
+        // no edge starts with this byte: hang the rest of the path off this node
+        if (child == -1) {
+            Node leaf;
+            leaf.label = path.substr(pos);
+            leaf.location = index;
+            nodes_.push_back(leaf);
+            addChild(node, static_cast<int>(nodes_.size()) - 1);
+            return;
+        }
+
+        // length of the common prefix between the edge label & the rest of the path
+        const std::string& label = nodes_[child].label;
+        size_t common = 0;
+        while (common < label.length() && pos + common < path.length()
+               && label[common] == path[pos + common])
+            ++common;
+
+        if (common < label.length()) {
+            // split the edge: parent -> mid (label[0, common)) -> child (label[common, ...))
+            Node mid;
+            mid.label = label.substr(0, common);
+            nodes_[child].label.erase(0, common);
+            nodes_.push_back(mid);
+            int midIndex = static_cast<int>(nodes_.size()) - 1;
+
+            std::vector<unsigned char>& keys = nodes_[node].keys;
+            size_t slot = std::lower_bound(keys.begin(), keys.end(), c) - keys.begin();
+            nodes_[node].children[slot] = midIndex;
+            addChild(midIndex, child);
+            child = midIndex;
+        }
+        node = child;
+        pos += common;
+    }
+
+    // first declaration of a duplicate path wins, like the linear scan
+    if (nodes_[node].location == -1)
+        nodes_[node].location = index;
+}
+
+int LocationMatcher::match(const std::string& uri) const {
+    const char* p = uri.c_str();
+    size_t len = uri.length();
+    size_t pos = 0;
+    int node = 0;
+    int best = -1;
+
+    while (true) {
+        // a location ends at depth pos: prefix match if it ends on a path segment boundary
+        if (nodes_[node].location != -1
+            && (p[pos - 1] == '/' || pos == len || p[pos] == '/'))
+            best = nodes_[node].location;
+
+        if (pos == len)
+            break;
+
+        int child = findChild(node, static_cast<unsigned char>(p[pos]));
+        if (child == -1)
+            return best;
+
+        const std::string& label = nodes_[child].label;
+        size_t i = 0;
+        while (i < label.length() && pos + i < len && label[i] == p[pos + i])
+            ++i;
+
+        if (i == label.length()) {
+            node = child;
+            pos += i;
+            continue;
+        }
+
+        // uri ran out one byte before the end of the edge: directory match (uri + "/")
+        if (pos + i == len && i + 1 == label.length() && label[i] == '/'
+            && nodes_[child].location != -1 && len > 0)
+            return nodes_[child].location;
+        return best;
+    }
+
+    // whole uri consumed on a node boundary: directory match is a "/" edge below it
+    int slash = findChild(node, '/');
+    if (slash != -1 && len > 0 && nodes_[slash].label.length() == 1
+        && nodes_[slash].location != -1)
+        return nodes_[slash].location;
+    return best;
+}
+
+/* original O(locations) scan, kept as the reference for tests & benchmarks */
+int LocationMatcher::matchLinear(const std::vector<LocationConfig>& locations, const std::string& path) {
+    int bestMatch = -1;
+    size_t maxLength = 0;
+
+    // location iteration
+    for (size_t i = 0; i < locations.size(); ++i) {
+        const LocationConfig& location = locations[i];
+        bool match = false;
+
+        // 1. exact match
+        if (location.path == path)
+            match = true;
+        // 2. directory match: eg. /github/ should match /github
+        else if (location.path.length() > 1 && location.path[location.path.length() - 1] == '/'
+                 && path + "/" == location.path)
+            match = true;
+        // 3. prefix match with boundary checkes
+        else if (location.path.length() <= path.length()
+                && path.substr(0, location.path.length()) == location.path)
+                {
+                    // boundary check
+                    if (location.path[location.path.length() - 1] == '/' // location ends with '/'
+                        || path.length() == location.path.length() // exact length match
+                        || path[location.path.length()] == '/') // next char is '/
+                        match = true;
+                }
+        // update maxLength & bestMatch
+        if (match && location.path.length() > maxLength) {
+            maxLength = location.path.length();
+            bestMatch = static_cast<int>(i);
+        }
+    }
+    return bestMatch;
+}
@@ -0,0 +1,45 @@
+#ifndef LOCATION_MATCHER_HPP
+#define LOCATION_MATCHER_HPP
+
+#include "config.hpp"
+#include <string>
+#include <vector>
+
+/* byte-level radix trie over the location paths of one server
+    - compiled once per ServerInstance at startup
+    - match() walks the URI once: O(URI length), no allocation
+    - same rules as the original linear scan (kept as matchLinear for reference):
+        1. exact match:      location == uri
+        2. directory match:  location == uri + "/"   (eg. /github/ matches /github)
+        3. prefix match:     location is a prefix of uri, and location ends with '/'
+                             or the next uri char is '/'
+      longest location wins, the first one declared wins between duplicates
+*/
+class LocationMatcher {
+private:
+    struct Node {
+        std::string label;                 // edge label from the parent node
+        int location;                      // index of the location ending here, -1 if none
+        std::vector<unsigned char> keys;   // first byte of each child label, sorted
+        std::vector<int> children;         // child node indices, parallel to keys
+
+        Node() : location(-1) {}
+    };
+
+    std::vector<Node> nodes_;              // nodes_[0] is the root (empty label)
+
+    int findChild(int node, unsigned char c) const;
+    void addChild(int node, int child);
+    void insert(const std::string& path, int index);
+
+public:
+    LocationMatcher();
+
+    void build(const std::vector<LocationConfig>& locations);
+    int match(const std::string& uri) const; // index into locations, -1 if none
+    size_t nodeCount() const { return nodes_.size(); }
+
+    static int matchLinear(const std::vector<LocationConfig>& locations, const std::string& uri);
+};
+
+#endif // LOCATION_MATCHER_HPP
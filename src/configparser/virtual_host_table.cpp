@@ -0,0 +1,81 @@
+#include "virtual_host_table.hpp"
+
+VirtualHostTable::VirtualHostTable() : default_(NULL), hasCatchAll_(false) {}
+
+// the first server declaring a name keeps it, like the old in-order scan
+void VirtualHostTable::insertFirst(StringTable<ServerInstance*>& table, const std::string& key, ServerInstance* server) {
+    if (!table.find(key))
+        table.insert(key, server);
+}
+
+void VirtualHostTable::add(ServerInstance* server, const std::vector<std::string>& serverNames) {
+    if (!default_)
+        default_ = server;
+
+    if (serverNames.empty() && !hasCatchAll_) {
+        default_ = server;
+        hasCatchAll_ = true;
+    }
+
+    for (size_t i = 0; i < serverNames.size(); ++i) {
+        const std::string& name = serverNames[i];
+
+        if (name == "_") {
+            if (!hasCatchAll_) {
+                default_ = server;
+                hasCatchAll_ = true;
+            }
+        }
+        else if (name.length() > 2 && name[0] == '*' && name[1] == '.')
+            insertFirst(suffix_, name.substr(1), server);
+        else if (name.length() > 2 && name[name.length() - 1] == '*' && name[name.length() - 2] == '.')
+            insertFirst(prefix_, name.substr(0, name.length() - 1), server);
+        else if (name.length() > 1 && name[0] == '.') {
+            insertFirst(exact_, name.substr(1), server);
+            insertFirst(suffix_, name, server);
+        }
+        else if (!name.empty())
+            insertFirst(exact_, name, server);
+    }
+}
+
+ServerInstance* VirtualHostTable::lookup(const char* host, size_t len) const {
+    // strip the port: "[::1]:8080" keeps the brackets, "example.com:8080" stops at ':'
+    size_t end = 0;
+    if (len > 0 && host[0] == '[') {
+        while (end < len && host[end] != ']')
+            ++end;
+        if (end < len)
+            ++end;
+    }
+    else {
+        while (end < len && host[end] != ':')
+            ++end;
+    }
+    // "example.com." is the same host as "example.com"
+    if (end > 0 && host[end - 1] == '.')
+        --end;
+    if (end == 0)
+        return default_;
+
+    ServerInstance* const* found = exact_.find(host, end);
+    if (found)
+        return *found;
+
+    // *.example.com: try ".b.example.com" before ".example.com" for a.b.example.com
+    if (!suffix_.empty()) {
+        for (size_t i = 0; i < end; ++i) {
+            if (host[i] == '.' && (found = suffix_.find(host + i, end - i)))
+                return *found;
+        }
+    }
+
+    // www.*: try "www.example." before "www." for www.example.com
+    if (!prefix_.empty()) {
+        for (size_t i = end; i > 0; --i) {
+            if (host[i - 1] == '.' && (found = prefix_.find(host, i)))
+                return *found;
+        }
+    }
+    return default_;
+}
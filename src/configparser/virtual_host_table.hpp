@@ -0,0 +1,38 @@
+#ifndef VIRTUAL_HOST_TABLE_HPP
+#define VIRTUAL_HOST_TABLE_HPP
+
+#include "../utils/string_table.hpp"
+#include <string>
+#include <vector>
+
+class ServerInstance;
+
+/* name-based virtual hosts of one listening port, built once at startup
+    - exact names:        example.com      -> hash lookup
+    - leading wildcard:   *.example.com    -> stored as ".example.com", longest suffix wins
+    - trailing wildcard:  www.*            -> stored as "www.", longest prefix wins
+    - ".example.com" is shorthand for example.com + *.example.com
+    - precedence: exact > leading wildcard > trailing wildcard > default server
+    - default server: first server without server_name (or with "_"), else the first server
+    - lookup() takes the raw Host header: port / trailing dot stripped & case folded without allocating
+*/
+class VirtualHostTable {
+private:
+    StringTable<ServerInstance*> exact_;
+    StringTable<ServerInstance*> suffix_;
+    StringTable<ServerInstance*> prefix_;
+    ServerInstance* default_;
+    bool hasCatchAll_;      // default_ was set explicitly by a catch-all server
+
+    static void insertFirst(StringTable<ServerInstance*>& table, const std::string& key, ServerInstance* server);
+
+public:
+    VirtualHostTable();
+
+    void add(ServerInstance* server, const std::vector<std::string>& serverNames);
+    ServerInstance* lookup(const char* host, size_t len) const;
+    ServerInstance* lookup(const std::string& host) const { return lookup(host.c_str(), host.length()); }
+    ServerInstance* defaultServer() const { return default_; }
+};
+
+#endif // VIRTUAL_HOST_TABLE_HPP
@@ -823,11 +823,10 @@ bool HttpRequest::parseRequest(const std::string& complete_request)
     std::string request_line = complete_request.substr(0, first_crlf);
     std::string header_section;
     size_t header_start = first_crlf + 2;
-    size_t header_length = header_end - header_start;
-    if (header_length < 0)
+    if (header_end < header_start) // no header lines between request line and blank line
         header_section = "";
     else
-        header_section = complete_request.substr(header_start, header_length);
+        header_section = complete_request.substr(header_start, header_end - header_start);
     std::string body_section;
     size_t body_start = header_end + 4;
     if (body_start >= complete_request.length())
@@ -1158,12 +1157,13 @@ bool HttpRequest::getIsParsed() const
 }
 
 // return the host value from the header, empty string if not found
-std::string HttpRequest::getHost() const
+const std::string& HttpRequest::getHost() const
 {
+    static const std::string empty;
     std::multimap<std::string, std::string>::const_iterator it = headers_.find("host");
     if (it != headers_.end())
         return it->second;
-    return "";
+    return empty;
 }
 
 // return the user-agent value from the header, empty string if not found
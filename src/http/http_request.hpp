@@ -210,7 +210,7 @@ public:
     bool getIsParsed() const;
 
     // specific headers
-    std::string getHost() const;
+    const std::string& getHost() const;
     std::string getUserAgent() const;
     std::string getContentType() const;
     std::string getHeader(const std::string& header_name) const;
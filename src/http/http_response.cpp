@@ -1,6 +1,10 @@
 #include "http_response.hpp"
+#include "mime_types.hpp"
+#include "../utils/server_clock.hpp"
 #include <fstream>
 #include <iomanip>
+#include <cstdio>
+#include <cstdlib>
 
 // ============================================================================
 // 构造函数和析构函数
@@ -86,10 +90,12 @@ std::string HttpResponse::getReasonPhrase() const
         case 200: return "OK";
         case 201: return "Created";
         case 204: return "No Content";
+        case 206: return "Partial Content";
         
         // 3xx 重定向  
         case 301: return "Moved Permanently";
         case 302: return "Found";
+        case 304: return "Not Modified";
         
         // 4xx 客户端错误
         case 400: return "Bad Request";
@@ -103,6 +109,7 @@ std::string HttpResponse::getReasonPhrase() const
         case 413: return "Payload Too Large";
         case 414: return "URI Too Long";
         case 415: return "Unsupported Media Type";
+        case 416: return "Range Not Satisfiable";
         case 431: return "Request Header Fields Too Large";
         
         // 5xx 服务器错误
@@ -132,6 +139,9 @@ std::string HttpResponse::buildStatusLine() const
 void HttpResponse::setHeader(const std::string& name, const std::string& value)
 {
     headers_[name] = value;
+    // keep setStandardHeaders() from putting the default type back
+    if (name == "Content-Type")
+        content_type_ = value;
 }
 
 void HttpResponse::removeHeader(const std::string& name)
@@ -147,65 +157,20 @@ std::string HttpResponse::getHeader(const std::string& name) const
     return "";
 }
 
-/* 获取HTTP格式的当前GMT时间 (RFC 7231) */
-std::string HttpResponse::getCurrentDateGMT() const
+/* 获取HTTP格式的当前GMT时间 (RFC 7231)
+ * The string is preformatted by ServerClock once per second, not per response
+ */
+const std::string& HttpResponse::getCurrentDateGMT() const
 {
-    time_t now = time(0);
-    struct tm* gmt = gmtime(&now);
-    
-    char buffer[100];
-    strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", gmt);
-    return std::string(buffer);
+    return ServerClock::httpDate();
 }
 
-/* 根据文件扩展名确定内容类型 */
-std::string HttpResponse::getContentType(const std::string& file_path) const
+/* 根据文件扩展名确定内容类型
+ * One hash probe in the MimeTypes registry (defaults + config `types`)
+ */
+const std::string& HttpResponse::getContentType(const std::string& file_path) const
 {
-    if (file_path.empty())
-        return "text/html; charset=UTF-8";
-        
-    // 查找文件扩展名
-    size_t dot_pos = file_path.find_last_of('.');
-    if (dot_pos == std::string::npos)
-        // return "text/plain; charset=UTF-8";
-        return "application/octet-stream";
-
-    std::string ext = file_path.substr(dot_pos + 1);
-    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-    
-    // 将扩展名映射到MIME类型
-    if (ext == "html" || ext == "htm")
-        return "text/html; charset=UTF-8";
-    else if (ext == "css")
-        return "text/css; charset=UTF-8";
-    else if (ext == "js")
-        return "application/javascript; charset=UTF-8";
-    else if (ext == "json")
-        return "application/json; charset=UTF-8";
-    else if (ext == "xml")
-        return "application/xml; charset=UTF-8";
-    else if (ext == "txt")
-        return "text/plain; charset=UTF-8";
-    else if (ext == "jpg" || ext == "jpeg")
-        return "image/jpeg";
-    else if (ext == "png")
-        return "image/png";
-    else if (ext == "gif")
-        return "image/gif";
-    else if (ext == "ico")
-        return "image/x-icon";
-    else if (ext == "pdf")
-        return "application/pdf";
-    else if (ext == "doc" || ext == "docx")
-        return "application/vnd.openxmlformats-officedocument.wordprocessingml.document";
-    else if (ext == "mp4")
-        return "video/mp4";
-    else if (ext == "mp3")
-        return "audio/mpeg";
-    else if (ext == "zip")
-        return "application/zip";
-    else
-        return "application/octet-stream";
+    return MimeTypes::lookup(file_path);
 }
 
 /* 设置标准HTTP响应头 */
@@ -504,6 +469,201 @@ std::string HttpResponse::buildFileResponse(const std::string& file_path, HttpRe
     return status_line + headers + "\r\n" + body_;
 }
 
+/* If-None-Match: weak comparison against a list of entity tags (RFC 7232 3.2) */
+static bool etagListMatches(const std::string& header, const std::string& etag)
+{
+    size_t pos = 0;
+    while (pos < header.size())
+    {
+        size_t end = header.find(',', pos);
+        if (end == std::string::npos)
+            end = header.size();
+        size_t first = header.find_first_not_of(" \t", pos);
+        size_t last = header.find_last_not_of(" \t", end - 1);
+        if (first != std::string::npos && first < end && last >= first)
+        {
+            std::string tag = header.substr(first, last - first + 1);
+            if (tag.compare(0, 2, "W/") == 0)
+                tag.erase(0, 2);
+            if (tag == "*" || tag == etag)
+                return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+/* Range: a single "bytes=first-last", "bytes=first-" or "bytes=-suffix"
+ * @return 1 satisfiable (offset/length set), 0 unsatisfiable (416), -1 ignore the header (200)
+ * several ranges are answered with the whole file, which RFC 7233 allows
+ */
+static int parseByteRange(const std::string& header, off_t size, off_t& offset, off_t& length)
+{
+    if (header.compare(0, 6, "bytes=") != 0 || header.find(',') != std::string::npos)
+        return -1;
+    std::string spec = header.substr(6);
+    size_t dash = spec.find('-');
+    if (dash == std::string::npos)
+        return -1;
+    std::string first = spec.substr(0, dash);
+    std::string last = spec.substr(dash + 1);
+    if (first.find_first_not_of("0123456789") != std::string::npos
+        || last.find_first_not_of("0123456789") != std::string::npos
+        || (first.empty() && last.empty()))
+        return -1;
+
+    if (first.empty()) // suffix: the last N bytes
+    {
+        off_t suffix = static_cast<off_t>(std::strtoll(last.c_str(), NULL, 10));
+        if (suffix == 0 || size == 0)
+            return 0;
+        length = suffix < size ? suffix : size;
+        offset = size - length;
+        return 1;
+    }
+    off_t start = static_cast<off_t>(std::strtoll(first.c_str(), NULL, 10));
+    off_t end = last.empty() ? size - 1 : static_cast<off_t>(std::strtoll(last.c_str(), NULL, 10));
+    if (!last.empty() && end < start)
+        return -1;
+    if (start >= size)
+        return 0;
+    if (end >= size)
+        end = size - 1;
+    offset = start;
+    length = end - start + 1;
+    return 1;
+}
+
+/* Build the head of a file response, the body is sent from the file by the caller
+ * Purpose: Static files served with sendfile() instead of being read into memory
+ * Features:
+ * - ETag ("mtime-size") & Last-Modified, 304 for If-None-Match / If-Modified-Since
+ * - a single byte range -> 206 with Content-Range, unsatisfiable -> 416,
+ *   a stale If-Range -> the whole file
+ * - headers set before the call (eg. Content-Type of a CGI X-Sendfile response) are kept
+ * @param offset, length: output, the part of the file to send after the head (length 0 = none)
+ */
+std::string HttpResponse::buildFileHead(const std::string& file_path, const struct stat& file_stat,
+                                        const HttpRequest& request, off_t& offset, off_t& length)
+{
+    char etag[64];
+    snprintf(etag, sizeof(etag), "\"%lx-%llx\"", static_cast<unsigned long>(file_stat.st_mtime),
+             static_cast<unsigned long long>(file_stat.st_size));
+    std::string last_modified = ServerClock::formatHttpDate(file_stat.st_mtime);
+    off_t size = file_stat.st_size;
+
+    setStatusCode(200);
+    offset = 0;
+    length = size;
+
+    // If-None-Match wins over If-Modified-Since (RFC 7232 6)
+    std::string if_none_match = request.getHeader("If-None-Match");
+    std::string if_modified_since = request.getHeader("If-Modified-Since");
+    bool not_modified = false;
+    if (!if_none_match.empty())
+        not_modified = etagListMatches(if_none_match, etag);
+    else if (!if_modified_since.empty())
+    {
+        time_t since = ServerClock::parseHttpDate(if_modified_since);
+        not_modified = since != -1 && file_stat.st_mtime <= since;
+    }
+
+    std::string range = request.getHeader("Range");
+    std::string if_range = request.getHeader("If-Range");
+    if (not_modified)
+    {
+        setStatusCode(304);
+        length = 0;
+    }
+    else if (!range.empty() && (if_range.empty() || if_range == etag || if_range == last_modified))
+    {
+        off_t range_offset = 0;
+        off_t range_length = 0;
+        int result = parseByteRange(range, size, range_offset, range_length);
+        std::ostringstream content_range;
+        if (result == 1)
+        {
+            setStatusCode(206);
+            offset = range_offset;
+            length = range_length;
+            content_range << "bytes " << offset << "-" << (offset + length - 1) << "/" << size;
+            setHeader("Content-Range", content_range.str());
+        }
+        else if (result == 0)
+        {
+            setStatusCode(416);
+            length = 0;
+            content_range << "bytes */" << size;
+            setHeader("Content-Range", content_range.str());
+        }
+    }
+
+    setHeader("Server", "42_webserv/1.0");
+    setHeader("Date", getCurrentDateGMT());
+    if (request.getConnection() && status_code_ < 400)
+        setHeader("Connection", "keep-alive");
+    else
+        setHeader("Connection", "close");
+    if (getHeader("Content-Type").empty())
+        setHeader("Content-Type", getContentType(file_path));
+    if (getHeader("Cache-Control").empty())
+        setHeader("Cache-Control", "public, max-age=3600"); // 缓存1小时
+    setHeader("ETag", etag);
+    setHeader("Last-Modified", last_modified);
+    setHeader("Accept-Ranges", "bytes");
+    if (status_code_ != 304)
+    {
+        std::ostringstream content_length;
+        content_length << length;
+        setHeader("Content-Length", content_length.str());
+    }
+    return buildStatusLine() + buildHeaders() + "\r\n";
+}
+
+/* Serialize a response once, for reuse across requests
+ * Purpose: Pre-build everything except the per-request Date & Connection headers
+ * Use cases: Configured error pages loaded at startup
+ */
+PreloadedResponse HttpResponse::preload(int status_code, const std::string& body, const std::string& file_path)
+{
+    HttpResponse response(status_code);
+    std::ostringstream head;
+    head << response.buildStatusLine()
+         << "Server: 42_webserv/1.0\r\n"
+         << "Content-Type: " << response.getContentType(file_path) << "\r\n"
+         << "Content-Length: " << body.length() << "\r\n";
+
+    PreloadedResponse preloaded;
+    preloaded.status_code = status_code;
+    preloaded.head = head.str();
+    preloaded.tail = "\r\n" + body;
+    return preloaded;
+}
+
+/* Build the per-request head of a preloaded response
+ * Purpose: Error responses without generating HTML or headers per request
+ * Features:
+ * - Only Date & Connection are added, error statuses always close the connection
+ * - The body is not copied: the caller sends preloaded.tail after the returned head
+ */
+std::string HttpResponse::buildPreloadedResponse(const PreloadedResponse& preloaded)
+{
+    setStatusCode(preloaded.status_code);
+    const char* connection = (status_code_ < 400) ? "keep-alive" : "close";
+    setHeader("Connection", connection);
+
+    const std::string& date = getCurrentDateGMT();
+    std::string response;
+    response.reserve(preloaded.head.size() + date.size() + 40);
+    response += preloaded.head;
+    response += "Date: ";
+    response += date;
+    response += "\r\nConnection: ";
+    response += connection;
+    response += "\r\n";
+    return response;
+}
+
 // ============================================================================
 // Getter方法和工具方法
 // ============================================================================
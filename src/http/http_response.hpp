@@ -7,8 +7,22 @@
 #include <sstream>
 #include <ctime>
 #include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "http_request.hpp"
 
+/* response serialized once at startup (eg. configured error pages)
+    - head: status line + static headers, without Date/Connection
+    - tail: blank line + body
+*/
+struct PreloadedResponse {
+    int status_code;
+    std::string head;
+    std::string tail;
+
+    PreloadedResponse() : status_code(0) {}
+};
+
 class HttpResponse
 {
 private:
@@ -20,12 +34,12 @@ private:
     
     // Helper methods
     std::string getReasonPhrase() const;
-    std::string getCurrentDateGMT() const;
+    const std::string& getCurrentDateGMT() const;
     std::string generateErrorPage(int status_code, const std::string& reason) const;
 
 public:
     // Utility methods
-    std::string getContentType(const std::string& file_path) const;
+    const std::string& getContentType(const std::string& file_path) const;
     // Constructor & Destructor
     HttpResponse();
     explicit HttpResponse(int status_code);
@@ -54,6 +68,10 @@ public:
     std::string buildFullResponse(const HttpRequest& request);
     std::string buildErrorResponse(int status_code, const std::string& message, HttpRequest& request);
     std::string buildFileResponse(const std::string& file_path, HttpRequest& request);
+    std::string buildFileHead(const std::string& file_path, const struct stat& file_stat,
+                              const HttpRequest& request, off_t& offset, off_t& length);
+    std::string buildPreloadedResponse(const PreloadedResponse& preloaded);
+    static PreloadedResponse preload(int status_code, const std::string& body, const std::string& file_path);
     
     // Getters
     int getStatusCode() const;
@@ -0,0 +1,81 @@
+#include "mime_types.hpp"
+
+StringTable<const std::string*> MimeTypes::table_;
+std::set<std::string> MimeTypes::pool_;
+const std::string MimeTypes::default_type_ = "application/octet-stream";
+const std::string MimeTypes::html_type_ = "text/html; charset=UTF-8";
+
+/* built-in table, used when the config does not define the extension */
+void MimeTypes::loadDefaults() {
+    static const char* defaults[][2] = {
+        { "html",  "text/html; charset=UTF-8" },
+        { "htm",   "text/html; charset=UTF-8" },
+        { "css",   "text/css; charset=UTF-8" },
+        { "js",    "application/javascript; charset=UTF-8" },
+        { "mjs",   "application/javascript; charset=UTF-8" },
+        { "json",  "application/json; charset=UTF-8" },
+        { "xml",   "application/xml; charset=UTF-8" },
+        { "txt",   "text/plain; charset=UTF-8" },
+        { "csv",   "text/csv; charset=UTF-8" },
+        { "jpg",   "image/jpeg" },
+        { "jpeg",  "image/jpeg" },
+        { "png",   "image/png" },
+        { "gif",   "image/gif" },
+        { "ico",   "image/x-icon" },
+        { "svg",   "image/svg+xml" },
+        { "webp",  "image/webp" },
+        { "avif",  "image/avif" },
+        { "woff",  "font/woff" },
+        { "woff2", "font/woff2" },
+        { "ttf",   "font/ttf" },
+        { "otf",   "font/otf" },
+        { "wasm",  "application/wasm" },
+        { "pdf",   "application/pdf" },
+        { "doc",   "application/vnd.openxmlformats-officedocument.wordprocessingml.document" },
+        { "docx",  "application/vnd.openxmlformats-officedocument.wordprocessingml.document" },
+        { "mp4",   "video/mp4" },
+        { "webm",  "video/webm" },
+        { "mp3",   "audio/mpeg" },
+        { "zip",   "application/zip" }
+    };
+    for (size_t i = 0; i < sizeof(defaults) / sizeof(defaults[0]); ++i)
+        add(defaults[i][0], defaults[i][1]);
+}
+
+void MimeTypes::add(const std::string& extension, const std::string& type) {
+    const std::string* interned = &*pool_.insert(type).first;
+    table_.insert(extension, interned);
+}
+
+/* called once at startup (and on reload) with the parsed `types` entries */
+void MimeTypes::configure(const std::map<std::string, std::string>& types) {
+    table_.clear();
+    pool_.clear();
+    loadDefaults();
+    for (std::map<std::string, std::string>::const_iterator it = types.begin();
+         it != types.end(); ++it)
+        add(it->first, it->second);
+}
+
+size_t MimeTypes::size() {
+    return table_.size();
+}
+
+const std::string& MimeTypes::lookupExtension(const char* extension, size_t len) {
+    if (table_.empty())
+        loadDefaults();
+    const std::string* const* type = table_.find(extension, len);
+    return type ? **type : default_type_;
+}
+
+/* resolve by file path: extension is whatever follows the last '.' of the last path segment */
+const std::string& MimeTypes::lookup(const std::string& file_path) {
+    if (file_path.empty())
+        return html_type_;
+    size_t dot_pos = file_path.find_last_of('.');
+    size_t slash_pos = file_path.find_last_of('/');
+    if (dot_pos == std::string::npos
+        || (slash_pos != std::string::npos && dot_pos < slash_pos))
+        return default_type_;
+    return lookupExtension(file_path.c_str() + dot_pos + 1, file_path.length() - dot_pos - 1);
+}
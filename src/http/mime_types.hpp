@@ -0,0 +1,33 @@
+#ifndef MIME_TYPES_HPP
+#define MIME_TYPES_HPP
+
+#include <string>
+#include <map>
+#include <set>
+#include "../utils/string_table.hpp"
+
+/* process-wide MIME type registry
+    - built-in defaults cover the types the server always knew about
+    - `types { }` blocks and `include mime.types` in the config add to / override them
+    - extension -> interned MIME string, one hash probe per lookup
+*/
+class MimeTypes {
+private:
+    static StringTable<const std::string*> table_; // extension (lowercase) -> interned type
+    static std::set<std::string> pool_;            // interned MIME strings, stable addresses
+    static const std::string default_type_;        // unknown extension
+    static const std::string html_type_;           // no file path (generated pages)
+
+    static void loadDefaults();
+    MimeTypes();
+
+public:
+    static void add(const std::string& extension, const std::string& type);
+    static void configure(const std::map<std::string, std::string>& types); // reset to defaults + config
+    static size_t size();
+
+    static const std::string& lookupExtension(const char* extension, size_t len);
+    static const std::string& lookup(const std::string& file_path);
+};
+
+#endif // MIME_TYPES_HPP
@@ -15,11 +15,19 @@ void signalHandler(int signal) {
     // Don't call exit(), let program exit naturally to trigger destructors
 }
 
+// SIGUSR1: dump the latency histograms, the event loop does the work
+void latencyDumpHandler(int signal) {
+    (void)signal;
+    if (g_server)
+        g_server->requestLatencyDump();
+}
+
 void setupSignalHandlers() {
     // Handle common termination signals
     signal(SIGINT, signalHandler);   // Ctrl+C
     signal(SIGTERM, signalHandler);  // Termination request
     signal(SIGQUIT, signalHandler);  // Quit signal
+    signal(SIGUSR1, latencyDumpHandler); // latency histograms to stderr
 
     // Ignore SIGPIPE (broken pipe), handle in code
     signal(SIGPIPE, SIG_IGN);
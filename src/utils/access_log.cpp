@@ -0,0 +1,179 @@
+#include "access_log.hpp"
+#include "logger.hpp"
+#include "server_clock.hpp"
+#include <ctime>
+
+const char* const AccessLogFormat::DEFAULT =
+    "$remote_addr - - [$time_local] \"$request\" $status $bytes_sent $request_time";
+
+AccessLogEntry::AccessLogEntry()
+    : remoteAddr(NULL), request(NULL), requestLength(0), host(NULL), server(NULL), location(NULL),
+      status(0), bytesReceived(0), bytesSent(0), timing(NULL), doneUs(0) {
+}
+
+AccessLogFormat::AccessLogFormat() {
+    std::string error;
+    compile(DEFAULT, error);
+}
+
+// FIELD_LITERAL = not a variable
+AccessLogFormat::Field AccessLogFormat::lookupField(const std::string& name) {
+    static const struct {
+        const char* name;
+        Field field;
+    } variables[] = {
+        { "remote_addr", FIELD_REMOTE_ADDR }, { "time_local", FIELD_TIME_LOCAL },
+        { "request", FIELD_REQUEST }, { "status", FIELD_STATUS },
+        { "bytes_sent", FIELD_BYTES_SENT }, { "request_length", FIELD_REQUEST_LENGTH },
+        { "host", FIELD_HOST }, { "server", FIELD_SERVER }, { "location", FIELD_LOCATION },
+        { "request_time", FIELD_REQUEST_TIME }, { "request_time_us", FIELD_REQUEST_TIME_US },
+        { "header_time_us", FIELD_HEADER_TIME_US }, { "body_time_us", FIELD_BODY_TIME_US },
+        { "parse_time_us", FIELD_PARSE_TIME_US }, { "route_time_us", FIELD_ROUTE_TIME_US },
+        { "build_time_us", FIELD_BUILD_TIME_US }, { "cgi_time_us", FIELD_CGI_TIME_US },
+        { "send_time_us", FIELD_SEND_TIME_US }
+    };
+    for (size_t i = 0; i < sizeof(variables) / sizeof(variables[0]); ++i) {
+        if (name == variables[i].name)
+            return variables[i].field;
+    }
+    return FIELD_LITERAL;
+}
+
+static bool isNameChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+bool AccessLogFormat::compile(const std::string& format, std::string& error) {
+    std::vector<Token> tokens;
+    size_t pos = 0;
+    while (pos < format.size()) {
+        size_t dollar = format.find('$', pos);
+        size_t end = dollar == std::string::npos ? format.size() : dollar;
+        if (end > pos) {
+            Token literal;
+            literal.field = FIELD_LITERAL;
+            literal.literal = format.substr(pos, end - pos);
+            tokens.push_back(literal);
+        }
+        if (dollar == std::string::npos)
+            break;
+        size_t nameEnd = dollar + 1;
+        while (nameEnd < format.size() && isNameChar(format[nameEnd]))
+            ++nameEnd;
+        std::string name = format.substr(dollar + 1, nameEnd - dollar - 1);
+        Token variable;
+        variable.field = lookupField(name);
+        if (variable.field == FIELD_LITERAL) {
+            error = "unknown access_log variable $" + name;
+            return false;
+        }
+        tokens.push_back(variable);
+        pos = nameEnd;
+    }
+    tokens_.swap(tokens);
+    return true;
+}
+
+// "18/Oct/2026:14:26:17 +0000", once per second
+static const char* timeLocal() {
+    static char formatted[40];
+    static time_t formattedSec = 0;
+    time_t now = ServerClock::now();
+    if (now != formattedSec) {
+        struct tm local;
+        localtime_r(&now, &local);
+        strftime(formatted, sizeof(formatted), "%d/%b/%Y:%H:%M:%S %z", &local);
+        formattedSec = now;
+    }
+    return formatted;
+}
+
+static void span(LogLine& line, long long from, long long to) {
+    if (from && to)
+        line << (to > from ? to - from : 0LL);
+    else
+        line << '-';
+}
+
+static void duration(LogLine& line, long long us) {
+    if (us >= 0)
+        line << us;
+    else
+        line << '-';
+}
+
+static void text(LogLine& line, const std::string* value) {
+    if (value && !value->empty())
+        line << *value;
+    else
+        line << '-';
+}
+
+void AccessLogFormat::render(const AccessLogEntry& e, LogLine& line) const {
+    static const RequestTiming none;
+    const RequestTiming& t = e.timing ? *e.timing : none;
+    for (size_t i = 0; i < tokens_.size(); ++i) {
+        switch (tokens_[i].field) {
+        case FIELD_LITERAL:
+            line << tokens_[i].literal;
+            break;
+        case FIELD_REMOTE_ADDR:
+            line << (e.remoteAddr ? e.remoteAddr : "-");
+            break;
+        case FIELD_TIME_LOCAL:
+            line << timeLocal();
+            break;
+        case FIELD_REQUEST:
+            if (e.request && e.requestLength)
+                line.append(e.request, e.requestLength);
+            else
+                line << '-';
+            break;
+        case FIELD_STATUS:
+            line << e.status;
+            break;
+        case FIELD_BYTES_SENT:
+            line << e.bytesSent;
+            break;
+        case FIELD_REQUEST_LENGTH:
+            line << e.bytesReceived;
+            break;
+        case FIELD_HOST:
+            text(line, e.host);
+            break;
+        case FIELD_SERVER:
+            text(line, e.server);
+            break;
+        case FIELD_LOCATION:
+            text(line, e.location);
+            break;
+        case FIELD_REQUEST_TIME:
+            line << (t.startUs && e.doneUs > t.startUs ? (e.doneUs - t.startUs) / 1e6 : 0.0);
+            break;
+        case FIELD_REQUEST_TIME_US:
+            span(line, t.startUs, e.doneUs);
+            break;
+        case FIELD_HEADER_TIME_US:
+            span(line, t.startUs, t.headersUs);
+            break;
+        case FIELD_BODY_TIME_US:
+            span(line, t.headersUs, t.completeUs);
+            break;
+        case FIELD_PARSE_TIME_US:
+            duration(line, t.startUs ? t.parseUs : -1);
+            break;
+        case FIELD_ROUTE_TIME_US:
+            duration(line, t.routeUs);
+            break;
+        case FIELD_BUILD_TIME_US:
+            duration(line, t.cgiStartUs ? -1 : t.buildUs);
+            break;
+        case FIELD_CGI_TIME_US:
+            span(line, t.cgiStartUs, t.readyUs);
+            break;
+        case FIELD_SEND_TIME_US:
+            span(line, t.readyUs, e.doneUs);
+            break;
+        }
+    }
+}
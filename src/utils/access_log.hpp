@@ -0,0 +1,75 @@
+#ifndef ACCESS_LOG_HPP
+#define ACCESS_LOG_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include "latency_histogram.hpp"
+
+class LogLine;
+
+/* what one finished response contributes to the access_log line */
+struct AccessLogEntry {
+    const char* remoteAddr;
+    const char* request;            // raw request line, not NUL-terminated
+    size_t requestLength;
+    const std::string* host;        // Host header, NULL = none
+    const std::string* server;      // ServerInstance::label()
+    const std::string* location;    // location path, NULL = none matched
+    int status;
+    unsigned long long bytesReceived;
+    unsigned long long bytesSent;
+    const RequestTiming* timing;
+    long long doneUs;               // last byte sent (ServerClock::monotonicUs)
+
+    AccessLogEntry();
+};
+
+/* access_log format, compiled once from the config string
+    - $variables are looked up at compile time, render() only walks the token list
+    - timing variables are microseconds ("-" when the phase wasn't reached),
+      $request_time is seconds with millisecond resolution like nginx
+*/
+class AccessLogFormat {
+public:
+    static const char* const DEFAULT;
+
+    AccessLogFormat();
+
+    bool compile(const std::string& format, std::string& error);
+    void render(const AccessLogEntry& entry, LogLine& line) const;
+
+private:
+    enum Field {
+        FIELD_LITERAL,
+        FIELD_REMOTE_ADDR,
+        FIELD_TIME_LOCAL,
+        FIELD_REQUEST,
+        FIELD_STATUS,
+        FIELD_BYTES_SENT,
+        FIELD_REQUEST_LENGTH,
+        FIELD_HOST,
+        FIELD_SERVER,
+        FIELD_LOCATION,
+        FIELD_REQUEST_TIME,
+        FIELD_REQUEST_TIME_US,
+        FIELD_HEADER_TIME_US,
+        FIELD_BODY_TIME_US,
+        FIELD_PARSE_TIME_US,
+        FIELD_ROUTE_TIME_US,
+        FIELD_BUILD_TIME_US,
+        FIELD_CGI_TIME_US,
+        FIELD_SEND_TIME_US
+    };
+
+    struct Token {
+        Field field;
+        std::string literal;
+    };
+
+    std::vector<Token> tokens_;
+
+    static Field lookupField(const std::string& name);
+};
+
+#endif // ACCESS_LOG_HPP
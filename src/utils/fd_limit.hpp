@@ -0,0 +1,14 @@
+#ifndef FD_LIMIT_HPP
+#define FD_LIMIT_HPP
+
+#include <sys/select.h>
+
+/* the event loop is select() based: an fd_set only holds fds below FD_SETSIZE
+    - FD_SET on a larger fd writes past the set, select() then fails (EBADF) every round
+    - so every fd the loop watches is checked where it is created, and refused there
+*/
+inline bool fitsFdSet(int fd) {
+    return fd >= 0 && fd < FD_SETSIZE;
+}
+
+#endif // FD_LIMIT_HPP
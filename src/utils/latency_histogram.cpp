@@ -0,0 +1,115 @@
+#include "latency_histogram.hpp"
+
+LatencyHistogram::LatencyHistogram() : count_(0), sum_(0), max_(0) {
+}
+
+size_t LatencyHistogram::bucketIndex(long long us) {
+    if (us < 0)
+        us = 0;
+    if (us > MAX_US)
+        us = MAX_US;
+    if (us < SUB_BUCKETS)
+        return static_cast<size_t>(us);
+    int msb = 63 - __builtin_clzll(static_cast<unsigned long long>(us));
+    int shift = msb - SUB_BITS;
+    // (us >> shift) is in [SUB_BUCKETS, 2 * SUB_BUCKETS): the top SUB_BITS + 1 bits
+    return static_cast<size_t>((shift + 1) * SUB_BUCKETS + (us >> shift) - SUB_BUCKETS);
+}
+
+long long LatencyHistogram::bucketUpperBound(size_t index) {
+    long long i = static_cast<long long>(index);
+    if (i < SUB_BUCKETS)
+        return i;
+    int shift = static_cast<int>(i / SUB_BUCKETS) - 1;
+    long long lower = (SUB_BUCKETS + i % SUB_BUCKETS) << shift;
+    return lower + (1LL << shift) - 1;
+}
+
+void LatencyHistogram::record(long long us) {
+    if (us < 0)
+        us = 0; // cached & fresh clock readings mixed across a wake-up
+    if (counts_.empty())
+        counts_.resize(BUCKETS, 0);
+    ++counts_[bucketIndex(us)];
+    ++count_;
+    sum_ += static_cast<unsigned long long>(us);
+    if (us > max_)
+        max_ = us;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    if (other.count_ == 0)
+        return;
+    if (counts_.empty())
+        counts_.resize(BUCKETS, 0);
+    for (size_t i = 0; i < other.counts_.size(); ++i)
+        counts_[i] += other.counts_[i];
+    count_ += other.count_;
+    sum_ += other.sum_;
+    if (other.max_ > max_)
+        max_ = other.max_;
+}
+
+long long LatencyHistogram::percentile(double p) const {
+    if (count_ == 0)
+        return 0;
+    unsigned long long rank = static_cast<unsigned long long>(p / 100.0 * count_ + 0.5);
+    if (rank < 1)
+        rank = 1;
+    if (rank > count_)
+        rank = count_;
+    unsigned long long seen = 0;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        seen += counts_[i];
+        if (seen >= rank) {
+            long long bound = bucketUpperBound(i);
+            return bound < max_ ? bound : max_;
+        }
+    }
+    return max_;
+}
+
+RequestTiming::RequestTiming() {
+    acceptedUs = 0;
+    reset();
+}
+
+// the accept time belongs to the connection, only its first request gets a first-byte phase
+void RequestTiming::reset() {
+    startUs = 0;
+    headersUs = 0;
+    completeUs = 0;
+    parseUs = 0;
+    routeUs = -1;
+    buildUs = -1;
+    cgiStartUs = 0;
+    readyUs = 0;
+}
+
+const char* PhaseLatency::phaseName(int phase) {
+    static const char* names[PHASE_COUNT] = {
+        "first_byte", "header", "body", "parse", "route", "static", "cgi", "send", "total"
+    };
+    return (phase >= 0 && phase < PHASE_COUNT) ? names[phase] : "unknown";
+}
+
+void PhaseLatency::record(const RequestTiming& t, long long doneUs) {
+    if (t.startUs == 0)
+        return; // nothing was received: not a request
+    if (t.acceptedUs)
+        phases_[PHASE_FIRST_BYTE].record(t.startUs - t.acceptedUs);
+    if (t.headersUs)
+        phases_[PHASE_HEADER].record(t.headersUs - t.startUs);
+    if (t.completeUs && t.headersUs)
+        phases_[PHASE_BODY].record(t.completeUs - t.headersUs);
+    phases_[PHASE_PARSE].record(t.parseUs);
+    if (t.routeUs >= 0)
+        phases_[PHASE_ROUTE].record(t.routeUs);
+    if (t.cgiStartUs && t.readyUs)
+        phases_[PHASE_CGI].record(t.readyUs - t.cgiStartUs);
+    else if (t.buildUs >= 0)
+        phases_[PHASE_STATIC].record(t.buildUs);
+    if (t.readyUs)
+        phases_[PHASE_SEND].record(doneUs - t.readyUs);
+    phases_[PHASE_TOTAL].record(doneUs - t.startUs);
+}
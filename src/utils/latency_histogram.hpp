@@ -0,0 +1,88 @@
+#ifndef LATENCY_HISTOGRAM_HPP
+#define LATENCY_HISTOGRAM_HPP
+
+#include <cstddef>
+#include <vector>
+
+/* HDR-style log-linear histogram of microsecond latencies
+    - values below SUB_BUCKETS are exact, above that every power of two is split
+      into SUB_BUCKETS linear buckets: relative error stays under 1/SUB_BUCKETS (6%)
+    - recording is an index computation and an increment, no allocation after the first value
+    - values past MAX_US land in the last bucket, the exact max is kept aside
+*/
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 4;
+    static const long long SUB_BUCKETS = 1LL << SUB_BITS;
+    static const int MAX_BITS = 38;                     // ~76 hours in microseconds
+    static const long long MAX_US = (1LL << MAX_BITS) - 1;
+    static const size_t BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+    LatencyHistogram();
+
+    void record(long long us);
+    void merge(const LatencyHistogram& other);
+
+    unsigned long long count() const { return count_; }
+    unsigned long long sumUs() const { return sum_; }
+    long long maxUs() const { return max_; }
+    long long percentile(double p) const;   // p in [0, 100], upper bound of the bucket holding it
+
+    static size_t bucketIndex(long long us);
+    static long long bucketUpperBound(size_t index);
+
+private:
+    std::vector<unsigned long long> counts_; // BUCKETS entries once the first value is recorded
+    unsigned long long count_;
+    unsigned long long sum_;
+    long long max_;
+};
+
+/* request phases, each timed on its own histogram
+    - I/O phases (first byte, header, body, send) use the cached per-wake-up clock:
+      they can only end on a wake-up anyway
+    - CPU phases (parse, route, build) take a fresh clock reading around the work
+*/
+enum LatencyPhase {
+    PHASE_FIRST_BYTE,   // accept -> first request byte (first request of a connection)
+    PHASE_HEADER,       // first byte -> end of the header block
+    PHASE_BODY,         // end of headers -> request complete
+    PHASE_PARSE,        // isRequestComplete + parseRequest + validateRequest
+    PHASE_ROUTE,        // findServerByHost + findMatchingLocation
+    PHASE_STATIC,       // response built in place (files, listings, errors, redirects)
+    PHASE_CGI,          // CGI dispatched -> response ready (queue wait included)
+    PHASE_SEND,         // response ready -> last byte handed to the kernel
+    PHASE_TOTAL,        // first byte -> last byte
+    PHASE_COUNT
+};
+
+/* timestamps of the request in progress, kept on the connection
+    - 0 = the point wasn't reached; reset for every request of a keep-alive connection
+*/
+struct RequestTiming {
+    long long acceptedUs;   // connection accepted (only set for its first request)
+    long long startUs;      // first byte of this request
+    long long headersUs;    // header block complete
+    long long completeUs;   // whole request received
+    long long parseUs;      // accumulated parsing time
+    long long routeUs;
+    long long buildUs;      // in-place response build time
+    long long cgiStartUs;   // CGI dispatched, 0 = not a CGI response
+    long long readyUs;      // response ready to send
+
+    RequestTiming();
+    void reset();
+};
+
+class PhaseLatency {
+public:
+    static const char* phaseName(int phase);
+
+    void record(const RequestTiming& timing, long long doneUs);  // one finished request
+    const LatencyHistogram& phase(int phase) const { return phases_[phase]; }
+
+private:
+    LatencyHistogram phases_[PHASE_COUNT];
+};
+
+#endif // LATENCY_HISTOGRAM_HPP
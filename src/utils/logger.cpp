@@ -0,0 +1,342 @@
+#include "logger.hpp"
+#include "server_clock.hpp"
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+/* ---------------------------------------------------------------- LogRing */
+
+static const size_t RECORD_HEADER = 5; // [length:4][sink:1]
+
+LogRing::LogRing(size_t capacity) : head_(0), tail_(0) {
+    size_t size = 4096;
+    while (size < capacity)
+        size <<= 1;
+    data_ = new char[size];
+    mask_ = size - 1;
+}
+
+LogRing::~LogRing() {
+    delete[] data_;
+}
+
+void LogRing::copyIn(size_t at, const void* from, size_t length) {
+    size_t offset = at & mask_;
+    size_t first = mask_ + 1 - offset;
+    if (first > length)
+        first = length;
+    std::memcpy(data_ + offset, from, first);
+    std::memcpy(data_, static_cast<const char*>(from) + first, length - first);
+}
+
+void LogRing::copyOut(size_t at, void* to, size_t length) const {
+    size_t offset = at & mask_;
+    size_t first = mask_ + 1 - offset;
+    if (first > length)
+        first = length;
+    std::memcpy(to, data_ + offset, first);
+    std::memcpy(static_cast<char*>(to) + first, data_, length - first);
+}
+
+bool LogRing::push(LogSink sink, const char* data, size_t length) {
+    size_t tail = __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+    if (head_ - tail + RECORD_HEADER + length > mask_ + 1)
+        return false;
+    unsigned int size = static_cast<unsigned int>(length);
+    unsigned char target = static_cast<unsigned char>(sink);
+    copyIn(head_, &size, 4);
+    copyIn(head_ + 4, &target, 1);
+    copyIn(head_ + RECORD_HEADER, data, length);
+    __atomic_store_n(&head_, head_ + RECORD_HEADER + length, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool LogRing::pop(LogSink& sink, char* data, size_t& length, size_t maxLength) {
+    size_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+    if (head == tail_)
+        return false;
+    unsigned int size = 0;
+    unsigned char target = 0;
+    copyOut(tail_, &size, 4);
+    copyOut(tail_ + 4, &target, 1);
+    length = size < maxLength ? size : maxLength;
+    copyOut(tail_ + RECORD_HEADER, data, length);
+    sink = static_cast<LogSink>(target);
+    __atomic_store_n(&tail_, tail_ + RECORD_HEADER + size, __ATOMIC_RELEASE);
+    return true;
+}
+
+/* ---------------------------------------------------------------- Logger */
+
+LogLevel Logger::level_ = LOG_LEVEL_INFO;
+int Logger::errorFd_ = STDERR_FILENO;
+int Logger::accessFd_ = -1;
+bool Logger::running_ = false;
+int Logger::stopping_ = 0;
+pthread_t Logger::writer_;
+pthread_mutex_t Logger::ringsLock_ = PTHREAD_MUTEX_INITIALIZER;
+LogRing* Logger::rings_[64];
+int Logger::ringCount_ = 0;
+int Logger::generation_ = 0;
+unsigned long long Logger::dropped_ = 0;
+
+static __thread LogRing* threadRing = NULL;
+static __thread int threadRingGeneration = -1;
+
+int Logger::openLog(const std::string& path) {
+    if (path == "stderr")
+        return STDERR_FILENO;
+    if (path == "stdout")
+        return STDOUT_FILENO;
+    return open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+}
+
+bool Logger::start(const std::string& errorLog, LogLevel level, const std::string& accessLog) {
+    stop();
+    level_ = level;
+    int errorFd = openLog(errorLog.empty() ? std::string("stderr") : errorLog);
+    int accessFd = (accessLog.empty() || accessLog == "off") ? -1 : openLog(accessLog);
+    if (errorFd == -1 || (accessFd == -1 && !accessLog.empty() && accessLog != "off")) {
+        int err = errno;
+        if (errorFd > STDERR_FILENO)
+            close(errorFd);
+        std::fprintf(stderr, "❌ Logger: cannot open %s: %s\n",
+                     errorFd == -1 ? errorLog.c_str() : accessLog.c_str(), std::strerror(err));
+        return false;
+    }
+    errorFd_ = errorFd;
+    accessFd_ = accessFd;
+
+    __atomic_store_n(&stopping_, 0, __ATOMIC_RELEASE);
+    if (pthread_create(&writer_, NULL, writerMain, NULL) != 0) {
+        std::fprintf(stderr, "❌ Logger: cannot start the writer thread, logging synchronously\n");
+        return true;
+    }
+    running_ = true;
+    return true;
+}
+
+void Logger::stop() {
+    if (running_) {
+        __atomic_store_n(&stopping_, 1, __ATOMIC_RELEASE);
+        pthread_join(writer_, NULL);
+        running_ = false;
+        pthread_mutex_lock(&ringsLock_);
+        for (int i = 0; i < ringCount_; ++i)
+            delete rings_[i];
+        ringCount_ = 0;
+        ++generation_;
+        pthread_mutex_unlock(&ringsLock_);
+    }
+    if (errorFd_ > STDERR_FILENO)
+        close(errorFd_);
+    if (accessFd_ > STDERR_FILENO)
+        close(accessFd_);
+    errorFd_ = STDERR_FILENO;
+    accessFd_ = -1;
+}
+
+bool Logger::parseLevel(const std::string& name, LogLevel& level) {
+    if (name == "debug")
+        level = LOG_LEVEL_DEBUG;
+    else if (name == "info")
+        level = LOG_LEVEL_INFO;
+    else if (name == "warn")
+        level = LOG_LEVEL_WARN;
+    else if (name == "error")
+        level = LOG_LEVEL_ERROR;
+    else
+        return false;
+    return true;
+}
+
+const char* Logger::levelName(LogLevel level) {
+    static const char* names[] = { "debug", "info", "warn", "error" };
+    return (level >= LOG_LEVEL_DEBUG && level <= LOG_LEVEL_ERROR) ? names[level] : "unknown";
+}
+
+unsigned long long Logger::dropped() {
+    return __atomic_load_n(&dropped_, __ATOMIC_RELAXED);
+}
+
+// the ring is created on the first line a thread logs; the lock is only taken then
+LogRing* Logger::localRing() {
+    if (threadRing && threadRingGeneration == generation_)
+        return threadRing;
+    threadRing = NULL;
+    pthread_mutex_lock(&ringsLock_);
+    if (ringCount_ < static_cast<int>(sizeof(rings_) / sizeof(rings_[0]))) {
+        threadRing = new LogRing(RING_SIZE);
+        rings_[ringCount_] = threadRing;
+        __atomic_store_n(&ringCount_, ringCount_ + 1, __ATOMIC_RELEASE);
+        threadRingGeneration = generation_;
+    }
+    pthread_mutex_unlock(&ringsLock_);
+    return threadRing;
+}
+
+void Logger::write(LogSink sink, const char* data, size_t length) {
+    if (running_) {
+        LogRing* ring = localRing();
+        if (ring) {
+            if (!ring->push(sink, data, length))
+                __atomic_add_fetch(&dropped_, 1, __ATOMIC_RELAXED); // never block the caller
+            return;
+        }
+    }
+    int fd = sink == LOG_SINK_ACCESS ? accessFd_ : errorFd_;
+    if (fd != -1)
+        writeAll(fd, data, length);
+}
+
+void Logger::writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = ::write(fd, data, length);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return; // nowhere left to report it
+        data += written;
+        length -= written;
+    }
+}
+
+/* one pass over every ring: lines are batched per sink, one write() per batch */
+size_t Logger::drain() {
+    static char batch[2][64 * 1024];
+    size_t used[2] = { 0, 0 };
+    int fds[2] = { errorFd_, accessFd_ };
+    char line[MAX_LINE];
+    size_t lines = 0;
+
+    int count = __atomic_load_n(&ringCount_, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < count; ++i) {
+        LogSink sink;
+        size_t length;
+        while (rings_[i]->pop(sink, line, length, sizeof(line))) {
+            int s = sink == LOG_SINK_ACCESS ? 1 : 0;
+            if (used[s] + length > sizeof(batch[s])) {
+                if (fds[s] != -1)
+                    writeAll(fds[s], batch[s], used[s]);
+                used[s] = 0;
+            }
+            std::memcpy(batch[s] + used[s], line, length);
+            used[s] += length;
+            ++lines;
+        }
+    }
+    for (int s = 0; s < 2; ++s) {
+        if (used[s] && fds[s] != -1)
+            writeAll(fds[s], batch[s], used[s]);
+    }
+    return lines;
+}
+
+void* Logger::writerMain(void* arg) {
+    (void)arg;
+    while (true) {
+        bool stopping = __atomic_load_n(&stopping_, __ATOMIC_ACQUIRE) != 0;
+        size_t lines = drain();
+        if (stopping && lines == 0)
+            break;
+        if (lines == 0) {
+            struct timespec pause = { 0, 10 * 1000 * 1000 }; // 10 ms between idle passes
+            nanosleep(&pause, NULL);
+        }
+    }
+    return NULL;
+}
+
+/* ---------------------------------------------------------------- LogLine */
+
+// "2026/10/18 14:26:17 ", re-formatted once per second per thread
+static const char* logTime() {
+    static __thread char formatted[32];
+    static __thread time_t formattedSec = 0;
+    time_t now = ServerClock::now();
+    if (now != formattedSec) {
+        struct tm local;
+        localtime_r(&now, &local);
+        strftime(formatted, sizeof(formatted), "%Y/%m/%d %H:%M:%S ", &local);
+        formattedSec = now;
+    }
+    return formatted;
+}
+
+LogLine::LogLine(LogLevel level) : length_(0), sink_(LOG_SINK_ERROR) {
+    *this << logTime() << '[' << Logger::levelName(level) << "] ";
+}
+
+LogLine::LogLine(LogSink sink) : length_(0), sink_(sink) {
+}
+
+LogLine::~LogLine() {
+    if (length_ == sizeof(buffer_))
+        --length_; // truncated: keep room for the line feed
+    buffer_[length_++] = '\n';
+    Logger::write(sink_, buffer_, length_);
+}
+
+void LogLine::append(const char* data, size_t length) {
+    size_t room = sizeof(buffer_) - length_;
+    if (length > room)
+        length = room;
+    std::memcpy(buffer_ + length_, data, length);
+    length_ += length;
+}
+
+LogLine& LogLine::operator<<(const char* text) {
+    if (text)
+        append(text, std::strlen(text));
+    return *this;
+}
+
+LogLine& LogLine::operator<<(const std::string& text) {
+    append(text.data(), text.size());
+    return *this;
+}
+
+LogLine& LogLine::operator<<(char c) {
+    append(&c, 1);
+    return *this;
+}
+
+LogLine& LogLine::operator<<(int value) {
+    return *this << static_cast<long long>(value);
+}
+
+LogLine& LogLine::operator<<(unsigned int value) {
+    return *this << static_cast<unsigned long long>(value);
+}
+
+LogLine& LogLine::operator<<(long value) {
+    return *this << static_cast<long long>(value);
+}
+
+LogLine& LogLine::operator<<(unsigned long value) {
+    return *this << static_cast<unsigned long long>(value);
+}
+
+LogLine& LogLine::operator<<(long long value) {
+    char digits[32];
+    int length = std::snprintf(digits, sizeof(digits), "%lld", value);
+    append(digits, static_cast<size_t>(length));
+    return *this;
+}
+
+LogLine& LogLine::operator<<(unsigned long long value) {
+    char digits[32];
+    int length = std::snprintf(digits, sizeof(digits), "%llu", value);
+    append(digits, static_cast<size_t>(length));
+    return *this;
+}
+
+LogLine& LogLine::operator<<(double value) {
+    char digits[64];
+    int length = std::snprintf(digits, sizeof(digits), "%.3f", value);
+    append(digits, static_cast<size_t>(length));
+    return *this;
+}
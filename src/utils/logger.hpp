@@ -0,0 +1,140 @@
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include <string>
+#include <cstddef>
+#include <pthread.h>
+
+enum LogLevel {
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR
+};
+
+enum LogSink {
+    LOG_SINK_ERROR,     // error_log: leveled messages
+    LOG_SINK_ACCESS     // access_log: one line per response
+};
+
+/* single-producer single-consumer byte ring
+    - one per logging thread: the owner appends, the writer thread drains
+    - records are [length:4][sink:1][bytes], copied around the wrap point
+    - head_ & tail_ only grow, published with release/acquire so neither side locks
+    - a full ring drops the record instead of blocking the event loop
+*/
+class LogRing {
+public:
+    explicit LogRing(size_t capacity);  // rounded up to a power of two
+    ~LogRing();
+
+    bool push(LogSink sink, const char* data, size_t length);   // owner thread
+    bool pop(LogSink& sink, char* data, size_t& length, size_t maxLength); // writer thread
+
+private:
+    char* data_;
+    size_t mask_;
+    size_t head_;   // next byte the owner writes
+    size_t tail_;   // next byte the writer reads
+
+    void copyIn(size_t at, const void* from, size_t length);
+    void copyOut(size_t at, void* to, size_t length) const;
+
+    LogRing(const LogRing&);
+    LogRing& operator=(const LogRing&);
+};
+
+/* asynchronous logger
+    - LOG_* macros format into a fixed buffer on the caller's stack, no allocation
+    - lines go to the calling thread's LogRing, a background thread writes them out in batches
+    - before start() (and after stop()) lines are written synchronously, so startup errors show
+    - LOG_DEBUG compiles to nothing under NDEBUG (release build)
+*/
+class Logger {
+public:
+    static const size_t RING_SIZE = 1024 * 1024;
+    static const size_t MAX_LINE = 2048;
+
+    // error_log path ("stderr" / "stdout" or a file), access_log path ("" = off)
+    static bool start(const std::string& errorLog, LogLevel level, const std::string& accessLog);
+    static void stop();     // drain everything, join the writer, close the files
+
+    static bool enabled(LogLevel level) { return level >= level_; }
+    static bool accessEnabled() { return accessFd_ != -1; }
+    static void setLevel(LogLevel level) { level_ = level; }
+    static bool parseLevel(const std::string& name, LogLevel& level);
+    static const char* levelName(LogLevel level);
+    static unsigned long long dropped();
+
+    static void write(LogSink sink, const char* data, size_t length);
+
+private:
+    static LogLevel level_;
+    static int errorFd_;
+    static int accessFd_;
+    static bool running_;
+    static int stopping_;
+    static pthread_t writer_;
+    static pthread_mutex_t ringsLock_;  // registration only, never taken per line
+    static LogRing* rings_[64];
+    static int ringCount_;
+    static int generation_;             // bumped by stop(): thread-local rings of a previous run are gone
+    static unsigned long long dropped_;
+
+    static LogRing* localRing();
+    static void* writerMain(void* arg);
+    static size_t drain();
+    static void writeAll(int fd, const char* data, size_t length);
+    static int openLog(const std::string& path);
+
+    Logger();
+};
+
+/* one log line, formatted in place and handed to the logger when the statement ends */
+class LogLine {
+public:
+    explicit LogLine(LogLevel level);
+    explicit LogLine(LogSink sink); // raw line for access_log
+    ~LogLine();
+
+    LogLine& operator<<(const char* text);
+    LogLine& operator<<(const std::string& text);
+    LogLine& operator<<(char c);
+    LogLine& operator<<(int value);
+    LogLine& operator<<(unsigned int value);
+    LogLine& operator<<(long value);
+    LogLine& operator<<(unsigned long value);
+    LogLine& operator<<(long long value);
+    LogLine& operator<<(unsigned long long value);
+    LogLine& operator<<(double value);
+
+    void append(const char* data, size_t length);
+
+private:
+    char buffer_[Logger::MAX_LINE];
+    size_t length_;
+    LogSink sink_;
+
+    LogLine(const LogLine&);
+    LogLine& operator=(const LogLine&);
+};
+
+// turns "LogLine << ..." into a void expression for the ?: in the macros
+struct LogVoidify {
+    void operator&(const LogLine&) {}
+};
+
+// expression form: the arguments are not evaluated when the level is off,
+// and the macro is safe inside an unbraced if/else
+#define LOG_AT(level) !Logger::enabled(level) ? (void)0 : LogVoidify() & LogLine(level)
+#define LOG_INFO LOG_AT(LOG_LEVEL_INFO)
+#define LOG_WARN LOG_AT(LOG_LEVEL_WARN)
+#define LOG_ERROR LOG_AT(LOG_LEVEL_ERROR)
+#ifdef NDEBUG
+# define LOG_DEBUG true ? (void)0 : LogVoidify() & LogLine(LOG_LEVEL_DEBUG)
+#else
+# define LOG_DEBUG LOG_AT(LOG_LEVEL_DEBUG)
+#endif
+#define LOG_ACCESS !Logger::accessEnabled() ? (void)0 : LogVoidify() & LogLine(LOG_SINK_ACCESS)
+
+#endif // LOGGER_HPP
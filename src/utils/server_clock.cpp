@@ -0,0 +1,101 @@
+#include "server_clock.hpp"
+#include <sys/time.h>
+#include <cstdio>
+#include <cstring>
+
+time_t ServerClock::wall_sec_ = 0;
+time_t ServerClock::mono_sec_ = 0;
+long long ServerClock::mono_ms_ = 0;
+long long ServerClock::mono_us_ = 0;
+time_t ServerClock::date_sec_ = 0;
+std::string ServerClock::http_date_;
+
+/* read both clocks once; strftime only runs when the second has changed */
+void ServerClock::update() {
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_REALTIME, &ts) == 0)
+        wall_sec_ = ts.tv_sec;
+    else
+        wall_sec_ = time(NULL);
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+        mono_sec_ = ts.tv_sec;
+        mono_us_ = static_cast<long long>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+        mono_ms_ = mono_us_ / 1000;
+    }
+
+    if (wall_sec_ != date_sec_ || http_date_.empty()) {
+        http_date_ = formatHttpDate(wall_sec_);
+        date_sec_ = wall_sec_;
+    }
+}
+
+std::string ServerClock::formatHttpDate(time_t when) {
+    struct tm gmt;
+    char buffer[64];
+    gmtime_r(&when, &gmt);
+    strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &gmt);
+    return buffer;
+}
+
+// lazy first update for code running outside the event loop (tests, tools)
+time_t ServerClock::now() {
+    if (wall_sec_ == 0)
+        update();
+    return wall_sec_;
+}
+
+time_t ServerClock::monotonic() {
+    if (wall_sec_ == 0)
+        update();
+    return mono_sec_;
+}
+
+long long ServerClock::monotonicMs() {
+    if (wall_sec_ == 0)
+        update();
+    return mono_ms_;
+}
+
+long long ServerClock::monotonicUs() {
+    if (wall_sec_ == 0)
+        update();
+    return mono_us_;
+}
+
+// not cached: measures work done between two wake-ups
+long long ServerClock::preciseUs() {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+        return monotonicMs() * 1000;
+    return static_cast<long long>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+const std::string& ServerClock::httpDate() {
+    if (wall_sec_ == 0)
+        update();
+    return http_date_;
+}
+
+/* "Sun, 06 Nov 1994 08:49:37 GMT" only: the format every current server sends (RFC 7231 7.1.1.1) */
+time_t ServerClock::parseHttpDate(const std::string& date) {
+    static const char* months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+    char weekday[4], month[4], zone[4];
+    struct tm gmt;
+    std::memset(&gmt, 0, sizeof(gmt));
+    if (std::sscanf(date.c_str(), "%3s, %d %3s %d %d:%d:%d %3s", weekday, &gmt.tm_mday, month,
+                    &gmt.tm_year, &gmt.tm_hour, &gmt.tm_min, &gmt.tm_sec, zone) != 8
+        || std::strcmp(zone, "GMT") != 0)
+        return -1;
+    gmt.tm_mon = -1;
+    for (int i = 0; i < 12; ++i) {
+        if (std::strcmp(month, months[i]) == 0)
+            gmt.tm_mon = i;
+    }
+    if (gmt.tm_mon < 0 || gmt.tm_mday < 1 || gmt.tm_mday > 31 || gmt.tm_year < 1970)
+        return -1;
+    gmt.tm_year -= 1900;
+    return timegm(&gmt);
+}
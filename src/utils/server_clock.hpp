@@ -0,0 +1,36 @@
+#ifndef SERVER_CLOCK_HPP
+#define SERVER_CLOCK_HPP
+
+#include <string>
+#include <ctime>
+
+/* loop-level clock shared by the whole server
+    - update() is called by the event loop once per select() wake-up
+    - connection, timeout & logging code read the cached values instead of calling time()
+    - the RFC 7231 Date string is only re-formatted when the wall second changes
+*/
+class ServerClock {
+private:
+    static time_t wall_sec_;        // cached wall clock (seconds since epoch)
+    static time_t mono_sec_;        // cached monotonic clock (seconds)
+    static long long mono_ms_;      // cached monotonic clock (milliseconds)
+    static long long mono_us_;      // cached monotonic clock (microseconds)
+    static time_t date_sec_;        // wall second the cached Date string belongs to
+    static std::string http_date_;  // preformatted "Sun, 06 Nov 1994 08:49:37 GMT"
+
+    ServerClock();
+
+public:
+    static void update();           // refresh cached time, re-format Date if needed
+
+    static time_t now();            // wall time, for Date/Last-Modified & logs
+    static time_t monotonic();      // monotonic seconds, for idle/CGI timeouts
+    static long long monotonicMs(); // monotonic milliseconds, for finer timings
+    static long long monotonicUs(); // monotonic microseconds of the wake-up, for request phase timestamps
+    static long long preciseUs();   // fresh (uncached) monotonic microseconds, for loop timing
+    static const std::string& httpDate();
+    static time_t parseHttpDate(const std::string& date); // IMF-fixdate -> epoch, -1 if invalid
+    static std::string formatHttpDate(time_t when);       // epoch -> IMF-fixdate (Last-Modified)
+};
+
+#endif // SERVER_CLOCK_HPP
@@ -0,0 +1,24 @@
+#include "server_stats.hpp"
+
+ServerStats::Cgi ServerStats::cgi = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+ServerStats::Http ServerStats::http = { 0, 0, 0, 0, 0, { 0 } };
+ServerStats::Loop ServerStats::loop = { 0, 0, 0, 0 };
+
+void ServerStats::countResponse(int statusCode) {
+    ++http.requests;
+    ++http.status[(statusCode >= 100 && statusCode < MAX_STATUS) ? statusCode : 0];
+}
+
+void ServerStats::countIteration(long long busyUs) {
+    ++loop.iterations;
+    loop.busyUsTotal += static_cast<unsigned long long>(busyUs);
+    if (busyUs > loop.busyUsMax)
+        loop.busyUsMax = busyUs;
+}
+
+void ServerStats::countSpawn(long long spawnUs) {
+    ++cgi.spawns;
+    cgi.spawnUsTotal += static_cast<unsigned long long>(spawnUs);
+    if (spawnUs > cgi.spawnUsMax)
+        cgi.spawnUsMax = spawnUs;
+}
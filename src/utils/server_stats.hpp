@@ -0,0 +1,61 @@
+#ifndef SERVER_STATS_HPP
+#define SERVER_STATS_HPP
+
+#include <cstddef>
+
+/* server-wide counters
+    - plain integers: the whole server runs in one select() loop, nothing to lock
+    - gauges (active, queued) go up and down, totals only ever grow
+    - written where the event happens, read by whoever reports them (stub_status)
+*/
+class ServerStats {
+public:
+    struct Cgi {
+        size_t active;                      // CGI jobs running (process, FastCGI or worker)
+        size_t queued;                      // requests waiting for a cgi_max_concurrent slot
+        unsigned long long queuedTotal;     // requests that had to wait
+        unsigned long long rejected;        // 503: queue full
+        unsigned long long queueTimeouts;   // 503: waited longer than the queue timeout
+        unsigned long long queueWaitMsTotal;
+        long long queueWaitMsMax;
+        size_t outputBuffered;              // CGI output held in memory (cgi_output_buffer)
+        unsigned long long outputSpilled;   // CGI output bytes written to temp files
+        unsigned long long outputSpills;    // responses that spilled to a temp file
+        unsigned long long spawns;          // CGI processes started (posix_spawn, not workers)
+        unsigned long long spawnUsTotal;    // loop time in posix_spawn: blocked until the child execs
+        long long spawnUsMax;
+        unsigned long long pipeIn;          // bytes written to CGI stdin (processes & workers)
+        unsigned long long pipeOut;         // bytes read or spliced from CGI stdout
+    };
+
+    static const int MAX_STATUS = 600;      // status codes 100-599, anything else counts as 0
+
+    struct Http {
+        unsigned long long accepted;        // connections accepted
+        unsigned long long handled;         // accepted and set up (not dropped right away)
+        unsigned long long requests;        // responses started
+        unsigned long long bytesIn;         // bytes received from clients
+        unsigned long long bytesOut;        // bytes sent to clients (headers, bodies, streams)
+        unsigned long long status[MAX_STATUS];
+    };
+
+    struct Loop {
+        long long startedMs;                // monotonic ms when the event loop started
+        unsigned long long iterations;      // select() wake-ups
+        unsigned long long busyUsTotal;     // fd set setup + event handling, select() wait excluded
+        long long busyUsMax;                // longest single iteration
+    };
+
+    static Cgi cgi;
+    static Http http;
+    static Loop loop;
+
+    static void countResponse(int statusCode);
+    static void countIteration(long long busyUs);
+    static void countSpawn(long long spawnUs);
+
+private:
+    ServerStats();
+};
+
+#endif // SERVER_STATS_HPP
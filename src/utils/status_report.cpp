@@ -0,0 +1,196 @@
+#include "status_report.hpp"
+#include "server_stats.hpp"
+#include <sstream>
+#include <iomanip>
+
+const char* const StatusReport::PROMETHEUS_CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8";
+
+StatusSnapshot::StatusSnapshot()
+    : active(0), reading(0), writing(0), waiting(0),
+      cacheHits(0), cacheStaleHits(0), cacheMisses(0), cacheEntries(0), cacheBytes(0) {
+}
+
+// fresh and stale hits both avoid running the CGI
+static double cacheHitRatio(const StatusSnapshot& s) {
+    size_t lookups = s.cacheHits + s.cacheStaleHits + s.cacheMisses;
+    return lookups ? static_cast<double>(s.cacheHits + s.cacheStaleHits) / lookups : 0.0;
+}
+
+static double uptimeSeconds(long long nowMs) {
+    long long started = ServerStats::loop.startedMs;
+    return (started && nowMs > started) ? (nowMs - started) / 1000.0 : 0.0;
+}
+
+std::string StatusReport::text(const StatusSnapshot& s, long long nowMs) {
+    const ServerStats::Http& http = ServerStats::http;
+    const ServerStats::Cgi& cgi = ServerStats::cgi;
+    const ServerStats::Loop& loop = ServerStats::loop;
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+
+    out << "Active connections: " << s.active << " \n"
+        << "server accepts handled requests\n"
+        << " " << http.accepted << " " << http.handled << " " << http.requests << " \n"
+        << "Reading: " << s.reading << " Writing: " << s.writing << " Waiting: " << s.waiting << " \n";
+
+    out << "Uptime: " << uptimeSeconds(nowMs) << " s\n"
+        << "Bytes: in " << http.bytesIn << " out " << http.bytesOut << "\n"
+        << "Responses:";
+    for (int code = 0; code < ServerStats::MAX_STATUS; ++code) {
+        if (http.status[code])
+            out << " " << code << "=" << http.status[code];
+    }
+    out << "\n";
+
+    out << "CGI: active " << cgi.active << " queued " << cgi.queued
+        << " queued_total " << cgi.queuedTotal << " rejected " << cgi.rejected
+        << " queue_timeouts " << cgi.queueTimeouts
+        << " output_buffered " << cgi.outputBuffered << " output_spilled " << cgi.outputSpilled << "\n";
+    unsigned long long spawnAvg = cgi.spawns ? cgi.spawnUsTotal / cgi.spawns : 0;
+    out << "CGI spawns: " << cgi.spawns << " spawn_avg_us " << spawnAvg << " spawn_max_us " << cgi.spawnUsMax
+        << " pipe_in " << cgi.pipeIn << " pipe_out " << cgi.pipeOut << "\n";
+
+    out << "Cache: hits " << s.cacheHits << " stale " << s.cacheStaleHits << " misses " << s.cacheMisses
+        << " hit_ratio " << cacheHitRatio(s)
+        << " entries " << s.cacheEntries << " bytes " << s.cacheBytes << "\n";
+
+    unsigned long long avg = loop.iterations ? loop.busyUsTotal / loop.iterations : 0;
+    out << "Event loop: iterations " << loop.iterations
+        << " busy_avg_us " << avg << " busy_max_us " << loop.busyUsMax << "\n";
+    out << latency(s);
+    return out.str();
+}
+
+std::string StatusReport::latency(const StatusSnapshot& s) {
+    std::ostringstream out;
+    out << "Latency (us): server location phase count p50 p90 p99 max\n";
+    for (size_t i = 0; i < s.latency.size(); ++i) {
+        const LatencyTarget& target = s.latency[i];
+        for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+            const LatencyHistogram& h = target.phases->phase(phase);
+            if (h.count() == 0)
+                continue;
+            out << " " << target.server << " " << (target.location.empty() ? "-" : target.location)
+                << " " << PhaseLatency::phaseName(phase) << " " << h.count()
+                << " " << h.percentile(50) << " " << h.percentile(90) << " " << h.percentile(99)
+                << " " << h.maxUs() << "\n";
+        }
+    }
+    return out.str();
+}
+
+// label values: backslash, double quote & line feed must be escaped
+static std::string labelValue(const std::string& value) {
+    std::string escaped;
+    for (size_t i = 0; i < value.size(); ++i) {
+        if (value[i] == '\\' || value[i] == '"')
+            escaped += '\\';
+        if (value[i] == '\n')
+            escaped += "\\n";
+        else
+            escaped += value[i];
+    }
+    return escaped;
+}
+
+static void metric(std::ostringstream& out, const char* name, const char* type, const char* help) {
+    out << "# HELP " << name << " " << help << "\n"
+        << "# TYPE " << name << " " << type << "\n";
+}
+
+std::string StatusReport::prometheus(const StatusSnapshot& s, long long nowMs) {
+    const ServerStats::Http& http = ServerStats::http;
+    const ServerStats::Cgi& cgi = ServerStats::cgi;
+    const ServerStats::Loop& loop = ServerStats::loop;
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(6);
+
+    metric(out, "webserv_uptime_seconds", "gauge", "Time since the event loop started.");
+    out << "webserv_uptime_seconds " << uptimeSeconds(nowMs) << "\n";
+
+    metric(out, "webserv_connections", "gauge", "Client connections by state.");
+    out << "webserv_connections{state=\"active\"} " << s.active << "\n"
+        << "webserv_connections{state=\"reading\"} " << s.reading << "\n"
+        << "webserv_connections{state=\"writing\"} " << s.writing << "\n"
+        << "webserv_connections{state=\"waiting\"} " << s.waiting << "\n";
+
+    metric(out, "webserv_connections_accepted_total", "counter", "Client connections accepted.");
+    out << "webserv_connections_accepted_total " << http.accepted << "\n";
+    metric(out, "webserv_connections_handled_total", "counter", "Client connections set up after accept.");
+    out << "webserv_connections_handled_total " << http.handled << "\n";
+    metric(out, "webserv_requests_total", "counter", "Responses started.");
+    out << "webserv_requests_total " << http.requests << "\n";
+
+    metric(out, "webserv_responses_total", "counter", "Responses by status code.");
+    for (int code = 0; code < ServerStats::MAX_STATUS; ++code) {
+        if (http.status[code])
+            out << "webserv_responses_total{code=\"" << code << "\"} " << http.status[code] << "\n";
+    }
+
+    metric(out, "webserv_received_bytes_total", "counter", "Bytes received from clients.");
+    out << "webserv_received_bytes_total " << http.bytesIn << "\n";
+    metric(out, "webserv_sent_bytes_total", "counter", "Bytes sent to clients.");
+    out << "webserv_sent_bytes_total " << http.bytesOut << "\n";
+
+    metric(out, "webserv_cgi_active", "gauge", "CGI jobs running.");
+    out << "webserv_cgi_active " << cgi.active << "\n";
+    metric(out, "webserv_cgi_queued", "gauge", "Requests waiting for a CGI slot.");
+    out << "webserv_cgi_queued " << cgi.queued << "\n";
+    metric(out, "webserv_cgi_queued_total", "counter", "Requests that waited for a CGI slot.");
+    out << "webserv_cgi_queued_total " << cgi.queuedTotal << "\n";
+    metric(out, "webserv_cgi_rejected_total", "counter", "CGI requests answered with 503.");
+    out << "webserv_cgi_rejected_total{reason=\"queue_full\"} " << cgi.rejected << "\n"
+        << "webserv_cgi_rejected_total{reason=\"queue_timeout\"} " << cgi.queueTimeouts << "\n";
+    metric(out, "webserv_cgi_output_buffered_bytes", "gauge", "CGI output held in memory.");
+    out << "webserv_cgi_output_buffered_bytes " << cgi.outputBuffered << "\n";
+    metric(out, "webserv_cgi_output_spilled_bytes_total", "counter", "CGI output written to temp files.");
+    out << "webserv_cgi_output_spilled_bytes_total " << cgi.outputSpilled << "\n";
+    metric(out, "webserv_cgi_spawns_total", "counter", "CGI processes started.");
+    out << "webserv_cgi_spawns_total " << cgi.spawns << "\n";
+    metric(out, "webserv_cgi_spawn_seconds_total", "counter", "Event loop time blocked starting CGI processes.");
+    out << "webserv_cgi_spawn_seconds_total " << cgi.spawnUsTotal / 1e6 << "\n";
+    metric(out, "webserv_cgi_spawn_max_seconds", "gauge", "Longest CGI process start.");
+    out << "webserv_cgi_spawn_max_seconds " << cgi.spawnUsMax / 1e6 << "\n";
+    metric(out, "webserv_cgi_pipe_bytes_total", "counter", "Bytes through CGI stdin/stdout pipes.");
+    out << "webserv_cgi_pipe_bytes_total{direction=\"in\"} " << cgi.pipeIn << "\n"
+        << "webserv_cgi_pipe_bytes_total{direction=\"out\"} " << cgi.pipeOut << "\n";
+
+    metric(out, "webserv_cgi_cache_lookups_total", "counter", "CGI cache lookups by result.");
+    out << "webserv_cgi_cache_lookups_total{result=\"hit\"} " << s.cacheHits << "\n"
+        << "webserv_cgi_cache_lookups_total{result=\"stale\"} " << s.cacheStaleHits << "\n"
+        << "webserv_cgi_cache_lookups_total{result=\"miss\"} " << s.cacheMisses << "\n";
+    metric(out, "webserv_cgi_cache_hit_ratio", "gauge", "Share of CGI cache lookups served from the cache.");
+    out << "webserv_cgi_cache_hit_ratio " << cacheHitRatio(s) << "\n";
+    metric(out, "webserv_cgi_cache_entries", "gauge", "Responses held in the CGI cache.");
+    out << "webserv_cgi_cache_entries " << s.cacheEntries << "\n";
+    metric(out, "webserv_cgi_cache_bytes", "gauge", "Bytes held in the CGI cache.");
+    out << "webserv_cgi_cache_bytes " << s.cacheBytes << "\n";
+
+    metric(out, "webserv_event_loop_iterations_total", "counter", "Event loop wake-ups.");
+    out << "webserv_event_loop_iterations_total " << loop.iterations << "\n";
+    metric(out, "webserv_event_loop_busy_seconds_total", "counter", "Time spent handling events.");
+    out << "webserv_event_loop_busy_seconds_total " << loop.busyUsTotal / 1e6 << "\n";
+    metric(out, "webserv_event_loop_busy_max_seconds", "gauge", "Longest event loop iteration.");
+    out << "webserv_event_loop_busy_max_seconds " << loop.busyUsMax / 1e6 << "\n";
+
+    static const char* quantiles[] = { "0.5", "0.9", "0.99" };
+    static const double percents[] = { 50, 90, 99 };
+    metric(out, "webserv_request_phase_seconds", "summary", "Request latency by server, location and phase.");
+    for (size_t i = 0; i < s.latency.size(); ++i) {
+        const LatencyTarget& target = s.latency[i];
+        std::string labels = "server=\"" + labelValue(target.server) + "\",location=\""
+                           + labelValue(target.location) + "\",phase=\"";
+        for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+            const LatencyHistogram& h = target.phases->phase(phase);
+            if (h.count() == 0)
+                continue;
+            std::string series = labels + PhaseLatency::phaseName(phase) + "\"";
+            for (size_t q = 0; q < 3; ++q)
+                out << "webserv_request_phase_seconds{" << series << ",quantile=\"" << quantiles[q] << "\"} "
+                    << h.percentile(percents[q]) / 1e6 << "\n";
+            out << "webserv_request_phase_seconds_sum{" << series << "} " << h.sumUs() / 1e6 << "\n"
+                << "webserv_request_phase_seconds_count{" << series << "} " << h.count() << "\n";
+        }
+    }
+    return out.str();
+}
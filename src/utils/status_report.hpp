@@ -0,0 +1,49 @@
+#ifndef STATUS_REPORT_HPP
+#define STATUS_REPORT_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include "latency_histogram.hpp"
+
+/* stub_status page
+    - connection states & cache totals are counted by the caller at request time
+    - everything else comes from ServerStats
+    - text: nginx stub_status layout first, so existing scrapers keep working, then the extras
+    - prometheus: text exposition format 0.0.4
+    - latency: one summary per server/location/phase (p50, p90, p99, max)
+*/
+struct LatencyTarget {
+    std::string server;         // ServerInstance::label()
+    std::string location;       // location path, "" = no location matched
+    const PhaseLatency* phases;
+};
+
+struct StatusSnapshot {
+    size_t active;          // open client connections
+    size_t reading;         // request partly received
+    size_t writing;         // response being built (CGI) or sent
+    size_t waiting;         // idle keep-alive, nothing received yet
+    size_t cacheHits;
+    size_t cacheStaleHits;
+    size_t cacheMisses;
+    size_t cacheEntries;
+    size_t cacheBytes;
+    std::vector<LatencyTarget> latency; // targets that served at least one request
+
+    StatusSnapshot();
+};
+
+class StatusReport {
+public:
+    static const char* const PROMETHEUS_CONTENT_TYPE;
+
+    static std::string text(const StatusSnapshot& snapshot, long long nowMs);
+    static std::string prometheus(const StatusSnapshot& snapshot, long long nowMs);
+    static std::string latency(const StatusSnapshot& snapshot); // text table, also the SIGUSR1 dump
+
+private:
+    StatusReport();
+};
+
+#endif // STATUS_REPORT_HPP
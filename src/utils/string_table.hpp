@@ -0,0 +1,111 @@
+#ifndef STRING_TABLE_HPP
+#define STRING_TABLE_HPP
+
+#include <string>
+#include <vector>
+#include <cctype>
+
+/* open-addressing hash table keyed by ASCII case-insensitive strings
+    - built once at startup (config load), read on the hot path
+    - lookups take (pointer, length) so callers can probe a substring
+      of a request field (Host header, file extension) without allocating
+*/
+template <typename T>
+class StringTable {
+private:
+    struct Slot {
+        std::string key;        // stored lowercase
+        T value;
+        unsigned long hash;
+        bool used;
+
+        Slot() : value(), hash(0), used(false) {}
+    };
+
+    std::vector<Slot> slots_;   // size is always a power of two
+    size_t count_;
+
+    static unsigned long hashKey(const char* key, size_t len) {
+        // FNV-1a over the lowercased bytes
+        unsigned long h = 2166136261UL;
+        for (size_t i = 0; i < len; ++i) {
+            h ^= static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(key[i])));
+            h *= 16777619UL;
+        }
+        return h;
+    }
+
+    static bool keyEquals(const std::string& stored, const char* key, size_t len) {
+        if (stored.length() != len)
+            return false;
+        for (size_t i = 0; i < len; ++i) {
+            if (stored[i] != std::tolower(static_cast<unsigned char>(key[i])))
+                return false;
+        }
+        return true;
+    }
+
+    size_t findSlot(const char* key, size_t len, unsigned long hash) const {
+        size_t mask = slots_.size() - 1;
+        size_t i = hash & mask;
+        while (slots_[i].used) {
+            if (slots_[i].hash == hash && keyEquals(slots_[i].key, key, len))
+                return i;
+            i = (i + 1) & mask; // linear probing
+        }
+        return i;
+    }
+
+    void grow() {
+        std::vector<Slot> old;
+        old.swap(slots_);
+        slots_.resize(old.empty() ? 16 : old.size() * 2);
+        count_ = 0;
+        for (size_t i = 0; i < old.size(); ++i) {
+            if (old[i].used)
+                insert(old[i].key, old[i].value);
+        }
+    }
+
+public:
+    StringTable() : count_(0) {}
+
+    // insert or overwrite; keeps load factor under 1/2
+    void insert(const std::string& key, const T& value) {
+        if ((count_ + 1) * 2 > slots_.size())
+            grow();
+        unsigned long hash = hashKey(key.c_str(), key.length());
+        size_t i = findSlot(key.c_str(), key.length(), hash);
+        if (!slots_[i].used) {
+            slots_[i].used = true;
+            slots_[i].hash = hash;
+            slots_[i].key.resize(key.length());
+            for (size_t j = 0; j < key.length(); ++j)
+                slots_[i].key[j] = std::tolower(static_cast<unsigned char>(key[j]));
+            ++count_;
+        }
+        slots_[i].value = value;
+    }
+
+    // NULL if absent
+    const T* find(const char* key, size_t len) const {
+        if (count_ == 0)
+            return NULL;
+        size_t i = findSlot(key, len, hashKey(key, len));
+        return slots_[i].used ? &slots_[i].value : NULL;
+    }
+
+    const T* find(const std::string& key) const {
+        return find(key.c_str(), key.length());
+    }
+
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+    void clear() {
+        slots_.clear();
+        count_ = 0;
+    }
+};
+
+#endif // STRING_TABLE_HPP
@@ -0,0 +1,463 @@
+// CGI throughput & latency by interpreter, request-body and response-size class
+// Build: make bench   Run: make bench-cgi, or tests/bench/load/cgi_bench --help
+#include "load_worker.hpp"
+#include "server_probe.hpp"
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+
+/* a script to run
+    - sized: answers ?bytes=N and reads its whole body (www/<dir>/bench_payload.*),
+      measured over every body x response class
+    - otherwise one of the demo scripts, measured as it is with GETs
+*/
+struct CgiTarget {
+    std::string name;
+    std::string path;
+    bool sized;
+};
+
+struct CgiOptions {
+    BenchOptions load;          // closed loop, one thread
+    std::vector<CgiTarget> targets;
+    std::vector<unsigned long long> bodies;
+    std::vector<unsigned long long> responses;
+    std::vector<int> clients;
+    std::string statusPath;
+    int pid;
+    bool json;
+
+    CgiOptions() : statusPath("/status"), pid(0), json(false) {
+        load.threads = 1;
+        load.durationSec = 2;
+        load.warmupSec = 0.5;
+        load.rate = 0;
+        load.timeoutSec = 10;
+    }
+};
+
+/* one row of the report; server-side values are deltas of stub_status over the whole
+   run (warm-up included), so they are averaged over the server's own counts */
+struct CgiResult {
+    const CgiTarget* target;
+    unsigned long long bodyBytes;
+    unsigned long long responseBytes;
+    int clients;
+    BenchStats stats;
+    double seconds;         // wall time of the run
+    double spawns;
+    double spawnSeconds;
+    double pipeBytes;       // stdin + stdout
+    double cgiCount;        // responses through the cgi phase
+    double cgiSeconds;      // dispatched -> response ready, summed
+    double busySeconds;     // event loop busy time
+    double cpuSeconds;      // server process CPU time (CGI children not included), -1 without --pid
+};
+
+static void usage(const char* name) {
+    std::cout
+        << "usage: " << name << " [options]\n"
+        << "  -H, --host ADDR          server IPv4 address (127.0.0.1)\n"
+        << "  -p, --port PORT          server port (8080)\n"
+        << "      --host-header NAME   Host header (localhost)\n"
+        << "  -t, --targets LIST       name=/path of ?bytes=N scripts, measured per class\n"
+        << "                           (python=/python/bench_payload.py,shell=/shell/bench_payload.sh,\n"
+        << "                            php=/php/bench_payload.php)\n"
+        << "      --scripts LIST       name=/path of scripts measured as they are, GET only\n"
+        << "                           (cgi-bin=/cgi-bin/test.py,python-demo=/python/simple_test.py,\n"
+        << "                            shell-demo=/shell/system_info.sh,php-demo=/php/info.php)\n"
+        << "  -b, --bodies LIST        request body classes, 0 = GET, K/M suffixes (0,64K,1M)\n"
+        << "  -r, --responses LIST     response body classes (1K,64K,1M)\n"
+        << "  -c, --clients LIST       concurrent keep-alive connections, closed loop (1,8)\n"
+        << "  -d, --duration SEC       measured time per run (2)\n"
+        << "  -w, --warmup SEC         unmeasured time before it (0.5)\n"
+        << "  -T, --timeout SEC        a request without a response for this long fails (10)\n"
+        << "  -S, --status PATH        stub_status location for the CGI and loop counters (/status)\n"
+        << "      --pid PID            server pid, for its CPU time from /proc\n"
+        << "  -j, --json               JSON report\n"
+        << "a target whose first run gets no 2xx (interpreter missing, 404) is skipped.\n"
+        << "spawn_us: loop time blocked in posix_spawn per CGI, what cgi_workers or fastcgi_pass save\n"
+        << "per request; cgi_ms: dispatch -> response ready, mostly interpreter start-up for small\n"
+        << "payloads; pipe_MB/s: stdin + stdout bytes per second of run; busy_us/req & loop%: event\n"
+        << "loop time (spawn + pipe I/O + the rest of the request) per CGI response and per second;\n"
+        << "cpu_us/req: server process CPU per CGI response, the children's own time excluded\n";
+}
+
+static bool parseBytes(const std::string& text, unsigned long long& bytes) {
+    char* end;
+    double value = std::strtod(text.c_str(), &end);
+    unsigned long long unit = 1;
+    if (*end == 'k' || *end == 'K')
+        unit = 1ULL << 10;
+    else if (*end == 'm' || *end == 'M')
+        unit = 1ULL << 20;
+    if (unit != 1)
+        ++end;
+    if (end == text.c_str() || *end != '\0' || value < 0)
+        return false;
+    bytes = static_cast<unsigned long long>(value * unit);
+    return true;
+}
+
+static std::string formatBytes(unsigned long long bytes) {
+    static const char* const units[] = { "", "K", "M", "G" };
+    int unit = 0;
+    while (unit < 3 && bytes >= 1024 && bytes % 1024 == 0) {
+        bytes /= 1024;
+        ++unit;
+    }
+    std::ostringstream out;
+    out << bytes << units[unit];
+    return out.str();
+}
+
+static std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> items;
+    std::istringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ','))
+        items.push_back(item);
+    return items;
+}
+
+static bool parseTargets(const std::string& list, bool sized, std::vector<CgiTarget>& targets) {
+    std::vector<std::string> items = splitList(list);
+    for (size_t i = 0; i < items.size(); ++i) {
+        size_t equals = items[i].find('=');
+        if (equals == 0 || equals == std::string::npos || items[i].size() == equals + 1
+            || items[i][equals + 1] != '/') {
+            std::cerr << "expected name=/path, got " << items[i] << std::endl;
+            return false;
+        }
+        CgiTarget target;
+        target.name = items[i].substr(0, equals);
+        target.path = items[i].substr(equals + 1);
+        target.sized = sized;
+        targets.push_back(target);
+    }
+    return true;
+}
+
+static bool parseSizes(const std::string& list, std::vector<unsigned long long>& sizes) {
+    std::vector<std::string> items = splitList(list);
+    for (size_t i = 0; i < items.size(); ++i) {
+        unsigned long long bytes;
+        if (!parseBytes(items[i], bytes)) {
+            std::cerr << "invalid size: " << items[i] << std::endl;
+            return false;
+        }
+        sizes.push_back(bytes);
+    }
+    return !sizes.empty();
+}
+
+static bool parseOptions(int argc, char** argv, CgiOptions& options) {
+    static const struct option longOptions[] = {
+        { "host", required_argument, NULL, 'H' },
+        { "port", required_argument, NULL, 'p' },
+        { "host-header", required_argument, NULL, 'A' },
+        { "targets", required_argument, NULL, 't' },
+        { "scripts", required_argument, NULL, 'X' },
+        { "bodies", required_argument, NULL, 'b' },
+        { "responses", required_argument, NULL, 'r' },
+        { "clients", required_argument, NULL, 'c' },
+        { "duration", required_argument, NULL, 'd' },
+        { "warmup", required_argument, NULL, 'w' },
+        { "timeout", required_argument, NULL, 'T' },
+        { "status", required_argument, NULL, 'S' },
+        { "pid", required_argument, NULL, 'P' },
+        { "json", no_argument, NULL, 'j' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    std::string targets = "python=/python/bench_payload.py,shell=/shell/bench_payload.sh,php=/php/bench_payload.php";
+    std::string scripts = "cgi-bin=/cgi-bin/test.py,python-demo=/python/simple_test.py,"
+                          "shell-demo=/shell/system_info.sh,php-demo=/php/info.php";
+    std::string bodies = "0,64K,1M";
+    std::string responses = "1K,64K,1M";
+    std::string clients = "1,8";
+    int opt;
+    while ((opt = getopt_long(argc, argv, "H:p:t:b:r:c:d:w:T:S:jh", longOptions, NULL)) != -1) {
+        switch (opt) {
+        case 'H':
+            if (inet_pton(AF_INET, optarg, &options.load.address.sin_addr) != 1) {
+                std::cerr << "invalid IPv4 address: " << optarg << std::endl;
+                return false;
+            }
+            break;
+        case 'p': options.load.address.sin_port = htons(static_cast<unsigned short>(std::atoi(optarg))); break;
+        case 'A': options.load.hostHeader = optarg; break;
+        case 't': targets = optarg; break;
+        case 'X': scripts = optarg; break;
+        case 'b': bodies = optarg; break;
+        case 'r': responses = optarg; break;
+        case 'c': clients = optarg; break;
+        case 'd': options.load.durationSec = std::atof(optarg); break;
+        case 'w': options.load.warmupSec = std::atof(optarg); break;
+        case 'T': options.load.timeoutSec = std::atof(optarg); break;
+        case 'S': options.statusPath = optarg; break;
+        case 'P': options.pid = std::atoi(optarg); break;
+        case 'j': options.json = true; break;
+        case 'h':
+            usage(argv[0]);
+            std::exit(0);
+        default:
+            usage(argv[0]);
+            return false;
+        }
+    }
+    if (!parseTargets(targets, true, options.targets) || !parseTargets(scripts, false, options.targets)
+        || !parseSizes(bodies, options.bodies) || !parseSizes(responses, options.responses))
+        return false;
+    std::vector<std::string> items = splitList(clients);
+    for (size_t i = 0; i < items.size(); ++i) {
+        int count = std::atoi(items[i].c_str());
+        if (count < 1) {
+            std::cerr << "invalid client count: " << items[i] << std::endl;
+            return false;
+        }
+        options.clients.push_back(count);
+    }
+    if (options.targets.empty() || options.clients.empty() || options.load.durationSec <= 0
+        || options.load.warmupSec < 0 || options.load.timeoutSec <= 0) {
+        std::cerr << "targets, clients, duration and timeout must be given and positive" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// the cgi phase is kept per server & location: the run only sends CGI requests, sum them all
+static void cgiPhase(const ServerProbe::Metrics& metrics, double& count, double& seconds) {
+    count = seconds = 0;
+    for (ServerProbe::Metrics::const_iterator it = metrics.begin(); it != metrics.end(); ++it) {
+        if (it->first.find("phase=\"cgi\"") == std::string::npos)
+            continue;
+        if (it->first.compare(0, 36, "webserv_request_phase_seconds_count{") == 0)
+            count += it->second;
+        else if (it->first.compare(0, 34, "webserv_request_phase_seconds_sum{") == 0)
+            seconds += it->second;
+    }
+}
+
+static double delta(const ServerProbe::Metrics& before, const ServerProbe::Metrics& after, const std::string& name) {
+    return ServerProbe::value(after, name) - ServerProbe::value(before, name);
+}
+
+static bool runScenario(const CgiOptions& options, ServerProbe& probe, CgiResult& result) {
+    BenchOptions load = options.load;
+    std::string path = result.target->path;
+    if (result.target->sized) {
+        std::ostringstream query;
+        query << (path.find('?') == std::string::npos ? '?' : '&') << "bytes=" << result.responseBytes;
+        path += query.str();
+    }
+    std::string error;
+    if (!load.mix.parse("cgi:100", error) || !load.mix.setPath("cgi=" + path, error)) {
+        std::cerr << error << std::endl;
+        return false;
+    }
+    load.mix.build(load.hostHeader, true, 0, static_cast<size_t>(result.bodyBytes));
+    load.connections = result.clients;
+
+    ServerProbe::Metrics before, after;
+    if (!probe.fetch(before)) {
+        std::cerr << "stub_status not reachable at " << options.statusPath << std::endl;
+        return false;
+    }
+    double cpuBefore = 0;
+    double cpuAfter = 0;
+    bool cpu = options.pid > 0 && ServerProbe::cpuSeconds(options.pid, cpuBefore);
+    LoadWorker worker(load, 0, load.connections, 0x9e3779b9u);
+    long long startUs = LoadWorker::nowUs();
+    long long measureUs = startUs + static_cast<long long>(load.warmupSec * 1e6);
+    long long endUs = measureUs + static_cast<long long>(load.durationSec * 1e6);
+    worker.setWindow(startUs, measureUs, endUs);
+    worker.run();
+    result.seconds = (LoadWorker::nowUs() - startUs) / 1e6;
+    result.stats = worker.stats();
+    cpu = cpu && ServerProbe::cpuSeconds(options.pid, cpuAfter);
+    result.cpuSeconds = cpu ? cpuAfter - cpuBefore : -1;
+    if (!probe.fetch(after))
+        return false;
+
+    result.spawns = delta(before, after, "webserv_cgi_spawns_total");
+    result.spawnSeconds = delta(before, after, "webserv_cgi_spawn_seconds_total");
+    result.pipeBytes = delta(before, after, "webserv_cgi_pipe_bytes_total{direction=\"in\"}")
+                     + delta(before, after, "webserv_cgi_pipe_bytes_total{direction=\"out\"}");
+    result.busySeconds = delta(before, after, "webserv_event_loop_busy_seconds_total");
+    double countBefore, secondsBefore;
+    cgiPhase(before, countBefore, secondsBefore);
+    cgiPhase(after, result.cgiCount, result.cgiSeconds);
+    result.cgiCount -= countBefore;
+    result.cgiSeconds -= secondsBefore;
+    return true;
+}
+
+// non-2xx answers and transport errors
+static unsigned long long failed(const CgiResult& r) {
+    return r.stats.errors() + r.stats.total() - r.stats.statusClass[2];
+}
+
+static double rps(const CgiOptions& options, const CgiResult& r) {
+    return r.stats.statusClass[2] / options.load.durationSec;
+}
+
+static double spawnUs(const CgiResult& r) {
+    return r.spawns > 0 ? r.spawnSeconds * 1e6 / r.spawns : 0;
+}
+
+static double cgiMs(const CgiResult& r) {
+    return r.cgiCount > 0 ? r.cgiSeconds * 1e3 / r.cgiCount : 0;
+}
+
+static double pipeMegabytesPerSecond(const CgiResult& r) {
+    return r.seconds > 0 ? r.pipeBytes / 1048576.0 / r.seconds : 0;
+}
+
+static double busyUsPerRequest(const CgiResult& r) {
+    return r.cgiCount > 0 ? r.busySeconds * 1e6 / r.cgiCount : 0;
+}
+
+static double cpuUsPerRequest(const CgiResult& r) {
+    return r.cgiCount > 0 && r.cpuSeconds >= 0 ? r.cpuSeconds * 1e6 / r.cgiCount : 0;
+}
+
+static double loopBusyPercent(const CgiResult& r) {
+    return r.seconds > 0 ? r.busySeconds * 100 / r.seconds : 0;
+}
+
+static std::string sizeClass(const CgiResult& r, unsigned long long bytes) {
+    if (!r.target->sized)
+        return "-";
+    return bytes ? formatBytes(bytes) : "GET";
+}
+
+static void reportText(const CgiOptions& options, const std::vector<CgiResult>& results,
+                       const std::vector<std::string>& skipped) {
+    char host[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &options.load.address.sin_addr, host, sizeof(host));
+    std::ostringstream out;
+    out << "cgi_bench " << host << ":" << ntohs(options.load.address.sin_port) << ": closed loop, "
+        << options.load.durationSec << " s per run\n\n"
+        << "target         body  resp conc       rps    p50_ms    p99_ms  spawn_us    cgi_ms  pipe_MB/s"
+        << "  busy_us/req  loop%  cpu_us/req  failed\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const CgiResult& r = results[i];
+        out << std::left << std::setw(12) << r.target->name << std::right
+            << std::setw(7) << sizeClass(r, r.bodyBytes) << std::setw(6) << sizeClass(r, r.responseBytes)
+            << std::setw(5) << r.clients << std::fixed << std::setprecision(1)
+            << std::setw(10) << rps(options, r) << std::setprecision(2)
+            << std::setw(10) << r.stats.latency.percentile(50) / 1000.0
+            << std::setw(10) << r.stats.latency.percentile(99) / 1000.0 << std::setprecision(0)
+            << std::setw(10) << spawnUs(r) << std::setprecision(2)
+            << std::setw(10) << cgiMs(r) << std::setprecision(1)
+            << std::setw(11) << pipeMegabytesPerSecond(r) << std::setprecision(0)
+            << std::setw(13) << busyUsPerRequest(r) << std::setprecision(1)
+            << std::setw(7) << loopBusyPercent(r) << std::setprecision(0)
+            << std::setw(12) << cpuUsPerRequest(r) << std::setw(8) << failed(r) << "\n";
+    }
+    for (size_t i = 0; i < skipped.size(); ++i)
+        out << "skipped " << skipped[i] << "\n";
+    if (options.pid <= 0)
+        out << "(no --pid: server CPU not measured)\n";
+    std::cout << out.str() << std::flush;
+}
+
+static void reportJson(const CgiOptions& options, const std::vector<CgiResult>& results,
+                       const std::vector<std::string>& skipped) {
+    char host[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &options.load.address.sin_addr, host, sizeof(host));
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << "{\n  \"target\": \"" << host << ":" << ntohs(options.load.address.sin_port) << "\",\n"
+        << "  \"duration_s\": " << options.load.durationSec << ",\n"
+        << "  \"runs\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const CgiResult& r = results[i];
+        const LatencyHistogram& h = r.stats.latency;
+        out << (i ? ",\n" : "\n")
+            << "    {\"name\": \"" << r.target->name << "\", \"path\": \"" << r.target->path << "\""
+            << ", \"body\": " << (r.target->sized ? static_cast<long long>(r.bodyBytes) : -1)
+            << ", \"response\": " << (r.target->sized ? static_cast<long long>(r.responseBytes) : -1)
+            << ", \"clients\": " << r.clients << ", \"rps\": " << rps(options, r)
+            << ", \"latency_us\": {\"p50\": " << h.percentile(50) << ", \"p99\": " << h.percentile(99)
+            << ", \"max\": " << h.maxUs() << "}"
+            << ", \"spawn_us\": " << spawnUs(r) << ", \"cgi_ms\": " << cgiMs(r)
+            << ", \"pipe_mb_per_s\": " << pipeMegabytesPerSecond(r)
+            << ", \"busy_us_per_request\": " << busyUsPerRequest(r)
+            << ", \"loop_busy_percent\": " << loopBusyPercent(r)
+            << ", \"cpu_us_per_request\": " << cpuUsPerRequest(r)
+            << ", \"failed\": " << failed(r) << "}";
+    }
+    out << "\n  ],\n  \"skipped\": [";
+    for (size_t i = 0; i < skipped.size(); ++i)
+        out << (i ? ", " : "") << "\"" << skipped[i] << "\"";
+    out << "]\n}\n";
+    std::cout << out.str() << std::flush;
+}
+
+/* runs of one target: sized targets over body x response x clients, the others per clients
+   only; stops after the first run when nothing came back 2xx */
+static bool runTarget(const CgiOptions& options, ServerProbe& probe, const CgiTarget& target,
+                      std::vector<CgiResult>& results, std::vector<std::string>& skipped) {
+    size_t bodies = target.sized ? options.bodies.size() : 1;
+    size_t responses = target.sized ? options.responses.size() : 1;
+    for (size_t b = 0; b < bodies; ++b) {
+        for (size_t r = 0; r < responses; ++r) {
+            for (size_t c = 0; c < options.clients.size(); ++c) {
+                CgiResult result;
+                result.target = &target;
+                result.bodyBytes = target.sized ? options.bodies[b] : 0;
+                result.responseBytes = target.sized ? options.responses[r] : 0;
+                result.clients = options.clients[c];
+                if (!runScenario(options, probe, result))
+                    return false;
+                if (results.empty() || results.back().target != &target) {
+                    if (result.stats.statusClass[2] == 0) {
+                        std::ostringstream note;
+                        note << target.name << " (" << target.path << "): no 2xx, "
+                             << result.stats.statusClass[5] << " 5xx, " << result.stats.statusClass[4] << " 4xx, "
+                             << result.stats.errors() << " errors";
+                        skipped.push_back(note.str());
+                        if (!options.json)
+                            std::cerr << "skip " << note.str() << std::endl;
+                        return true;
+                    }
+                }
+                if (!options.json)
+                    std::cerr << target.name << " " << sizeClass(result, result.bodyBytes) << " "
+                              << sizeClass(result, result.responseBytes) << " x " << result.clients << ": "
+                              << std::fixed << std::setprecision(1) << rps(options, result) << " rps" << std::endl;
+                results.push_back(result);
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    CgiOptions options;
+    if (!parseOptions(argc, argv, options))
+        return 2;
+    signal(SIGPIPE, SIG_IGN);
+
+    ServerProbe probe(options.load.address, options.load.hostHeader, options.statusPath);
+    std::vector<CgiResult> results;
+    std::vector<std::string> skipped;
+    for (size_t i = 0; i < options.targets.size(); ++i) {
+        if (!runTarget(options, probe, options.targets[i], results, skipped)) {
+            std::cerr << "cannot reach the server" << std::endl;
+            return 1;
+        }
+    }
+    if (options.json)
+        reportJson(options, results, skipped);
+    else
+        reportText(options, results, skipped);
+    return 0;
+}
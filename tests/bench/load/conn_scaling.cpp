@@ -0,0 +1,331 @@
+// Connection scaling (C10K/C100K): idle keep-alive connections vs server memory, loop cost and latency
+// Build: make bench   Run: make bench-scaling, or tests/bench/load/conn_scaling --help
+#include "load_worker.hpp"
+#include "idle_pool.hpp"
+#include "server_probe.hpp"
+#include <sys/resource.h>
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+
+struct ScalingOptions {
+    BenchOptions active;        // the small measured stream
+    std::vector<size_t> levels;
+    std::string path;
+    std::string statusPath;
+    int pid;
+    double settleSec;
+    double openTimeoutSec;
+    bool json;
+
+    ScalingOptions() : path("/"), statusPath("/status"), pid(0), settleSec(2), openTimeoutSec(30), json(false) {
+        active.connections = 4;
+        active.threads = 1;
+        active.durationSec = 5;
+        active.warmupSec = 0.5;
+        active.rate = 200;
+    }
+};
+
+/* one point of the curve */
+struct LevelResult {
+    size_t target;
+    size_t held;            // idle connections the server kept until the end of the level
+    size_t refused;         // closed by the server (limits) or never answered
+    double serverConnections;
+    long rssKb;
+    long peakKb;
+    double idleBusyUs;      // per loop iteration, idle connections only
+    double activeBusyUs;    // per loop iteration, with the active stream running
+    double iterationsPerSec;
+    BenchStats stats;
+};
+
+static void usage(const char* name) {
+    std::cout
+        << "usage: " << name << " [options]\n"
+        << "  -H, --host ADDR          server IPv4 address (127.0.0.1)\n"
+        << "  -p, --port PORT          server port (8080)\n"
+        << "      --host-header NAME   Host header (localhost)\n"
+        << "  -l, --levels N,N,...     idle connection counts (0,1000,10000,50000,100000)\n"
+        << "  -u, --path PATH          path of the idle and active requests (/)\n"
+        << "  -c, --connections N      active stream connections (4)\n"
+        << "  -R, --rate N             active stream requests/s, open loop (200)\n"
+        << "  -d, --duration SEC       active stream measured time per level (5)\n"
+        << "  -s, --settle SEC         idle time before measuring, loop cost sampled meanwhile (2)\n"
+        << "  -S, --status PATH        stub_status location (/status)\n"
+        << "      --pid PID            server pid, for RSS from /proc (memory not reported without it)\n"
+        << "  -j, --json               JSON report\n"
+        << "levels are measured one after another on fresh connections, each within the server's\n"
+        << "30 s idle timeout; the client raises its fd limit to the hard limit and caps levels to it.\n"
+        << "KB/conn is the RSS growth over the first level (0 by default) per extra held connection\n";
+}
+
+static bool parseLevels(const std::string& spec, std::vector<size_t>& levels) {
+    levels.clear();
+    std::istringstream in(spec);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        char* end;
+        long value = std::strtol(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || value < 0)
+            return false;
+        levels.push_back(static_cast<size_t>(value));
+    }
+    return !levels.empty();
+}
+
+static bool parseOptions(int argc, char** argv, ScalingOptions& options) {
+    static const struct option longOptions[] = {
+        { "host", required_argument, NULL, 'H' },
+        { "port", required_argument, NULL, 'p' },
+        { "host-header", required_argument, NULL, 'A' },
+        { "levels", required_argument, NULL, 'l' },
+        { "path", required_argument, NULL, 'u' },
+        { "connections", required_argument, NULL, 'c' },
+        { "rate", required_argument, NULL, 'R' },
+        { "duration", required_argument, NULL, 'd' },
+        { "settle", required_argument, NULL, 's' },
+        { "status", required_argument, NULL, 'S' },
+        { "pid", required_argument, NULL, 'P' },
+        { "json", no_argument, NULL, 'j' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    std::string levels = "0,1000,10000,50000,100000";
+    int opt;
+    while ((opt = getopt_long(argc, argv, "H:p:l:u:c:R:d:s:S:jh", longOptions, NULL)) != -1) {
+        switch (opt) {
+        case 'H':
+            if (inet_pton(AF_INET, optarg, &options.active.address.sin_addr) != 1) {
+                std::cerr << "invalid IPv4 address: " << optarg << std::endl;
+                return false;
+            }
+            break;
+        case 'p': options.active.address.sin_port = htons(static_cast<unsigned short>(std::atoi(optarg))); break;
+        case 'A': options.active.hostHeader = optarg; break;
+        case 'l': levels = optarg; break;
+        case 'u': options.path = optarg; break;
+        case 'c': options.active.connections = std::atoi(optarg); break;
+        case 'R': options.active.rate = std::atof(optarg); break;
+        case 'd': options.active.durationSec = std::atof(optarg); break;
+        case 's': options.settleSec = std::atof(optarg); break;
+        case 'S': options.statusPath = optarg; break;
+        case 'P': options.pid = std::atoi(optarg); break;
+        case 'j': options.json = true; break;
+        case 'h':
+            usage(argv[0]);
+            std::exit(0);
+        default:
+            usage(argv[0]);
+            return false;
+        }
+    }
+    if (!parseLevels(levels, options.levels)) {
+        std::cerr << "invalid levels: " << levels << std::endl;
+        return false;
+    }
+    if (options.active.connections < 1 || options.active.durationSec <= 0 || options.settleSec <= 0
+        || options.active.rate < 0) {
+        std::cerr << "connections, durations and rate must be positive" << std::endl;
+        return false;
+    }
+    std::string error;
+    if (!options.active.mix.parse("static:100", error) || !options.active.mix.setPath("static=" + options.path, error)) {
+        std::cerr << error << std::endl;
+        return false;
+    }
+    options.active.mix.build(options.active.hostHeader, true, 0);
+    return true;
+}
+
+static void pause(double seconds) {
+    usleep(static_cast<useconds_t>(seconds * 1e6));
+}
+
+// idle connections the client can hold next to the active stream and the probe
+static size_t clientCapacity(const ScalingOptions& options) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0)
+        return 1000;
+    if (limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        getrlimit(RLIMIT_NOFILE, &limit);
+    }
+    size_t reserved = static_cast<size_t>(options.active.connections) + 32;
+    return limit.rlim_cur > reserved ? static_cast<size_t>(limit.rlim_cur) - reserved : 0;
+}
+
+static double busyPerIteration(const ServerProbe::Metrics& before, const ServerProbe::Metrics& after) {
+    double iterations = ServerProbe::value(after, "webserv_event_loop_iterations_total")
+                      - ServerProbe::value(before, "webserv_event_loop_iterations_total");
+    double busy = ServerProbe::value(after, "webserv_event_loop_busy_seconds_total")
+                - ServerProbe::value(before, "webserv_event_loop_busy_seconds_total");
+    return iterations > 0 ? busy * 1e6 / iterations : 0;
+}
+
+/* one level
+    - the active connections and the probe connect first: the idle flood must not
+      push them past a server-side connection limit
+    - loop cost is sampled twice: over the settle time (idle only) and over the active run
+*/
+static bool measureLevel(const ScalingOptions& options, size_t target, const std::string& idleRequest,
+                         LevelResult& result) {
+    const struct sockaddr_in& server = options.active.address;
+    ServerProbe probe(server, options.active.hostHeader, options.statusPath);
+    ServerProbe::Metrics settleStart, activeStart, activeEnd;
+    if (!probe.connect()) {
+        std::cerr << "cannot connect to the server" << std::endl;
+        return false;
+    }
+    LoadWorker worker(options.active, 0, options.active.connections, 0x9e3779b9u);
+    worker.openAll();
+    pause(0.2);
+
+    IdlePool pool;
+    pool.open(target, server, idleRequest, options.openTimeoutSec);
+    if (!probe.fetch(settleStart)) {
+        std::cerr << "stub_status not reachable at " << options.statusPath << std::endl;
+        return false;
+    }
+    long long settleStartUs = LoadWorker::nowUs();
+    pause(options.settleSec);
+    probe.fetch(activeStart);
+    double settleSec = (LoadWorker::nowUs() - settleStartUs) / 1e6;
+    result.rssKb = result.peakKb = -1;
+    if (options.pid > 0)
+        ServerProbe::memory(options.pid, result.rssKb, result.peakKb);
+
+    long long startUs = LoadWorker::nowUs();
+    long long measureUs = startUs + static_cast<long long>(options.active.warmupSec * 1e6);
+    long long endUs = measureUs + static_cast<long long>(options.active.durationSec * 1e6);
+    worker.setWindow(startUs, measureUs, endUs);
+    worker.run();
+    probe.fetch(activeEnd);
+    long peakKb = -1;
+    long rssKb = -1;
+    if (options.pid > 0 && ServerProbe::memory(options.pid, rssKb, peakKb) && rssKb > result.rssKb)
+        result.rssKb = rssKb;
+    result.peakKb = peakKb;
+
+    result.target = target;
+    result.held = pool.alive();
+    result.refused = target - result.held;
+    result.serverConnections = ServerProbe::value(activeStart, "webserv_connections{state=\"active\"}");
+    result.idleBusyUs = busyPerIteration(settleStart, activeStart);
+    result.activeBusyUs = busyPerIteration(activeStart, activeEnd);
+    double iterations = ServerProbe::value(activeStart, "webserv_event_loop_iterations_total")
+                      - ServerProbe::value(settleStart, "webserv_event_loop_iterations_total");
+    result.iterationsPerSec = settleSec > 0 ? iterations / settleSec : 0;
+    result.stats = worker.stats();
+    pool.closeAll();
+    pause(0.5);     // let the server see the closes before the next level
+    return true;
+}
+
+static double ms(long long us) {
+    return us / 1000.0;
+}
+
+// memory per idle connection, against the first level as the baseline
+static double kbPerConnection(const LevelResult& level, const LevelResult& base) {
+    if (level.rssKb < 0 || base.rssKb < 0 || level.held <= base.held)
+        return 0;
+    return static_cast<double>(level.rssKb - base.rssKb) / (level.held - base.held);
+}
+
+static void reportText(const ScalingOptions& options, const std::vector<LevelResult>& levels) {
+    char host[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &options.active.address.sin_addr, host, sizeof(host));
+    std::ostringstream out;
+    out << "conn_scaling " << host << ":" << ntohs(options.active.address.sin_port) << ": active stream "
+        << options.active.connections << " connections at " << options.active.rate << " req/s, GET "
+        << options.path << ", " << options.active.durationSec << " s per level\n\n"
+        << "    idle    held refused  srv_conns   rss_MB KB/conn  idle_us/it  busy_us/it  it/s(idle)"
+        << "      rps    p50_ms    p99_ms  p99.9_ms  errors\n";
+    for (size_t i = 0; i < levels.size(); ++i) {
+        const LevelResult& l = levels[i];
+        double seconds = options.active.durationSec;
+        out << std::fixed << std::setprecision(1)
+            << std::setw(8) << l.target << std::setw(8) << l.held << std::setw(8) << l.refused
+            << std::setw(11) << std::setprecision(0) << l.serverConnections << std::setprecision(1)
+            << std::setw(9) << (l.rssKb < 0 ? 0.0 : l.rssKb / 1024.0)
+            << std::setw(8) << kbPerConnection(l, levels[0])
+            << std::setw(12) << l.idleBusyUs << std::setw(12) << l.activeBusyUs
+            << std::setw(12) << l.iterationsPerSec
+            << std::setw(9) << l.stats.total() / seconds << std::setprecision(3)
+            << std::setw(10) << ms(l.stats.latency.percentile(50))
+            << std::setw(10) << ms(l.stats.latency.percentile(99))
+            << std::setw(10) << ms(l.stats.latency.percentile(99.9))
+            << std::setw(8) << l.stats.errors() << "\n";
+    }
+    if (options.pid <= 0)
+        out << "(no --pid: memory not measured)\n";
+    std::cout << out.str() << std::flush;
+}
+
+static void reportJson(const ScalingOptions& options, const std::vector<LevelResult>& levels) {
+    char host[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &options.active.address.sin_addr, host, sizeof(host));
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+    out << "{\n  \"target\": \"" << host << ":" << ntohs(options.active.address.sin_port) << "\",\n"
+        << "  \"path\": \"" << options.path << "\",\n"
+        << "  \"active_connections\": " << options.active.connections << ",\n"
+        << "  \"active_rate\": " << options.active.rate << ",\n"
+        << "  \"duration_s\": " << options.active.durationSec << ",\n"
+        << "  \"levels\": [";
+    for (size_t i = 0; i < levels.size(); ++i) {
+        const LevelResult& l = levels[i];
+        const LatencyHistogram& h = l.stats.latency;
+        out << (i ? ",\n" : "\n")
+            << "    {\"idle\": " << l.target << ", \"held\": " << l.held << ", \"refused\": " << l.refused
+            << ", \"server_connections\": " << l.serverConnections
+            << ", \"rss_kb\": " << l.rssKb << ", \"peak_rss_kb\": " << l.peakKb
+            << ", \"kb_per_connection\": " << kbPerConnection(l, levels[0])
+            << ", \"idle_busy_us_per_iteration\": " << l.idleBusyUs
+            << ", \"active_busy_us_per_iteration\": " << l.activeBusyUs
+            << ", \"idle_iterations_per_s\": " << l.iterationsPerSec
+            << ", \"rps\": " << l.stats.total() / options.active.durationSec
+            << ", \"latency_us\": {\"p50\": " << h.percentile(50) << ", \"p99\": " << h.percentile(99)
+            << ", \"p99_9\": " << h.percentile(99.9) << ", \"max\": " << h.maxUs() << "}"
+            << ", \"errors\": " << l.stats.errors() << "}";
+    }
+    out << "\n  ]\n}\n";
+    std::cout << out.str() << std::flush;
+}
+
+int main(int argc, char** argv) {
+    ScalingOptions options;
+    if (!parseOptions(argc, argv, options))
+        return 2;
+    signal(SIGPIPE, SIG_IGN);
+
+    size_t capacity = clientCapacity(options);
+    std::string idleRequest = "GET " + options.path + " HTTP/1.1\r\nHost: " + options.active.hostHeader + "\r\n\r\n";
+    std::vector<LevelResult> results;
+    for (size_t i = 0; i < options.levels.size(); ++i) {
+        size_t target = options.levels[i];
+        if (target > capacity) {
+            std::cerr << "level " << target << " capped to " << capacity << " (client fd limit)" << std::endl;
+            target = capacity;
+        }
+        LevelResult result;
+        if (!measureLevel(options, target, idleRequest, result))
+            return 1;
+        if (!options.json)
+            std::cerr << "level " << target << ": " << result.held << " held" << std::endl;
+        results.push_back(result);
+    }
+    if (options.json)
+        reportJson(options, results);
+    else
+        reportText(options, results);
+    return 0;
+}
@@ -0,0 +1,160 @@
+#include "idle_pool.hpp"
+#include "load_worker.hpp"
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+
+IdlePool::IdlePool() : epollFd_(epoll_create1(EPOLL_CLOEXEC)), failed_(0) {
+}
+
+IdlePool::~IdlePool() {
+    closeAll();
+    if (epollFd_ != -1)
+        close(epollFd_);
+}
+
+bool IdlePool::start(size_t index, const struct sockaddr_in& server) {
+    Connection& c = conns_[index];
+    c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (c.fd == -1) {
+        finish(index, DEAD);
+        return false;
+    }
+    if ((ntohl(server.sin_addr.s_addr) >> 24) == 127) {
+        struct sockaddr_in source;
+        source.sin_family = AF_INET;
+        source.sin_port = 0;
+        source.sin_addr.s_addr = htonl(INADDR_LOOPBACK + static_cast<unsigned int>(index / PER_SOURCE));
+        if (bind(c.fd, reinterpret_cast<struct sockaddr*>(&source), sizeof(source)) == -1) {
+            finish(index, DEAD);
+            return false;
+        }
+    }
+    if (connect(c.fd, reinterpret_cast<const struct sockaddr*>(&server), sizeof(server)) == -1
+        && errno != EINPROGRESS) {
+        finish(index, DEAD);
+        return false;
+    }
+    c.state = CONNECTING;
+    struct epoll_event event;
+    event.events = EPOLLOUT;
+    event.data.u64 = index;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, c.fd, &event);
+    return true;
+}
+
+// IDLE keeps the socket open but stops watching it
+void IdlePool::finish(size_t index, State state) {
+    Connection& c = conns_[index];
+    c.state = state;
+    if (c.fd == -1)
+        return;
+    epoll_ctl(epollFd_, EPOLL_CTL_DEL, c.fd, NULL);
+    if (state == DEAD) {
+        close(c.fd);
+        c.fd = -1;
+        ++failed_;
+    }
+}
+
+/* open `count` connections, at most MAX_HANDSHAKES unfinished at a time
+    - returns how many made it to IDLE before the timeout
+    - a refused, reset or closed connection counts in failed()
+*/
+size_t IdlePool::open(size_t count, const struct sockaddr_in& server, const std::string& request, double timeoutSec) {
+    closeAll();
+    conns_.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        conns_[i].fd = -1;
+        conns_[i].state = DEAD;
+        conns_[i].reader.reset();
+    }
+    long long deadline = LoadWorker::nowUs() + static_cast<long long>(timeoutSec * 1e6);
+    std::vector<struct epoll_event> events(1024);
+    char buffer[16384];
+    size_t next = 0;
+    size_t pending = 0;
+    size_t idle = 0;
+
+    while ((next < count || pending > 0) && LoadWorker::nowUs() < deadline) {
+        while (next < count && pending < MAX_HANDSHAKES) {
+            if (start(next, server))
+                ++pending;
+            ++next;
+        }
+        int ready = epoll_wait(epollFd_, &events[0], static_cast<int>(events.size()), 50);
+        for (int i = 0; i < ready; ++i) {
+            size_t index = static_cast<size_t>(events[i].data.u64);
+            Connection& c = conns_[index];
+            if (c.state == CONNECTING) {
+                int error = 0;
+                socklen_t length = sizeof(error);
+                getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+                // a one-packet request: anything short of a full send is a failure
+                if (error != 0 || send(c.fd, request.data(), request.size(), MSG_NOSIGNAL)
+                                      != static_cast<ssize_t>(request.size())) {
+                    finish(index, DEAD);
+                    --pending;
+                    continue;
+                }
+                c.state = WAITING;
+                struct epoll_event event;
+                event.events = EPOLLIN;
+                event.data.u64 = index;
+                epoll_ctl(epollFd_, EPOLL_CTL_MOD, c.fd, &event);
+                continue;
+            }
+            if (c.state != WAITING)
+                continue;
+            while (c.state == WAITING) {
+                ssize_t received = recv(c.fd, buffer, sizeof(buffer), 0);
+                if (received > 0) {
+                    c.reader.feed(buffer, static_cast<size_t>(received));
+                    if (c.reader.failed() || (c.reader.done() && !c.reader.keepAlive())) {
+                        finish(index, DEAD);
+                        --pending;
+                    } else if (c.reader.done()) {
+                        finish(index, IDLE);
+                        --pending;
+                        ++idle;
+                    }
+                    continue;
+                }
+                if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+                    break;
+                finish(index, DEAD);    // closed or reset before the response was complete
+                --pending;
+            }
+        }
+    }
+    for (size_t i = 0; i < conns_.size(); ++i) {
+        if (conns_[i].state == CONNECTING || conns_[i].state == WAITING)
+            finish(i, DEAD);
+    }
+    return idle;
+}
+
+// EOF or an error pending on the socket = the server let it go
+size_t IdlePool::alive() const {
+    size_t count = 0;
+    char byte;
+    for (size_t i = 0; i < conns_.size(); ++i) {
+        if (conns_[i].state != IDLE)
+            continue;
+        ssize_t peeked = recv(conns_[i].fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (peeked < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            ++count;
+    }
+    return count;
+}
+
+void IdlePool::closeAll() {
+    for (size_t i = 0; i < conns_.size(); ++i) {
+        if (conns_[i].fd != -1)
+            close(conns_[i].fd);
+    }
+    conns_.clear();
+    failed_ = 0;
+}
@@ -0,0 +1,50 @@
+#ifndef IDLE_POOL_HPP
+#define IDLE_POOL_HPP
+
+#include <string>
+#include <vector>
+#include <netinet/in.h>
+#include "response_reader.hpp"
+
+/* N keep-alive connections that went quiet
+    - each one sends a single request and reads its response, then is left alone:
+      the server holds it as an idle keep-alive connection
+    - loopback targets get a new source address (127.0.0.2, .3, ...) every
+      PER_SOURCE connections, one address has ~28K ephemeral ports only
+    - nothing is read afterwards; alive() peeks to see what the server closed
+*/
+class IdlePool {
+public:
+    IdlePool();
+    ~IdlePool();
+
+    size_t open(size_t count, const struct sockaddr_in& server, const std::string& request, double timeoutSec);
+    size_t alive() const;
+    void closeAll();
+
+    size_t failed() const { return failed_; }
+
+private:
+    enum State { CONNECTING, WAITING, IDLE, DEAD };
+
+    struct Connection {
+        int fd;
+        State state;
+        ResponseReader reader;
+    };
+
+    static const size_t PER_SOURCE = 20000;
+    static const size_t MAX_HANDSHAKES = 256;  // connects in flight, keeps the listen backlog from overflowing
+
+    std::vector<Connection> conns_;
+    int epollFd_;
+    size_t failed_;
+
+    bool start(size_t index, const struct sockaddr_in& server);
+    void finish(size_t index, State state);
+
+    IdlePool(const IdlePool&);
+    IdlePool& operator=(const IdlePool&);
+};
+
+#endif // IDLE_POOL_HPP
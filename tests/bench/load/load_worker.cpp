@@ -0,0 +1,409 @@
+#include "load_worker.hpp"
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <errno.h>
+#include <ctime>
+
+static const long long RETRY_DELAY_US = 10000;
+static const long long TIMEOUT_CHECK_US = 100000;
+static const int MAX_WAIT_MS = 50;
+
+BenchOptions::BenchOptions()
+    : hostHeader("localhost"), connections(64), threads(2), durationSec(10), warmupSec(1),
+      keepAlive(true), pipeline(1), rate(0), timeoutSec(5), uploadBytes(4096), json(false) {
+    address.sin_family = AF_INET;
+    address.sin_port = htons(8080);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+}
+
+/* ---------------------------------------------------------------- BenchStats */
+
+BenchStats::BenchStats()
+    : bytesRead(0), bytesWritten(0), connects(0), connectErrors(0), readErrors(0), writeErrors(0),
+      timeouts(0), resets(0), parseErrors(0) {
+    for (int i = 0; i < KIND_COUNT; ++i)
+        requests[i] = 0;
+    for (int i = 0; i < 6; ++i)
+        statusClass[i] = 0;
+}
+
+void BenchStats::merge(const BenchStats& other) {
+    latency.merge(other.latency);
+    uncorrected.merge(other.uncorrected);
+    for (int i = 0; i < KIND_COUNT; ++i) {
+        kindLatency[i].merge(other.kindLatency[i]);
+        requests[i] += other.requests[i];
+    }
+    for (int i = 0; i < 6; ++i)
+        statusClass[i] += other.statusClass[i];
+    bytesRead += other.bytesRead;
+    bytesWritten += other.bytesWritten;
+    connects += other.connects;
+    connectErrors += other.connectErrors;
+    readErrors += other.readErrors;
+    writeErrors += other.writeErrors;
+    timeouts += other.timeouts;
+    resets += other.resets;
+    parseErrors += other.parseErrors;
+}
+
+unsigned long long BenchStats::total() const {
+    return latency.count();
+}
+
+unsigned long long BenchStats::errors() const {
+    return connectErrors + readErrors + writeErrors + timeouts + resets + parseErrors;
+}
+
+/* ---------------------------------------------------------------- LoadWorker */
+
+LoadWorker::Connection::Connection()
+    : fd(-1), connecting(false), wantWrite(false), outOffset(0), nextUs(0), retryUs(0),
+      sentOnConnection(0) {
+}
+
+LoadWorker::LoadWorker(const BenchOptions& options, int firstConnection, int connectionCount, unsigned int seed)
+    : options_(options), firstConnection_(firstConnection), conns_(connectionCount),
+      epollFd_(epoll_create1(EPOLL_CLOEXEC)), seed_(seed), intervalUs_(0),
+      startUs_(0), measureUs_(0), endUs_(0), now_(0), buffer_(64 * 1024) {
+    if (options_.rate > 0)
+        intervalUs_ = options_.connections * 1e6 / options_.rate;
+}
+
+LoadWorker::~LoadWorker() {
+    for (size_t i = 0; i < conns_.size(); ++i) {
+        if (conns_[i].fd != -1)
+            close(conns_[i].fd);
+    }
+    if (epollFd_ != -1)
+        close(epollFd_);
+}
+
+long long LoadWorker::nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<long long>(ts.tv_sec) * 1000000LL + ts.tv_nsec / 1000;
+}
+
+void* LoadWorker::threadMain(void* worker) {
+    static_cast<LoadWorker*>(worker)->run();
+    return NULL;
+}
+
+void LoadWorker::setWindow(long long startUs, long long measureUs, long long endUs) {
+    startUs_ = startUs;
+    measureUs_ = measureUs;
+    endUs_ = endUs;
+}
+
+void LoadWorker::watch(size_t index, bool write) {
+    Connection& c = conns_[index];
+    struct epoll_event event;
+    event.events = write ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    event.data.u64 = index;
+    epoll_ctl(epollFd_, EPOLL_CTL_MOD, c.fd, &event);
+    c.wantWrite = write;
+}
+
+void LoadWorker::openConnection(size_t index) {
+    Connection& c = conns_[index];
+    c.reader.reset();
+    c.sentOnConnection = 0;
+    c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (c.fd == -1) {
+        ++stats_.connectErrors;
+        c.retryUs = now_ + RETRY_DELAY_US;
+        reconnect_.push_back(index);
+        return;
+    }
+    int one = 1;
+    setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    int result = connect(c.fd, reinterpret_cast<const struct sockaddr*>(&options_.address),
+                         sizeof(options_.address));
+    if (result == -1 && errno != EINPROGRESS) {
+        ++stats_.connectErrors;
+        close(c.fd);
+        c.fd = -1;
+        c.retryUs = now_ + RETRY_DELAY_US;
+        reconnect_.push_back(index);
+        return;
+    }
+    ++stats_.connects;
+    c.connecting = result == -1;
+    c.wantWrite = c.connecting;
+    struct epoll_event event;
+    event.events = c.connecting ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    event.data.u64 = index;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, c.fd, &event);
+}
+
+// requests still in flight are lost: the connection went away under them
+void LoadWorker::closeConnection(size_t index) {
+    Connection& c = conns_[index];
+    if (c.fd != -1)
+        close(c.fd);    // also leaves the epoll set
+    c.fd = -1;
+    c.connecting = false;
+    c.wantWrite = false;
+    stats_.resets += c.inflight.size();
+    c.inflight.clear();
+    c.out.clear();
+    c.outOffset = 0;
+    c.reader.reset();
+    reconnect_.push_back(index);
+}
+
+// open loop: every send that came due goes to the backlog with its scheduled time
+void LoadWorker::schedule(size_t index) {
+    Connection& c = conns_[index];
+    while (c.nextUs <= now_ && c.nextUs < endUs_) {
+        c.backlog.push_back(static_cast<long long>(c.nextUs));
+        c.nextUs += intervalUs_;
+    }
+}
+
+void LoadWorker::fill(size_t index) {
+    Connection& c = conns_[index];
+    bool openLoop = options_.rate > 0;
+    if (c.fd == -1) {
+        if (now_ < c.retryUs || now_ >= endUs_)
+            return;
+        if (!options_.keepAlive && openLoop && c.backlog.empty())
+            return; // one connection per request: connect when one is due
+        openConnection(index);
+        if (c.fd == -1)
+            return;
+    }
+    size_t depth = options_.keepAlive ? static_cast<size_t>(options_.pipeline) : 1;
+    while (c.inflight.size() < depth && now_ < endUs_) {
+        if (!options_.keepAlive && c.sentOnConnection > 0)
+            break;
+        InFlight request;
+        if (openLoop) {
+            if (c.backlog.empty())
+                break;
+            request.intendedUs = c.backlog.front();
+            c.backlog.pop_front();
+        } else {
+            request.intendedUs = now_;
+        }
+        const RequestTemplate& chosen = options_.mix.pick(seed_);
+        request.kind = chosen.kind;
+        request.sentUs = now_;
+        c.out += chosen.bytes;
+        c.inflight.push_back(request);
+        ++c.sentOnConnection;
+    }
+    flush(index);
+}
+
+void LoadWorker::flush(size_t index) {
+    Connection& c = conns_[index];
+    if (c.fd == -1 || c.connecting)
+        return; // EPOLLOUT is registered until the connect completes
+    while (c.outOffset < c.out.size()) {
+        ssize_t sent = send(c.fd, c.out.data() + c.outOffset, c.out.size() - c.outOffset, MSG_NOSIGNAL);
+        if (sent > 0) {
+            c.outOffset += sent;
+            if (now_ >= measureUs_)
+                stats_.bytesWritten += static_cast<unsigned long long>(sent);
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!c.wantWrite)
+                watch(index, true);
+            return;
+        }
+        ++stats_.writeErrors;
+        closeConnection(index);
+        return;
+    }
+    c.out.clear();
+    c.outOffset = 0;
+    if (c.wantWrite)
+        watch(index, false);
+}
+
+void LoadWorker::onWritable(size_t index) {
+    Connection& c = conns_[index];
+    if (c.connecting) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+            ++stats_.connectErrors;
+            c.inflight.clear(); // never sent: a connect error, not a reset
+            closeConnection(index);
+            c.retryUs = now_ + RETRY_DELAY_US;
+            return;
+        }
+        c.connecting = false;
+    }
+    flush(index);
+}
+
+/* a response is complete: record it, false = the connection was closed */
+bool LoadWorker::complete(size_t index) {
+    Connection& c = conns_[index];
+    InFlight request = c.inflight.front();
+    c.inflight.pop_front();
+    int status = c.reader.status();
+    bool keepAlive = c.reader.keepAlive();
+    c.reader.reset();
+
+    if (request.intendedUs >= measureUs_ && now_ <= endUs_) {
+        stats_.latency.record(now_ - request.intendedUs);
+        stats_.uncorrected.record(now_ - request.sentUs);
+        stats_.kindLatency[request.kind].record(now_ - request.intendedUs);
+        ++stats_.requests[request.kind];
+        ++stats_.statusClass[status >= 100 && status < 600 ? status / 100 : 0];
+    }
+    if (!options_.keepAlive || !keepAlive) {
+        closeConnection(index);
+        return false;
+    }
+    return true;
+}
+
+void LoadWorker::onReadable(size_t index) {
+    Connection& c = conns_[index];
+    while (c.fd != -1) {
+        ssize_t received = recv(c.fd, &buffer_[0], buffer_.size(), 0);
+        if (received > 0) {
+            if (now_ >= measureUs_)
+                stats_.bytesRead += static_cast<unsigned long long>(received);
+            size_t used = 0;
+            while (used < static_cast<size_t>(received)) {
+                if (c.inflight.empty()) {
+                    ++stats_.parseErrors; // bytes nobody asked for
+                    closeConnection(index);
+                    return;
+                }
+                used += c.reader.feed(&buffer_[used], received - used);
+                if (c.reader.failed()) {
+                    ++stats_.parseErrors;
+                    closeConnection(index);
+                    return;
+                }
+                if (c.reader.done() && !complete(index))
+                    return;
+            }
+            if (static_cast<size_t>(received) < buffer_.size())
+                break;
+            continue;
+        }
+        if (received == 0) {
+            // close-delimited body, or the server dropped the connection
+            if (!c.inflight.empty() && c.reader.started() && c.reader.finishAtEof() && !complete(index))
+                return;
+            closeConnection(index);
+            return;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            break;
+        ++stats_.readErrors;
+        closeConnection(index);
+        return;
+    }
+    fill(index);
+}
+
+void LoadWorker::checkTimeouts() {
+    long long timeoutUs = static_cast<long long>(options_.timeoutSec * 1e6);
+    for (size_t i = 0; i < conns_.size(); ++i) {
+        Connection& c = conns_[i];
+        if (c.fd == -1 || c.inflight.empty() || now_ - c.inflight.front().sentUs < timeoutUs)
+            continue;
+        stats_.timeouts += c.inflight.size();
+        c.inflight.clear();
+        closeConnection(i);
+    }
+}
+
+// the connections are accepted ahead of whatever the caller opens next (conn_scaling's idle pool)
+void LoadWorker::openAll() {
+    now_ = nowUs();
+    for (size_t i = 0; i < conns_.size(); ++i) {
+        if (conns_[i].fd == -1)
+            openConnection(i);
+    }
+}
+
+void LoadWorker::run() {
+    now_ = nowUs();
+    if (startUs_ > now_) {
+        long long wait = startUs_ - now_;
+        struct timespec pause = { static_cast<time_t>(wait / 1000000), static_cast<long>(wait % 1000000) * 1000 };
+        nanosleep(&pause, NULL);
+    }
+    now_ = nowUs();
+    bool openLoop = options_.rate > 0;
+    for (size_t i = 0; i < conns_.size(); ++i) {
+        if (openLoop) {
+            // spread the connections' schedules evenly over one interval
+            int global = firstConnection_ + static_cast<int>(i);
+            conns_[i].nextUs = startUs_ + intervalUs_ * global / options_.connections;
+            sends_.push(Send(conns_[i].nextUs, i));
+        }
+        if (options_.keepAlive || !openLoop)
+            fill(i);
+    }
+
+    std::vector<struct epoll_event> events(1024);
+    long long nextTimeoutCheck = now_ + TIMEOUT_CHECK_US;
+    while (true) {
+        now_ = nowUs();
+        if (now_ >= endUs_)
+            break;
+        int waitMs = MAX_WAIT_MS;
+        if (!reconnect_.empty())
+            waitMs = 1;
+        if (!sends_.empty()) {
+            long long untilNext = static_cast<long long>(sends_.top().first) - now_;
+            int ms = untilNext <= 0 ? 0 : static_cast<int>((untilNext + 999) / 1000);
+            if (ms < waitMs)
+                waitMs = ms;
+        }
+        int ready = epoll_wait(epollFd_, &events[0], static_cast<int>(events.size()), waitMs);
+        now_ = nowUs();
+        for (int i = 0; i < ready; ++i) {
+            size_t index = static_cast<size_t>(events[i].data.u64);
+            if (conns_[index].fd == -1)
+                continue;   // closed earlier in this batch
+            if (events[i].events & EPOLLOUT)
+                onWritable(index);
+            if (conns_[index].fd != -1 && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+                onReadable(index);
+        }
+
+        while (!sends_.empty() && sends_.top().first <= now_) {
+            size_t index = sends_.top().second;
+            sends_.pop();
+            schedule(index);
+            if (conns_[index].nextUs < endUs_)
+                sends_.push(Send(conns_[index].nextUs, index));
+            fill(index);
+        }
+
+        if (!reconnect_.empty()) {
+            std::vector<size_t> pending;
+            pending.swap(reconnect_);
+            for (size_t i = 0; i < pending.size(); ++i) {
+                Connection& c = conns_[pending[i]];
+                if (c.fd != -1)
+                    continue;
+                if (now_ < c.retryUs)
+                    reconnect_.push_back(pending[i]);
+                else if (options_.keepAlive || !openLoop || !c.backlog.empty())
+                    fill(pending[i]);
+            }
+        }
+
+        if (now_ >= nextTimeoutCheck) {
+            checkTimeouts();
+            nextTimeoutCheck = now_ + TIMEOUT_CHECK_US;
+        }
+    }
+}
@@ -0,0 +1,128 @@
+#ifndef LOAD_WORKER_HPP
+#define LOAD_WORKER_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <utility>
+#include <netinet/in.h>
+#include "request_mix.hpp"
+#include "response_reader.hpp"
+#include "../../../src/utils/latency_histogram.hpp"
+
+struct BenchOptions {
+    struct sockaddr_in address;
+    std::string hostHeader;
+    int connections;
+    int threads;
+    double durationSec;
+    double warmupSec;
+    bool keepAlive;
+    int pipeline;           // requests in flight per connection
+    double rate;            // open loop: requests/s over all connections, 0 = closed loop
+    double timeoutSec;
+    size_t uploadBytes;
+    bool json;
+    RequestMix mix;
+
+    BenchOptions();
+};
+
+/* counters of one worker, merged into the totals at the end */
+struct BenchStats {
+    LatencyHistogram latency;       // open loop: from the intended send time (coordinated omission corrected)
+    LatencyHistogram uncorrected;   // from the moment the request was actually written
+    LatencyHistogram kindLatency[KIND_COUNT];
+    unsigned long long requests[KIND_COUNT];
+    unsigned long long statusClass[6];  // [1..5] = 1xx..5xx, [0] = anything else
+    unsigned long long bytesRead;
+    unsigned long long bytesWritten;
+    unsigned long long connects;
+    unsigned long long connectErrors;
+    unsigned long long readErrors;
+    unsigned long long writeErrors;
+    unsigned long long timeouts;
+    unsigned long long resets;          // requests lost to a connection closed under them
+    unsigned long long parseErrors;
+
+    BenchStats();
+    void merge(const BenchStats& other);
+    unsigned long long total() const;
+    unsigned long long errors() const;
+};
+
+/* one load-generating thread
+    - owns its connections and an epoll instance, nothing is shared while running
+    - closed loop: every connection keeps `pipeline` requests in flight
+    - open loop: each connection has a fixed send schedule; a request that can't go out on
+      time waits in a backlog and its latency still counts from the scheduled time
+*/
+class LoadWorker {
+public:
+    LoadWorker(const BenchOptions& options, int firstConnection, int connectionCount, unsigned int seed);
+    ~LoadWorker();
+
+    void setWindow(long long startUs, long long measureUs, long long endUs);
+    void openAll();     // connect now instead of at the start of run()
+    void run();
+    const BenchStats& stats() const { return stats_; }
+
+    static void* threadMain(void* worker);
+    static long long nowUs();
+
+private:
+    struct InFlight {
+        int kind;
+        long long intendedUs;
+        long long sentUs;
+    };
+
+    struct Connection {
+        int fd;
+        bool connecting;
+        bool wantWrite;             // EPOLLOUT registered
+        std::string out;
+        size_t outOffset;
+        std::deque<InFlight> inflight;
+        std::deque<long long> backlog;  // open loop: scheduled, not sent yet
+        double nextUs;                  // open loop: next scheduled send
+        long long retryUs;              // reconnect not before
+        unsigned int sentOnConnection;
+        ResponseReader reader;
+
+        Connection();
+    };
+
+    const BenchOptions& options_;
+    int firstConnection_;
+    std::vector<Connection> conns_;
+    int epollFd_;
+    unsigned int seed_;
+    double intervalUs_;     // open loop: per-connection send interval
+    long long startUs_;
+    long long measureUs_;
+    long long endUs_;
+    long long now_;
+    BenchStats stats_;
+    std::vector<char> buffer_;
+    std::vector<size_t> reconnect_;     // closed connections waiting for their retry time
+    typedef std::pair<double, size_t> Send;
+    std::priority_queue<Send, std::vector<Send>, std::greater<Send> > sends_; // open loop schedule
+
+    void openConnection(size_t index);
+    void closeConnection(size_t index);
+    void watch(size_t index, bool write);
+    void schedule(size_t index);
+    void fill(size_t index);
+    void flush(size_t index);
+    void onReadable(size_t index);
+    void onWritable(size_t index);
+    bool complete(size_t index);
+    void checkTimeouts();
+
+    LoadWorker(const LoadWorker&);
+    LoadWorker& operator=(const LoadWorker&);
+};
+
+#endif // LOAD_WORKER_HPP
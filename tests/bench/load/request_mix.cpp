@@ -0,0 +1,141 @@
+#include "request_mix.hpp"
+#include <cstdlib>
+#include <sstream>
+
+static const char* const KIND_NAMES[KIND_COUNT] = { "static", "autoindex", "404", "upload", "cgi" };
+
+RequestMix::RequestMix() : totalWeight_(0) {
+    paths_[KIND_STATIC] = "/index.html";
+    paths_[KIND_AUTOINDEX] = "/images/";
+    paths_[KIND_NOT_FOUND] = "/webserv-bench-missing.html";
+    paths_[KIND_UPLOAD] = "/upload/";
+    paths_[KIND_CGI] = "/cgi-bin/test.py?bench=1";
+    for (int i = 0; i < KIND_COUNT; ++i)
+        weights_[i] = 0;
+    weights_[KIND_STATIC] = 100;
+}
+
+const char* RequestMix::kindName(int kind) {
+    return (kind >= 0 && kind < KIND_COUNT) ? KIND_NAMES[kind] : "unknown";
+}
+
+int RequestMix::kindFromName(const std::string& name) {
+    for (int i = 0; i < KIND_COUNT; ++i) {
+        if (name == KIND_NAMES[i])
+            return i;
+    }
+    return -1;
+}
+
+bool RequestMix::parse(const std::string& spec, std::string& error) {
+    int weights[KIND_COUNT] = { 0, 0, 0, 0, 0 };
+    std::istringstream entries(spec);
+    std::string entry;
+    int total = 0;
+    while (std::getline(entries, entry, ',')) {
+        size_t colon = entry.find(':');
+        int kind = kindFromName(entry.substr(0, colon));
+        if (kind < 0) {
+            error = "unknown request kind in mix: " + entry;
+            return false;
+        }
+        int weight = colon == std::string::npos ? 1 : std::atoi(entry.c_str() + colon + 1);
+        if (weight < 0) {
+            error = "negative weight in mix: " + entry;
+            return false;
+        }
+        weights[kind] += weight;
+        total += weight;
+    }
+    if (total <= 0) {
+        error = "request mix has no weight: " + spec;
+        return false;
+    }
+    for (int i = 0; i < KIND_COUNT; ++i)
+        weights_[i] = weights[i];
+    return true;
+}
+
+bool RequestMix::setPath(const std::string& assignment, std::string& error) {
+    size_t equals = assignment.find('=');
+    int kind = kindFromName(assignment.substr(0, equals));
+    if (kind < 0 || equals == std::string::npos || assignment.size() == equals + 1
+        || assignment[equals + 1] != '/') {
+        error = "expected kind=/path, got " + assignment;
+        return false;
+    }
+    paths_[kind] = assignment.substr(equals + 1);
+    return true;
+}
+
+void RequestMix::build(const std::string& host, bool keepAlive, size_t uploadBytes, size_t cgiBodyBytes) {
+    templates_.clear();
+    totalWeight_ = 0;
+    const char* connection = keepAlive ? "keep-alive" : "close";
+    for (int kind = 0; kind < KIND_COUNT; ++kind) {
+        if (weights_[kind] <= 0)
+            continue;
+        RequestTemplate request;
+        request.kind = static_cast<RequestKind>(kind);
+        request.weight = weights_[kind];
+        std::ostringstream bytes;
+        if (kind == KIND_UPLOAD) {
+            const std::string boundary = "----webservbench7d1f0c";
+            std::string body = "--" + boundary + "\r\n"
+                "Content-Disposition: form-data; name=\"file\"; filename=\"webserv-bench.bin\"\r\n"
+                "Content-Type: application/octet-stream\r\n\r\n"
+                + std::string(uploadBytes, 'x') + "\r\n--" + boundary + "--\r\n";
+            bytes << "POST " << paths_[kind] << " HTTP/1.1\r\n"
+                  << "Host: " << host << "\r\n"
+                  << "User-Agent: webserv-bench\r\n"
+                  << "Connection: " << connection << "\r\n"
+                  << "Content-Type: multipart/form-data; boundary=" << boundary << "\r\n"
+                  << "Content-Length: " << body.size() << "\r\n\r\n"
+                  << body;
+        } else if (kind == KIND_CGI && cgiBodyBytes > 0) {
+            bytes << "POST " << paths_[kind] << " HTTP/1.1\r\n"
+                  << "Host: " << host << "\r\n"
+                  << "User-Agent: webserv-bench\r\n"
+                  << "Connection: " << connection << "\r\n"
+                  << "Content-Type: application/octet-stream\r\n"
+                  << "Content-Length: " << cgiBodyBytes << "\r\n\r\n"
+                  << std::string(cgiBodyBytes, 'x');
+        } else {
+            bytes << "GET " << paths_[kind] << " HTTP/1.1\r\n"
+                  << "Host: " << host << "\r\n"
+                  << "User-Agent: webserv-bench\r\n"
+                  << "Accept: */*\r\n"
+                  << "Connection: " << connection << "\r\n\r\n";
+        }
+        request.bytes = bytes.str();
+        templates_.push_back(request);
+        totalWeight_ += request.weight;
+    }
+}
+
+const RequestTemplate& RequestMix::pick(unsigned int& seed) const {
+    if (templates_.size() == 1)
+        return templates_[0];
+    int r = rand_r(&seed) % totalWeight_;
+    for (size_t i = 0; i + 1 < templates_.size(); ++i) {
+        if (r < templates_[i].weight)
+            return templates_[i];
+        r -= templates_[i].weight;
+    }
+    return templates_.back();
+}
+
+std::string RequestMix::describe() const {
+    int total = 0;
+    for (int i = 0; i < KIND_COUNT; ++i)
+        total += weights_[i];
+    std::ostringstream out;
+    for (int i = 0; i < KIND_COUNT; ++i) {
+        if (weights_[i] <= 0)
+            continue;
+        if (!out.str().empty())
+            out << ", ";
+        out << KIND_NAMES[i] << " " << (weights_[i] * 100.0 / total) << "% (" << paths_[i] << ")";
+    }
+    return out.str();
+}
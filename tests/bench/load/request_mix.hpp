@@ -0,0 +1,54 @@
+#ifndef REQUEST_MIX_HPP
+#define REQUEST_MIX_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+enum RequestKind {
+    KIND_STATIC,        // GET of a small static page
+    KIND_AUTOINDEX,     // GET of a directory listing
+    KIND_NOT_FOUND,     // GET of a missing file (error page)
+    KIND_UPLOAD,        // multipart/form-data POST of one file
+    KIND_CGI,           // GET of a CGI script
+    KIND_COUNT
+};
+
+/* one prepared request, built once and replayed byte for byte */
+struct RequestTemplate {
+    RequestKind kind;
+    int weight;
+    std::string bytes;
+};
+
+/* weighted request mix
+    - spec "static:70,404:10,cgi:20", kinds: static autoindex 404 upload cgi
+    - paths default to what config/default.conf serves, "kind=/path" overrides one
+    - picking a request is one random number and a walk over at most KIND_COUNT entries
+    - cgi is a GET, or a POST of cgiBodyBytes when build() gets some
+*/
+class RequestMix {
+public:
+    RequestMix();
+
+    static const char* kindName(int kind);
+
+    bool parse(const std::string& spec, std::string& error);
+    bool setPath(const std::string& assignment, std::string& error);
+    void build(const std::string& host, bool keepAlive, size_t uploadBytes, size_t cgiBodyBytes = 0);
+
+    const RequestTemplate& pick(unsigned int& seed) const;
+    const std::string& path(int kind) const { return paths_[kind]; }
+    int weight(int kind) const { return weights_[kind]; }
+    std::string describe() const;   // "static 70%, 404 30%"
+
+private:
+    std::string paths_[KIND_COUNT];
+    int weights_[KIND_COUNT];
+    int totalWeight_;
+    std::vector<RequestTemplate> templates_;    // kinds with a weight only
+
+    static int kindFromName(const std::string& name);
+};
+
+#endif // REQUEST_MIX_HPP
@@ -0,0 +1,153 @@
+#include "response_reader.hpp"
+#include <cstring>
+#include <cstdlib>
+#include <strings.h>
+
+static const size_t MAX_LINE = 16 * 1024;
+
+ResponseReader::ResponseReader() {
+    reset();
+}
+
+void ResponseReader::reset() {
+    state_ = HEADERS;
+    started_ = false;
+    line_.clear();
+    remaining_ = 0;
+    contentLength_ = -1;
+    chunked_ = false;
+    status_ = 0;
+    close_ = false;
+    body_ = 0;
+}
+
+// appends up to the next LF to line_, complete = the line ended (CRLF stripped)
+size_t ResponseReader::takeLine(const char* data, size_t length, bool& complete) {
+    const char* lf = static_cast<const char*>(std::memchr(data, '\n', length));
+    size_t used = lf ? static_cast<size_t>(lf - data) + 1 : length;
+    line_.append(data, used);
+    complete = lf != NULL;
+    if (complete) {
+        line_.erase(line_.size() - 1);
+        if (!line_.empty() && line_[line_.size() - 1] == '\r')
+            line_.erase(line_.size() - 1);
+    } else if (line_.size() > MAX_LINE) {
+        state_ = FAILED;
+    }
+    return used;
+}
+
+void ResponseReader::headerLine() {
+    if (status_ == 0) {
+        // "HTTP/1.1 200 OK"
+        if (line_.compare(0, 5, "HTTP/") != 0 || line_.size() < 12) {
+            state_ = FAILED;
+            return;
+        }
+        status_ = std::atoi(line_.c_str() + 9);
+        if (status_ < 100 || status_ > 999)
+            state_ = FAILED;
+        if (line_.compare(0, 8, "HTTP/1.0") == 0)
+            close_ = true;
+        return;
+    }
+    size_t colon = line_.find(':');
+    if (colon == std::string::npos)
+        return;
+    std::string name = line_.substr(0, colon);
+    size_t start = line_.find_first_not_of(" \t", colon + 1);
+    std::string value = start == std::string::npos ? std::string() : line_.substr(start);
+    if (strcasecmp(name.c_str(), "Content-Length") == 0)
+        contentLength_ = std::atoll(value.c_str());
+    else if (strcasecmp(name.c_str(), "Transfer-Encoding") == 0)
+        chunked_ = strcasecmp(value.c_str(), "chunked") == 0;
+    else if (strcasecmp(name.c_str(), "Connection") == 0)
+        close_ = strcasecmp(value.c_str(), "close") == 0;
+}
+
+void ResponseReader::headersDone() {
+    if (status_ == 0) {
+        state_ = FAILED;
+    } else if (status_ < 200 || status_ == 204 || status_ == 304) {
+        state_ = DONE;
+    } else if (chunked_) {
+        state_ = CHUNK_SIZE;
+    } else if (contentLength_ >= 0) {
+        remaining_ = static_cast<unsigned long long>(contentLength_);
+        state_ = remaining_ ? BODY_LENGTH : DONE;
+    } else {
+        state_ = BODY_EOF;
+        close_ = true;
+    }
+}
+
+size_t ResponseReader::feed(const char* data, size_t length) {
+    size_t used = 0;
+    if (length)
+        started_ = true;
+    while (used < length && state_ != DONE && state_ != FAILED) {
+        const char* at = data + used;
+        size_t left = length - used;
+        bool complete = false;
+        switch (state_) {
+        case HEADERS:
+            used += takeLine(at, left, complete);
+            if (!complete)
+                break;
+            if (line_.empty())
+                headersDone();
+            else
+                headerLine();
+            line_.clear();
+            break;
+        case BODY_LENGTH:
+        case CHUNK_DATA: {
+            size_t take = left < remaining_ ? left : static_cast<size_t>(remaining_);
+            used += take;
+            body_ += take;
+            remaining_ -= take;
+            if (remaining_ == 0)
+                state_ = state_ == BODY_LENGTH ? DONE : CHUNK_END;
+            break;
+        }
+        case BODY_EOF:
+            body_ += left;
+            used = length;
+            break;
+        case CHUNK_SIZE:
+            used += takeLine(at, left, complete);
+            if (!complete)
+                break;
+            if (line_.empty()) {
+                state_ = FAILED;
+                break;
+            }
+            remaining_ = std::strtoull(line_.c_str(), NULL, 16);
+            state_ = remaining_ ? CHUNK_DATA : TRAILERS;
+            line_.clear();
+            break;
+        case CHUNK_END:
+            used += takeLine(at, left, complete);
+            if (!complete)
+                break;
+            state_ = line_.empty() ? CHUNK_SIZE : FAILED;
+            line_.clear();
+            break;
+        case TRAILERS:
+            used += takeLine(at, left, complete);
+            if (complete && line_.empty())
+                state_ = DONE;
+            line_.clear();
+            break;
+        default:
+            break;
+        }
+    }
+    return used;
+}
+
+bool ResponseReader::finishAtEof() {
+    if (state_ == BODY_EOF)
+        state_ = DONE;
+    return state_ == DONE;
+}
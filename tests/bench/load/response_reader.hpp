@@ -0,0 +1,55 @@
+#ifndef RESPONSE_READER_HPP
+#define RESPONSE_READER_HPP
+
+#include <string>
+#include <cstddef>
+
+/* incremental HTTP/1.x response framing
+    - feed() stops at the end of one response, pipelined bytes behind it stay with the caller
+    - Content-Length, chunked and close-delimited bodies; 1xx/204/304 have none
+    - only the framing is parsed, body bytes are counted and dropped
+*/
+class ResponseReader {
+public:
+    ResponseReader();
+
+    void reset();
+    size_t feed(const char* data, size_t length);   // bytes consumed
+    bool finishAtEof();     // connection closed: true if that ended the response
+
+    bool done() const { return state_ == DONE; }
+    bool failed() const { return state_ == FAILED; }
+    bool started() const { return started_; }
+    int status() const { return status_; }
+    bool keepAlive() const { return !close_; }
+    unsigned long long bodyBytes() const { return body_; }
+
+private:
+    enum State {
+        HEADERS,
+        BODY_LENGTH,
+        BODY_EOF,
+        CHUNK_SIZE,
+        CHUNK_DATA,
+        CHUNK_END,
+        TRAILERS,
+        DONE,
+        FAILED
+    };
+
+    State state_;
+    bool started_;
+    std::string line_;              // status, header, chunk size or trailer line so far
+    unsigned long long remaining_;  // body or chunk bytes still expected
+    long long contentLength_;       // -1 = no Content-Length
+    bool chunked_;
+    int status_;
+    bool close_;
+    unsigned long long body_;
+
+    size_t takeLine(const char* data, size_t length, bool& complete);
+    void headerLine();
+    void headersDone();
+};
+
+#endif // RESPONSE_READER_HPP
@@ -0,0 +1,32 @@
+#!/bin/bash
+# Run one of the benchmarks here against a freshly started webserv
+# usage: tests/bench/load/run_bench.sh BENCH CONFIG [options...]
+#   e.g. tests/bench/load/run_bench.sh conn_scaling config/bench_scaling.conf --levels 0,1000,10000 --json
+#        tests/bench/load/run_bench.sh upload_bench config/bench_upload.conf --sizes 1M,2G --clients 1
+#        tests/bench/load/run_bench.sh cgi_bench config/bench_cgi.conf --targets python=/python/bench_payload.py --clients 1,16
+# BENCH gets --pid of the server; the config needs a stub_status location (/status) on
+# port 8080, or pass -p/--status to match it
+
+cd "$(dirname "$0")/../../.." || exit 1
+
+if [ $# -lt 2 ]; then
+    echo "usage: $0 BENCH CONFIG [options...]" >&2
+    exit 2
+fi
+BENCH=$1
+CONFIG=$2
+shift 2
+
+# the server and the client both hold one fd per connection
+ulimit -n "$(ulimit -Hn)" 2>/dev/null
+
+./webserv "$CONFIG" > /tmp/webserv_bench.log 2>&1 &
+SERVER=$!
+trap 'kill $SERVER 2>/dev/null; wait $SERVER 2>/dev/null' EXIT
+
+for _ in $(seq 50); do
+    (exec 3<>/dev/tcp/127.0.0.1/8080) 2>/dev/null && break
+    sleep 0.1
+done
+
+tests/bench/load/"$BENCH" --pid "$SERVER" "$@"
@@ -0,0 +1,156 @@
+#include "server_probe.hpp"
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+ServerProbe::ServerProbe(const struct sockaddr_in& server, const std::string& hostHeader, const std::string& path)
+    : server_(server), fd_(-1) {
+    std::string separator = path.find('?') == std::string::npos ? "?" : "&";
+    request_ = "GET " + path + separator + "format=prometheus HTTP/1.1\r\nHost: " + hostHeader + "\r\n\r\n";
+}
+
+ServerProbe::~ServerProbe() {
+    disconnect();
+}
+
+void ServerProbe::disconnect() {
+    if (fd_ != -1)
+        close(fd_);
+    fd_ = -1;
+}
+
+// blocking, with a 5 s receive timeout: a probe is a handful of requests
+bool ServerProbe::connect() {
+    if (fd_ != -1)
+        return true;
+    fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ == -1)
+        return false;
+    struct timeval timeout = { 5, 0 };
+    setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (::connect(fd_, reinterpret_cast<const struct sockaddr*>(&server_), sizeof(server_)) == -1) {
+        disconnect();
+        return false;
+    }
+    return true;
+}
+
+/* one request, the body of a Content-Length response back */
+bool ServerProbe::exchange(std::string& body) {
+    if (send(fd_, request_.data(), request_.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(request_.size()))
+        return false;
+    std::string data;
+    char buffer[16384];
+    size_t headerEnd = std::string::npos;
+    size_t length = 0;
+    while (true) {
+        if (headerEnd == std::string::npos) {
+            headerEnd = data.find("\r\n\r\n");
+            if (headerEnd != std::string::npos) {
+                std::string head = data.substr(0, headerEnd);
+                for (size_t i = 0; i < head.size(); ++i)
+                    head[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(head[i])));
+                size_t field = head.find("\r\ncontent-length:");
+                if (head.size() < 12 || head.compare(9, 3, "200") != 0 || field == std::string::npos)
+                    return false;
+                length = std::strtoul(head.c_str() + field + 17, NULL, 10);
+                headerEnd += 4;
+            }
+        }
+        if (headerEnd != std::string::npos && data.size() >= headerEnd + length) {
+            body = data.substr(headerEnd, length);
+            return true;
+        }
+        ssize_t received = recv(fd_, buffer, sizeof(buffer), 0);
+        if (received <= 0)
+            return false;
+        data.append(buffer, static_cast<size_t>(received));
+    }
+}
+
+bool ServerProbe::fetch(Metrics& metrics) {
+    std::string body;
+    bool ok = connect() && exchange(body);
+    if (!ok) {
+        disconnect();   // idle timeout or keep-alive limit on the server side: try once more
+        ok = connect() && exchange(body);
+    }
+    if (!ok) {
+        disconnect();
+        return false;
+    }
+    metrics.clear();
+    std::istringstream lines(body);
+    std::string line;
+    while (std::getline(lines, line)) {
+        size_t space = line.rfind(' ');
+        if (line.empty() || line[0] == '#' || space == std::string::npos)
+            continue;
+        metrics[line.substr(0, space)] = std::atof(line.c_str() + space + 1);
+    }
+    return true;
+}
+
+double ServerProbe::value(const Metrics& metrics, const std::string& name) {
+    Metrics::const_iterator it = metrics.find(name);
+    return it == metrics.end() ? 0 : it->second;
+}
+
+bool ServerProbe::memory(int pid, long& rssKb, long& peakKb) {
+    char path[64];
+    std::snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    FILE* file = std::fopen(path, "r");
+    if (!file)
+        return false;
+    rssKb = -1;
+    peakKb = -1;
+    char line[256];
+    while (std::fgets(line, sizeof(line), file)) {
+        if (std::strncmp(line, "VmRSS:", 6) == 0)
+            rssKb = std::atol(line + 6);
+        else if (std::strncmp(line, "VmHWM:", 6) == 0)
+            peakKb = std::atol(line + 6);
+    }
+    std::fclose(file);
+    return rssKb >= 0;
+}
+
+// clear_refs "5" resets the high-water mark: each measurement gets its own peak
+bool ServerProbe::resetPeak(int pid) {
+    char path[64];
+    std::snprintf(path, sizeof(path), "/proc/%d/clear_refs", pid);
+    int fd = open(path, O_WRONLY);
+    if (fd == -1)
+        return false;
+    bool ok = write(fd, "5", 1) == 1;
+    close(fd);
+    return ok;
+}
+
+// utime and stime are fields 14 and 15 of /proc/<pid>/stat, counted after the ")" of the name
+bool ServerProbe::cpuSeconds(int pid, double& seconds) {
+    char path[64];
+    std::snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE* file = std::fopen(path, "r");
+    if (!file)
+        return false;
+    char line[1024];
+    bool ok = std::fgets(line, sizeof(line), file) != NULL;
+    std::fclose(file);
+    const char* fields = ok ? std::strrchr(line, ')') : NULL;
+    if (!fields)
+        return false;
+    unsigned long user = 0;
+    unsigned long system = 0;
+    // state ppid pgrp session tty tpgid flags minflt cminflt majflt cmajflt utime stime
+    if (std::sscanf(fields + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &user, &system) != 2)
+        return false;
+    seconds = static_cast<double>(user + system) / sysconf(_SC_CLK_TCK);
+    return true;
+}
@@ -0,0 +1,40 @@
+#ifndef SERVER_PROBE_HPP
+#define SERVER_PROBE_HPP
+
+#include <string>
+#include <map>
+#include <netinet/in.h>
+
+/* the server's own view, read between measurements
+    - stub_status in Prometheus format over one keep-alive connection: opened before
+      a benchmark fills the server's fd table, it still gets through afterwards
+    - memory and CPU time from /proc/<pid>, the server has to run on this host
+*/
+class ServerProbe {
+public:
+    typedef std::map<std::string, double> Metrics;     // "name{labels}" -> value
+
+    ServerProbe(const struct sockaddr_in& server, const std::string& hostHeader, const std::string& path);
+    ~ServerProbe();
+
+    bool connect();
+    bool fetch(Metrics& metrics);   // reconnects once if the connection was dropped
+
+    static bool memory(int pid, long& rssKb, long& peakKb);     // VmRSS, VmHWM
+    static bool resetPeak(int pid);                             // VmHWM back to the current RSS
+    static bool cpuSeconds(int pid, double& seconds);           // user + system time so far
+    static double value(const Metrics& metrics, const std::string& name);  // 0 if missing
+
+private:
+    struct sockaddr_in server_;
+    std::string request_;
+    int fd_;
+
+    bool exchange(std::string& body);
+    void disconnect();
+
+    ServerProbe(const ServerProbe&);
+    ServerProbe& operator=(const ServerProbe&);
+};
+
+#endif // SERVER_PROBE_HPP
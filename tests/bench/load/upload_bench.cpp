@@ -0,0 +1,386 @@
+// Upload throughput: Content-Length, chunked and multipart bodies from 1 KB to GBs, fast and slow senders
+// Build: make bench   Run: make bench-upload, or tests/bench/load/upload_bench --help
+#include "upload_runner.hpp"
+#include "server_probe.hpp"
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <signal.h>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+
+struct UploadOptions {
+    struct sockaddr_in address;
+    std::string hostHeader;
+    std::string path;
+    std::string statusPath;
+    std::vector<int> encodings;
+    std::vector<unsigned long long> sizes;
+    std::vector<int> clients;
+    int slowClients;
+    double slowRate;
+    unsigned long long volume;          // payload per scenario, split over the clients
+    unsigned long long maxInflight;     // skip scenarios with more body bytes in flight at once
+    size_t chunkBytes;
+    double timeoutSec;
+    int pid;
+    bool json;
+
+    UploadOptions()
+        : hostHeader("localhost"), path("/upload/"), statusPath("/status"), slowClients(0), slowRate(0),
+          volume(64ULL << 20), maxInflight(256ULL << 20), chunkBytes(16384), timeoutSec(30), pid(0), json(false) {
+        address.sin_family = AF_INET;
+        address.sin_port = htons(8080);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    }
+};
+
+/* one row of the report */
+struct ScenarioReport {
+    UploadScenario scenario;
+    UploadResult result;
+    double cpuSeconds;
+    long rssKb;             // before the scenario
+    long peakKb;            // high-water mark during the scenario
+    double receivedBytes;   // stub_status: bytes the server read
+    double iterations;      // stub_status: loop wake-ups
+};
+
+static const int MAX_UPLOADS_PER_CLIENT = 1000;
+
+static void usage(const char* name) {
+    std::cout
+        << "usage: " << name << " [options]\n"
+        << "  -H, --host ADDR          server IPv4 address (127.0.0.1)\n"
+        << "  -p, --port PORT          server port (8080)\n"
+        << "      --host-header NAME   Host header (localhost)\n"
+        << "  -u, --path PATH          upload location, needs no client_max_body_size limit (/upload/)\n"
+        << "  -e, --encodings LIST     length,chunked,multipart (all)\n"
+        << "  -s, --sizes LIST         body sizes, K/M/G suffixes (1K,64K,1M,16M)\n"
+        << "  -c, --clients LIST       concurrent uploading clients (1,16,64)\n"
+        << "      --slow N@RATE        N more clients sending at RATE bytes/s each, e.g. 16@64K\n"
+        << "  -V, --volume BYTES       payload per scenario, at least one upload per client (64M)\n"
+        << "      --max-inflight BYTES skip scenarios with size x clients above this (256M)\n"
+        << "      --chunk-size BYTES   chunk size of chunked bodies (16K)\n"
+        << "  -T, --timeout SEC        an upload without progress for this long fails (30)\n"
+        << "  -S, --status PATH        stub_status location for loop counters (/status)\n"
+        << "      --pid PID            server pid, for CPU time and peak RSS from /proc\n"
+        << "  -j, --json               JSON report\n"
+        << "the server holds ~8 copies of a body today, size --max-inflight to the machine's memory;\n"
+        << "a 2G upload: --sizes 2G --clients 1 --max-inflight 2G\n"
+        << "cpu s/GB rising with the size points at quadratic parsing, amp (peak RSS growth over the\n"
+        << "bytes in flight) at per-copy buffering, KB/iter (bytes read per loop wake-up) at the read size\n";
+}
+
+static bool parseBytes(const std::string& text, unsigned long long& bytes) {
+    char* end;
+    double value = std::strtod(text.c_str(), &end);
+    unsigned long long unit = 1;
+    if (*end == 'k' || *end == 'K')
+        unit = 1ULL << 10;
+    else if (*end == 'm' || *end == 'M')
+        unit = 1ULL << 20;
+    else if (*end == 'g' || *end == 'G')
+        unit = 1ULL << 30;
+    if (unit != 1)
+        ++end;
+    if (end == text.c_str() || *end != '\0' || value < 0)
+        return false;
+    bytes = static_cast<unsigned long long>(value * unit);
+    return true;
+}
+
+static std::string formatBytes(unsigned long long bytes) {
+    static const char* const units[] = { "", "K", "M", "G" };
+    int unit = 0;
+    while (unit < 3 && bytes >= 1024 && bytes % 1024 == 0) {
+        bytes /= 1024;
+        ++unit;
+    }
+    std::ostringstream out;
+    out << bytes << units[unit];
+    return out.str();
+}
+
+static std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> items;
+    std::istringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ','))
+        items.push_back(item);
+    return items;
+}
+
+static bool parseLists(UploadOptions& options, const std::string& encodings, const std::string& sizes,
+                       const std::string& clients, const std::string& slow) {
+    std::vector<std::string> items = splitList(encodings);
+    for (size_t i = 0; i < items.size(); ++i) {
+        int encoding = UploadStream::encodingFromName(items[i]);
+        if (encoding < 0) {
+            std::cerr << "unknown encoding: " << items[i] << " (length, chunked, multipart)" << std::endl;
+            return false;
+        }
+        options.encodings.push_back(encoding);
+    }
+    items = splitList(sizes);
+    for (size_t i = 0; i < items.size(); ++i) {
+        unsigned long long bytes;
+        if (!parseBytes(items[i], bytes)) {
+            std::cerr << "invalid size: " << items[i] << std::endl;
+            return false;
+        }
+        options.sizes.push_back(bytes);
+    }
+    items = splitList(clients);
+    for (size_t i = 0; i < items.size(); ++i) {
+        int count = std::atoi(items[i].c_str());
+        if (count < 1) {
+            std::cerr << "invalid client count: " << items[i] << std::endl;
+            return false;
+        }
+        options.clients.push_back(count);
+    }
+    if (!slow.empty()) {
+        size_t at = slow.find('@');
+        unsigned long long rate;
+        if (at == std::string::npos || !parseBytes(slow.substr(at + 1), rate) || rate == 0
+            || std::atoi(slow.c_str()) < 1) {
+            std::cerr << "invalid --slow, expected N@RATE: " << slow << std::endl;
+            return false;
+        }
+        options.slowClients = std::atoi(slow.c_str());
+        options.slowRate = static_cast<double>(rate);
+    }
+    return !options.encodings.empty() && !options.sizes.empty() && !options.clients.empty();
+}
+
+static bool parseOptions(int argc, char** argv, UploadOptions& options) {
+    static const struct option longOptions[] = {
+        { "host", required_argument, NULL, 'H' },
+        { "port", required_argument, NULL, 'p' },
+        { "host-header", required_argument, NULL, 'A' },
+        { "path", required_argument, NULL, 'u' },
+        { "encodings", required_argument, NULL, 'e' },
+        { "sizes", required_argument, NULL, 's' },
+        { "clients", required_argument, NULL, 'c' },
+        { "slow", required_argument, NULL, 'L' },
+        { "volume", required_argument, NULL, 'V' },
+        { "max-inflight", required_argument, NULL, 'M' },
+        { "chunk-size", required_argument, NULL, 'C' },
+        { "timeout", required_argument, NULL, 'T' },
+        { "status", required_argument, NULL, 'S' },
+        { "pid", required_argument, NULL, 'P' },
+        { "json", no_argument, NULL, 'j' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    std::string encodings = "length,chunked,multipart";
+    std::string sizes = "1K,64K,1M,16M";
+    std::string clients = "1,16,64";
+    std::string slow;
+    unsigned long long bytes;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "H:p:u:e:s:c:V:T:S:jh", longOptions, NULL)) != -1) {
+        switch (opt) {
+        case 'H':
+            if (inet_pton(AF_INET, optarg, &options.address.sin_addr) != 1) {
+                std::cerr << "invalid IPv4 address: " << optarg << std::endl;
+                return false;
+            }
+            break;
+        case 'p': options.address.sin_port = htons(static_cast<unsigned short>(std::atoi(optarg))); break;
+        case 'A': options.hostHeader = optarg; break;
+        case 'u': options.path = optarg; break;
+        case 'e': encodings = optarg; break;
+        case 's': sizes = optarg; break;
+        case 'c': clients = optarg; break;
+        case 'L': slow = optarg; break;
+        case 'V':
+        case 'M':
+        case 'C':
+            if (!parseBytes(optarg, bytes) || bytes == 0) {
+                std::cerr << "invalid byte count: " << optarg << std::endl;
+                return false;
+            }
+            if (opt == 'V')
+                options.volume = bytes;
+            else if (opt == 'M')
+                options.maxInflight = bytes;
+            else
+                options.chunkBytes = static_cast<size_t>(bytes);
+            break;
+        case 'T': options.timeoutSec = std::atof(optarg); break;
+        case 'S': options.statusPath = optarg; break;
+        case 'P': options.pid = std::atoi(optarg); break;
+        case 'j': options.json = true; break;
+        case 'h':
+            usage(argv[0]);
+            std::exit(0);
+        default:
+            usage(argv[0]);
+            return false;
+        }
+    }
+    if (options.timeoutSec <= 0) {
+        std::cerr << "timeout must be positive" << std::endl;
+        return false;
+    }
+    return parseLists(options, encodings, sizes, clients, slow);
+}
+
+static bool runScenario(const UploadOptions& options, ServerProbe& probe, const UploadScenario& scenario,
+                        ScenarioReport& report) {
+    ServerProbe::Metrics before, after;
+    bool counters = probe.fetch(before);
+    double cpuBefore = 0;
+    double cpuAfter = 0;
+    long peakKb = -1;
+    report.rssKb = report.peakKb = -1;
+    if (options.pid > 0) {
+        ServerProbe::resetPeak(options.pid);
+        ServerProbe::memory(options.pid, report.rssKb, peakKb);
+        ServerProbe::cpuSeconds(options.pid, cpuBefore);
+    }
+    UploadRunner runner(options.address, options.hostHeader, options.path, options.chunkBytes, options.timeoutSec);
+    report.scenario = scenario;
+    if (!runner.run(scenario, report.result))
+        return false;
+    long rssKb = -1;
+    if (options.pid > 0) {
+        ServerProbe::cpuSeconds(options.pid, cpuAfter);
+        ServerProbe::memory(options.pid, rssKb, report.peakKb);
+    }
+    report.cpuSeconds = cpuAfter - cpuBefore;
+    counters = counters && probe.fetch(after);
+    report.receivedBytes = counters ? ServerProbe::value(after, "webserv_received_bytes_total")
+                                    - ServerProbe::value(before, "webserv_received_bytes_total") : 0;
+    report.iterations = counters ? ServerProbe::value(after, "webserv_event_loop_iterations_total")
+                                 - ServerProbe::value(before, "webserv_event_loop_iterations_total") : 0;
+    return true;
+}
+
+static double megabytesPerSecond(const ScenarioReport& r) {
+    return r.result.seconds > 0 ? r.result.payloadBytes / 1048576.0 / r.result.seconds : 0;
+}
+
+// server CPU per GB the server received, slow senders included
+static double cpuPerGigabyte(const ScenarioReport& r) {
+    double gigabytes = (r.result.payloadBytes + r.result.slowBytes) / 1073741824.0;
+    return gigabytes > 0 && r.cpuSeconds >= 0 ? r.cpuSeconds / gigabytes : 0;
+}
+
+// peak RSS growth per body byte in flight: 1 = one copy of every body held at once;
+// heap kept from an earlier, larger scenario hides the growth, run a size alone for exact numbers
+static double amplification(const ScenarioReport& r) {
+    double inflight = static_cast<double>(r.scenario.bodyBytes) * r.scenario.clients;
+    if (r.peakKb < 0 || r.rssKb < 0 || inflight <= 0 || r.peakKb < r.rssKb)
+        return 0;
+    return (r.peakKb - r.rssKb) * 1024.0 / inflight;
+}
+
+static double kilobytesPerIteration(const ScenarioReport& r) {
+    return r.iterations > 0 ? r.receivedBytes / 1024.0 / r.iterations : 0;
+}
+
+static void reportText(const UploadOptions& options, const std::vector<ScenarioReport>& reports) {
+    char host[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &options.address.sin_addr, host, sizeof(host));
+    std::ostringstream out;
+    out << "upload_bench " << host << ":" << ntohs(options.address.sin_port) << " POST " << options.path;
+    if (options.slowClients)
+        out << ", plus " << options.slowClients << " slow clients at " << formatBytes(static_cast<unsigned long long>(options.slowRate)) << "B/s";
+    out << "\n\n"
+        << "encoding      size clients uploads     MB/s    p50_ms    p99_ms  cpu_s/GB  peak_MB   amp  KB/iter  failed\n";
+    for (size_t i = 0; i < reports.size(); ++i) {
+        const ScenarioReport& r = reports[i];
+        out << std::left << std::setw(10) << UploadStream::encodingName(r.scenario.encoding) << std::right
+            << std::setw(8) << formatBytes(r.scenario.bodyBytes) << std::setw(8) << r.scenario.clients
+            << std::setw(8) << r.result.uploads << std::fixed << std::setprecision(1)
+            << std::setw(9) << megabytesPerSecond(r) << std::setprecision(2)
+            << std::setw(10) << r.result.latency.percentile(50) / 1000.0
+            << std::setw(10) << r.result.latency.percentile(99) / 1000.0
+            << std::setw(10) << cpuPerGigabyte(r) << std::setprecision(1)
+            << std::setw(9) << (r.peakKb < 0 ? 0.0 : r.peakKb / 1024.0)
+            << std::setw(6) << amplification(r) << std::setw(9) << kilobytesPerIteration(r)
+            << std::setw(8) << r.result.failed << "\n";
+    }
+    if (options.pid <= 0)
+        out << "(no --pid: CPU and memory not measured)\n";
+    std::cout << out.str() << std::flush;
+}
+
+static void reportJson(const UploadOptions& options, const std::vector<ScenarioReport>& reports) {
+    char host[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &options.address.sin_addr, host, sizeof(host));
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << "{\n  \"target\": \"" << host << ":" << ntohs(options.address.sin_port) << "\",\n"
+        << "  \"path\": \"" << options.path << "\",\n"
+        << "  \"slow_clients\": " << options.slowClients << ",\n"
+        << "  \"slow_rate\": " << options.slowRate << ",\n"
+        << "  \"scenarios\": [";
+    for (size_t i = 0; i < reports.size(); ++i) {
+        const ScenarioReport& r = reports[i];
+        out << (i ? ",\n" : "\n")
+            << "    {\"encoding\": \"" << UploadStream::encodingName(r.scenario.encoding) << "\""
+            << ", \"size\": " << r.scenario.bodyBytes << ", \"clients\": " << r.scenario.clients
+            << ", \"uploads\": " << r.result.uploads << ", \"failed\": " << r.result.failed
+            << ", \"seconds\": " << r.result.seconds << ", \"mb_per_s\": " << megabytesPerSecond(r)
+            << ", \"slow_bytes\": " << r.result.slowBytes
+            << ", \"latency_us\": {\"p50\": " << r.result.latency.percentile(50)
+            << ", \"p99\": " << r.result.latency.percentile(99) << ", \"max\": " << r.result.latency.maxUs() << "}"
+            << ", \"cpu_s_per_gb\": " << cpuPerGigabyte(r) << ", \"rss_kb\": " << r.rssKb
+            << ", \"peak_rss_kb\": " << r.peakKb << ", \"amplification\": " << amplification(r)
+            << ", \"kb_per_iteration\": " << kilobytesPerIteration(r) << "}";
+    }
+    out << "\n  ]\n}\n";
+    std::cout << out.str() << std::flush;
+}
+
+int main(int argc, char** argv) {
+    UploadOptions options;
+    if (!parseOptions(argc, argv, options))
+        return 2;
+    signal(SIGPIPE, SIG_IGN);
+
+    ServerProbe probe(options.address, options.hostHeader, options.statusPath);
+    std::vector<ScenarioReport> reports;
+    for (size_t e = 0; e < options.encodings.size(); ++e) {
+        for (size_t s = 0; s < options.sizes.size(); ++s) {
+            for (size_t c = 0; c < options.clients.size(); ++c) {
+                UploadScenario scenario;
+                scenario.encoding = static_cast<UploadEncoding>(options.encodings[e]);
+                scenario.bodyBytes = options.sizes[s];
+                scenario.clients = options.clients[c];
+                scenario.slowClients = options.slowClients;
+                scenario.slowRate = options.slowRate;
+                unsigned long long inflight = scenario.bodyBytes * scenario.clients;
+                if (inflight > options.maxInflight) {
+                    std::cerr << "skip " << UploadStream::encodingName(scenario.encoding) << " "
+                              << formatBytes(scenario.bodyBytes) << " x " << scenario.clients
+                              << ": above --max-inflight " << formatBytes(options.maxInflight) << std::endl;
+                    continue;
+                }
+                unsigned long long perClient = options.volume / (inflight ? inflight : 1);
+                scenario.uploadsPerClient = perClient < 1 ? 1
+                    : static_cast<int>(perClient > MAX_UPLOADS_PER_CLIENT ? MAX_UPLOADS_PER_CLIENT : perClient);
+                ScenarioReport report;
+                if (!runScenario(options, probe, scenario, report)) {
+                    std::cerr << "cannot connect to the server" << std::endl;
+                    return 1;
+                }
+                if (!options.json)
+                    std::cerr << UploadStream::encodingName(scenario.encoding) << " " << formatBytes(scenario.bodyBytes)
+                              << " x " << scenario.clients << ": " << std::fixed << std::setprecision(1)
+                              << megabytesPerSecond(report) << " MB/s" << std::endl;
+                reports.push_back(report);
+            }
+        }
+    }
+    if (options.json)
+        reportJson(options, reports);
+    else
+        reportText(options, reports);
+    return 0;
+}
@@ -0,0 +1,289 @@
+#include "upload_runner.hpp"
+#include "load_worker.hpp"
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sstream>
+
+static const size_t OUT_BYTES = 256 * 1024;
+static const long long PACE_STEP_US = 10000;
+static const long long TIMEOUT_CHECK_US = 100000;
+
+UploadResult::UploadResult() : seconds(0), payloadBytes(0), slowBytes(0), uploads(0), failed(0) {
+}
+
+UploadRunner::Client::Client()
+    : fd(-1), slow(false), connecting(false), wantWrite(false), closed(false), outOffset(0), outSize(0),
+      uploads(0), uploadStartUs(0), progressUs(0), pacingStartUs(0), paced(0), resumeUs(0) {
+}
+
+UploadRunner::UploadRunner(const struct sockaddr_in& server, const std::string& hostHeader, const std::string& path,
+                           size_t chunkBytes, double timeoutSec)
+    : server_(server), hostHeader_(hostHeader), path_(path), chunkBytes_(chunkBytes),
+      timeoutUs_(static_cast<long long>(timeoutSec * 1e6)), epollFd_(epoll_create1(EPOLL_CLOEXEC)),
+      buffer_(OUT_BYTES), scenario_(NULL), result_(NULL), fastRunning_(0), now_(0) {
+}
+
+UploadRunner::~UploadRunner() {
+    for (size_t i = 0; i < clients_.size(); ++i)
+        closeClient(i);
+    if (epollFd_ != -1)
+        close(epollFd_);
+}
+
+bool UploadRunner::connectClient(size_t index) {
+    Client& c = clients_[index];
+    c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (c.fd == -1)
+        return false;
+    if (connect(c.fd, reinterpret_cast<const struct sockaddr*>(&server_), sizeof(server_)) == -1
+        && errno != EINPROGRESS) {
+        closeClient(index);
+        return false;
+    }
+    c.connecting = true;
+    c.wantWrite = true;
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT;
+    event.data.u64 = index;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, c.fd, &event);
+    return true;
+}
+
+void UploadRunner::closeClient(size_t index) {
+    Client& c = clients_[index];
+    if (c.fd != -1)
+        close(c.fd);
+    c.fd = -1;
+    c.connecting = false;
+    c.wantWrite = false;
+}
+
+void UploadRunner::watch(size_t index, bool write) {
+    Client& c = clients_[index];
+    struct epoll_event event;
+    event.events = write ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    event.data.u64 = index;
+    epoll_ctl(epollFd_, EPOLL_CTL_MOD, c.fd, &event);
+    c.wantWrite = write;
+}
+
+void UploadRunner::startUpload(size_t index) {
+    Client& c = clients_[index];
+    std::ostringstream filename;
+    filename << "webserv-upload-bench-" << index << "-" << c.uploads << ".bin";
+    c.filename = filename.str();
+    c.stream.start(scenario_->encoding, path_, hostHeader_, scenario_->bodyBytes, chunkBytes_, c.filename);
+    c.outOffset = 0;
+    c.outSize = 0;
+    c.reader.reset();
+    ++c.uploads;
+    c.uploadStartUs = now_;
+    c.progressUs = now_;
+    if (!c.wantWrite && !c.connecting)
+        watch(index, true);
+}
+
+/* one upload ended: count it, then the next one on this connection or a new one */
+void UploadRunner::uploadDone(size_t index, bool ok) {
+    Client& c = clients_[index];
+    if (ok && scenario_->encoding == UPLOAD_MULTIPART)
+        uploaded_.push_back(c.filename);
+    if (!c.slow) {
+        if (ok) {
+            ++result_->uploads;
+            result_->payloadBytes += c.stream.payloadBytes();
+            result_->latency.record(now_ - c.uploadStartUs);
+        } else {
+            ++result_->failed;
+        }
+        if (c.uploads >= scenario_->uploadsPerClient) {
+            closeClient(index);
+            c.closed = true;
+            --fastRunning_;
+            return;
+        }
+    }
+    // an answer before the whole body went out leaves the connection unusable
+    bool reusable = ok && c.fd != -1 && c.reader.keepAlive() && c.stream.finished() && c.outOffset == c.outSize;
+    if (!reusable) {
+        closeClient(index);
+        if (!connectClient(index)) {
+            c.closed = true;
+            if (!c.slow)
+                --fastRunning_;
+            return;
+        }
+    }
+    startUpload(index);
+}
+
+void UploadRunner::onWritable(size_t index) {
+    Client& c = clients_[index];
+    if (c.connecting) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+            uploadDone(index, false);
+            return;
+        }
+        c.connecting = false;
+    }
+    while (true) {
+        if (c.outOffset == c.outSize) {
+            if (c.stream.finished()) {
+                watch(index, false);
+                return;
+            }
+            size_t capacity = c.out.size();
+            if (c.slow) {
+                double budget = scenario_->slowRate * (now_ - c.pacingStartUs) / 1e6 - c.paced;
+                if (budget < 1) {
+                    watch(index, false);
+                    c.resumeUs = now_ + PACE_STEP_US;
+                    return;
+                }
+                if (budget < capacity)
+                    capacity = static_cast<size_t>(budget);
+            }
+            c.outSize = c.stream.read(&c.out[0], capacity);
+            c.outOffset = 0;
+        }
+        ssize_t sent = send(c.fd, &c.out[c.outOffset], c.outSize - c.outOffset, MSG_NOSIGNAL);
+        if (sent > 0) {
+            c.outOffset += static_cast<size_t>(sent);
+            c.progressUs = now_;
+            if (c.slow) {
+                c.paced += static_cast<unsigned long long>(sent);
+                result_->slowBytes += static_cast<unsigned long long>(sent);
+            }
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        uploadDone(index, false);
+        return;
+    }
+}
+
+void UploadRunner::onReadable(size_t index) {
+    Client& c = clients_[index];
+    while (c.fd != -1) {
+        ssize_t received = recv(c.fd, &buffer_[0], buffer_.size(), 0);
+        if (received > 0) {
+            c.progressUs = now_;
+            size_t used = 0;
+            while (used < static_cast<size_t>(received) && !c.reader.done()) {
+                used += c.reader.feed(&buffer_[used], received - used);
+                if (c.reader.failed()) {
+                    uploadDone(index, false);
+                    return;
+                }
+            }
+            if (c.reader.done()) {
+                uploadDone(index, c.reader.status() >= 200 && c.reader.status() < 300);
+                return;
+            }
+            continue;
+        }
+        if (received == 0) {
+            bool ended = c.reader.started() && c.reader.finishAtEof();
+            uploadDone(index, ended && c.reader.status() >= 200 && c.reader.status() < 300);
+            return;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            return;
+        uploadDone(index, false);
+        return;
+    }
+}
+
+// slow clients are exempt: their pace is the point
+void UploadRunner::checkTimeouts() {
+    for (size_t i = 0; i < clients_.size(); ++i) {
+        Client& c = clients_[i];
+        if (!c.slow && c.fd != -1 && now_ - c.progressUs > timeoutUs_)
+            uploadDone(i, false);
+    }
+}
+
+bool UploadRunner::run(const UploadScenario& scenario, UploadResult& result) {
+    scenario_ = &scenario;
+    result_ = &result;
+    clients_.assign(scenario.clients + scenario.slowClients, Client());
+    now_ = LoadWorker::nowUs();
+    long long startUs = now_;
+    fastRunning_ = scenario.clients;
+    for (size_t i = 0; i < clients_.size(); ++i) {
+        Client& c = clients_[i];
+        c.slow = static_cast<int>(i) >= scenario.clients;
+        c.out.resize(c.slow ? 64 * 1024 : OUT_BYTES);
+        c.pacingStartUs = now_;
+        if (!connectClient(i))
+            return false;
+        startUpload(i);
+    }
+
+    std::vector<struct epoll_event> events(1024);
+    long long nextTimeoutCheck = now_ + TIMEOUT_CHECK_US;
+    while (fastRunning_ > 0) {
+        int ready = epoll_wait(epollFd_, &events[0], static_cast<int>(events.size()),
+                               scenario.slowClients ? 10 : 50);
+        now_ = LoadWorker::nowUs();
+        for (int i = 0; i < ready; ++i) {
+            size_t index = static_cast<size_t>(events[i].data.u64);
+            if (clients_[index].fd == -1)
+                continue;
+            if (events[i].events & EPOLLOUT)
+                onWritable(index);
+            if (clients_[index].fd != -1 && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+                onReadable(index);
+        }
+        for (size_t i = scenario.clients; i < clients_.size(); ++i) {
+            Client& c = clients_[i];
+            if (c.fd != -1 && c.resumeUs && now_ >= c.resumeUs) {
+                c.resumeUs = 0;
+                watch(i, true);
+            }
+        }
+        if (now_ >= nextTimeoutCheck) {
+            checkTimeouts();
+            nextTimeoutCheck = now_ + TIMEOUT_CHECK_US;
+        }
+    }
+    result.seconds = (now_ - startUs) / 1e6;
+    for (size_t i = 0; i < clients_.size(); ++i)
+        closeClient(i);
+    removeUploads();
+    return true;
+}
+
+// one blocking keep-alive connection, a new one whenever the server closes it
+void UploadRunner::removeUploads() {
+    int fd = -1;
+    for (size_t i = 0; i < uploaded_.size(); ++i) {
+        if (fd == -1) {
+            fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd == -1 || connect(fd, reinterpret_cast<const struct sockaddr*>(&server_), sizeof(server_)) == -1)
+                break;
+        }
+        std::string request = "DELETE " + path_ + uploaded_[i] + " HTTP/1.1\r\nHost: " + hostHeader_ + "\r\n\r\n";
+        ResponseReader reader;
+        bool ok = send(fd, request.data(), request.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(request.size());
+        while (ok && !reader.done()) {
+            ssize_t received = recv(fd, &buffer_[0], buffer_.size(), 0);
+            if (received > 0)
+                reader.feed(&buffer_[0], static_cast<size_t>(received));
+            ok = received > 0 && !reader.failed();
+        }
+        if (!ok || !reader.keepAlive()) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (fd != -1)
+        close(fd);
+    uploaded_.clear();
+}
@@ -0,0 +1,97 @@
+#ifndef UPLOAD_RUNNER_HPP
+#define UPLOAD_RUNNER_HPP
+
+#include <string>
+#include <vector>
+#include <netinet/in.h>
+#include "upload_stream.hpp"
+#include "response_reader.hpp"
+#include "../../../src/utils/latency_histogram.hpp"
+
+struct UploadScenario {
+    UploadEncoding encoding;
+    unsigned long long bodyBytes;
+    int clients;
+    int uploadsPerClient;
+    int slowClients;        // extra clients trickling their uploads in at slowRate meanwhile
+    double slowRate;        // bytes/s per slow client
+};
+
+struct UploadResult {
+    double seconds;
+    unsigned long long payloadBytes;    // file bytes of the completed fast uploads
+    unsigned long long slowBytes;       // bytes the slow clients got out meanwhile
+    unsigned long long uploads;
+    unsigned long long failed;          // non-2xx, reset or timed out
+    LatencyHistogram latency;           // one upload: first byte sent -> response complete
+
+    UploadResult();
+};
+
+/* runs one scenario on one epoll loop
+    - fast clients send as fast as the server reads, uploadsPerClient times each, keep-alive
+    - slow clients are paced by a byte budget that grows at slowRate, they are closed
+      mid-upload once the fast ones are done: their partial bodies are what the server holds
+    - every multipart upload gets a new file name (rewriting a file can cost a writeback
+      flush that has nothing to do with the request path), DELETEd again after the run
+*/
+class UploadRunner {
+public:
+    UploadRunner(const struct sockaddr_in& server, const std::string& hostHeader, const std::string& path,
+                 size_t chunkBytes, double timeoutSec);
+    ~UploadRunner();
+
+    bool run(const UploadScenario& scenario, UploadResult& result);
+
+private:
+    struct Client {
+        std::string filename;
+        int fd;
+        bool slow;
+        bool connecting;
+        bool wantWrite;
+        bool closed;
+        UploadStream stream;
+        ResponseReader reader;
+        std::vector<char> out;
+        size_t outOffset;
+        size_t outSize;
+        int uploads;                // started so far
+        long long uploadStartUs;
+        long long progressUs;       // last byte sent or received
+        long long pacingStartUs;
+        unsigned long long paced;   // bytes sent under the slow budget
+        long long resumeUs;         // slow: budget spent, send again from here
+
+        Client();
+    };
+
+    struct sockaddr_in server_;
+    std::string hostHeader_;
+    std::string path_;
+    size_t chunkBytes_;
+    long long timeoutUs_;
+    int epollFd_;
+    std::vector<Client> clients_;
+    std::vector<char> buffer_;
+    std::vector<std::string> uploaded_;     // multipart files to delete after the run
+    const UploadScenario* scenario_;
+    UploadResult* result_;
+    int fastRunning_;
+    long long now_;
+
+    bool connectClient(size_t index);
+    void closeClient(size_t index);
+    void startUpload(size_t index);
+    void watch(size_t index, bool write);
+    void onWritable(size_t index);
+    void onReadable(size_t index);
+    void uploadDone(size_t index, bool ok);
+    void checkTimeouts();
+    void removeUploads();
+
+    UploadRunner(const UploadRunner&);
+    UploadRunner& operator=(const UploadRunner&);
+};
+
+#endif // UPLOAD_RUNNER_HPP
@@ -0,0 +1,132 @@
+#include "upload_stream.hpp"
+#include <cstring>
+#include <sstream>
+
+static const char* const BOUNDARY = "----webservUploadBench7MA4YWxkTrZu0gW";
+static const size_t PATTERN_BYTES = 64 * 1024;
+
+// printable filler: no CR/LF (chunk and header parsers), no NUL (C string handling)
+static const char* pattern() {
+    static char bytes[PATTERN_BYTES];
+    static bool ready = false;
+    if (!ready) {
+        for (size_t i = 0; i < PATTERN_BYTES; ++i)
+            bytes[i] = static_cast<char>('a' + (i * 7 + i / 26) % 26);
+        ready = true;
+    }
+    return bytes;
+}
+
+UploadStream::UploadStream()
+    : encoding_(UPLOAD_LENGTH), chunkBytes_(16384), payload_(0), payloadSent_(0), chunkLeft_(0),
+      stage_(DONE), textOffset_(0) {
+}
+
+const char* UploadStream::encodingName(int encoding) {
+    static const char* const names[UPLOAD_ENCODING_COUNT] = { "length", "chunked", "multipart" };
+    return encoding >= 0 && encoding < UPLOAD_ENCODING_COUNT ? names[encoding] : "?";
+}
+
+int UploadStream::encodingFromName(const std::string& name) {
+    for (int i = 0; i < UPLOAD_ENCODING_COUNT; ++i) {
+        if (name == encodingName(i))
+            return i;
+    }
+    return -1;
+}
+
+void UploadStream::start(UploadEncoding encoding, const std::string& path, const std::string& hostHeader,
+                         unsigned long long bodyBytes, size_t chunkBytes, const std::string& filename) {
+    encoding_ = encoding;
+    chunkBytes_ = chunkBytes ? chunkBytes : 16384;
+    payload_ = bodyBytes;
+    payloadSent_ = 0;
+    chunkLeft_ = 0;
+    tail_.clear();
+    pattern();
+
+    std::ostringstream head;
+    head << "POST " << path << " HTTP/1.1\r\nHost: " << hostHeader << "\r\n";
+    if (encoding == UPLOAD_CHUNKED) {
+        head << "Content-Type: application/octet-stream\r\nTransfer-Encoding: chunked\r\n\r\n";
+        tail_ = "0\r\n\r\n";
+    } else if (encoding == UPLOAD_MULTIPART) {
+        std::string part = std::string("--") + BOUNDARY + "\r\nContent-Disposition: form-data; name=\"file\"; filename=\""
+                         + filename + "\"\r\nContent-Type: application/octet-stream\r\n\r\n";
+        tail_ = std::string("\r\n--") + BOUNDARY + "--\r\n";
+        head << "Content-Type: multipart/form-data; boundary=" << BOUNDARY << "\r\n"
+             << "Content-Length: " << part.size() + bodyBytes + tail_.size() << "\r\n\r\n" << part;
+    } else {
+        head << "Content-Type: application/octet-stream\r\nContent-Length: " << bodyBytes << "\r\n\r\n";
+    }
+    text_ = head.str();
+    textOffset_ = 0;
+    stage_ = HEAD;
+}
+
+// the next chunk line, or the end of the body
+void UploadStream::nextChunk() {
+    unsigned long long remaining = payload_ - payloadSent_;
+    if (encoding_ == UPLOAD_CHUNKED && remaining > 0) {
+        chunkLeft_ = remaining < chunkBytes_ ? remaining : chunkBytes_;
+        std::ostringstream line;
+        line << std::hex << chunkLeft_ << "\r\n";
+        text_ = line.str();
+        stage_ = CHUNK_HEAD;
+    } else if (encoding_ != UPLOAD_CHUNKED && remaining > 0) {
+        chunkLeft_ = remaining;
+        stage_ = PAYLOAD;
+        return;
+    } else if (!tail_.empty()) {
+        text_ = tail_;
+        stage_ = TAIL;
+    } else {
+        stage_ = DONE;
+        return;
+    }
+    textOffset_ = 0;
+}
+
+size_t UploadStream::read(char* out, size_t capacity) {
+    size_t produced = 0;
+    while (produced < capacity && stage_ != DONE) {
+        if (stage_ == PAYLOAD) {
+            size_t offset = static_cast<size_t>(payloadSent_ % PATTERN_BYTES);
+            size_t count = capacity - produced;
+            if (count > PATTERN_BYTES - offset)
+                count = PATTERN_BYTES - offset;
+            if (count > chunkLeft_)
+                count = static_cast<size_t>(chunkLeft_);
+            std::memcpy(out + produced, pattern() + offset, count);
+            produced += count;
+            payloadSent_ += count;
+            chunkLeft_ -= count;
+            if (chunkLeft_ == 0) {
+                if (encoding_ == UPLOAD_CHUNKED) {
+                    text_ = "\r\n";
+                    textOffset_ = 0;
+                    stage_ = CHUNK_END;
+                } else {
+                    nextChunk();
+                }
+            }
+            continue;
+        }
+        size_t count = text_.size() - textOffset_;
+        if (count > capacity - produced)
+            count = capacity - produced;
+        std::memcpy(out + produced, text_.data() + textOffset_, count);
+        produced += count;
+        textOffset_ += count;
+        if (textOffset_ < text_.size())
+            continue;
+        if (stage_ == CHUNK_HEAD) {
+            stage_ = PAYLOAD;
+        } else if (stage_ == TAIL) {
+            stage_ = DONE;
+        } else {
+            nextChunk();    // after the head or a chunk's CRLF
+        }
+    }
+    return produced;
+}
@@ -0,0 +1,50 @@
+#ifndef UPLOAD_STREAM_HPP
+#define UPLOAD_STREAM_HPP
+
+#include <string>
+#include <cstddef>
+
+enum UploadEncoding {
+    UPLOAD_LENGTH,      // Content-Length body
+    UPLOAD_CHUNKED,     // Transfer-Encoding: chunked
+    UPLOAD_MULTIPART,   // multipart/form-data with one file part, Content-Length
+    UPLOAD_ENCODING_COUNT
+};
+
+/* one POST request, generated while it is sent
+    - the body is a printable pattern (no CR/LF, no NUL), nothing of it is held in memory:
+      a 2 GB upload costs the client one buffer
+    - read() hands out the next bytes of head, framing and body in wire order
+*/
+class UploadStream {
+public:
+    UploadStream();
+
+    static const char* encodingName(int encoding);
+    static int encodingFromName(const std::string& name);     // -1 if unknown
+
+    void start(UploadEncoding encoding, const std::string& path, const std::string& hostHeader,
+               unsigned long long bodyBytes, size_t chunkBytes, const std::string& filename);
+    size_t read(char* out, size_t capacity);
+    bool finished() const { return stage_ == DONE; }
+
+    unsigned long long payloadBytes() const { return payload_; }   // file bytes, without framing
+    unsigned long long payloadSent() const { return payloadSent_; }
+
+private:
+    enum Stage { HEAD, CHUNK_HEAD, PAYLOAD, CHUNK_END, TAIL, DONE };
+
+    UploadEncoding encoding_;
+    size_t chunkBytes_;
+    unsigned long long payload_;
+    unsigned long long payloadSent_;
+    unsigned long long chunkLeft_;
+    Stage stage_;
+    std::string text_;      // head, chunk line or tail being sent
+    size_t textOffset_;
+    std::string tail_;      // multipart closing boundary, "0\r\n\r\n" for chunked
+
+    void nextChunk();
+};
+
+#endif // UPLOAD_STREAM_HPP
@@ -0,0 +1,254 @@
+// HTTP load generator for webserv: closed or open loop, keep-alive or one request per connection
+// Build: make bench   Run: tests/bench/load/webserv_bench --help
+#include "load_worker.hpp"
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <getopt.h>
+#include <signal.h>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+
+static void usage(const char* name) {
+    std::cout
+        << "usage: " << name << " [options]\n"
+        << "  -H, --host ADDR          server IPv4 address (127.0.0.1)\n"
+        << "  -p, --port PORT          server port (8080)\n"
+        << "      --host-header NAME   Host header (localhost)\n"
+        << "  -c, --connections N      concurrent connections (64)\n"
+        << "  -t, --threads N          load generator threads (2)\n"
+        << "  -d, --duration SEC       measured time (10)\n"
+        << "  -w, --warmup SEC         warm-up before measuring (1)\n"
+        << "  -k, --close              one request per connection (default: keep-alive)\n"
+        << "  -P, --pipeline N         requests in flight per keep-alive connection (1)\n"
+        << "  -R, --rate N             open loop at N requests/s in total (default: closed loop)\n"
+        << "  -m, --mix SPEC           request mix, e.g. static:70,autoindex:5,404:10,upload:5,cgi:10\n"
+        << "  -u, --path KIND=PATH     path of one request kind, e.g. cgi=/python/cgi_basic.py\n"
+        << "  -b, --upload-size BYTES  upload file size (4096)\n"
+        << "  -T, --timeout SEC        per-request timeout (5)\n"
+        << "  -j, --json               JSON report\n";
+}
+
+static bool parseOptions(int argc, char** argv, BenchOptions& options) {
+    static const struct option longOptions[] = {
+        { "host", required_argument, NULL, 'H' },
+        { "port", required_argument, NULL, 'p' },
+        { "host-header", required_argument, NULL, 'A' },
+        { "connections", required_argument, NULL, 'c' },
+        { "threads", required_argument, NULL, 't' },
+        { "duration", required_argument, NULL, 'd' },
+        { "warmup", required_argument, NULL, 'w' },
+        { "close", no_argument, NULL, 'k' },
+        { "pipeline", required_argument, NULL, 'P' },
+        { "rate", required_argument, NULL, 'R' },
+        { "mix", required_argument, NULL, 'm' },
+        { "path", required_argument, NULL, 'u' },
+        { "upload-size", required_argument, NULL, 'b' },
+        { "timeout", required_argument, NULL, 'T' },
+        { "json", no_argument, NULL, 'j' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    std::string error;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "H:p:c:t:d:w:kP:R:m:u:b:T:jh", longOptions, NULL)) != -1) {
+        switch (opt) {
+        case 'H':
+            if (inet_pton(AF_INET, optarg, &options.address.sin_addr) != 1) {
+                std::cerr << "invalid IPv4 address: " << optarg << std::endl;
+                return false;
+            }
+            break;
+        case 'p': options.address.sin_port = htons(static_cast<unsigned short>(std::atoi(optarg))); break;
+        case 'A': options.hostHeader = optarg; break;
+        case 'c': options.connections = std::atoi(optarg); break;
+        case 't': options.threads = std::atoi(optarg); break;
+        case 'd': options.durationSec = std::atof(optarg); break;
+        case 'w': options.warmupSec = std::atof(optarg); break;
+        case 'k': options.keepAlive = false; break;
+        case 'P': options.pipeline = std::atoi(optarg); break;
+        case 'R': options.rate = std::atof(optarg); break;
+        case 'b': options.uploadBytes = static_cast<size_t>(std::atol(optarg)); break;
+        case 'T': options.timeoutSec = std::atof(optarg); break;
+        case 'j': options.json = true; break;
+        case 'm':
+        case 'u':
+            if (!(opt == 'm' ? options.mix.parse(optarg, error) : options.mix.setPath(optarg, error))) {
+                std::cerr << error << std::endl;
+                return false;
+            }
+            break;
+        case 'h':
+            usage(argv[0]);
+            std::exit(0);
+        default:
+            usage(argv[0]);
+            return false;
+        }
+    }
+    if (options.connections < 1 || options.threads < 1 || options.pipeline < 1
+        || options.durationSec <= 0 || options.warmupSec < 0 || options.timeoutSec <= 0 || options.rate < 0) {
+        std::cerr << "connections, threads, pipeline and durations must be positive" << std::endl;
+        return false;
+    }
+    if (options.threads > options.connections)
+        options.threads = options.connections;
+    options.mix.build(options.hostHeader, options.keepAlive, options.uploadBytes);
+    return true;
+}
+
+static double ms(long long us) {
+    return us / 1000.0;
+}
+
+static void latencyRow(std::ostream& out, const std::string& name, const LatencyHistogram& h) {
+    out << "  " << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(3)
+        << std::setw(10) << ms(h.percentile(50)) << std::setw(10) << ms(h.percentile(90))
+        << std::setw(10) << ms(h.percentile(99)) << std::setw(10) << ms(h.percentile(99.9))
+        << std::setw(10) << ms(h.maxUs())
+        << std::setw(10) << (h.count() ? ms(static_cast<long long>(h.sumUs() / h.count())) : 0.0)
+        << std::setw(12) << h.count() << "\n";
+}
+
+static std::string address(const BenchOptions& options) {
+    char host[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &options.address.sin_addr, host, sizeof(host));
+    std::ostringstream out;
+    out << host << ":" << ntohs(options.address.sin_port);
+    return out.str();
+}
+
+static void reportText(const BenchOptions& options, const BenchStats& total, double seconds) {
+    std::ostringstream out;
+    out << "webserv_bench " << address(options) << ": " << options.connections << " connections on "
+        << options.threads << " threads, " << (options.keepAlive ? "keep-alive" : "connection: close")
+        << ", pipeline " << (options.keepAlive ? options.pipeline : 1) << ", ";
+    if (options.rate > 0)
+        out << "open loop at " << options.rate << " req/s";
+    else
+        out << "closed loop";
+    out << "\nmix: " << options.mix.describe() << "\n"
+        << "measured " << seconds << " s after " << options.warmupSec << " s warm-up\n\n";
+
+    out << std::fixed << std::setprecision(1)
+        << "requests    " << total.total() << "  (" << total.total() / seconds << " req/s)\n"
+        << "transfer    " << total.bytesRead / 1048576.0 << " MB read, " << total.bytesWritten / 1048576.0
+        << " MB written  (" << total.bytesRead / 1048576.0 / seconds << " MB/s in)\n"
+        << "status      1xx " << total.statusClass[1] << "  2xx " << total.statusClass[2]
+        << "  3xx " << total.statusClass[3] << "  4xx " << total.statusClass[4]
+        << "  5xx " << total.statusClass[5] << "  other " << total.statusClass[0] << "\n"
+        << "errors      connect " << total.connectErrors << "  read " << total.readErrors
+        << "  write " << total.writeErrors << "  timeout " << total.timeouts
+        << "  reset " << total.resets << "  parse " << total.parseErrors << "\n"
+        << "connections " << total.connects << " opened\n\n";
+
+    out << "latency (ms)       p50       p90       p99     p99.9       max      mean       count\n";
+    latencyRow(out, "all", total.latency);
+    for (int kind = 0; kind < KIND_COUNT; ++kind) {
+        if (options.mix.weight(kind) > 0)
+            latencyRow(out, RequestMix::kindName(kind), total.kindLatency[kind]);
+    }
+    if (options.rate > 0) {
+        out << "service time, from the actual send (not corrected for coordinated omission):\n";
+        latencyRow(out, "all", total.uncorrected);
+    }
+    std::cout << out.str() << std::flush;
+}
+
+static std::string jsonString(const std::string& value) {
+    std::string quoted = "\"";
+    for (size_t i = 0; i < value.size(); ++i) {
+        if (value[i] == '"' || value[i] == '\\')
+            quoted += '\\';
+        quoted += value[i];
+    }
+    return quoted + "\"";
+}
+
+static void latencyJson(std::ostream& out, const LatencyHistogram& h) {
+    out << "{\"count\": " << h.count()
+        << ", \"p50\": " << h.percentile(50) << ", \"p90\": " << h.percentile(90)
+        << ", \"p99\": " << h.percentile(99) << ", \"p99_9\": " << h.percentile(99.9)
+        << ", \"max\": " << h.maxUs() << ", \"mean\": " << (h.count() ? h.sumUs() / h.count() : 0) << "}";
+}
+
+static void reportJson(const BenchOptions& options, const BenchStats& total, double seconds) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << "{\n  \"target\": " << jsonString(address(options)) << ",\n"
+        << "  \"connections\": " << options.connections << ",\n"
+        << "  \"threads\": " << options.threads << ",\n"
+        << "  \"keep_alive\": " << (options.keepAlive ? "true" : "false") << ",\n"
+        << "  \"pipeline\": " << (options.keepAlive ? options.pipeline : 1) << ",\n"
+        << "  \"rate\": " << options.rate << ",\n"
+        << "  \"mix\": " << jsonString(options.mix.describe()) << ",\n"
+        << "  \"duration_s\": " << seconds << ",\n"
+        << "  \"requests\": " << total.total() << ",\n"
+        << "  \"rps\": " << total.total() / seconds << ",\n"
+        << "  \"bytes_read\": " << total.bytesRead << ",\n"
+        << "  \"bytes_written\": " << total.bytesWritten << ",\n"
+        << "  \"status\": {\"1xx\": " << total.statusClass[1] << ", \"2xx\": " << total.statusClass[2]
+        << ", \"3xx\": " << total.statusClass[3] << ", \"4xx\": " << total.statusClass[4]
+        << ", \"5xx\": " << total.statusClass[5] << ", \"other\": " << total.statusClass[0] << "},\n"
+        << "  \"errors\": {\"connect\": " << total.connectErrors << ", \"read\": " << total.readErrors
+        << ", \"write\": " << total.writeErrors << ", \"timeout\": " << total.timeouts
+        << ", \"reset\": " << total.resets << ", \"parse\": " << total.parseErrors << "},\n"
+        << "  \"latency_us\": ";
+    latencyJson(out, total.latency);
+    out << ",\n  \"service_time_us\": ";
+    latencyJson(out, total.uncorrected);
+    out << ",\n  \"kinds\": {";
+    bool first = true;
+    for (int kind = 0; kind < KIND_COUNT; ++kind) {
+        if (options.mix.weight(kind) <= 0)
+            continue;
+        out << (first ? "\n" : ",\n") << "    " << jsonString(RequestMix::kindName(kind)) << ": ";
+        latencyJson(out, total.kindLatency[kind]);
+        first = false;
+    }
+    out << "\n  }\n}\n";
+    std::cout << out.str() << std::flush;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options))
+        return 2;
+    signal(SIGPIPE, SIG_IGN);
+
+    std::vector<LoadWorker*> workers;
+    long long startUs = LoadWorker::nowUs() + 20000;    // all threads start together
+    long long measureUs = startUs + static_cast<long long>(options.warmupSec * 1e6);
+    long long endUs = measureUs + static_cast<long long>(options.durationSec * 1e6);
+    int first = 0;
+    for (int i = 0; i < options.threads; ++i) {
+        int count = options.connections / options.threads + (i < options.connections % options.threads ? 1 : 0);
+        LoadWorker* worker = new LoadWorker(options, first, count, 0x9e3779b9u * (i + 1));
+        worker->setWindow(startUs, measureUs, endUs);
+        workers.push_back(worker);
+        first += count;
+    }
+
+    std::vector<pthread_t> threads(workers.size());
+    for (size_t i = 0; i < workers.size(); ++i) {
+        if (pthread_create(&threads[i], NULL, LoadWorker::threadMain, workers[i]) != 0) {
+            std::cerr << "cannot start load thread " << i << std::endl;
+            return 2;
+        }
+    }
+    BenchStats total;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        pthread_join(threads[i], NULL);
+        total.merge(workers[i]->stats());
+        delete workers[i];
+    }
+
+    double seconds = (endUs - measureUs) / 1e6;
+    if (options.json)
+        reportJson(options, total, seconds);
+    else
+        reportText(options, total, seconds);
+    return total.total() > 0 ? 0 : 1;
+}
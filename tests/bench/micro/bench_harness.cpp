@@ -0,0 +1,89 @@
+#include "bench_harness.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+unsigned long long AllocationCounter::allocations = 0;
+unsigned long long AllocationCounter::bytes = 0;
+
+// every std::string / container allocation of the benchmarked code passes through here
+void* operator new(size_t size) throw(std::bad_alloc) {
+    ++AllocationCounter::allocations;
+    AllocationCounter::bytes += size;
+    void* memory = std::malloc(size ? size : 1);
+    if (!memory)
+        throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new[](size_t size) throw(std::bad_alloc) {
+    return operator new(size);
+}
+
+void operator delete(void* memory) throw() {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) throw() {
+    std::free(memory);
+}
+
+// swallows everything written to it
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) { return c; }
+};
+
+static NullBuffer nullBuffer;
+
+MicroBench::MicroBench(int argc, char** argv) : minNs_(200e6), json_(false), coutBuffer_(NULL) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0)
+            json_ = true;
+        else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+            filter_ = argv[++i];
+        else if (std::strcmp(argv[i], "--time-ms") == 0 && i + 1 < argc)
+            minNs_ = std::atof(argv[++i]) * 1e6;
+        else {
+            std::cerr << "usage: " << argv[0] << " [--filter SUBSTR] [--time-ms MS] [--json]" << std::endl;
+            std::exit(2);
+        }
+    }
+    if (json_)
+        coutBuffer_ = std::cout.rdbuf(&nullBuffer);
+    else
+        std::printf("%-44s %12s %14s %14s %12s\n", "benchmark", "iterations", "ns/op", "allocs/op", "B/op");
+}
+
+double MicroBench::nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+void MicroBench::report(const BenchResult& result) {
+    results_.push_back(result);
+    if (!json_) {
+        std::printf("%-44s %12llu %14.1f %14.2f %12.1f\n", result.name.c_str(), result.iterations,
+                    result.nsPerOp, result.allocsPerOp, result.bytesPerOp);
+        std::fflush(stdout);
+    }
+}
+
+int MicroBench::finish() {
+    if (json_) {
+        std::cout.rdbuf(coutBuffer_);
+        std::printf("[\n");
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const BenchResult& r = results_[i];
+            std::printf("  {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.1f, "
+                        "\"allocs_per_op\": %.2f, \"bytes_per_op\": %.1f}%s\n",
+                        r.name.c_str(), r.iterations, r.nsPerOp, r.allocsPerOp, r.bytesPerOp,
+                        i + 1 < results_.size() ? "," : "");
+        }
+        std::printf("]\n");
+    }
+    return results_.empty() ? 1 : 0;
+}
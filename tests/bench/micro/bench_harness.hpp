@@ -0,0 +1,83 @@
+#ifndef BENCH_HARNESS_HPP
+#define BENCH_HARNESS_HPP
+
+#include <string>
+#include <vector>
+#include <ctime>
+#include <streambuf>
+
+/* heap traffic of the whole process, counted by the replaced global operator new */
+struct AllocationCounter {
+    static unsigned long long allocations;
+    static unsigned long long bytes;
+};
+
+struct BenchResult {
+    std::string name;
+    unsigned long long iterations;
+    double nsPerOp;
+    double allocsPerOp;
+    double bytesPerOp;
+};
+
+/* minimal benchmark runner
+    - body() is one operation; the batch size doubles until a batch runs for --time-ms
+    - allocations and bytes are those of the final batch, divided by its size
+    - --filter SUBSTR runs the matching benchmarks only, --json prints the results as JSON;
+      std::cout chatter of the code under test is muted then, stdout carries the JSON only
+*/
+class MicroBench {
+public:
+    MicroBench(int argc, char** argv);
+
+    template <class Body>
+    void run(const std::string& name, Body& body);
+
+    int finish();           // JSON output, exit status
+
+    static void keep(const void* value) { __asm__ __volatile__("" : : "g"(value) : "memory"); }
+
+private:
+    std::string filter_;
+    double minNs_;
+    bool json_;
+    std::vector<BenchResult> results_;
+    std::streambuf* coutBuffer_;
+
+    static double nowNs();
+    void report(const BenchResult& result);
+};
+
+template <class Body>
+void MicroBench::run(const std::string& name, Body& body) {
+    if (!filter_.empty() && name.find(filter_) == std::string::npos)
+        return;
+    body(); // warm caches and lazily built tables
+    unsigned long long iterations = 1;
+    while (true) {
+        unsigned long long allocations = AllocationCounter::allocations;
+        unsigned long long bytes = AllocationCounter::bytes;
+        double start = nowNs();
+        for (unsigned long long i = 0; i < iterations; ++i)
+            body();
+        double elapsed = nowNs() - start;
+        if (elapsed >= minNs_ || iterations >= (1ULL << 40)) {
+            BenchResult result;
+            result.name = name;
+            result.iterations = iterations;
+            result.nsPerOp = elapsed / iterations;
+            result.allocsPerOp = static_cast<double>(AllocationCounter::allocations - allocations) / iterations;
+            result.bytesPerOp = static_cast<double>(AllocationCounter::bytes - bytes) / iterations;
+            report(result);
+            return;
+        }
+        // aim 20% past the target from the rate seen so far, at most 100x at once
+        double perOp = elapsed > 0 ? elapsed / iterations : 1;
+        unsigned long long next = static_cast<unsigned long long>(minNs_ * 1.2 / perOp);
+        if (next > iterations * 100)
+            next = iterations * 100;
+        iterations = next > iterations ? next : iterations * 2;
+    }
+}
+
+#endif // BENCH_HARNESS_HPP
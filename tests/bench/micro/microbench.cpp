@@ -0,0 +1,15 @@
+// Microbenchmarks of the per-request hot path: parser, router, response builder
+// Build & run: make microbench   (or: tests/bench/micro/microbench --filter route/ --json)
+#include "bench_harness.hpp"
+
+void parserBenchmarks(MicroBench& bench);
+void routingBenchmarks(MicroBench& bench);
+void responseBenchmarks(MicroBench& bench);
+
+int main(int argc, char** argv) {
+    MicroBench bench(argc, argv);
+    parserBenchmarks(bench);
+    routingBenchmarks(bench);
+    responseBenchmarks(bench);
+    return bench.finish();
+}
@@ -0,0 +1,193 @@
+// HttpRequest hot path: completeness check, parsing, validation, multipart bodies
+#include "bench_harness.hpp"
+#include "../../../src/http/http_request.hpp"
+#include <cassert>
+#include <sstream>
+
+struct CorpusEntry {
+    const char* name;
+    const char* request;
+};
+
+// captured from real clients, bodies trimmed
+static const CorpusEntry CORPUS[] = {
+    { "chrome-get",
+      "GET /images/ HTTP/1.1\r\n"
+      "Host: localhost:8080\r\n"
+      "Connection: keep-alive\r\n"
+      "sec-ch-ua: \"Chromium\";v=\"124\", \"Google Chrome\";v=\"124\", \"Not-A.Brand\";v=\"99\"\r\n"
+      "sec-ch-ua-mobile: ?0\r\n"
+      "sec-ch-ua-platform: \"Linux\"\r\n"
+      "Upgrade-Insecure-Requests: 1\r\n"
+      "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+      "Chrome/124.0.0.0 Safari/537.36\r\n"
+      "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,"
+      "image/apng,*/*;q=0.8,application/signed-exchange;v=b3;q=0.7\r\n"
+      "Sec-Fetch-Site: same-origin\r\n"
+      "Sec-Fetch-Mode: navigate\r\n"
+      "Sec-Fetch-User: ?1\r\n"
+      "Sec-Fetch-Dest: document\r\n"
+      "Referer: http://localhost:8080/index.html\r\n"
+      "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+      "Accept-Language: en-US,en;q=0.9,fr;q=0.8\r\n"
+      "Cookie: session=7f3a9c2e4b1d; theme=dark; _ga=GA1.1.123456789.1712345678\r\n"
+      "\r\n" },
+    { "firefox-get",
+      "GET /about.html?ref=nav HTTP/1.1\r\n"
+      "Host: localhost:8080\r\n"
+      "User-Agent: Mozilla/5.0 (X11; Ubuntu; Linux x86_64; rv:125.0) Gecko/20100101 Firefox/125.0\r\n"
+      "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+      "Accept-Language: en-US,en;q=0.5\r\n"
+      "Accept-Encoding: gzip, deflate, br\r\n"
+      "Connection: keep-alive\r\n"
+      "Upgrade-Insecure-Requests: 1\r\n"
+      "Sec-Fetch-Dest: document\r\n"
+      "Sec-Fetch-Mode: navigate\r\n"
+      "Sec-Fetch-Site: none\r\n"
+      "Sec-Fetch-User: ?1\r\n"
+      "\r\n" },
+    { "curl-get",
+      "GET /index.html HTTP/1.1\r\n"
+      "Host: localhost:8080\r\n"
+      "User-Agent: curl/8.5.0\r\n"
+      "Accept: */*\r\n"
+      "\r\n" },
+    { "googlebot-get",
+      "GET /robots.txt HTTP/1.1\r\n"
+      "Host: example.com\r\n"
+      "Connection: keep-alive\r\n"
+      "Accept: text/plain,text/html,*/*\r\n"
+      "Accept-Encoding: gzip,deflate,br\r\n"
+      "User-Agent: Mozilla/5.0 (compatible; Googlebot/2.1; +http://www.google.com/bot.html)\r\n"
+      "From: googlebot(at)googlebot.com\r\n"
+      "\r\n" },
+    { "form-post",
+      "POST /cgi-bin/test.py HTTP/1.1\r\n"
+      "Host: localhost:8080\r\n"
+      "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0.0.0\r\n"
+      "Content-Type: application/x-www-form-urlencoded\r\n"
+      "Content-Length: 47\r\n"
+      "Origin: http://localhost:8080\r\n"
+      "Referer: http://localhost:8080/upload.html\r\n"
+      "\r\n"
+      "name=webserv&email=bench%40example.com&msg=hello" },
+    { "chunked-post",
+      "POST /upload/ HTTP/1.1\r\n"
+      "Host: localhost:8080\r\n"
+      "User-Agent: curl/8.5.0\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "Content-Type: text/plain\r\n"
+      "\r\n"
+      "1a\r\nabcdefghijklmnopqrstuvwxyz\r\n"
+      "10\r\n0123456789abcdef\r\n"
+      "0\r\n\r\n" },
+};
+
+static const size_t CORPUS_SIZE = sizeof(CORPUS) / sizeof(CORPUS[0]);
+
+struct CompleteBody {
+    std::string request;
+    void operator()() {
+        HttpRequest parser;
+        RequestStatus status = parser.isRequestComplete(request);
+        MicroBench::keep(&status);
+    }
+};
+
+struct ParseBody {
+    std::string request;
+    void operator()() {
+        HttpRequest parser;
+        bool parsed = parser.parseRequest(request);
+        MicroBench::keep(&parsed);
+    }
+};
+
+struct ValidateBody {
+    HttpRequest parsed;
+    void operator()() {
+        ValidationResult result = parsed.validateRequest();
+        MicroBench::keep(&result);
+    }
+};
+
+// what the event loop does once per request
+struct PipelineBody {
+    std::string request;
+    void operator()() {
+        HttpRequest parser;
+        if (parser.isRequestComplete(request) == REQUEST_COMPLETE && parser.parseRequest(request)) {
+            ValidationResult result = parser.validateRequest();
+            MicroBench::keep(&result);
+        }
+    }
+};
+
+// the copy of the parsed request is part of each operation: parseMultipartFormData() appends
+struct MultipartBody {
+    HttpRequest parsed;
+    void operator()() {
+        HttpRequest request(parsed);
+        bool ok = request.parseMultipartFormData();
+        MicroBench::keep(&ok);
+    }
+};
+
+static std::string multipartRequest(int parts, size_t partBytes) {
+    const std::string boundary = "----WebKitFormBoundary7MA4YWxkTrZu0gW";
+    std::ostringstream body;
+    for (int i = 0; i < parts; ++i) {
+        body << "--" << boundary << "\r\n";
+        if (i % 2 == 0)
+            body << "Content-Disposition: form-data; name=\"field" << i << "\"\r\n\r\n";
+        else
+            body << "Content-Disposition: form-data; name=\"file" << i << "\"; filename=\"part" << i
+                 << ".bin\"\r\nContent-Type: application/octet-stream\r\n\r\n";
+        body << std::string(partBytes, static_cast<char>('a' + i % 26)) << "\r\n";
+    }
+    body << "--" << boundary << "--\r\n";
+    std::ostringstream request;
+    request << "POST /upload/ HTTP/1.1\r\n"
+            << "Host: localhost:8080\r\n"
+            << "Content-Type: multipart/form-data; boundary=" << boundary << "\r\n"
+            << "Content-Length: " << body.str().size() << "\r\n\r\n"
+            << body.str();
+    return request.str();
+}
+
+void parserBenchmarks(MicroBench& bench) {
+    for (size_t i = 0; i < CORPUS_SIZE; ++i) {
+        std::string name = CORPUS[i].name;
+        std::string request = CORPUS[i].request;
+
+        CompleteBody complete;
+        complete.request = request;
+        assert(HttpRequest().isRequestComplete(request) == REQUEST_COMPLETE);
+        bench.run("request/isRequestComplete/" + name, complete);
+
+        ParseBody parse;
+        parse.request = request;
+        bench.run("request/parseRequest/" + name, parse);
+
+        ValidateBody validate;
+        assert(validate.parsed.parseRequest(request));
+        assert(validate.parsed.validateRequest() == VALID_REQUEST);
+        bench.run("request/validateRequest/" + name, validate);
+
+        PipelineBody pipeline;
+        pipeline.request = request;
+        bench.run("request/all/" + name, pipeline);
+    }
+
+    const int partCounts[] = { 1, 4, 16, 64 };
+    for (size_t i = 0; i < sizeof(partCounts) / sizeof(partCounts[0]); ++i) {
+        MultipartBody multipart;
+        assert(multipart.parsed.parseRequest(multipartRequest(partCounts[i], 1024)));
+        HttpRequest check(multipart.parsed);
+        assert(check.parseMultipartFormData());
+        assert(check.getUploadedFiles().size() + check.getFormData().size() == static_cast<size_t>(partCounts[i]));
+        std::ostringstream name;
+        name << "multipart/parts=" << partCounts[i] << "x1KB";
+        bench.run(name.str(), multipart);
+    }
+}
@@ -0,0 +1,102 @@
+// HttpResponse building and MIME lookup
+#include "bench_harness.hpp"
+#include "../../../src/http/http_response.hpp"
+#include "../../../src/http/mime_types.hpp"
+#include <sys/stat.h>
+#include <cassert>
+#include <cstring>
+
+static const char* const REQUEST =
+    "GET /index.html HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "User-Agent: curl/8.5.0\r\n"
+    "Accept: */*\r\n"
+    "\r\n";
+
+// an in-memory body: generated pages, CGI output, upload replies
+struct FullResponseBody {
+    const HttpRequest* request;
+    std::string body;
+    int status;
+    void operator()() {
+        HttpResponse response(status);
+        if (!body.empty()) {
+            response.setHeader("Content-Type", "text/html");
+            response.setBody(body);
+        }
+        std::string wire = response.buildFullResponse(*request);
+        MicroBench::keep(wire.data());
+    }
+};
+
+// head of a static file, the body follows with sendfile()
+struct FileHeadBody {
+    const HttpRequest* request;
+    struct stat fileStat;
+    void operator()() {
+        HttpResponse response;
+        off_t offset = 0;
+        off_t length = 0;
+        std::string head = response.buildFileHead("./www/html/index.html", fileStat, *request, offset, length);
+        MicroBench::keep(head.data());
+    }
+};
+
+// head of a preloaded error page, the body goes out from preloaded.tail
+struct PreloadedBody {
+    PreloadedResponse preloaded;
+    void operator()() {
+        HttpResponse response;
+        std::string head = response.buildPreloadedResponse(preloaded);
+        MicroBench::keep(head.data());
+    }
+};
+
+struct ContentTypeBody {
+    HttpResponse response;
+    std::vector<std::string> paths;
+    size_t next;
+    void operator()() {
+        const std::string& type = response.getContentType(paths[next]);
+        MicroBench::keep(&type);
+        next = (next + 1) % paths.size();
+    }
+};
+
+void responseBenchmarks(MicroBench& bench) {
+    HttpRequest request;
+    assert(request.parseRequest(REQUEST) && request.validateRequest() == VALID_REQUEST);
+
+    const size_t sizes[] = { 1024, 64 * 1024 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        FullResponseBody full;
+        full.request = &request;
+        full.body = std::string(sizes[i], 'x');
+        full.status = 200;
+        bench.run(sizes[i] < 4096 ? "response/buildFullResponse/1KB" : "response/buildFullResponse/64KB", full);
+    }
+    FullResponseBody error;
+    error.request = &request;
+    error.status = 404;
+    bench.run("response/buildFullResponse/404-generated", error);
+
+    FileHeadBody head;
+    head.request = &request;
+    std::memset(&head.fileStat, 0, sizeof(head.fileStat));
+    head.fileStat.st_size = 9000;
+    head.fileStat.st_mtime = 1700000000;
+    bench.run("response/buildFileHead", head);
+
+    PreloadedBody preloaded;
+    preloaded.preloaded = HttpResponse::preload(404, std::string(4000, 'e'), "/html_error/404.html");
+    bench.run("response/buildPreloadedResponse/404", preloaded);
+
+    ContentTypeBody contentType;
+    const char* paths[] = { "/index.html", "/images/ecole42.jpeg", "/css/site.CSS", "/js/app.min.js",
+                            "/fonts/inter.woff2", "/download/archive.tar.gz", "/README", "/data.unknownext" };
+    for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); ++i)
+        contentType.paths.push_back(paths[i]);
+    contentType.next = 0;
+    assert(contentType.response.getContentType("/index.html").find("text/html") == 0);
+    bench.run("response/getContentType", contentType);
+}
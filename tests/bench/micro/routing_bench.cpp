@@ -0,0 +1,131 @@
+// request routing: location lookup and server_name lookup on generated configs
+#include "bench_harness.hpp"
+#include "../../../src/configparser/initialize.hpp"
+#include <cassert>
+#include <cstdlib>
+#include <sstream>
+
+static std::string itos(int n) {
+    std::ostringstream oss;
+    oss << n;
+    return oss.str();
+}
+
+// same shape as location_match_bench: nested API prefixes, static dirs, per-user trees
+static ServerConfig makeServer(int locationCount) {
+    ServerConfig config;
+    config.listen.push_back(8080);
+    config.serverName.push_back("bench.example.com");
+    config.root = "./www/html";
+    LocationConfig root;
+    root.path = "/";
+    config.locations.push_back(root);
+    for (int i = 0; config.locations.size() < static_cast<size_t>(locationCount); ++i) {
+        LocationConfig a, b, c, d;
+        a.path = "/api/v" + itos(i % 4) + "/svc" + itos(i) + "/";
+        b.path = "/static" + itos(i);
+        c.path = "/api/v" + itos(i % 4) + "/svc" + itos(i) + "/items";
+        d.path = "/user" + itos(i) + "/profile/";
+        config.locations.push_back(a);
+        config.locations.push_back(b);
+        config.locations.push_back(c);
+        config.locations.push_back(d);
+    }
+    config.locations.resize(locationCount);
+    return config;
+}
+
+static std::vector<std::string> makeUris(int count, int locations) {
+    std::vector<std::string> uris;
+    srand(42);
+    for (int i = 0; i < count; ++i) {
+        int n = rand() % (locations / 4 + 1);
+        switch (rand() % 6) {
+            case 0: uris.push_back("/api/v" + itos(n % 4) + "/svc" + itos(n) + "/items/42"); break;
+            case 1: uris.push_back("/static" + itos(n) + "/css/site.css"); break;
+            case 2: uris.push_back("/user" + itos(n) + "/profile"); break;
+            case 3: uris.push_back("/index.html"); break;
+            case 4: uris.push_back("/api/v" + itos(n % 4) + "/svc" + itos(n) + "/itemsX"); break;
+            default: uris.push_back("/missing/" + itos(n)); break;
+        }
+    }
+    return uris;
+}
+
+// one op = one lookup, cycling through 1024 URIs so the branch predictor can't learn them
+struct LocationBody {
+    ServerInstance* server;
+    std::vector<std::string> uris;
+    size_t next;
+    void operator()() {
+        LocationConfig* location = server->findMatchingLocation(uris[next]);
+        MicroBench::keep(location);
+        next = (next + 1) & 1023;
+    }
+};
+
+// the table only stores the pointers, distinct addresses are enough
+static std::vector<char> serverSlots(10000);
+
+static ServerInstance* fakeServer(int i) {
+    return reinterpret_cast<ServerInstance*>(&serverSlots[i]);
+}
+
+/* WebServer::findServerByHost is a port lookup and VirtualHostTable::lookup();
+   the table is built directly because a WebServer binds its ports when initialized */
+struct VirtualHostBody {
+    VirtualHostTable table;
+    std::vector<std::string> hosts;
+    size_t next;
+    void operator()() {
+        ServerInstance* server = table.lookup(hosts[next]);
+        MicroBench::keep(server);
+        next = (next + 1) & 1023;
+    }
+};
+
+static void buildVirtualHosts(VirtualHostBody& body, int serverCount) {
+    for (int i = 0; i < serverCount; ++i) {
+        std::vector<std::string> names;
+        switch (i % 4) {
+            case 0: names.push_back("svc" + itos(i) + ".example.com"); break;
+            case 1: names.push_back("*.zone" + itos(i) + ".example.org"); break;
+            case 2: names.push_back("www" + itos(i) + ".*"); break;
+            default:
+                names.push_back("app" + itos(i) + ".example.net");
+                names.push_back("www.app" + itos(i) + ".example.net");
+                break;
+        }
+        body.table.add(fakeServer(i), names);
+    }
+    srand(7);
+    for (int i = 0; i < 1024; ++i) {
+        int n = rand() % serverCount;
+        switch (rand() % 5) {
+            case 0: body.hosts.push_back("svc" + itos(n - n % 4) + ".example.com:8080"); break;
+            case 1: body.hosts.push_back("img.zone" + itos(n - n % 4 + 1) + ".example.org"); break;
+            case 2: body.hosts.push_back("www" + itos(n - n % 4 + 2) + ".example.io"); break;
+            case 3: body.hosts.push_back("WWW.App" + itos(n - n % 4 + 3) + ".Example.NET."); break;
+            default: body.hosts.push_back("unknown" + itos(n) + ".test"); break;
+        }
+    }
+    body.next = 0;
+}
+
+void routingBenchmarks(MicroBench& bench) {
+    const int sizes[] = { 10, 100, 1000, 10000 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        ServerInstance server(makeServer(sizes[i]));
+        LocationBody location;
+        location.server = &server;
+        location.uris = makeUris(1024, sizes[i]);
+        location.next = 0;
+        assert(server.findMatchingLocation("/index.html") == &server.getConfig().locations[0]);
+        bench.run("route/findMatchingLocation/locations=" + itos(sizes[i]), location);
+
+        VirtualHostBody vhost;
+        buildVirtualHosts(vhost, sizes[i]);
+        assert(vhost.table.lookup("svc0.example.com") == fakeServer(0));
+        bench.run("route/findServerByHost/servers=" + itos(sizes[i]), vhost);
+    }
+}
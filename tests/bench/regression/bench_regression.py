@@ -0,0 +1,409 @@
+#!/usr/bin/env python3
+"""Performance regression baselines for the load and microbenchmark suites.
+
+Usage:
+    python3 tests/bench/regression/bench_regression.py record  [--suite NAME ...]
+    python3 tests/bench/regression/bench_regression.py compare [--suite NAME ...]
+                                                [--tolerance PCT] [--verbose] [--json FILE]
+    python3 tests/bench/regression/bench_regression.py large-config [FILE]
+
+Suites:
+    micro          tests/bench/micro/microbench: parser, router, response builder
+    load-default   tests/bench/load/webserv_bench against config/default.conf
+    load-multi     the same against config/multi_server.conf
+    load-large     the same against a generated config: 64 virtual hosts on one port,
+                   256 locations each, requests for the last host
+
+record builds the server and the benchmarks, runs the suites and writes
+baselines/<suite>.json. compare runs them the same way, with the parameters
+stored in each baseline, and checks every metric against tolerances.json. A metric
+regresses when it moves the wrong way by more than percent of the baseline and by
+more than the metric's slack, an absolute noise floor that also covers zero baselines.
+--tolerance overrides every percent. Exit status: 0 no regression, 1 regression,
+2 the suites could not run. Both leave the measured build in build/ (make re goes
+back to the debug build).
+
+Baselines only compare on the machine and build they were recorded with: compare
+warns when the CPU, CPU count or build differ, and the numbers checked in here are
+those of the reference box, re-record them there after an intended change.
+"""
+import argparse
+import fnmatch
+import json
+import os
+import platform
+import signal
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), "..", "..", ".."))
+HERE = os.path.dirname(os.path.abspath(__file__))
+BASELINES = os.path.join(HERE, "baselines")
+TOLERANCES = os.path.join(HERE, "tolerances.json")
+
+# every suite runs `repeat` times: micro keeps the fastest run of each metric (noise only
+# ever slows it down), load keeps the median
+LOAD_DEFAULTS = {
+    "repeat": 3,
+    "aggregate": "median",
+    "connections": 16,
+    "threads": 1,
+    "duration": 5,
+    "warmup": 1,
+    "mix": "static:80,autoindex:10,404:10",
+    "host": "localhost",
+}
+
+SUITES = {
+    "micro": {"kind": "micro", "time_ms": 100, "repeat": 3, "aggregate": "min"},
+    "load-default": dict(LOAD_DEFAULTS, kind="load", config="config/default.conf"),
+    "load-multi": dict(LOAD_DEFAULTS, kind="load", config="config/multi_server.conf"),
+    "load-large": dict(LOAD_DEFAULTS, kind="load", config="large", host="site63.bench.local"),
+}
+
+LARGE_HOSTS = 64
+LARGE_LOCATIONS = 256
+PORT = 8080
+
+
+def log(message):
+    sys.stderr.write(message + "\n")
+    sys.stderr.flush()
+
+
+def large_config():
+    """Same location shapes as the routing microbenchmark: nested API prefixes, static
+    dirs and per-user trees, plus the / and /images/ the load mix requests."""
+    lines = ["# generated by tests/bench/regression/bench_regression.py: %d virtual hosts x %d locations"
+             % (LARGE_HOSTS, LARGE_LOCATIONS), "",
+             "include %s;" % os.path.join(ROOT, "config", "mime.types"), ""]
+    for host in range(LARGE_HOSTS):
+        name = "localhost" if host == 0 else "site%d.bench.local" % host
+        lines += ["server {", "    listen %d;" % PORT, "    server_name %s;" % name,
+                  "    root ./www/html;", ""]
+        locations = ["location / {\n        root ./www/html;\n        index index.html;\n    }",
+                     "location /images/ {\n        root ./www;\n        autoindex on;\n    }"]
+        i = 0
+        while len(locations) < LARGE_LOCATIONS:
+            for path in ("/api/v%d/svc%d/" % (i % 4, i), "/static%d" % i,
+                         "/api/v%d/svc%d/items" % (i % 4, i), "/user%d/profile/" % i):
+                locations.append("location %s {\n        root ./www/html;\n    }" % path)
+            i += 1
+        lines += ["    " + location for location in locations[:LARGE_LOCATIONS]]
+        lines += ["}", ""]
+    return "\n".join(lines)
+
+
+def run(command, **kwargs):
+    return subprocess.run(command, cwd=ROOT, check=True, **kwargs)
+
+
+def build(mode):
+    log("building the server (%s) and the benchmarks" % mode)
+    quiet = {"stdout": subprocess.DEVNULL}
+    if mode == "release":
+        run(["make", "-s", "release"], **quiet)
+    else:
+        run(["make", "-s", "all"], **quiet)
+    run(["make", "-s", "bench"], **quiet)
+    run(["make", "-s", "-C", "tests/bench/micro"], **quiet)
+
+
+def wait_for_port(port, seconds):
+    deadline = time.time() + seconds
+    while time.time() < deadline:
+        try:
+            with socket.create_connection(("127.0.0.1", port), timeout=0.5):
+                return True
+        except OSError:
+            time.sleep(0.1)
+    return False
+
+
+def port_in_use(port):
+    try:
+        with socket.create_connection(("127.0.0.1", port), timeout=0.5):
+            return True
+    except OSError:
+        return False
+
+
+class Server:
+    """./webserv CONFIG from the repository root, stopped on exit"""
+
+    def __init__(self, config, workdir):
+        self.config = config
+        self.logfile = os.path.join(workdir, "webserv.log")
+        self.process = None
+
+    def __enter__(self):
+        if port_in_use(PORT):
+            raise RuntimeError("port %d is already in use, stop the running server first" % PORT)
+        with open(self.logfile, "w") as out:
+            self.process = subprocess.Popen([os.path.join(ROOT, "webserv"), self.config], cwd=ROOT,
+                                            stdout=out, stderr=subprocess.STDOUT)
+        if not wait_for_port(PORT, 10):
+            self.__exit__(None, None, None)
+            raise RuntimeError("webserv did not start with %s, see %s" % (self.config, self.logfile))
+        return self
+
+    def __exit__(self, *exc):
+        if self.process and self.process.poll() is None:
+            self.process.send_signal(signal.SIGTERM)
+            try:
+                self.process.wait(timeout=5)
+            except subprocess.TimeoutExpired:
+                self.process.kill()
+                self.process.wait()
+
+
+def run_micro(params):
+    output = run([os.path.join(ROOT, "tests/bench/micro/microbench"), "--json",
+                  "--time-ms", str(params["time_ms"])], stdout=subprocess.PIPE).stdout
+    benchmarks = {}
+    for result in json.loads(output):
+        benchmarks[result["name"]] = {
+            "ns_per_op": result["ns_per_op"],
+            "allocs_per_op": result["allocs_per_op"],
+            "bytes_per_op": result["bytes_per_op"],
+        }
+    return benchmarks
+
+
+def run_load(params, workdir):
+    config = params["config"]
+    if config == "large":
+        config = os.path.join(workdir, "large.conf")
+        with open(config, "w") as out:
+            out.write(large_config())
+    with Server(config, workdir):
+        output = run([os.path.join(ROOT, "tests/bench/load/webserv_bench"), "--json",
+                      "--connections", str(params["connections"]), "--threads", str(params["threads"]),
+                      "--duration", str(params["duration"]), "--warmup", str(params["warmup"]),
+                      "--mix", params["mix"], "--host-header", params["host"]],
+                     stdout=subprocess.PIPE).stdout
+    report = json.loads(output)
+    errors = sum(report["errors"].values())
+    benchmarks = {"all": {
+        "rps": report["rps"],
+        "latency_p50_us": report["latency_us"]["p50"],
+        "latency_p99_us": report["latency_us"]["p99"],
+        "errors": errors,
+    }}
+    for kind, latency in report["kinds"].items():
+        benchmarks[kind] = {"latency_p50_us": latency["p50"], "latency_p99_us": latency["p99"]}
+    return benchmarks
+
+
+def aggregate(runs, how):
+    merged = {}
+    for benchmark in runs[0]:
+        merged[benchmark] = {}
+        for metric in runs[0][benchmark]:
+            values = sorted(run[benchmark][metric] for run in runs
+                            if metric in run.get(benchmark, {}))
+            merged[benchmark][metric] = values[0] if how == "min" else values[len(values) // 2]
+    return merged
+
+
+def run_suite(name, params):
+    runs = []
+    for attempt in range(params.get("repeat", 1)):
+        log("running %s (%d/%d)" % (name, attempt + 1, params.get("repeat", 1)))
+        with tempfile.TemporaryDirectory(prefix="webserv-regression-") as workdir:
+            if params["kind"] == "micro":
+                runs.append(run_micro(params))
+            else:
+                runs.append(run_load(params, workdir))
+    return aggregate(runs, params.get("aggregate", "median"))
+
+
+def cpu_model():
+    try:
+        with open("/proc/cpuinfo") as cpuinfo:
+            for line in cpuinfo:
+                if line.startswith("model name"):
+                    return line.split(":", 1)[1].strip()
+    except OSError:
+        pass
+    return platform.processor() or "unknown"
+
+
+def machine(mode):
+    return {"cpu": cpu_model(), "cpus": os.cpu_count(), "build": mode}
+
+
+def commit():
+    try:
+        return subprocess.run(["git", "rev-parse", "--short", "HEAD"], cwd=ROOT, check=True,
+                              stdout=subprocess.PIPE, stderr=subprocess.DEVNULL,
+                              universal_newlines=True).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return "unknown"
+
+
+def baseline_path(name):
+    return os.path.join(BASELINES, name + ".json")
+
+
+def record(args):
+    build(args.build)
+    os.makedirs(BASELINES, exist_ok=True)
+    for name in args.suite:
+        params = SUITES[name]
+        baseline = {
+            "suite": name,
+            "recorded": time.strftime("%Y-%m-%d"),
+            "commit": commit(),
+            "machine": machine(args.build),
+            "params": params,
+            "benchmarks": run_suite(name, params),
+        }
+        with open(baseline_path(name), "w") as out:
+            json.dump(baseline, out, indent=2, sort_keys=True)
+            out.write("\n")
+        log("wrote %s" % os.path.relpath(baseline_path(name), ROOT))
+    return 0
+
+
+def load_tolerances(override):
+    with open(TOLERANCES) as source:
+        tolerances = json.load(source)
+    if override is not None:
+        for rule in [tolerances["default"]] + list(tolerances["metrics"].values()) \
+                + list(tolerances.get("overrides", {}).values()):
+            rule["percent"] = override
+    return tolerances
+
+
+def rule_for(tolerances, suite, benchmark, metric):
+    """the metric's rule, with the first matching "suite/benchmark/metric" override on top"""
+    rule = dict(tolerances["default"])
+    rule.update(tolerances["metrics"].get(metric, {}))
+    key = "%s/%s/%s" % (suite, benchmark, metric)
+    for pattern, override in tolerances.get("overrides", {}).items():
+        if fnmatch.fnmatchcase(key, pattern):
+            rule.update(override)
+            break
+    return rule
+
+
+def check(baseline, current, rule):
+    """(status, change in percent): status is ok, regression or improvement"""
+    worse = current - baseline if rule.get("better", "lower") == "lower" else baseline - current
+    change = (current - baseline) * 100.0 / baseline if baseline else 0.0
+    limit = max(abs(baseline) * rule.get("percent", 0) / 100.0, rule.get("slack", 0))
+    if worse > limit:
+        return "regression", change
+    if -worse > limit:
+        return "improvement", change
+    return "ok", change
+
+
+def compare(args):
+    tolerances = load_tolerances(args.tolerance)
+    baselines = {}
+    for name in args.suite:
+        try:
+            with open(baseline_path(name)) as source:
+                baselines[name] = json.load(source)
+        except OSError:
+            log("no baseline for %s, run: bench_regression.py record --suite %s" % (name, name))
+            return 2
+    builds = set(b["machine"]["build"] for b in baselines.values())
+    if len(builds) != 1:
+        log("baselines were recorded with different builds: %s" % ", ".join(sorted(builds)))
+        return 2
+    mode = builds.pop()
+    build(mode)
+    here = machine(mode)
+
+    rows = []
+    for name in args.suite:
+        baseline = baselines[name]
+        if baseline["machine"] != here:
+            log("warning: %s was recorded on %s, this is %s" % (name, baseline["machine"], here))
+        results = run_suite(name, baseline["params"])
+        for benchmark, metrics in sorted(baseline["benchmarks"].items()):
+            for metric, expected in sorted(metrics.items()):
+                got = results.get(benchmark, {}).get(metric)
+                if got is None:
+                    rows.append((name, benchmark, metric, expected, None, 0.0, None, "missing"))
+                    continue
+                rule = rule_for(tolerances, name, benchmark, metric)
+                status, change = check(expected, got, rule)
+                rows.append((name, benchmark, metric, expected, got, change, rule, status))
+
+    report(rows, args.verbose)
+    if args.json:
+        with open(args.json, "w") as out:
+            json.dump([{"suite": r[0], "benchmark": r[1], "metric": r[2], "baseline": r[3],
+                        "current": r[4], "change_percent": round(r[5], 2), "status": r[7]} for r in rows],
+                      out, indent=2)
+            out.write("\n")
+    failed = [r for r in rows if r[7] in ("regression", "missing")]
+    return 1 if failed else 0
+
+
+def report(rows, verbose):
+    width = max([len("%s/%s/%s" % r[:3]) for r in rows] + [10])
+    print("%-*s %14s %14s %9s %10s  %s" % (width, "metric", "baseline", "current", "change", "limit", "status"))
+    shown = 0
+    for suite, benchmark, metric, expected, got, change, rule, status in rows:
+        if status == "ok" and not verbose:
+            continue
+        limit = "-"
+        if rule:
+            limit = "%s%g%%" % ("+" if rule.get("better", "lower") == "lower" else "-", rule.get("percent", 0))
+        print("%-*s %14.2f %14s %8.1f%% %10s  %s" % (width, "%s/%s/%s" % (suite, benchmark, metric), expected,
+                                                    "-" if got is None else "%.2f" % got, change, limit, status))
+        shown += 1
+    counts = {}
+    for row in rows:
+        counts[row[7]] = counts.get(row[7], 0) + 1
+    if not shown:
+        print("(every metric within tolerance, --verbose lists them)")
+    print("\n%d metrics: %s" % (len(rows), ", ".join("%d %s" % (n, s) for s, n in sorted(counts.items()))))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="performance regression baselines")
+    commands = parser.add_subparsers(dest="command")
+    for command in ("record", "compare"):
+        sub = commands.add_parser(command)
+        sub.add_argument("--suite", action="append", choices=sorted(SUITES),
+                         help="suite to run, repeatable (default: all)")
+        if command == "record":
+            sub.add_argument("--build", choices=("release", "debug"), default="release",
+                             help="server build to measure (release)")
+        else:
+            sub.add_argument("--tolerance", type=float, help="percent for every metric, overrides tolerances.json")
+            sub.add_argument("--verbose", action="store_true", help="list metrics within tolerance too")
+            sub.add_argument("--json", metavar="FILE", help="also write the comparison as JSON")
+    generate = commands.add_parser("large-config")
+    generate.add_argument("file", nargs="?", help="output file (stdout)")
+    args = parser.parse_args()
+
+    if args.command == "large-config":
+        if args.file:
+            with open(args.file, "w") as out:
+                out.write(large_config())
+        else:
+            sys.stdout.write(large_config())
+        return 0
+    if args.command not in ("record", "compare"):
+        parser.print_help()
+        return 2
+    args.suite = args.suite or sorted(SUITES)
+    try:
+        return record(args) if args.command == "record" else compare(args)
+    except (RuntimeError, subprocess.CalledProcessError, ValueError) as error:
+        log("error: %s" % error)
+        return 2
+
+
+if __name__ == "__main__":
+    sys.exit(main())
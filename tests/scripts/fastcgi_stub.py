@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""Minimal FastCGI responder for testing fastcgi_pass without php-fpm.
+
+Usage:
+    python3 tests/scripts/fastcgi_stub.py unix:/tmp/webserv-fcgi.sock [--mpxs]
+    python3 tests/scripts/fastcgi_stub.py 127.0.0.1:9000
+
+Answers FCGI_GET_VALUES (multiplexing only with --mpxs), keeps connections
+open when FCGI_KEEP_CONN is set, and replies to every request with a small
+text/plain page listing the method, script, query string and body size.
+A script name containing "slow" sleeps one second before answering.
+"""
+import os
+import socket
+import struct
+import sys
+import threading
+import time
+
+BEGIN, ABORT, END, PARAMS, STDIN, STDOUT = 1, 2, 3, 4, 5, 6
+GET_VALUES, GET_VALUES_RESULT = 9, 10
+
+
+def record(rtype, rid, content=b""):
+    pad = (8 - len(content) % 8) % 8
+    return struct.pack("!BBHHBx", 1, rtype, rid, len(content), pad) + content + b"\0" * pad
+
+
+def encode_len(n):
+    return struct.pack("!B", n) if n < 128 else struct.pack("!I", n | 0x80000000)
+
+
+def pairs(data):
+    out, pos = {}, 0
+    while pos < len(data):
+        lens = []
+        for _ in range(2):
+            if data[pos] & 0x80:
+                lens.append(struct.unpack("!I", data[pos:pos + 4])[0] & 0x7FFFFFFF)
+                pos += 4
+            else:
+                lens.append(data[pos])
+                pos += 1
+        name = data[pos:pos + lens[0]].decode()
+        value = data[pos + lens[0]:pos + lens[0] + lens[1]].decode(errors="replace")
+        pos += lens[0] + lens[1]
+        out[name] = value
+    return out
+
+
+def serve(conn, mpxs):
+    buf, reqs, lock = b"", {}, threading.Lock()
+
+    def respond(rid, req):
+        params = pairs(req["params"])
+        if "slow" in params.get("SCRIPT_FILENAME", ""):
+            time.sleep(1)
+        body = ("method=%s\nscript=%s\nquery=%s\nbody=%d\npid=%d\n" % (
+            params.get("REQUEST_METHOD"), params.get("SCRIPT_FILENAME"),
+            params.get("QUERY_STRING"), len(req["stdin"]), os.getpid())).encode()
+        out = b"Content-Type: text/plain\r\n\r\n" + body
+        with lock:
+            conn.sendall(record(STDOUT, rid, out) + record(STDOUT, rid) +
+                         record(END, rid, struct.pack("!IB3x", 0, 0)))
+            if not req["keep"]:
+                conn.close()
+
+    while True:
+        try:
+            data = conn.recv(65536)
+        except OSError:
+            return
+        if not data:
+            return
+        buf += data
+        while len(buf) >= 8:
+            _, rtype, rid, clen, pad = struct.unpack("!BBHHBx", buf[:8])
+            if len(buf) < 8 + clen + pad:
+                break
+            content, buf = buf[8:8 + clen], buf[8 + clen + pad:]
+            if rtype == GET_VALUES:
+                values = {"FCGI_MAX_CONNS": "8", "FCGI_MAX_REQS": "8" if mpxs else "1",
+                          "FCGI_MPXS_CONNS": "1" if mpxs else "0"}
+                payload = b"".join(encode_len(len(k)) + encode_len(len(v)) + k.encode() + v.encode()
+                                   for k, v in values.items() if k in pairs(content))
+                with lock:
+                    conn.sendall(record(GET_VALUES_RESULT, 0, payload))
+            elif rtype == BEGIN:
+                reqs[rid] = {"params": b"", "stdin": b"", "keep": bool(content[2] & 1)}
+            elif rtype == PARAMS and rid in reqs:
+                reqs[rid]["params"] += content
+            elif rtype == STDIN and rid in reqs:
+                if content:
+                    reqs[rid]["stdin"] += content
+                else:
+                    req = reqs.pop(rid)
+                    if mpxs:
+                        threading.Thread(target=respond, args=(rid, req), daemon=True).start()
+                    else:
+                        respond(rid, req)
+            elif rtype == ABORT:
+                reqs.pop(rid, None)
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit(__doc__)
+    address, mpxs = sys.argv[1], "--mpxs" in sys.argv
+    if address.startswith("unix:"):
+        path = address[5:]
+        if os.path.exists(path):
+            os.unlink(path)
+        server = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        server.bind(path)
+    else:
+        host, port = address.rsplit(":", 1)
+        server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        server.bind((host, int(port)))
+    server.listen(64)
+    while True:
+        conn, _ = server.accept()
+        threading.Thread(target=serve, args=(conn, mpxs), daemon=True).start()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,93 @@
+#include "../../src/cgi/cgi_cache.hpp"
+#include "../../src/cgi/cgi_response.hpp"
+#include "../../src/utils/server_clock.hpp"
+#include <cassert>
+#include <iostream>
+
+static long long freshness(const std::string& raw, time_t now = 1000000000) {
+    CGIResponse response;
+    assert(response.parseRawOutput(raw));
+    return CGICache::freshnessMs(response, 5000, now);
+}
+
+// host is case-insensitive, the query is part of the key
+void test_make_key() {
+    std::cout << "Testing cache keys..." << std::endl;
+    assert(CGICache::makeKey("GET", "Example.COM", "/a.py", "") == "GET example.com /a.py");
+    assert(CGICache::makeKey("GET", "h", "/a.py", "x=1") == "GET h /a.py?x=1");
+    std::cout << "✅ cache keys passed" << std::endl;
+}
+
+void test_ttl_and_lru() {
+    std::cout << "\nTesting TTL and LRU eviction..." << std::endl;
+    CGICache cache(1000, 0, 30, 20);
+    std::string out;
+    assert(cache.lookup("k1", 0, out) == CGICache::MISS);
+    cache.store("k1", "0123456789", 1000, 0);          // 12 bytes
+    assert(cache.lookup("k1", 999, out) == CGICache::FRESH && out == "0123456789");
+    assert(cache.lookup("k1", 1000, out) == CGICache::MISS);  // expired and dropped
+    assert(cache.entryCount() == 0 && cache.bytes() == 0);
+
+    cache.store("k1", "0123456789", 1000, 0);
+    cache.store("k2", "0123456789", 1000, 0);
+    assert(cache.lookup("k1", 1, out) == CGICache::FRESH);    // k2 is now least recent
+    cache.store("k3", "0123456789", 1000, 0);
+    assert(cache.lookup("k2", 1, out) == CGICache::MISS);
+    assert(cache.lookup("k1", 1, out) == CGICache::FRESH && cache.lookup("k3", 1, out) == CGICache::FRESH);
+    assert(cache.bytes() <= 30);
+
+    cache.store("big", "0123456789012345678901", 1000, 0);  // over the entry limit
+    assert(cache.lookup("big", 1, out) == CGICache::MISS);
+    cache.store("no", "x", 0, 0);
+    assert(cache.lookup("no", 1, out) == CGICache::MISS);
+    std::cout << "✅ TTL and LRU eviction passed" << std::endl;
+}
+
+// expired entries are still served within the stale window
+void test_stale_window() {
+    std::cout << "\nTesting stale window..." << std::endl;
+    CGICache cache(1000, 500, 1024, 1024);
+    std::string out;
+    cache.store("k", "old", 1000, 0);
+    assert(cache.lookup("k", 999, out) == CGICache::FRESH);
+    assert(cache.lookup("k", 1000, out) == CGICache::STALE && out == "old");
+    assert(cache.lookup("k", 1499, out) == CGICache::STALE);
+    assert(cache.lookup("k", 1500, out) == CGICache::MISS);
+    assert(cache.staleHits() == 2 && cache.entryCount() == 0);
+
+    cache.store("k", "old", 1000, 0);
+    cache.store("k", "new", 1000, 1200);                  // the refresh replaces it
+    assert(cache.lookup("k", 1300, out) == CGICache::FRESH && out == "new");
+    std::cout << "✅ stale window passed" << std::endl;
+}
+
+void test_freshness() {
+    std::cout << "\nTesting freshness rules..." << std::endl;
+    assert(freshness("Content-Type: text/plain\n\nx") == 5000);
+    assert(freshness("Cache-Control: public, max-age=60\n\nx") == 60000);
+    assert(freshness("Cache-Control: max-age=60, s-maxage=10\n\nx") == 10000);
+    assert(freshness("Cache-Control: max-age=0\n\nx") == -1);
+    assert(freshness("Cache-Control: no-store\n\nx") == -1);
+    assert(freshness("Cache-Control: Private\n\nx") == -1);
+    assert(freshness("Set-Cookie: a=b\n\nx") == -1);
+    assert(freshness("Vary: Accept\n\nx") == -1);
+    assert(freshness("Status: 404 Not Found\n\nx") == -1);
+    assert(freshness("Status: 302 Found\nLocation: /\n\n") == 5000);
+
+    time_t expires = ServerClock::parseHttpDate("Sun, 09 Sep 2001 01:46:40 GMT");
+    assert(expires == 1000000000);
+    assert(freshness("Expires: Sun, 09 Sep 2001 01:47:40 GMT\n\nx", expires) == 60000);
+    assert(freshness("Expires: Sun, 09 Sep 2001 01:46:40 GMT\n\nx", expires) == -1);
+    assert(freshness("Expires: 0\n\nx") == -1);
+    std::cout << "✅ freshness rules passed" << std::endl;
+}
+
+int main() {
+    std::cout << "=== CGI Cache Tests ===\n" << std::endl;
+    test_make_key();
+    test_ttl_and_lru();
+    test_stale_window();
+    test_freshness();
+    std::cout << "\n🎉 All CGI cache tests passed!" << std::endl;
+    return 0;
+}
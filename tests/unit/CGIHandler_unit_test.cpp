@@ -0,0 +1,337 @@
+#include "../../src/cgi/cgi_handler.hpp"
+#include "../../src/utils/server_stats.hpp"
+#include "../../src/utils/server_clock.hpp"
+#include <sys/select.h>
+#include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+// /bin/sh scripts in a temp dir, driven through the handler like the event loop does
+static std::string scriptDir;
+
+static bool contains(const std::string& haystack, const std::string& needle) {
+    return haystack.find(needle) != std::string::npos;
+}
+
+static void writeFile(const std::string& name, const std::string& content) {
+    std::ofstream out((scriptDir + "/" + name).c_str(), std::ios::binary | std::ios::trunc);
+    out << content;
+}
+
+static void setUpScripts() {
+    char dir[] = "/tmp/cgi_handler_test.XXXXXX";
+    assert(mkdtemp(dir) != NULL);
+    scriptDir = dir;
+    // answers with whatever the test left in body.txt
+    writeFile("payload.sh", "printf 'Content-Type: text/plain\\r\\n\\r\\n'\n"
+                            "cat \"$(dirname \"$0\")/body.txt\"\n");
+    // takes a while & may not be shared with requests waiting for it
+    writeFile("nostore.sh", "sleep 0.2\n"
+                            "printf 'Content-Type: text/plain\\r\\nCache-Control: no-store\\r\\n\\r\\nprivate'\n");
+    writeFile("slow.sh", "sleep 0.5\n"
+                         "printf 'Content-Type: text/plain\\r\\n\\r\\nslow'\n");
+}
+
+static void tearDownScripts() {
+    std::string command = "rm -rf " + scriptDir;
+    assert(system(command.c_str()) == 0);
+}
+
+static LocationConfig cgiLocation() {
+    LocationConfig location("/");
+    location.cgiExtension = ".sh";
+    location.cgiPath = "/bin/sh";
+    return location;
+}
+
+static HttpRequest* getRequest(const std::string& uri) {
+    HttpRequest* request = new HttpRequest();
+    assert(request->parseRequest("GET " + uri + " HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+    return request;
+}
+
+// one event loop iteration: select on the handler's fds, collect what completed
+static void pumpOnce(CGIHandler& handler, std::set<int>& completed) {
+    fd_set readFds;
+    fd_set writeFds;
+    FD_ZERO(&readFds);
+    FD_ZERO(&writeFds);
+    int maxFd = -1;
+    handler.addFds(&readFds, &writeFds, maxFd);
+    struct timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 10000;
+    select(maxFd + 1, &readFds, &writeFds, NULL, &timeout);
+    ServerClock::update();
+    std::vector<int> done;
+    handler.handleIO(&readFds, &writeFds, done);
+    completed.insert(done.begin(), done.end());
+}
+
+static void waitFor(CGIHandler& handler, std::set<int>& completed, int clientFd) {
+    long long deadlineMs = ServerClock::monotonicMs() + 5000;
+    while (!completed.count(clientFd) && ServerClock::monotonicMs() < deadlineMs)
+        pumpOnce(handler, completed);
+    assert(completed.count(clientFd));
+    completed.erase(clientFd);
+}
+
+// background jobs report nothing: wait until the handler has no job left
+static void waitIdle(CGIHandler& handler) {
+    std::set<int> completed;
+    long long deadlineMs = ServerClock::monotonicMs() + 5000;
+    while (handler.activeCount() > 0 && ServerClock::monotonicMs() < deadlineMs)
+        pumpOnce(handler, completed);
+    assert(handler.activeCount() == 0);
+    assert(completed.empty());
+}
+
+static void sleepMs(int ms) {
+    usleep(ms * 1000);
+    ServerClock::update();
+}
+
+/* stale hits refresh in the background under cgi_max_concurrent 1
+    - a refresh whose output outgrows cgi_output_buffer is dropped, not streamed to nobody,
+      and gives its slot back: the next refresh can start
+*/
+void test_stale_refresh() {
+    std::cout << "Testing stale hit & background refresh..." << std::endl;
+    LocationConfig location = cgiLocation();
+    location.cgiCacheTtlMs = 100;
+    location.cgiCacheStaleMs = 60000;
+    location.cgiMaxConcurrent = 1;
+    location.cgiOutputBufferSize = 64 * 1024;
+    std::string script = scriptDir + "/payload.sh";
+    HttpRequest* request = getRequest("/payload.sh");
+    CGIHandler handler;
+    std::set<int> completed;
+    std::string response;
+
+    writeFile("body.txt", "v1");
+    assert(handler.lookupCache(10, *request, location, script, response) == CGIHandler::CACHE_MISS);
+    assert(handler.submit(10, *request, location, script) == CGIHandler::START_OK);
+    waitFor(handler, completed, 10);
+    assert(handler.finish(10, response) == 0 && contains(response, "v1"));
+    assert(ServerStats::cgi.active == 0);
+
+    // stale: the old response now, the new one once the refresh is done
+    sleepMs(150);
+    writeFile("body.txt", "v2");
+    assert(handler.lookupCache(11, *request, location, script, response) == CGIHandler::CACHE_HIT);
+    assert(contains(response, "v1"));
+    assert(handler.activeCount() == 1 && ServerStats::cgi.active == 1);
+    waitIdle(handler);
+    assert(ServerStats::cgi.active == 0);
+    assert(handler.lookupCache(12, *request, location, script, response) == CGIHandler::CACHE_HIT);
+    assert(contains(response, "v2"));
+
+    // the refresh outgrows cgi_output_buffer: dropped, v2 stays
+    sleepMs(150);
+    writeFile("body.txt", std::string(300 * 1024, 'x'));
+    assert(handler.lookupCache(13, *request, location, script, response) == CGIHandler::CACHE_HIT);
+    assert(contains(response, "v2"));
+    waitIdle(handler);
+    assert(ServerStats::cgi.active == 0);
+
+    // its slot is free again: the next stale hit refreshes
+    writeFile("body.txt", "v3");
+    assert(handler.lookupCache(14, *request, location, script, response) == CGIHandler::CACHE_HIT);
+    assert(contains(response, "v2"));
+    assert(ServerStats::cgi.active == 1);
+    waitIdle(handler);
+    assert(handler.lookupCache(15, *request, location, script, response) == CGIHandler::CACHE_HIT);
+    assert(contains(response, "v3"));
+    assert(ServerStats::cgi.active == 0);
+    delete request;
+    std::cout << "✅ stale hit & background refresh passed" << std::endl;
+}
+
+/* a miss while the key runs waits for it (cache lock)
+    - unshareable result (no-store): the waiters execute themselves, one at a time under
+      cgi_max_concurrent 1, each after the previous one gave its slot back
+*/
+void test_waiters_after_unshareable_fill() {
+    std::cout << "\nTesting waiters after an unshareable fill..." << std::endl;
+    LocationConfig location = cgiLocation();
+    location.cgiCacheTtlMs = 5000;
+    location.cgiMaxConcurrent = 1;
+    std::string script = scriptDir + "/nostore.sh";
+    HttpRequest* request = getRequest("/nostore.sh");
+    CGIHandler handler;
+    std::set<int> completed;
+    std::string response;
+
+    assert(handler.lookupCache(20, *request, location, script, response) == CGIHandler::CACHE_MISS);
+    assert(handler.submit(20, *request, location, script) == CGIHandler::START_OK);
+    assert(handler.lookupCache(21, *request, location, script, response) == CGIHandler::CACHE_WAIT);
+    assert(handler.lookupCache(22, *request, location, script, response) == CGIHandler::CACHE_WAIT);
+    assert(ServerStats::cgi.active == 1);
+
+    waitFor(handler, completed, 20);
+    assert(handler.finish(20, response) == 0 && contains(response, "private"));
+    // 21 takes the lock again and runs, 22 waits in the queue for the slot
+    assert(ServerStats::cgi.active == 1 && ServerStats::cgi.queued == 1);
+    waitFor(handler, completed, 21);
+    assert(handler.finish(21, response) == 0 && contains(response, "private"));
+    waitFor(handler, completed, 22);
+    assert(handler.finish(22, response) == 0 && contains(response, "private"));
+    assert(ServerStats::cgi.active == 0 && ServerStats::cgi.queued == 0);
+    assert(handler.activeCount() == 0);
+
+    // nothing was cached, no lock is left: a new request executes
+    assert(handler.lookupCache(23, *request, location, script, response) == CGIHandler::CACHE_MISS);
+    delete request;
+    std::cout << "✅ waiters after an unshareable fill passed" << std::endl;
+}
+
+/* a waiter gives up on the lock after cgi_cache_lock_timeout and executes itself;
+   the owner's result still fills the cache, both slots are given back */
+void test_lock_timeout() {
+    std::cout << "\nTesting cache lock timeout..." << std::endl;
+    LocationConfig location = cgiLocation();
+    location.cgiCacheTtlMs = 5000;
+    location.cgiCacheLockTimeoutMs = 100;
+    location.cgiMaxConcurrent = 2;
+    std::string script = scriptDir + "/slow.sh";
+    HttpRequest* request = getRequest("/slow.sh");
+    CGIHandler handler;
+    std::set<int> completed;
+    std::string response;
+
+    assert(handler.lookupCache(30, *request, location, script, response) == CGIHandler::CACHE_MISS);
+    assert(handler.submit(30, *request, location, script) == CGIHandler::START_OK);
+    assert(handler.lookupCache(31, *request, location, script, response) == CGIHandler::CACHE_WAIT);
+    assert(ServerStats::cgi.active == 1);
+
+    // 31 times out long before the owner is done and runs its own job
+    long long deadlineMs = ServerClock::monotonicMs() + 300;
+    while (ServerStats::cgi.active < 2 && ServerClock::monotonicMs() < deadlineMs)
+        pumpOnce(handler, completed);
+    assert(ServerStats::cgi.active == 2 && completed.empty());
+
+    waitFor(handler, completed, 30);
+    assert(handler.finish(30, response) == 0 && contains(response, "slow"));
+    waitFor(handler, completed, 31);
+    assert(handler.finish(31, response) == 0 && contains(response, "slow"));
+    assert(ServerStats::cgi.active == 0 && handler.activeCount() == 0);
+    assert(handler.lookupCache(32, *request, location, script, response) == CGIHandler::CACHE_HIT);
+    delete request;
+    std::cout << "✅ cache lock timeout passed" << std::endl;
+}
+
+/* cgi_max_concurrent 1: the second request queues, endJob() of the first starts it
+    - a queue of 1 turns the third away, a queued request leaves on release()
+    - a streamed job holds its slot until the body is out (release), not until finish()
+*/
+void test_queue_drain() {
+    std::cout << "\nTesting admission queue drain..." << std::endl;
+    LocationConfig location = cgiLocation();
+    location.cgiCacheTtlMs = 5000;          // buffered: finish() ends the job
+    location.cgiMaxConcurrent = 1;
+    location.cgiQueueSize = 1;
+    std::string script = scriptDir + "/nostore.sh";
+    HttpRequest* request = getRequest("/nostore.sh");
+    CGIHandler handler;
+    std::set<int> completed;
+    std::string response;
+
+    assert(handler.submit(40, *request, location, script) == CGIHandler::START_OK);
+    assert(handler.submit(41, *request, location, script) == CGIHandler::START_QUEUED);
+    assert(handler.submit(42, *request, location, script) == CGIHandler::START_BUSY);
+    assert(ServerStats::cgi.active == 1 && ServerStats::cgi.queued == 1);
+
+    waitFor(handler, completed, 40);
+    assert(handler.finish(40, response) == 0 && !handler.isStreaming(40));
+    assert(ServerStats::cgi.active == 1 && ServerStats::cgi.queued == 0);
+    assert(handler.submit(43, *request, location, script) == CGIHandler::START_QUEUED);
+    handler.release(43);
+    assert(ServerStats::cgi.queued == 0);
+    waitFor(handler, completed, 41);
+    assert(handler.finish(41, response) == 0 && contains(response, "private"));
+    assert(ServerStats::cgi.active == 0 && handler.activeCount() == 0);
+
+    LocationConfig streamed = cgiLocation();
+    streamed.cgiMaxConcurrent = 1;
+    std::string slowScript = scriptDir + "/slow.sh";
+    HttpRequest* slowRequest = getRequest("/slow.sh");
+    assert(handler.submit(44, *slowRequest, streamed, slowScript) == CGIHandler::START_OK);
+    assert(handler.submit(45, *slowRequest, streamed, slowScript) == CGIHandler::START_QUEUED);
+    waitFor(handler, completed, 44);
+    assert(handler.finish(44, response) == 0 && handler.isStreaming(44));
+    assert(ServerStats::cgi.active == 1 && ServerStats::cgi.queued == 1);
+    handler.release(44);
+    assert(ServerStats::cgi.active == 1 && ServerStats::cgi.queued == 0);
+    handler.release(45);
+    assert(ServerStats::cgi.active == 0 && handler.activeCount() == 0);
+    // the killed child is reaped by the loop, release() does not wait for it
+    long long deadlineMs = ServerClock::monotonicMs() + 1000;
+    while (CGIProcess::hasKilled() && ServerClock::monotonicMs() < deadlineMs)
+        pumpOnce(handler, completed);
+    assert(!CGIProcess::hasKilled() && !handler.needsPolling());
+    delete slowRequest;
+    delete request;
+    std::cout << "✅ admission queue drain passed" << std::endl;
+}
+
+/* the lowest free fds are past FD_SETSIZE: the CGI is refused with 503 (START_BUSY),
+   its pipes are closed again and no slot is taken */
+void test_fd_limit() {
+    std::cout << "\nTesting select() fd limit..." << std::endl;
+    struct rlimit limit;
+    assert(getrlimit(RLIMIT_NOFILE, &limit) == 0);
+    if (limit.rlim_max != RLIM_INFINITY && limit.rlim_max < static_cast<rlim_t>(FD_SETSIZE + 64)) {
+        std::cout << "⚠️  RLIMIT_NOFILE hard limit too low, skipped" << std::endl;
+        return;
+    }
+    struct rlimit raised = limit;
+    raised.rlim_cur = FD_SETSIZE + 64;
+    assert(setrlimit(RLIMIT_NOFILE, &raised) == 0);
+
+    std::vector<int> fillers;
+    int fd;
+    while ((fd = open("/dev/null", O_RDONLY)) < FD_SETSIZE - 1)
+        fillers.push_back(fd);
+    fillers.push_back(fd);
+
+    LocationConfig location = cgiLocation();
+    std::string script = scriptDir + "/slow.sh";
+    HttpRequest* request = getRequest("/slow.sh");
+    CGIHandler handler;
+    std::string response;
+    assert(handler.submit(50, *request, location, script) == CGIHandler::START_BUSY);
+    assert(contains(handler.getLastError(), "FD_SETSIZE"));
+    assert(ServerStats::cgi.active == 0 && handler.activeCount() == 0);
+    fd = open("/dev/null", O_RDONLY);
+    assert(fd == FD_SETSIZE);   // the refused pipes did not leak
+    close(fd);
+
+    for (size_t i = 0; i < fillers.size(); ++i)
+        close(fillers[i]);
+    assert(handler.submit(51, *request, location, script) == CGIHandler::START_OK);
+    handler.release(51);
+    assert(ServerStats::cgi.active == 0);
+    assert(setrlimit(RLIMIT_NOFILE, &limit) == 0);
+    delete request;
+    std::cout << "✅ select() fd limit passed" << std::endl;
+}
+
+int main() {
+    std::cout << "=== CGI Handler Tests ===\n" << std::endl;
+    setUpScripts();
+    test_stale_refresh();
+    test_waiters_after_unshareable_fill();
+    test_lock_timeout();
+    test_queue_drain();
+    test_fd_limit();
+    tearDownScripts();
+    std::cout << "\n🎉 All CGI handler tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "../../src/cgi/cgi_output_buffer.hpp"
+#include "../../src/utils/server_stats.hpp"
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+static std::string readAll(int fd) {
+    std::string data;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+        data.append(buffer, n);
+    return data;
+}
+
+// under the limit everything stays in memory
+void test_in_memory() {
+    std::cout << "Testing output under the limit..." << std::endl;
+    CGIOutputBuffer output;
+    output.setLimit(64 * 1024, "/tmp");
+    assert(output.append("Content-Type: text/plain\r\n\r\n", 28));
+    assert(output.append("hello", 5));
+    assert(output.size() == 33 && output.spilled() == 0);
+    assert(output.memory() == "Content-Type: text/plain\r\n\r\nhello");
+    assert(ServerStats::cgi.outputBuffered == 33);
+    assert(output.takeSpill() == -1);
+    output.clear();
+    assert(ServerStats::cgi.outputBuffered == 0);
+    std::cout << "✅ output under the limit passed" << std::endl;
+}
+
+// past the limit the tail goes to an unlinked temp file, in order
+void test_spill() {
+    std::cout << "\nTesting spill to a temp file..." << std::endl;
+    unsigned long long spillsBefore = ServerStats::cgi.outputSpills;
+    CGIOutputBuffer output;
+    output.setLimit(1, "/tmp"); // raised to MIN_LIMIT
+    std::string data;
+    for (size_t i = 0; i < CGIOutputBuffer::MIN_LIMIT + 5000; ++i)
+        data += static_cast<char>('a' + i % 26);
+    assert(output.append(data.data(), 1000));
+    assert(output.append(data.data() + 1000, data.size() - 1000));
+
+    assert(output.memory() == data.substr(0, CGIOutputBuffer::MIN_LIMIT));
+    assert(output.spilled() == 5000);
+    assert(output.size() == data.size());
+    assert(ServerStats::cgi.outputSpills == spillsBefore + 1);
+    assert(ServerStats::cgi.outputBuffered == CGIOutputBuffer::MIN_LIMIT);
+
+    int fd = output.takeSpill();
+    assert(fd != -1 && output.spilled() == 0);
+    assert(readAll(fd) == data.substr(CGIOutputBuffer::MIN_LIMIT));
+    close(fd);
+    std::cout << "✅ spill to a temp file passed" << std::endl;
+}
+
+// finish() hands the output over with swap(): the gauge does not move
+void test_swap() {
+    std::cout << "\nTesting swap..." << std::endl;
+    CGIOutputBuffer job;
+    CGIOutputBuffer taken;
+    job.setLimit(64 * 1024, "/tmp");
+    assert(job.append("abc", 3));
+    size_t buffered = ServerStats::cgi.outputBuffered;
+    taken.swap(job);
+    assert(taken.memory() == "abc" && job.empty());
+    assert(ServerStats::cgi.outputBuffered == buffered);
+    std::cout << "✅ swap passed" << std::endl;
+}
+
+// an unusable temp directory fails the output instead of losing bytes silently
+void test_spill_failure() {
+    std::cout << "\nTesting spill failure..." << std::endl;
+    CGIOutputBuffer output;
+    output.setLimit(0, "/nonexistent-webserv-dir");
+    std::string data(CGIOutputBuffer::MIN_LIMIT + 1, 'x');
+    assert(!output.append(data.data(), data.size()));
+    assert(output.failed());
+    assert(!output.append("y", 1));
+    std::cout << "✅ spill failure passed" << std::endl;
+}
+
+int main() {
+    std::cout << "=== CGI Output Buffer Tests ===\n" << std::endl;
+    test_in_memory();
+    test_spill();
+    test_swap();
+    test_spill_failure();
+    std::cout << "\n🎉 All CGI output buffer tests passed!" << std::endl;
+    return 0;
+}
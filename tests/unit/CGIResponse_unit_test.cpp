@@ -0,0 +1,79 @@
+#include "../../src/cgi/cgi_response.hpp"
+#include <cassert>
+#include <iostream>
+
+// the earliest blank line ends the headers, CRLF or bare LF
+void test_find_header_end() {
+    std::cout << "Testing header block detection..." << std::endl;
+    size_t sep = 0;
+    assert(CGIResponse::findHeaderEnd("Content-Type: text/html\r\n\r\nbody", sep) == 23 && sep == 4);
+    assert(CGIResponse::findHeaderEnd("Content-Type: text/html\n\nbody", sep) == 23 && sep == 2);
+    // LF headers with a CRLF blank line later in the body
+    assert(CGIResponse::findHeaderEnd("A: b\n\nx\r\n\r\ny", sep) == 4 && sep == 2);
+    assert(CGIResponse::findHeaderEnd("Content-Type: text/ht", sep) == std::string::npos);
+    assert(CGIResponse::findHeaderEnd("Content-Type: text/html\r\n", sep) == std::string::npos);
+    std::cout << "✅ header block detection passed" << std::endl;
+}
+
+// bare "\n\n" used to cut two bytes off the body
+void test_buffered_output() {
+    std::cout << "\nTesting buffered CGI output..." << std::endl;
+    CGIResponse lf;
+    assert(lf.parseRawOutput("Content-Type: text/html\n\n<!DOCTYPE html>"));
+    assert(lf.getBody() == "<!DOCTYPE html>");
+    assert(lf.getHeader("Content-Length") == "15");
+
+    CGIResponse crlf;
+    assert(crlf.parseRawOutput("Status: 404 Not Found\r\nContent-Type: text/plain\r\n\r\nmissing"));
+    assert(crlf.getStatusCode() == 404);
+    assert(crlf.getBody() == "missing");
+    std::string http = crlf.buildHTTPResponse();
+    assert(http.compare(0, 13, "HTTP/1.1 404 ") == 0);
+    assert(http.substr(http.size() - 11) == "\r\n\r\nmissing");
+    std::cout << "✅ buffered output passed" << std::endl;
+}
+
+// streamed output: headers only, no invented Content-Length
+void test_header_block() {
+    std::cout << "\nTesting streamed header block..." << std::endl;
+    CGIResponse response;
+    assert(response.parseHeaderBlock("Status: 201 Created\nX-Report: yes"));
+    assert(response.getStatusCode() == 201);
+    assert(!response.hasHeader("Content-Length"));
+    assert(response.getHeader("Content-Type") == "text/html");
+    response.setHeader("Transfer-Encoding", "chunked");
+    std::string block = response.buildHeaderBlock();
+    assert(block.find("transfer-encoding: chunked\r\n") != std::string::npos);
+    assert(block.substr(block.size() - 4) == "\r\n\r\n");
+    std::cout << "✅ streamed header block passed" << std::endl;
+}
+
+// X-Accel-Redirect always, X-Sendfile only when the location has a cgi_sendfile_root
+void test_offload() {
+    std::cout << "\nTesting X-Accel-Redirect / X-Sendfile..." << std::endl;
+    std::string target;
+    CGIResponse accel;
+    assert(accel.parseRawOutput("X-Accel-Redirect: /protected/a.iso\r\nContent-Type: application/x-iso9660-image\r\n\r\n"));
+    assert(accel.getOffload(false, target) == CGIResponse::OFFLOAD_ACCEL && target == "/protected/a.iso");
+
+    CGIResponse sendfile;
+    assert(sendfile.parseRawOutput("x-sendfile: /srv/files/a.iso\n\nignored body"));
+    assert(sendfile.getOffload(false, target) == CGIResponse::OFFLOAD_NONE);
+    assert(sendfile.getOffload(true, target) == CGIResponse::OFFLOAD_SENDFILE && target == "/srv/files/a.iso");
+    assert(sendfile.hasDefaultContentType() && !accel.hasDefaultContentType());
+
+    CGIResponse plain;
+    assert(plain.parseRawOutput("Content-Type: text/plain\n\nhello"));
+    assert(plain.getOffload(true, target) == CGIResponse::OFFLOAD_NONE);
+    std::cout << "✅ offload headers passed" << std::endl;
+}
+
+int main() {
+    std::cout << "=== CGI Response Tests ===\n" << std::endl;
+    test_find_header_end();
+    test_buffered_output();
+    test_header_block();
+    test_offload();
+    std::cout << "\n🎉 All CGI response tests passed!" << std::endl;
+    return 0;
+}
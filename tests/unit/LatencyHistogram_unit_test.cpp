@@ -0,0 +1,102 @@
+#include "../../src/utils/latency_histogram.hpp"
+#include <cassert>
+#include <iostream>
+
+// every value lands in a bucket whose bounds hold it, within 1/SUB_BUCKETS
+void test_buckets() {
+    std::cout << "Testing bucket layout..." << std::endl;
+    for (long long v = 0; v < LatencyHistogram::SUB_BUCKETS * 2; ++v)
+        assert(LatencyHistogram::bucketUpperBound(LatencyHistogram::bucketIndex(v)) == v);
+
+    long long samples[] = { 33, 100, 1000, 4095, 4096, 123456, 9999999, LatencyHistogram::MAX_US };
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); ++i) {
+        long long v = samples[i];
+        size_t index = LatencyHistogram::bucketIndex(v);
+        assert(index < LatencyHistogram::BUCKETS);
+        long long upper = LatencyHistogram::bucketUpperBound(index);
+        assert(upper >= v);
+        assert(upper - v <= v / LatencyHistogram::SUB_BUCKETS);
+        if (index > 0)
+            assert(LatencyHistogram::bucketUpperBound(index - 1) < v);
+    }
+    assert(LatencyHistogram::bucketIndex(LatencyHistogram::MAX_US * 4) == LatencyHistogram::BUCKETS - 1);
+    assert(LatencyHistogram::bucketIndex(-5) == 0);
+    std::cout << "✅ bucket layout passed" << std::endl;
+}
+
+void test_percentiles() {
+    std::cout << "\nTesting percentiles..." << std::endl;
+    LatencyHistogram h;
+    assert(h.count() == 0 && h.percentile(50) == 0);
+    for (long long v = 1; v <= 1000; ++v)
+        h.record(v);
+    assert(h.count() == 1000);
+    assert(h.sumUs() == 500500);
+    assert(h.maxUs() == 1000);
+    long long p50 = h.percentile(50);
+    long long p99 = h.percentile(99);
+    assert(p50 >= 500 && p50 <= 500 + 500 / LatencyHistogram::SUB_BUCKETS);
+    assert(p99 >= 990 && p99 <= 1000);
+    assert(h.percentile(100) == 1000); // capped to the exact max
+
+    LatencyHistogram other, merged;
+    other.record(5000);
+    merged.merge(h);
+    merged.merge(other);
+    merged.merge(LatencyHistogram());
+    assert(merged.count() == 1001 && merged.sumUs() == 505500 && merged.maxUs() == 5000);
+    assert(merged.percentile(50) == p50 && merged.percentile(100) == 5000);
+    std::cout << "✅ percentiles passed" << std::endl;
+}
+
+// phases come from the timestamps that were reached
+void test_phases() {
+    std::cout << "\nTesting request phases..." << std::endl;
+    PhaseLatency latency;
+    RequestTiming t;
+    t.acceptedUs = 1000;
+    t.startUs = 1100;
+    t.headersUs = 1150;
+    t.completeUs = 1400;
+    t.parseUs = 12;
+    t.routeUs = 2;
+    t.buildUs = 30;
+    t.cgiStartUs = 1400;
+    t.readyUs = 9400;
+    latency.record(t, 9500);
+
+    assert(latency.phase(PHASE_FIRST_BYTE).maxUs() == 100);
+    assert(latency.phase(PHASE_HEADER).maxUs() == 50);
+    assert(latency.phase(PHASE_BODY).maxUs() == 250);
+    assert(latency.phase(PHASE_PARSE).maxUs() == 12);
+    assert(latency.phase(PHASE_ROUTE).maxUs() == 2);
+    assert(latency.phase(PHASE_CGI).maxUs() == 8000);
+    assert(latency.phase(PHASE_STATIC).count() == 0); // a CGI response isn't also a static one
+    assert(latency.phase(PHASE_SEND).maxUs() == 100);
+    assert(latency.phase(PHASE_TOTAL).maxUs() == 8400);
+
+    // keep-alive request: no accept time, a 400 never reaches routing
+    t.acceptedUs = 0;
+    t.reset();
+    t.startUs = 20000;
+    t.readyUs = 20000;
+    latency.record(t, 20010);
+    assert(latency.phase(PHASE_FIRST_BYTE).count() == 1);
+    assert(latency.phase(PHASE_ROUTE).count() == 1);
+    assert(latency.phase(PHASE_TOTAL).count() == 2);
+
+    // nothing received: not a request
+    t.reset();
+    latency.record(t, 30000);
+    assert(latency.phase(PHASE_TOTAL).count() == 2);
+    std::cout << "✅ request phases passed" << std::endl;
+}
+
+int main() {
+    std::cout << "=== Latency Histogram Tests ===\n" << std::endl;
+    test_buckets();
+    test_percentiles();
+    test_phases();
+    std::cout << "\n🎉 All latency histogram tests passed!" << std::endl;
+    return 0;
+}
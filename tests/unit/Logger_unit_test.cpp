@@ -0,0 +1,124 @@
+#include "../../src/utils/logger.hpp"
+#include "../../src/utils/access_log.hpp"
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+static std::string readFile(const char* path) {
+    std::ifstream file(path);
+    std::ostringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+// records survive the wrap point, a full ring refuses instead of overwriting
+void test_ring() {
+    std::cout << "Testing log ring..." << std::endl;
+    LogRing ring(4096);
+    char record[1000];
+    char out[2048];
+    LogSink sink;
+    size_t length;
+    for (int round = 0; round < 20; ++round) {
+        std::memset(record, 'a' + round % 26, sizeof(record));
+        assert(ring.push(round % 2 ? LOG_SINK_ACCESS : LOG_SINK_ERROR, record, sizeof(record)));
+        assert(ring.pop(sink, out, length, sizeof(out)));
+        assert(length == sizeof(record));
+        assert(sink == (round % 2 ? LOG_SINK_ACCESS : LOG_SINK_ERROR));
+        assert(std::memcmp(out, record, length) == 0);
+    }
+    assert(!ring.pop(sink, out, length, sizeof(out)));
+
+    int pushed = 0;
+    while (ring.push(LOG_SINK_ERROR, record, sizeof(record)))
+        ++pushed;
+    assert(pushed == 4); // 4 x (5 + 1000) fits in 4096, a fifth doesn't
+    assert(ring.pop(sink, out, length, sizeof(out)));
+    assert(ring.push(LOG_SINK_ERROR, record, sizeof(record)));
+    std::cout << "✅ log ring passed" << std::endl;
+}
+
+// leveled lines reach error_log, raw lines access_log, both through the writer thread
+void test_logger() {
+    std::cout << "\nTesting asynchronous logger..." << std::endl;
+    const char* errorPath = "/tmp/webserv_logger_test_error.log";
+    const char* accessPath = "/tmp/webserv_logger_test_access.log";
+    unlink(errorPath);
+    unlink(accessPath);
+
+    assert(Logger::start(errorPath, LOG_LEVEL_INFO, accessPath));
+    assert(Logger::accessEnabled());
+    int evaluated = 0;
+    LOG_DEBUG << "hidden " << ++evaluated;
+    LOG_INFO << "served " << 3 << " of " << 4ULL << " in " << 0.25;
+    LOG_ERROR << "broken fd=" << 7;
+    LOG_ACCESS << "GET / 200";
+    Logger::stop();
+    assert(evaluated == 0); // arguments of a disabled level aren't evaluated
+    assert(!Logger::accessEnabled());
+
+    std::string errors = readFile(errorPath);
+    assert(errors.find("[info] served 3 of 4 in 0.250\n") != std::string::npos);
+    assert(errors.find("[error] broken fd=7\n") != std::string::npos);
+    assert(errors.find("hidden") == std::string::npos);
+    assert(readFile(accessPath) == "GET / 200\n");
+    assert(Logger::dropped() == 0);
+
+    LogLevel level;
+    assert(Logger::parseLevel("warn", level) && level == LOG_LEVEL_WARN);
+    assert(!Logger::parseLevel("verbose", level));
+    unlink(errorPath);
+    unlink(accessPath);
+    std::cout << "✅ asynchronous logger passed" << std::endl;
+}
+
+void test_access_format() {
+    std::cout << "\nTesting access_log format..." << std::endl;
+    AccessLogFormat format;
+    std::string error;
+    assert(!format.compile("$remote_addr $nope", error));
+    assert(error == "unknown access_log variable $nope");
+    assert(format.compile("$remote_addr \"$request\" $status $bytes_sent $request_length"
+                          " $host $location $parse_time_us $cgi_time_us $request_time_us", error));
+
+    const char* accessPath = "/tmp/webserv_logger_test_format.log";
+    unlink(accessPath);
+    assert(Logger::start("stderr", LOG_LEVEL_INFO, accessPath));
+    std::string request = "GET /index.html HTTP/1.1\r\nHost: a\r\n\r\n";
+    std::string host = "example.com";
+    RequestTiming timing;
+    timing.startUs = 1000;
+    timing.parseUs = 12;
+    AccessLogEntry entry;
+    entry.remoteAddr = "127.0.0.1";
+    entry.request = request.c_str();
+    entry.requestLength = request.find("\r\n");
+    entry.host = &host;
+    entry.status = 200;
+    entry.bytesReceived = request.size();
+    entry.bytesSent = 512;
+    entry.timing = &timing;
+    entry.doneUs = 1750;
+    {
+        LogLine line(LOG_SINK_ACCESS);
+        format.render(entry, line);
+    }
+    Logger::stop();
+    assert(readFile(accessPath) ==
+           "127.0.0.1 \"GET /index.html HTTP/1.1\" 200 512 37 example.com - 12 - 750\n");
+    unlink(accessPath);
+    std::cout << "✅ access_log format passed" << std::endl;
+}
+
+int main() {
+    std::cout << "=== Logger Tests ===\n" << std::endl;
+    test_ring();
+    test_logger();
+    test_access_format();
+    std::cout << "\n🎉 All logger tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include "../../src/http/mime_types.hpp"
+#include "../../src/configparser/configparser.hpp"
+#include <cassert>
+#include <iostream>
+
+// Built-in table, no config
+void test_defaults() {
+    std::cout << "Testing built-in MIME types..." << std::endl;
+    std::map<std::string, std::string> none;
+    MimeTypes::configure(none);
+
+    assert(MimeTypes::lookup("./www/html/index.html") == "text/html; charset=UTF-8");
+    assert(MimeTypes::lookup("/img/LOGO.PNG") == "image/png");
+    assert(MimeTypes::lookup("/fonts/a.woff2") == "font/woff2");
+    assert(MimeTypes::lookup("/app.wasm") == "application/wasm");
+    assert(MimeTypes::lookup("/unknown.xyz") == "application/octet-stream");
+    assert(MimeTypes::lookup("./www.d/README") == "application/octet-stream"); // dot only in dir name
+    assert(MimeTypes::lookup("") == "text/html; charset=UTF-8");
+    std::cout << "✅ Built-in MIME types passed" << std::endl;
+}
+
+// types {} block overrides & extends the defaults
+void test_types_block() {
+    std::cout << "\nTesting types block..." << std::endl;
+    ConfigParser parser;
+    Config config;
+    std::string conf =
+        "types {\n"
+        "    text/x-custom   cst;\n"
+        "    \"text/plain; charset=ISO-8859-1\" txt;\n"
+        "    video/3gpp      3gp 3gpp;\n"
+        "}\n"
+        "server { listen 8080; }\n";
+
+    assert(parser.parseString(conf, config) == true);
+    assert(config.mimeTypes.size() == 4);
+    MimeTypes::configure(config.mimeTypes);
+
+    assert(MimeTypes::lookup("a.cst") == "text/x-custom");
+    assert(MimeTypes::lookup("a.TXT") == "text/plain; charset=ISO-8859-1");
+    assert(MimeTypes::lookup("clip.3gp") == "video/3gpp");
+    assert(MimeTypes::lookup("page.htm") == "text/html; charset=UTF-8"); // default kept
+    std::cout << "✅ types block passed" << std::endl;
+}
+
+// include of a missing file fails the parse
+void test_include_missing() {
+    std::cout << "\nTesting include of missing file..." << std::endl;
+    ConfigParser parser;
+    Config config;
+    assert(parser.parseString("include does_not_exist.types;\nserver { listen 8080; }\n", config) == false);
+    std::cout << "✅ include error passed" << std::endl;
+}
+
+int main() {
+    std::cout << "=== MIME Type Registry Tests ===\n" << std::endl;
+    test_defaults();
+    test_types_block();
+    test_include_missing();
+    std::cout << "\n🎉 All MIME type tests passed!" << std::endl;
+    return 0;
+}
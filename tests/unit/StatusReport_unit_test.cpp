@@ -0,0 +1,101 @@
+#include "../../src/utils/status_report.hpp"
+#include "../../src/utils/server_stats.hpp"
+#include <cassert>
+#include <iostream>
+#include <string>
+
+static bool contains(const std::string& haystack, const std::string& needle) {
+    return haystack.find(needle) != std::string::npos;
+}
+
+static StatusSnapshot sampleSnapshot() {
+    StatusSnapshot snapshot;
+    snapshot.active = 4;
+    snapshot.reading = 1;
+    snapshot.writing = 2;
+    snapshot.waiting = 1;
+    snapshot.cacheHits = 3;
+    snapshot.cacheStaleHits = 1;
+    snapshot.cacheMisses = 4;
+    return snapshot;
+}
+
+// status codes outside 100-599 are kept apart instead of indexing out of range
+void test_count_response() {
+    std::cout << "Testing response counters..." << std::endl;
+    ServerStats::countResponse(200);
+    ServerStats::countResponse(200);
+    ServerStats::countResponse(404);
+    ServerStats::countResponse(0);
+    ServerStats::countResponse(1000);
+    assert(ServerStats::http.requests == 5);
+    assert(ServerStats::http.status[200] == 2);
+    assert(ServerStats::http.status[404] == 1);
+    assert(ServerStats::http.status[0] == 2);
+    std::cout << "✅ response counters passed" << std::endl;
+}
+
+void test_count_iteration() {
+    std::cout << "\nTesting event loop timing..." << std::endl;
+    ServerStats::countIteration(100);
+    ServerStats::countIteration(300);
+    assert(ServerStats::loop.iterations == 2);
+    assert(ServerStats::loop.busyUsTotal == 400);
+    assert(ServerStats::loop.busyUsMax == 300);
+    std::cout << "✅ event loop timing passed" << std::endl;
+}
+
+void test_count_spawn() {
+    std::cout << "\nTesting CGI spawn timing..." << std::endl;
+    ServerStats::countSpawn(500);
+    ServerStats::countSpawn(1500);
+    assert(ServerStats::cgi.spawns == 2);
+    assert(ServerStats::cgi.spawnUsTotal == 2000);
+    assert(ServerStats::cgi.spawnUsMax == 1500);
+    std::cout << "✅ CGI spawn timing passed" << std::endl;
+}
+
+// the first lines keep the nginx stub_status layout
+void test_text() {
+    std::cout << "\nTesting text format..." << std::endl;
+    ServerStats::http.accepted = 7;
+    ServerStats::http.handled = 7;
+    ServerStats::loop.startedMs = 1000;
+    std::string text = StatusReport::text(sampleSnapshot(), 3500);
+    assert(text.compare(0, 22, "Active connections: 4 ") == 0);
+    assert(contains(text, "server accepts handled requests\n 7 7 5 \n"));
+    assert(contains(text, "Reading: 1 Writing: 2 Waiting: 1 \n"));
+    assert(contains(text, "Uptime: 2.500 s\n"));
+    assert(contains(text, "Responses: 0=2 200=2 404=1\n"));
+    assert(contains(text, "hit_ratio 0.500"));
+    assert(contains(text, "busy_avg_us 200 busy_max_us 300"));
+    assert(contains(text, "CGI spawns: 2 spawn_avg_us 1000 spawn_max_us 1500"));
+    std::cout << "✅ text format passed" << std::endl;
+}
+
+void test_prometheus() {
+    std::cout << "\nTesting Prometheus format..." << std::endl;
+    std::string prom = StatusReport::prometheus(sampleSnapshot(), 3500);
+    assert(contains(prom, "# TYPE webserv_connections gauge\n"));
+    assert(contains(prom, "webserv_connections{state=\"writing\"} 2\n"));
+    assert(contains(prom, "webserv_responses_total{code=\"404\"} 1\n"));
+    assert(contains(prom, "webserv_cgi_cache_lookups_total{result=\"stale\"} 1\n"));
+    assert(contains(prom, "webserv_cgi_cache_hit_ratio 0.500000\n"));
+    assert(contains(prom, "webserv_event_loop_busy_seconds_total 0.000400\n"));
+    assert(contains(prom, "webserv_cgi_spawn_seconds_total 0.002000\n"));
+    assert(contains(prom, "webserv_cgi_pipe_bytes_total{direction=\"out\"} 0\n"));
+    // the exposition format requires a final line feed
+    assert(prom[prom.size() - 1] == '\n');
+    std::cout << "✅ Prometheus format passed" << std::endl;
+}
+
+int main() {
+    std::cout << "=== Status Report Tests ===\n" << std::endl;
+    test_count_response();
+    test_count_iteration();
+    test_count_spawn();
+    test_text();
+    test_prometheus();
+    std::cout << "\n🎉 All status report tests passed!" << std::endl;
+    return 0;
+}
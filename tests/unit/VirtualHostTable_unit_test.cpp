@@ -0,0 +1,80 @@
+#include "../../src/configparser/virtual_host_table.hpp"
+#include <cassert>
+#include <iostream>
+
+// the table only stores the pointers, distinct addresses are enough
+static char slots[8];
+static ServerInstance* srv(int i) { return reinterpret_cast<ServerInstance*>(&slots[i]); }
+
+static std::vector<std::string> names(const char* a, const char* b = NULL) {
+    std::vector<std::string> v;
+    v.push_back(a);
+    if (b)
+        v.push_back(b);
+    return v;
+}
+
+// exact > *.suffix > prefix.* > default
+void test_precedence() {
+    std::cout << "Testing server_name precedence..." << std::endl;
+    VirtualHostTable table;
+    table.add(srv(0), names("first.test"));
+    table.add(srv(1), names("example.com", "www.example.com"));
+    table.add(srv(2), names("*.example.com"));
+    table.add(srv(3), names("*.api.example.com"));
+    table.add(srv(4), names("www.*"));
+    table.add(srv(5), std::vector<std::string>());     // catch-all default
+
+    assert(table.lookup("example.com") == srv(1));
+    assert(table.lookup("www.example.com") == srv(1));  // exact beats both wildcards
+    assert(table.lookup("img.example.com") == srv(2));
+    assert(table.lookup("a.b.example.com") == srv(2));
+    assert(table.lookup("v1.api.example.com") == srv(3)); // longest suffix
+    assert(table.lookup("www.other.org") == srv(4));
+    assert(table.lookup("nothing.org") == srv(5));
+    assert(table.lookup("") == srv(5));
+    assert(table.defaultServer() == srv(5));
+    std::cout << "✅ precedence passed" << std::endl;
+}
+
+// Host header forms: port, case, trailing dot, IPv6 literal
+void test_host_forms() {
+    std::cout << "\nTesting Host header normalisation..." << std::endl;
+    VirtualHostTable table;
+    table.add(srv(0), names("default.test"));
+    table.add(srv(1), names("Example.COM"));
+    table.add(srv(2), names("[::1]"));
+
+    assert(table.lookup("example.com:8080") == srv(1));
+    assert(table.lookup("EXAMPLE.com") == srv(1));
+    assert(table.lookup("example.com.") == srv(1));
+    assert(table.lookup("example.com.:80") == srv(1));
+    assert(table.lookup("[::1]:8080") == srv(2));
+    assert(table.lookup("example.co") == srv(0));     // no catch-all: first server
+    std::cout << "✅ Host header forms passed" << std::endl;
+}
+
+// "_" is a catch-all, ".example.com" covers the bare name too, first server keeps a duplicate name
+void test_special_names() {
+    std::cout << "\nTesting special server names..." << std::endl;
+    VirtualHostTable table;
+    table.add(srv(0), names("a.test"));
+    table.add(srv(1), names("_"));
+    table.add(srv(2), names(".example.com"));
+    table.add(srv(3), names("a.test"));
+
+    assert(table.lookup("a.test") == srv(0));
+    assert(table.lookup("example.com") == srv(2));
+    assert(table.lookup("x.example.com") == srv(2));
+    assert(table.lookup("unknown") == srv(1));
+    std::cout << "✅ special names passed" << std::endl;
+}
+
+int main() {
+    std::cout << "=== Virtual Host Table Tests ===\n" << std::endl;
+    test_precedence();
+    test_host_forms();
+    test_special_names();
+    std::cout << "\n🎉 All virtual host tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,9 @@
+<?php
+// CGI基准测试负载（tests/bench/load/cgi_bench）
+// 读完整个请求body，返回 ?bytes=N 字节的body（默认1024）
+file_get_contents("php://input");
+
+$size = isset($_GET["bytes"]) ? intval($_GET["bytes"]) : 1024;
+header("Content-Type: text/plain");
+header("Content-Length: " . $size);
+echo str_repeat("x", $size);
@@ -0,0 +1,24 @@
+#!/usr/bin/env python3
+"""
+CGI基准测试负载（tests/bench/load/cgi_bench）
+读完整个请求body，返回 ?bytes=N 字节的body（默认1024）
+"""
+import os
+import sys
+from urllib.parse import parse_qs
+
+length = int(os.environ.get("CONTENT_LENGTH") or 0)
+while length > 0:
+    chunk = sys.stdin.buffer.read(min(length, 65536))
+    if not chunk:
+        break
+    length -= len(chunk)
+
+size = int(parse_qs(os.environ.get("QUERY_STRING", "")).get("bytes", ["1024"])[0])
+out = sys.stdout.buffer
+out.write(b"Content-Type: text/plain\r\nContent-Length: %d\r\n\r\n" % size)
+block = b"x" * 65536
+while size > 0:
+    out.write(block[:min(size, len(block))])
+    size -= len(block)
+out.flush()
@@ -0,0 +1,13 @@
+#!/bin/bash
+# CGI基准测试负载（tests/bench/load/cgi_bench）
+# 读完整个请求body，返回 ?bytes=N 字节的body（默认1024）
+
+head -c "${CONTENT_LENGTH:-0}" > /dev/null
+
+SIZE=1024
+case "$QUERY_STRING" in
+    *bytes=*) SIZE=${QUERY_STRING##*bytes=}; SIZE=${SIZE%%&*} ;;
+esac
+
+printf 'Content-Type: text/plain\r\nContent-Length: %d\r\n\r\n' "$SIZE"
+head -c "$SIZE" /dev/zero | tr '\0' 'x'